@@ -33,6 +33,15 @@ FILE *scrub_file = NULL;
 char *scrub_string = NULL;
 char *scrub_last_string = NULL;
 
+/*
+ * When the input file is memory mapped do_scrub_next_char() is called with a
+ * NULL FILE pointer and reads from scrub_input up to scrub_input_end instead.
+ * The mapping must be writable (private) as characters are pushed back into
+ * the bytes already read just like ungetc(3).
+ */
+char *scrub_input = NULL;
+char *scrub_input_end = NULL;
+
 #ifdef NeXT_MOD	/* .include feature */
 /* These are moved out of do_scrub() so save_scrub_context() can save them */
 static int state;
@@ -54,11 +63,15 @@ static char	symbol_chars[] =
 #define LEX_IS_LINE_SEPERATOR		(4)
 #define LEX_IS_COMMENT_START		(8)	/* JF added these two */
 #define LEX_IS_LINE_COMMENT_START	(16)
+#define LEX_IS_SCRUB_STOP		(32)	/* ends a run in states 2,3,9 */
+#define LEX_IS_STRING_STOP		(64)	/* ends a run in state 5 */
 #define IS_SYMBOL_COMPONENT(c)		(lex [c] & LEX_IS_SYMBOL_COMPONENT)
 #define IS_WHITESPACE(c)		(lex [c] & LEX_IS_WHITESPACE)
 #define IS_LINE_SEPERATOR(c)		(lex [c] & LEX_IS_LINE_SEPERATOR)
 #define IS_COMMENT(c)			(lex [c] & LEX_IS_COMMENT_START)
 #define IS_LINE_COMMENT(c)		(lex [c] & LEX_IS_LINE_COMMENT_START)
+#define IS_SCRUB_STOP(c)		(lex [c] & LEX_IS_SCRUB_STOP)
+#define IS_STRING_STOP(c)		(lex [c] & LEX_IS_STRING_STOP)
 
 void
 do_scrub_begin(
@@ -102,6 +115,82 @@ void)
 		lex[(int)*q] |= LEX_IS_COMMENT_START;
 	for (q=md_line_comment_chars;*q;q++)
 		lex[(int)*q] |= LEX_IS_LINE_COMMENT_START;
+
+	/*
+	 * The characters that do_scrub_next_char() treats specially in the
+	 * states 2, 3 and 9 (after the first non-white character on a line).
+	 * All other characters are passed through unchanged in those states
+	 * so do_scrub_buffer() can copy runs of them in bulk.
+	 */
+	lex [' ']		|= LEX_IS_SCRUB_STOP;
+	lex ['\t']		|= LEX_IS_SCRUB_STOP;
+	lex ['/']		|= LEX_IS_SCRUB_STOP;
+	lex ['"']		|= LEX_IS_SCRUB_STOP;
+	lex ['\'']		|= LEX_IS_SCRUB_STOP;
+	lex [':']		|= LEX_IS_SCRUB_STOP;
+	lex ['\n']		|= LEX_IS_SCRUB_STOP;
+#if defined(M88K) || defined(PPC) || defined(HPPA)
+	lex ['@']		|= LEX_IS_SCRUB_STOP;
+#else
+	lex [';']		|= LEX_IS_SCRUB_STOP;
+#endif
+	for (q=md_comment_chars;*q;q++)
+		lex[(int)*q] |= LEX_IS_SCRUB_STOP;
+
+	/* Likewise for the characters that are special in a string. */
+	lex ['"']		|= LEX_IS_STRING_STOP;
+	lex ['\\']		|= LEX_IS_STRING_STOP;
+#ifdef PPC
+	if(flagseen[(int)'p'] == TRUE)
+	    lex ['\'']		|= LEX_IS_STRING_STOP;
+#endif /* PPC */
+}
+
+static inline int
+scrub_getc(
+FILE *fp)
+{
+	if(fp != NULL)
+		return getc_unlocked(fp);
+	return scrub_input == scrub_input_end ?
+	       EOF : (unsigned char)*scrub_input++;
+}
+
+static inline void
+scrub_ungetc(
+int ch,
+FILE *fp)
+{
+	if(fp != NULL)
+		ungetc(ch, fp);
+	else if(ch != EOF)
+		*--scrub_input = ch;
+}
+
+/*
+ * scrub_skip_line() discards characters up to and including the next newline
+ * and returns the last character read, '\n' or EOF.  For mapped input this is
+ * done with memchr(3).
+ */
+static inline int
+scrub_skip_line(
+FILE *fp)
+{
+    int ch;
+    char *p;
+
+	if(fp != NULL){
+		do ch=getc_unlocked(fp);
+		while(ch!=EOF && ch!='\n');
+		return ch;
+	}
+	p = memchr(scrub_input, '\n', scrub_input_end - scrub_input);
+	if(p == NULL){
+		scrub_input = scrub_input_end;
+		return EOF;
+	}
+	scrub_input = p + 1;
+	return '\n';
 }
 
 static inline int
@@ -165,27 +254,27 @@ FILE *fp)
 	}
 	if(state==-2) {
 		for(;;) {
-			do ch=getc_unlocked(fp);
+			do ch=scrub_getc(fp);
 			while(ch!=EOF && ch!='\n' && ch!='*');
 			if(ch=='\n' || ch==EOF)
 				return ch;
-			 ch=getc_unlocked(fp);
+			 ch=scrub_getc(fp);
 			 if(ch==EOF || ch=='/')
 			 	break;
-			ungetc(ch, fp);
+			scrub_ungetc(ch, fp);
 		}
 		state=old_state;
 		return ' ';
 	}
 	if(state==4) {
-		ch=getc_unlocked(fp);
+		ch=scrub_getc(fp);
 		if(ch==EOF || (ch>='0' && ch<='9'))
 			return ch;
 		else {
 			while(ch!=EOF && IS_WHITESPACE(ch))
-				ch=getc_unlocked(fp);
+				ch=scrub_getc(fp);
 			if(ch=='"') {
-				ungetc(ch, fp);
+				scrub_ungetc(ch, fp);
 #if defined(M88K) || defined(PPC) || defined(HPPA)
 				out_string="@ .file ";
 #else
@@ -196,7 +285,7 @@ FILE *fp)
 				return *out_string++;
 			} else {
 				while(ch!=EOF && ch!='\n')
-					ch=getc_unlocked(fp);
+					ch=scrub_getc(fp);
 #ifdef NeXT_MOD
 				/* bug fix for bug #8918, which was when
 				 * a full line comment line this:
@@ -211,7 +300,7 @@ FILE *fp)
 		}
 	}
 	if(state==5) {
-		ch=getc_unlocked(fp);
+		ch=scrub_getc(fp);
 #ifdef PPC
 		if(flagseen[(int)'p'] == TRUE && ch=='\'') {
 			state=old_state;
@@ -226,7 +315,7 @@ FILE *fp)
 			return ch;
 		} else if(ch==EOF) {
  			state=old_state;
-			ungetc('\n', fp);
+			scrub_ungetc('\n', fp);
 #ifdef PPC
 			if(flagseen[(int)'p'] == TRUE){
 			    as_warn("End of file in string: inserted '\''");
@@ -241,13 +330,13 @@ FILE *fp)
 	}
 	if(state==6) {
 		state=5;
-		ch=getc_unlocked(fp);
+		ch=scrub_getc(fp);
 		switch(ch) {
 			/* This is neet.  Turn "string
 			   more string" into "string\n  more string"
 			 */
 		case '\n':
-			ungetc('n', fp);
+			scrub_ungetc('n', fp);
 			add_newlines++;
 			return '\\';
 
@@ -280,14 +369,14 @@ FILE *fp)
 	}
 
 	if(state==7) {
-		ch=getc_unlocked(fp);
+		ch=scrub_getc(fp);
 		state=5;
 		old_state=8;
 		return ch;
 	}
 
 	if(state==8) {
-		do ch= getc_unlocked(fp);
+		do ch= scrub_getc(fp);
 		while(ch!='\n');
 		state=0;
 #ifdef I386
@@ -297,19 +386,19 @@ FILE *fp)
 	}
 
  flushchar:
-	ch=getc_unlocked(fp);
+	ch=scrub_getc(fp);
 	switch(ch) {
 	case ' ':
 	case '\t':
-		do ch=getc_unlocked(fp);
+		do ch=scrub_getc(fp);
 		while(ch!=EOF && IS_WHITESPACE(ch));
 		if(ch==EOF)
 			return ch;
 		if(IS_COMMENT(ch) || (state==0 && IS_LINE_COMMENT(ch)) || ch=='/' || IS_LINE_SEPERATOR(ch)) {
-			ungetc(ch, fp);
+			scrub_ungetc(ch, fp);
 			goto flushchar;
 		}
-		ungetc(ch, fp);
+		scrub_ungetc(ch, fp);
 		if(state==0 || state==2) {
 #ifdef I386
 			if(state == 2){
@@ -337,45 +426,43 @@ FILE *fp)
 		goto flushchar;
 
 	case '/':
-		ch=getc_unlocked(fp);
+		ch=scrub_getc(fp);
 		if(ch=='*') {
 			for(;;) {
 				do {
-					ch=getc_unlocked(fp);
+					ch=scrub_getc(fp);
 					if(ch=='\n')
 						add_newlines++;
 				} while(ch!=EOF && ch!='*');
-				ch=getc_unlocked(fp);
+				ch=scrub_getc(fp);
 				if(ch==EOF || ch=='/')
 					break;
-				ungetc(ch, fp);
+				scrub_ungetc(ch, fp);
 			}
 			if(ch==EOF)
 				as_warn("End of file in '/' '*' string: */ inserted");
 
-			ungetc(' ', fp);
+			scrub_ungetc(' ', fp);
 			goto flushchar;
 		} else {
 #if defined(I860) || defined(M88K) || defined(PPC) || defined(I386) || \
     defined(HPPA) || defined (SPARC)
 		  if (ch == '/') {
-		    do {
-		      ch=getc_unlocked(fp);
-		    } while (ch != EOF && (ch != '\n'));
+		    ch=scrub_skip_line(fp);
 		    if (ch == EOF)
 		      as_warn("End of file before newline in // comment");
 		    if ( ch == '\n' )	/* Push NL back so we can complete state */
-		    	ungetc(ch, fp);
+		    	scrub_ungetc(ch, fp);
 		    goto flushchar;
 		  }
 #endif
 			if(IS_COMMENT('/') || (state==0 && IS_LINE_COMMENT('/'))) {
-				ungetc(ch, fp);
+				scrub_ungetc(ch, fp);
 				ch='/';
 				goto deal_misc;
 			}
 			if(ch!=EOF)
-				ungetc(ch, fp);
+				scrub_ungetc(ch, fp);
 			return '/';
 		}
 		break;
@@ -395,7 +482,7 @@ FILE *fp)
 			break;
 		}
 #endif
-		ch=getc_unlocked(fp);
+		ch=scrub_getc(fp);
 		if(ch==EOF) {
 			as_warn("End-of-file after a ': \\000 inserted");
 			ch=0;
@@ -418,7 +505,7 @@ FILE *fp)
 	case '\n':
 		if(add_newlines) {
 			--add_newlines;
-			ungetc(ch, fp);
+			scrub_ungetc(ch, fp);
 		}
 	/* Fall through.  */
 #if defined(M88K) || defined(PPC) || defined(HPPA)
@@ -442,7 +529,7 @@ FILE *fp)
 			/* This is a symbol character following another symbol
 			   character, with whitespace in between.  We skipped
 			   the whitespace earlier, so output it now.  */
-			ungetc(ch, fp);
+			scrub_ungetc(ch, fp);
 			state = 3;
 			ch = ' ';
 			return ch;
@@ -462,17 +549,15 @@ FILE *fp)
 		  state = 3;
 
 		if(state==0 && IS_LINE_COMMENT(ch)) {
-			do ch=getc_unlocked(fp);
+			do ch=scrub_getc(fp);
 			while(ch!=EOF && IS_WHITESPACE(ch));
 			if(ch==EOF) {
 				as_warn("EOF in comment:  Newline inserted");
 				return '\n';
 			}
 			if(ch<'0' || ch>'9') {
-				if(ch!='\n'){
-					do ch=getc_unlocked(fp);
-					while(ch!=EOF && ch!='\n');
-				}
+				if(ch!='\n')
+					ch=scrub_skip_line(fp);
 				if(ch==EOF)
 					as_warn("EOF in Comment: Newline inserted");
 				state=0;
@@ -481,15 +566,14 @@ FILE *fp)
 #endif
 				return '\n';
 			}
-			ungetc(ch, fp);
+			scrub_ungetc(ch, fp);
 			old_state=4;
 			state= -1;
 			out_string=".line ";
 			return *out_string++;
 
 		} else if(IS_COMMENT(ch)) {
-			do ch=getc_unlocked(fp);
-			while(ch!=EOF && ch!='\n');
+			ch=scrub_skip_line(fp);
 			if(ch==EOF)
 				as_warn("EOF in comment:  Newline inserted");
 			state=0;
@@ -516,6 +600,60 @@ FILE *fp)
 	return -1;
 }
 
+/*
+ * do_scrub_buffer() fills the buffer "to" with up to "size" sanitised
+ * characters from the mapped input (scrub_input to scrub_input_end) and
+ * returns the number of characters stored, zero at end of file.  The output is
+ * exactly what repeated calls to do_scrub_next_char(NULL) produce, but runs of
+ * characters that pass through the state machine unchanged are copied in bulk
+ * rather than one call per character.
+ */
+int
+do_scrub_buffer(
+char *to,
+int size)
+{
+    char *p, *end, *run, *limit;
+    int ch, n;
+
+	p = to;
+	end = to + size;
+	while(p < end){
+	    if(state == 2 || state == 3 || state == 9 || state == 5){
+		run = scrub_input;
+		limit = scrub_input + (end - p);
+		if(limit > scrub_input_end)
+		    limit = scrub_input_end;
+		if(state == 5){
+		    while(run < limit && !IS_STRING_STOP((unsigned char)*run))
+			run++;
+		}
+		else{
+		    while(run < limit && !IS_SCRUB_STOP((unsigned char)*run))
+			run++;
+		}
+		if(run != scrub_input){
+		    n = run - scrub_input;
+		    memcpy(p, scrub_input, n);
+		    p += n;
+		    scrub_input = run;
+		    /*
+		     * In states 3 and 9 a symbol character moves to state 9 and
+		     * any other character moves to state 3.
+		     */
+		    if(state == 3 || state == 9)
+			state = IS_SYMBOL_COMPONENT((unsigned char)run[-1]) ? 9 : 3;
+		    continue;
+		}
+	    }
+	    ch = do_scrub_next_char(NULL);
+	    if(ch == EOF)
+		break;
+	    *p++ = ch;
+	}
+	return(p - to);
+}
+
 int
 do_scrub_next_char_from_string()
 {
@@ -866,6 +1004,8 @@ save_scrub_context(
 scrub_context_data *save_buffer_ptr)
 {
 	save_buffer_ptr->last_scrub_file = scrub_file;
+	save_buffer_ptr->last_scrub_input = scrub_input;
+	save_buffer_ptr->last_scrub_input_end = scrub_input_end;
 	save_buffer_ptr->last_state = state;
 	save_buffer_ptr->last_old_state = old_state;
 	save_buffer_ptr->last_out_string = out_string;
@@ -884,6 +1024,8 @@ restore_scrub_context(
 scrub_context_data *save_buffer_ptr)
 {
 	scrub_file = save_buffer_ptr->last_scrub_file;
+	scrub_input = save_buffer_ptr->last_scrub_input;
+	scrub_input_end = save_buffer_ptr->last_scrub_input_end;
 	state = save_buffer_ptr->last_state;
 	old_state = save_buffer_ptr->last_old_state;
 	out_string = save_buffer_ptr->last_out_string;
@@ -894,6 +1036,8 @@ scrub_context_data *save_buffer_ptr)
 
 #ifdef TEST
 #include <stdarg.h>
+#include <stdlib.h>
+#include <sys/time.h>
 
 const char md_comment_chars[] = "|";
 const char md_line_comment_chars[] = "#";
@@ -903,17 +1047,104 @@ const char md_line_comment_chars[] = "#";
 char flagseen[128] = { 0 };
 #endif
 
+static double
+seconds(
+void)
+{
+    struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return(tv.tv_sec + tv.tv_usec / 1000000.0);
+}
+
+/*
+ * bench() scrubs the file both with do_scrub_next_char() reading through stdio
+ * and with do_scrub_buffer() from memory, checks that the output is the same
+ * and reports the throughput of each.
+ */
+static int
+bench(
+char *name)
+{
+    FILE *fp;
+    long size, old_size, new_size, n;
+    char *input, *old_out, *new_out;
+    int ch, differs;
+    double start, old_time, new_time;
+    scrub_context_data context;
+
+	if((fp = fopen(name, "r")) == NULL){
+	    perror(name);
+	    return(1);
+	}
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	rewind(fp);
+	input = malloc(size + 1);
+	/* a quoted character like 'a grows to (97) */
+	old_out = malloc(size * 3 + 64);
+	new_out = malloc(size * 3 + 64);
+	if(fread(input, 1, size, fp) != (size_t)size){
+	    perror(name);
+	    return(1);
+	}
+
+	rewind(fp);
+	save_scrub_context(&context);
+	start = seconds();
+	old_size = 0;
+	while((ch = do_scrub_next_char(fp)) != EOF)
+	    old_out[old_size++] = ch;
+	old_time = seconds() - start;
+	fclose(fp);
+
+	save_scrub_context(&context);
+	scrub_input = input;
+	scrub_input_end = input + size;
+	start = seconds();
+	new_size = 0;
+	while((n = do_scrub_buffer(new_out + new_size, 64 * 1024)) != 0)
+	    new_size += n;
+	new_time = seconds() - start;
+
+	differs = old_size != new_size ||
+		  memcmp(old_out, new_out, old_size) != 0;
+	printf("%s: %ld bytes, do_scrub_next_char %.1f MB/s, "
+	       "do_scrub_buffer %.1f MB/s%s\n", name, size,
+	       size / (old_time * 1024 * 1024), size / (new_time * 1024 * 1024),
+	       differs ? ", OUTPUT DIFFERS" : "");
+	free(input);
+	free(old_out);
+	free(new_out);
+	return(differs);
+}
+
+/*
+ * With no arguments the standard input is scrubbed to the standard output.
+ * With "-b file ..." each file is scrubbed both ways as a benchmark.
+ */
 int
 main(
 int argc,
 char *argv[],
 char *envp[])
 {
-    int ch;
+    int ch, i, errors;
 #ifdef PPC
-	if(argc > 1 && strncmp(argv[1], "-p", 2) == 0)
+	if(argc > 1 && strncmp(argv[1], "-p", 2) == 0){
 	    flagseen[(int)'p'] = TRUE;
+	    argc--;
+	    argv++;
+	}
 #endif
+	do_scrub_begin();
+
+	if(argc > 1 && strcmp(argv[1], "-b") == 0){
+	    errors = 0;
+	    for(i = 2; i < argc; i++)
+		errors |= bench(argv[i]);
+	    return(errors);
+	}
 
 	while((ch = do_scrub_next_char(stdin)) != EOF)
 	    putc(ch, stdout);
@@ -3,11 +3,16 @@
 extern FILE *scrub_file;
 extern char *scrub_string;
 extern char *scrub_last_string;
+extern char *scrub_input;
+extern char *scrub_input_end;
 
 extern void do_scrub_begin(
     void);
 extern int do_scrub_next_char(
     FILE *fp);
+extern int do_scrub_buffer(
+    char *to,
+    int size);
 extern int do_scrub_next_char_from_string();
 
 /*
@@ -16,6 +21,8 @@ extern int do_scrub_next_char_from_string();
  */
 typedef struct scrub_context_data {
     FILE *last_scrub_file;
+    char *last_scrub_input;
+    char *last_scrub_input_end;
     int last_state;
     int last_old_state;
     char *last_out_string;
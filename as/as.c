@@ -103,6 +103,9 @@ char *progname = NULL;
 /* non-NULL if AS_SECURE_LOG_FILE is set */
 const char *secure_log_file = NULL;
 
+/* TRUE if AS_STATS is set, print statistics about the assembly to stderr */
+int as_stats = 0;
+
 int
 main(
 int argc,
@@ -839,6 +842,12 @@ unknown_flag:
 	 */
 	secure_log_file = getenv("AS_SECURE_LOG_FILE");
 
+	/*
+	 * Test to see if the AS_STATS environment variable is set.
+	 */
+	if(getenv("AS_STATS") != NULL)
+	    as_stats = TRUE;
+
 	/*
 	 * Call the initialization routines.
 	 */
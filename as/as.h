@@ -217,6 +217,9 @@ extern struct directory_stack *include;
 /* non-NULL if AS_SECURE_LOG_FILE is set */
 extern const char *secure_log_file;
 
+/* TRUE if AS_STATS is set, print statistics about the assembly to stderr */
+extern int as_stats;
+
 #ifndef OCTETS_PER_BYTE_POWER
 #define OCTETS_PER_BYTE_POWER 0
 #endif
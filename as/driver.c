@@ -2,25 +2,57 @@
  * The assembler driver as and runs the assembler for the "-arch <arch_flag>"
  * (if given) in ../libexec/as/<arch_flag>/as or
  * ../local/libexec/as/<arch_flag>/as.  Or runs the assembler for the host
- * architecture as returned by get_arch_from_host().  The driver only checks to
- * make sure their are not multiple arch_flags and then passes all flags to the
- * assembler it will run.
+ * architecture as returned by get_arch_from_host().  The driver passes all
+ * flags to the assembler it will run.  If more than one "-arch <arch_flag>" is
+ * given the driver runs itself once for each arch_flag concurrently, each into
+ * a temporary object file, and then combines them into a fat output file.
  */
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
 #include "libc.h"
 #include <sys/file.h>
+#include <sys/wait.h>
+#include <errno.h>
 #include <mach/mach.h>
 #include "stuff/arch.h"
 #include "stuff/errors.h"
 #include "stuff/execute.h"
 #include "stuff/allocate.h"
+#include "stuff/breakout.h"
 #include <mach-o/dyld.h>
 
+#define MAXSECTALIGN		15 /* 2**15 or 0x8000 */
+
 /* used by error calls (exported) */
 char *progname = NULL;
 
+static void assemble_archs(
+    char *driver,
+    int argc,
+    char **argv,
+    char *skip_args,
+    char **arch_names,
+    uint32_t narch_names,
+    char *output,
+    uint32_t verbose);
+static void assemble_archs_cleanup(
+    void);
+static uint32_t get_align(
+    struct object *object);
+
+/*
+ * The children started by assemble_archs() that have not been waited for and
+ * the temporary files created for them.  If this process exits before they are
+ * all done, as with a fatal error, assemble_archs_cleanup() waits for the
+ * children and removes the files.
+ */
+static int *assemble_pids = NULL;
+static uint32_t assemble_npids = 0;
+static char **assemble_temp_names = NULL;
+static uint32_t assemble_ntemp_names = 0;
+static pid_t assemble_parent = 0;
+
 int
 main(
 int argc,
@@ -32,21 +64,29 @@ char **envp)
     const char *AS = "/as";
 
     int i, j;
-    uint32_t count, verbose, run_clang;
-    char *p, c, *arch_name, *as, *as_local;
-    char **new_argv;
+    uint32_t count, verbose, run_clang, narch_names;
+    char *p, c, *arch_name, *as, *as_local, *driver, *output, *skip_args;
+    char **new_argv, **arch_names;
     const char *CLANG = "clang";
     char *prefix, buf[MAXPATHLEN], resolved_name[PATH_MAX];
     uint32_t bufsize;
     struct arch_flag arch_flag;
     const struct arch_flag *arch_flags, *family_arch_flag;
-    enum bool oflag_specified, qflag, Qflag, some_input_files;
+    enum bool oflag_specified, oflag_grouped, qflag, Qflag, some_input_files,
+	      stdin_input;
 
 	progname = argv[0];
 	arch_name = NULL;
+	arch_names = allocate(argc * sizeof(char *));
+	narch_names = 0;
+	skip_args = allocate(argc);
+	memset(skip_args, '\0', argc);
+	output = "a.out";
 	verbose = 0;
 	run_clang = 0;
 	oflag_specified = FALSE;
+	oflag_grouped = FALSE;
+	stdin_input = FALSE;
 	qflag = FALSE;
 	Qflag = FALSE;
 	some_input_files = FALSE;
@@ -63,6 +103,7 @@ char **envp)
 	prefix = realpath(p, resolved_name);
 	if(prefix == NULL)
 	    system_fatal("realpath(3) for %s failed", p);
+	driver = makestr(prefix, NULL);
 	p = rindex(prefix, '/');
 	if(p != NULL)
 	    p[1] = '\0';
@@ -85,8 +126,10 @@ char **envp)
 		/*
 		 * Treat a single "-" as reading from stdin input also.
 		 */
-		if(argv[i][1] == '\0')
+		if(argv[i][1] == '\0'){
 		    some_input_files = TRUE;
+		    stdin_input = TRUE;
+		}
 		/*
 		 * the assembler allows single letter flags to be grouped
 		 * together so "-abc" is the same as "-a -b -c".  So that
@@ -110,6 +153,21 @@ char **envp)
 		     */
 		    case 'o':	/* -o name */
 			oflag_specified = TRUE;
+			/*
+			 * Remember where the output name is so it can be
+			 * replaced for each arch if there is more than one.
+			 */
+			if(p == &(argv[i][1])){
+			    skip_args[i] = 1;
+			    if(p[1] != '\0')
+				output = p + 1;
+			    else if(i + 1 < argc){
+				skip_args[i + 1] = 1;
+				output = argv[i + 1];
+			    }
+			}
+			else
+			    oflag_grouped = TRUE;
 		    case 'I':	/* -I directory */
 		    case 'm':	/* -mc68000, -mc68010 and mc68020 */
 		    case 'N':	/* -NEXTSTEP-deployment-target */
@@ -151,10 +209,14 @@ char **envp)
 			if(strcmp(p, "arch") == 0){
 			    if(i + 1 >= argc)
 				fatal("missing argument to %s option", argv[i]);
-			    if(arch_name != NULL)
-				fatal("more than one %s option (not allowed, "
-				      "use cc(1) instead)", argv[i]);
+			    for(j = 0; j < narch_names; j++)
+				if(strcmp(arch_names[j], argv[i+1]) == 0)
+				    fatal("more than one %s %s option", argv[i],
+					  argv[i+1]);
 			    arch_name = argv[i+1];
+			    arch_names[narch_names++] = arch_name;
+			    skip_args[i] = 1;
+			    skip_args[i+1] = 1;
 			    p = " "; /* Finished with this arg. */
 			    i++;
 			    break;
@@ -185,9 +247,33 @@ char **envp)
 		    }
 		}
 	    }
-	    else{
+	    /*
+	     * A "--" is assembling from stdin.
+	     */
+	    else if(strcmp(argv[i], "--") == 0){
 		some_input_files = TRUE;
+		stdin_input = TRUE;
 	    }
+	    else
+		some_input_files = TRUE;
+	}
+
+	/*
+	 * If more than one -arch flag is given run an assembler for each of
+	 * them and combine the results into a fat file.
+	 */
+	if(narch_names > 1){
+	    if(some_input_files == FALSE || stdin_input == TRUE)
+		fatal("can't assemble standard input with more than one -arch "
+		      "option");
+	    if(oflag_grouped == TRUE)
+		fatal("-o can't be grouped with other flags with more than "
+		      "one -arch option");
+	    assemble_archs(driver, argc, argv, skip_args, arch_names,
+			   narch_names, output, verbose);
+	    if(errors)
+		exit(1);
+	    exit(0);
 	}
 
 	/*
@@ -424,3 +510,230 @@ char **envp)
 	    printf("%s: no assemblers installed\n", progname);
 	exit(1);
 }
+
+/*
+ * assemble_archs() runs the driver, driver, once for each of the narch_names
+ * arch_names concurrently with the arguments in argv that are not marked in
+ * skip_args plus "-arch <arch_name> -o <temporary file>".  When they all
+ * succeed the temporary object files are combined into the fat file output.
+ * The temporary files are always removed, and all the children waited for,
+ * before this process exits.
+ */
+static
+void
+assemble_archs(
+char *driver,
+int argc,
+char **argv,
+char *skip_args,
+char **arch_names,
+uint32_t narch_names,
+char *output,
+uint32_t verbose)
+{
+    int i, j, fd;
+    uint32_t k, l, narchs, nobject_archs;
+    int *pids;
+    char **new_argv, **temp_names;
+    struct arch *archs, *object_archs;
+    struct arch_flag arch_flag;
+    enum bool failed;
+
+	pids = allocate(narch_names * sizeof(int));
+	temp_names = allocate(narch_names * sizeof(char *));
+	assemble_pids = pids;
+	assemble_temp_names = temp_names;
+	assemble_parent = getpid();
+	atexit(assemble_archs_cleanup);
+	for(k = 0; k < narch_names; k++){
+	    temp_names[k] = makestr(output, ".", arch_names[k], ".XXXXXX",
+				    NULL);
+	    fd = mkstemp(temp_names[k]);
+	    if(fd == -1)
+		system_fatal("can't create temporary output file: %s",
+			     temp_names[k]);
+	    assemble_ntemp_names = k + 1;
+	    close(fd);
+
+	    new_argv = allocate((argc + 5) * sizeof(char *));
+	    new_argv[0] = driver;
+	    j = 1;
+	    for(i = 1; i < argc; i++){
+		if(skip_args[i] == 0){
+		    new_argv[j] = argv[i];
+		    j++;
+		}
+	    }
+	    new_argv[j++] = "-arch";
+	    new_argv[j++] = arch_names[k];
+	    new_argv[j++] = "-o";
+	    new_argv[j++] = temp_names[k];
+	    new_argv[j] = NULL;
+	    pids[k] = execute_start(new_argv, verbose);
+	    assemble_npids = k + 1;
+	    free(new_argv);
+	}
+
+	/*
+	 * Wait for all of them, even after one fails, so that no assembler
+	 * is left writing a temporary file when it is removed.
+	 */
+	failed = FALSE;
+	for(k = 0; k < narch_names; k++){
+	    if(execute_wait(pids[k], driver) == 0){
+		error("assembly for architecture %s failed", arch_names[k]);
+		failed = TRUE;
+	    }
+	    pids[k] = 0;
+	}
+
+	if(failed == FALSE){
+	    archs = NULL;
+	    narchs = 0;
+	    for(k = 0; k < narch_names && errors == 0; k++){
+		breakout(temp_names[k], &object_archs, &nobject_archs, FALSE);
+		if(errors)
+		    break;
+		archs = reallocate(archs,
+			       (narchs + nobject_archs) * sizeof(struct arch));
+		for(l = 0; l < nobject_archs; l++){
+		    if(object_archs[l].type != OFILE_Mach_O)
+			fatal("assembler for architecture %s did not produce "
+			      "an object file: %s", arch_names[k],
+			      temp_names[k]);
+		    /*
+		     * Each object must be for the arch it was assembled for
+		     * and can't be the same as one already seen.
+		     */
+		    if(get_arch_from_flag(arch_names[k], &arch_flag) != 0 &&
+		       arch_flag.cputype !=
+			   object_archs[l].object->mh_cputype)
+			fatal("assembler for architecture %s produced an object "
+			      "for a different architecture", arch_names[k]);
+		    for(i = 0; i < narchs; i++){
+			if(archs[i].fat_arch->cputype ==
+			       object_archs[l].object->mh_cputype &&
+			   (archs[i].fat_arch->cpusubtype & ~CPU_SUBTYPE_MASK) ==
+			       (object_archs[l].object->mh_cpusubtype &
+				~CPU_SUBTYPE_MASK))
+			    fatal("architecture %s is the same as an earlier "
+				  "-arch option", arch_names[k]);
+		    }
+		    archs[narchs] = object_archs[l];
+		    archs[narchs].fat_arch = allocate(sizeof(struct fat_arch));
+		    archs[narchs].fat_arch->cputype =
+			object_archs[l].object->mh_cputype;
+		    archs[narchs].fat_arch->cpusubtype =
+			object_archs[l].object->mh_cpusubtype;
+		    archs[narchs].fat_arch->offset = 0;
+		    archs[narchs].fat_arch->size = 0;
+		    archs[narchs].fat_arch->align =
+			get_align(object_archs[l].object);
+		    narchs++;
+		}
+	    }
+	    if(errors == 0)
+		writeout(archs, narchs, output, 0666, TRUE, FALSE, FALSE,
+			 FALSE, NULL);
+	}
+
+	assemble_archs_cleanup();
+}
+
+/*
+ * assemble_archs_cleanup() waits for the children started by assemble_archs()
+ * that have not been waited for and removes the temporary files created for
+ * them.  It is registered with atexit(3) so it is also done on a fatal error,
+ * and does nothing in a child that exits before it runs the assembler.
+ */
+static
+void
+assemble_archs_cleanup(
+void)
+{
+    uint32_t k;
+    int waitstatus;
+
+	if(getpid() != assemble_parent)
+	    return;
+	for(k = 0; k < assemble_npids; k++){
+	    if(assemble_pids[k] == 0)
+		continue;
+	    while(waitpid(assemble_pids[k], &waitstatus, 0) == -1 &&
+		  errno == EINTR)
+		;
+	    assemble_pids[k] = 0;
+	}
+	assemble_npids = 0;
+	for(k = 0; k < assemble_ntemp_names; k++)
+	    (void)unlink(assemble_temp_names[k]);
+	assemble_ntemp_names = 0;
+}
+
+/*
+ * get_align() returns the alignment, as a power of 2, of the object in a fat
+ * file.  This matches what lipo(1) would use for the same object file.
+ */
+static
+uint32_t
+get_align(
+struct object *object)
+{
+    uint32_t i, j, ncmds, align;
+    struct load_command *lc;
+    struct segment_command *sg;
+    struct segment_command_64 *sg64;
+    struct section *s;
+    struct section_64 *s64;
+
+	/*
+	 * As with lipo(1) special case the architectures where the kernel and
+	 * mmap only need file offsets to be page aligned.
+	 */
+	if(object->mh_cputype == CPU_TYPE_POWERPC ||
+	   object->mh_cputype == CPU_TYPE_POWERPC64 ||
+	   object->mh_cputype == CPU_TYPE_I386 ||
+	   object->mh_cputype == CPU_TYPE_X86_64)
+	    return(12);
+	if(object->mh_cputype == CPU_TYPE_ARM ||
+	   object->mh_cputype == CPU_TYPE_ARM64 ||
+	   object->mh_cputype == CPU_TYPE_ARM64_32)
+	    return(14);
+
+	/* this is the minimum alignment, then take largest section's */
+	if(object->mh != NULL){
+	    align = 2; /* 2^2 sizeof(uint32_t) */
+	    ncmds = object->mh->ncmds;
+	}
+	else{
+	    align = 3; /* 2^3 sizeof(uint64_t) */
+	    ncmds = object->mh64->ncmds;
+	}
+	lc = object->load_commands;
+	for(i = 0; i < ncmds; i++){
+	    if(lc->cmd == LC_SEGMENT){
+		sg = (struct segment_command *)lc;
+		s = (struct section *)((char *)sg +
+				       sizeof(struct segment_command));
+		for(j = 0; j < sg->nsects; j++){
+		    if(s->align > align)
+			align = s->align;
+		    s++;
+		}
+	    }
+	    else if(lc->cmd == LC_SEGMENT_64){
+		sg64 = (struct segment_command_64 *)lc;
+		s64 = (struct section_64 *)((char *)sg64 +
+					    sizeof(struct segment_command_64));
+		for(j = 0; j < sg64->nsects; j++){
+		    if(s64->align > align)
+			align = s64->align;
+		    s64++;
+		}
+	    }
+	    lc = (struct load_command *)((char *)lc + lc->cmdsize);
+	}
+	if(align > MAXSECTALIGN)
+	    align = MAXSECTALIGN;
+	return(align);
+}
@@ -40,6 +40,8 @@ fragS zero_address_frag = {
 	NULL,			/* fr_opcode */
 	rs_fill,		/* fr_type */
 	0,			/* fr_subtype */
+	NULL,			/* fr_data */
+	0,			/* fr_relax_index */
 #ifdef ARM
 	0			/* fr_literal [0] */
 #else
@@ -221,6 +223,29 @@ char *opcode)
     return (retval);
 }				/* frag_var() */
 
+/*
+ *			frag_mapped()
+ *
+ * Close off the current frag and add a frag of size fixed chars whose contents
+ * are at data, typically a mapped file for .incbin, instead of in the frags
+ * obstack.  The chars are not copied until the object file is written.  Then
+ * start a new frag after it.
+ */
+void
+frag_mapped(
+char *data,
+int32_t size)
+{
+    fragS *fragP;
+
+    frag_wane(frag_now);
+    frag_new(0);
+    fragP = frag_now;
+    fragP->fr_data = data;
+    frag_new(0);
+    fragP->fr_fix = size;
+}				/* frag_mapped() */
+
 /*
  *			frag_wane()
  *
@@ -57,6 +57,10 @@ struct frag			/* a code fragment */
     relax_stateT fr_type;	/* What state is my tail in? */
     relax_substateT fr_subtype;	/* Used to index in to md_relax_table for */
 				/*  fr_type == rs_machine_dependent frags. */
+    char *fr_data;		/* If not NULL the fr_fix chars are here and */
+				/* not in fr_literal (see frag_mapped()). */
+    uint64_t fr_relax_index;	/* Increasing along the frags of a section, */
+				/* set by relax_section(). */
 #ifdef ARM
     /* Where the frag was created, or where it became a variant frag.  */
     char *fr_file;
@@ -106,6 +110,9 @@ extern char *frag_var(
     symbolS *symbol,
     int32_t offset,
     char *opcode);
+extern void frag_mapped(
+    char *data,
+    int32_t size);
 extern void frag_wane(
     fragS *fragP);
 extern void frag_align(
@@ -31,6 +31,9 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 #include <string.h>
 #include <assert.h>
 #include <libc.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include "input-file.h"
 #include "xmalloc.h"
 #include "input-scrub.h"
@@ -67,6 +70,15 @@ static char in_buf[BUFFER_SIZE];
 FILE *f_in = NULL;	/* JF do things the RIGHT way */
 /* static JF remove static so app.c can use file_name */
 char *file_name = NULL;
+
+/*
+ * If the input file is a regular file it is also mapped and the characters are
+ * taken from the mapping (through app's scrub_input pointer) rather than from
+ * f_in.  f_in is still left open so the rest of the assembler, which tests it
+ * to see if a file is being read, is unchanged.
+ */
+char *f_in_map = NULL;
+unsigned long f_in_map_size = 0;
 
 /* These hooks accomodate most operating systems. */
 
@@ -106,6 +118,8 @@ int pre)
 {
 	int	c;
 	char	buf[80];
+	struct stat stat_buf;
+	char	*p, *q, *end;
 
 	preprocess = pre;
 
@@ -121,6 +135,54 @@ int pre)
 		as_perror ("Can't open source file for input", file_name);
 		return;
 	}
+	f_in_map = NULL;
+	f_in_map_size = 0;
+	if(fstat(fileno(f_in), &stat_buf) == 0 &&
+	   S_ISREG(stat_buf.st_mode) && stat_buf.st_size != 0){
+		/*
+		 * The mapping is private and writable as app pushes characters
+		 * back into it.  If it can't be mapped fall back to stdio.
+		 */
+		f_in_map = mmap(0, stat_buf.st_size, PROT_READ|PROT_WRITE,
+				MAP_PRIVATE, fileno(f_in), 0);
+		if(f_in_map == MAP_FAILED)
+			f_in_map = NULL;
+		else
+			f_in_map_size = stat_buf.st_size;
+	}
+	if(f_in_map != NULL) {
+		/*
+		 * The same checks for "#NO_APP" as below but on the mapped
+		 * file, leaving scrub_input where the stdio code would leave
+		 * the stream.
+		 */
+		p = f_in_map;
+		end = f_in_map + f_in_map_size;
+		if(*p == '#') {
+			p++;
+			if(p < end && *p == 'N') {
+				p++;
+				for(q = p; q < end && q - p < (int)sizeof(buf) - 1;)
+					if(*q++ == '\n')
+						break;
+				if(q - p == 6 && strncmp(p, "O_APP\n", 6) == 0)
+					preprocess=0;
+				if(q == p || q[-1] != '\n')
+					*--q = '#';	/* It was longer */
+				else
+					--q;
+				p = q;
+			} else if(p < end && *p == '\n')
+				;
+			else if(p < end)
+				*p = '#';
+			else
+				*--p = '#';
+		}
+		scrub_input = p;
+		scrub_input_end = end;
+		return;
+	}
 #ifdef NeXT_MOD	/* .include feature */
 	setbuffer(f_in, xmalloc(BUFFER_SIZE), BUFFER_SIZE);
 #else
@@ -163,7 +225,17 @@ int *give_next_size)
        * don't bother to synch output and input.
        */
   /* size = read (file_handle, where, BUFFER_SIZE); */
-  if(preprocess) {
+  if(f_in_map != NULL) {
+	if(preprocess)
+		size = do_scrub_buffer(where, BUFFER_SIZE);
+	else {
+		size = scrub_input_end - scrub_input;
+		if(size > BUFFER_SIZE)
+			size = BUFFER_SIZE;
+		memcpy(where, scrub_input, size);
+		scrub_input += size;
+	}
+  } else if(preprocess) {
 	char *p;
 	int n;
 	int ch;
@@ -189,10 +261,18 @@ int *give_next_size)
     {
 #ifdef NeXT_MOD	/* .include feature */
 #ifdef __OPENSTEP__
-      if(doing_include)
+      if(doing_include && f_in_map == NULL)
 	free (f_in->_base);
 #endif /* defined(__OPENSTEP__) */
 #endif /* NeXT_MOD .include feature */
+      if (f_in_map != NULL)
+	{
+	  munmap (f_in_map, f_in_map_size);
+	  f_in_map = NULL;
+	  f_in_map_size = 0;
+	  scrub_input = NULL;
+	  scrub_input_end = NULL;
+	}
       if (fclose (f_in))
 	as_perror ("Can't close source file -- continuing", file_name);
       f_in = (FILE *)0;
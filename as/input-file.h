@@ -49,6 +49,8 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
  * about I/O errors. No I/O errors are fatal: an end-of-file may be faked.
  */
 extern FILE *f_in;
+extern char *f_in_map;
+extern unsigned long f_in_map_size;
 extern char *file_name;
 
 #ifdef SUSPECT
@@ -479,6 +479,8 @@ char *no_path_name)
   char	   	      			* last_buffer_start;
   int					  last_doing_include;
   FILE	  	      			* last_f_in;
+  char					* last_f_in_map;
+  unsigned long				  last_f_in_map_size;
   char	  	      			* last_file_name;
   char		      			* last_input_line_pointer;
   char	   	      			* last_logical_input_file;
@@ -507,6 +509,8 @@ char *no_path_name)
   last_buffer_start = buffer_start;
   last_doing_include = doing_include;
   last_f_in = f_in;
+  last_f_in_map = f_in_map;
+  last_f_in_map_size = f_in_map_size;
   last_file_name = file_name;
   last_input_line_pointer = input_line_pointer;
   last_logical_input_file = logical_input_file;
@@ -536,6 +540,8 @@ char *no_path_name)
   buffer_start = last_buffer_start;
   doing_include = last_doing_include;
   f_in = last_f_in;
+  f_in_map = last_f_in_map;
+  f_in_map_size = last_f_in_map_size;
   file_name = last_file_name;
   input_line_pointer = last_input_line_pointer;
   logical_input_file = last_logical_input_file;
@@ -19,6 +19,7 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 #include "stuff/rnd.h"
 #include "as.h"
 #include "sections.h"
@@ -31,6 +32,7 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 #include "obstack.h"
 #include "input-scrub.h"
 #include "dwarf2dbg.h"
+#include "xmalloc.h"
 #if I386
 #include "i386.h"
 #endif
@@ -92,12 +94,43 @@ static int relax_section(
 static relax_addressT relax_align(
     relax_addressT address,
     uint32_t alignment);
+static int32_t relax_align_frag(
+    struct frag *fragP,
+    relax_addressT was_address,
+    relax_addressT address);
 #ifndef ARM
+static int32_t relax_md_frag(
+    struct frag *fragP,
+    int32_t aim);
+static void relax_frags_incremental(
+    struct frag *frag_root,
+    uint32_t nfrags,
+    relax_addressT end_address);
+static void relax_heap_push(
+    uint32_t *heap,
+    uint32_t *nheap,
+    uint32_t frag_index);
+static uint32_t relax_heap_pop(
+    uint32_t *heap,
+    uint32_t *nheap);
 static int is_down_range(
     struct frag *f1,
     struct frag *f2);
 #endif /* !defined(ARM) */
 
+/*
+ * The last fr_relax_index given to a frag by relax_section().  Each call
+ * numbers the frags of its section after all previously numbered frags so
+ * is_down_range() can compare indexes.
+ */
+static uint64_t relax_frag_index = 0;
+
+/* Statistics about relax_section() printed when AS_STATS is set */
+static uint32_t relax_stat_calls = 0;
+static uint32_t relax_stat_passes = 0;
+static uint64_t relax_stat_frags = 0;
+static double relax_stat_time = 0.0;
+
 /*
  * add_last_frags_to_sections() does what layout_addresses() does below about
  * adding a last ".fill 0" frag to each section.  This is called by
@@ -262,6 +295,11 @@ void)
 	    }
 	    while(changed != 0);
 	}
+	if(as_stats)
+	    fprintf(stderr, "as: relax_section: %u calls, %u passes, %llu frags "
+		    "visited, %.3f seconds\n", relax_stat_calls,
+		    relax_stat_passes, (unsigned long long)relax_stat_frags,
+		    relax_stat_time);
 
 	/*
 	 * Now set the absolute addresses of all frags by sliding the frags in
@@ -1086,10 +1124,6 @@ int nsect)
 		       doesn't fit anymore, we need another pass */
 
 #ifndef ARM
-    const relax_typeS *this_type;
-    const relax_typeS *start_type;
-    relax_substateT next_state;
-    relax_substateT this_state;
     int32_t aim;
 #endif /* !defined(ARM) */
 
@@ -1099,20 +1133,33 @@ int nsect)
     symbolS *symbolP;
     int32_t target;
     int32_t after;
-    uint32_t oldoff, newoff;
     int ret;
+    struct timeval start, end;
+#ifndef ARM
+    uint32_t nfrags;
+    int incremental;
+#endif /* !defined(ARM) */
 
 	ret = 0;
 	growth = 0;
+	if(as_stats){
+	    gettimeofday(&start, NULL);
+	    relax_stat_calls++;
+	}
 
 	/*
 	 * For each frag in segment count and store (a 1st guess of) fr_address.
 	 */
 	address = 0;
+#ifndef ARM
+	nfrags = 0;
+	incremental = 1;
+#endif /* !defined(ARM) */
 	for(fragP = frag_root; fragP != NULL; fragP = fragP->fr_next){
 #ifdef ARM
             fragP->relax_marker = 0;
 #endif /* ARM */
+	    fragP->fr_relax_index = ++relax_frag_index;
 	    fragP->fr_address = address;
 	    address += fragP->fr_fix;
 	    switch(fragP->fr_type){
@@ -1166,6 +1213,13 @@ int nsect)
 		BAD_CASE(fragP->fr_type);
 		break;
 	    }
+#ifndef ARM
+	    nfrags++;
+	    if(fragP->fr_type != rs_fill &&
+	       fragP->fr_type != rs_align &&
+	       fragP->fr_type != rs_machine_dependent)
+		incremental = 0;
+#endif /* !defined(ARM) */
 	}
 
 	/*
@@ -1174,14 +1228,26 @@ int nsect)
 	 * grow if needed.  On each pass each frag's address is incremented by
 	 * the accumulated growth, kept in stretched.  Passes are continued 
 	 * until there is no stretch on the previous pass.
+	 *
+	 * If the section only has frags whose growth depends just on the
+	 * addresses of frags in the section (fills, aligns and machine
+	 * dependent branches) the same passes are done by visiting only the
+	 * frags that a previous growth could change.
 	 */
+#ifndef ARM
+	if(incremental)
+	    relax_frags_incremental(frag_root, nfrags, address);
+	else
+#endif /* !defined(ARM) */
 	do{
 	    stretch = 0;
 	    stretched = 0;
+	    relax_stat_passes++;
 	    for(fragP = frag_root; fragP != NULL; fragP = fragP->fr_next){
 #ifdef ARM
                 fragP->relax_marker ^= 1;
 #endif /* ARM */
+		relax_stat_frags++;
 		was_address = fragP->fr_address;
 		fragP->fr_address += stretch;
 		address = fragP->fr_address;
@@ -1193,19 +1259,7 @@ int nsect)
 		    break;
 
 		case rs_align:
-		    oldoff = relax_align(was_address + fragP->fr_fix, offset);
-		    newoff = relax_align(address + fragP->fr_fix, offset);
-		    /*
-		     * Check if a maximum number of bytes to fill was specified
-		     * for this align (stored in fr_subtype).
-		     */
-		    if(fragP->fr_subtype != 0){
-			if(oldoff > fragP->fr_subtype)
-			    oldoff = 0;
-			if(newoff > fragP->fr_subtype)
-			    newoff = 0;
-		    }
-		    growth = newoff - oldoff;
+		    growth = relax_align_frag(fragP, was_address, address);
 		    break;
 
 		case rs_org:
@@ -1234,10 +1288,6 @@ int nsect)
 #ifdef ARM
 		    growth = arm_relax_frag(nsect, fragP, stretch);
 #else /* !defined(ARM) */
-		    this_state = fragP->fr_subtype;
-		    this_type = md_relax_table + this_state;
-		    start_type = this_type;
-
 		    target = offset;
 		    if(symbolP){
 			know(((symbolP->sy_type & N_TYPE) == N_ABS) ||
@@ -1259,32 +1309,7 @@ int nsect)
 			    target += stretch;
 		    }
 		    aim = target - address - fragP->fr_fix;
-		    if(aim < 0){
-			/* Look backwards. */
-			for(next_state = this_type->rlx_more; next_state; ){
-			    if(aim >= this_type->rlx_backward)
-				next_state = 0;
-			    else{	/* Grow to next state. */
-				this_state = next_state;
-				this_type = md_relax_table + this_state;
-				next_state = this_type->rlx_more;
-			    }
-			}
-		    }
-		    else{
-			/* Look forwards. */
-			for(next_state = this_type->rlx_more; next_state; ){
-			    if(aim <= this_type->rlx_forward)
-				next_state = 0;
-			    else{	/* Grow to next state. */
-				this_state = next_state;
-				this_type = md_relax_table + this_state;
-				next_state = this_type->rlx_more;
-			    }
-			}
-		    }
-		    if((growth = this_type->rlx_length -start_type->rlx_length))
-			  fragP->fr_subtype = this_state;
+		    growth = relax_md_frag(fragP, aim);
 #endif /* !defined(ARM) */
 		    break;
 		  case rs_dwarf2dbg:
@@ -1349,6 +1374,11 @@ int nsect)
 		ret = 1;
 	    }
 	}
+	if(as_stats){
+	    gettimeofday(&end, NULL);
+	    relax_stat_time += (end.tv_sec - start.tv_sec) +
+			       (end.tv_usec - start.tv_usec) / 1000000.0;
+	}
 	return(ret);
 }
 
@@ -1370,10 +1400,404 @@ uint32_t alignment)		/* Alignment (binary). */
 	return(new_address - address);
 }
 
+/*
+ * relax_align_frag() returns the growth of the rs_align frag fragP when it
+ * moves from was_address to address.
+ */
+static
+int32_t
+relax_align_frag(
+struct frag *fragP,
+relax_addressT was_address,
+relax_addressT address)
+{
+    uint32_t oldoff, newoff;
+
+	oldoff = relax_align(was_address + fragP->fr_fix, fragP->fr_offset);
+	newoff = relax_align(address + fragP->fr_fix, fragP->fr_offset);
+	/*
+	 * Check if a maximum number of bytes to fill was specified
+	 * for this align (stored in fr_subtype).
+	 */
+	if(fragP->fr_subtype != 0){
+	    if(oldoff > fragP->fr_subtype)
+		oldoff = 0;
+	    if(newoff > fragP->fr_subtype)
+		newoff = 0;
+	}
+	return(newoff - oldoff);
+}
+
 #ifndef ARM
+/*
+ * relax_md_frag() moves the rs_machine_dependent frag fragP to the first state
+ * in md_relax_table from its current one that can reach aim and returns the
+ * growth.
+ */
+static
+int32_t
+relax_md_frag(
+struct frag *fragP,
+int32_t aim)
+{
+    const relax_typeS *this_type;
+    const relax_typeS *start_type;
+    relax_substateT next_state;
+    relax_substateT this_state;
+    int32_t growth;
+
+	this_state = fragP->fr_subtype;
+	this_type = md_relax_table + this_state;
+	start_type = this_type;
+	if(aim < 0){
+	    /* Look backwards. */
+	    for(next_state = this_type->rlx_more; next_state; ){
+		if(aim >= this_type->rlx_backward)
+		    next_state = 0;
+		else{	/* Grow to next state. */
+		    this_state = next_state;
+		    this_type = md_relax_table + this_state;
+		    next_state = this_type->rlx_more;
+		}
+	    }
+	}
+	else{
+	    /* Look forwards. */
+	    for(next_state = this_type->rlx_more; next_state; ){
+		if(aim <= this_type->rlx_forward)
+		    next_state = 0;
+		else{	/* Grow to next state. */
+		    this_state = next_state;
+		    this_type = md_relax_table + this_state;
+		    next_state = this_type->rlx_more;
+		}
+	    }
+	}
+	if((growth = this_type->rlx_length - start_type->rlx_length))
+	    fragP->fr_subtype = this_state;
+	return(growth);
+}
+
+/*
+ * relax_frags_incremental() does the relax passes of relax_section() for the
+ * nfrags frags starting at frag_root, which are only rs_fill, rs_align and
+ * rs_machine_dependent frags and have had their first guess of fr_address set
+ * with end_address being the first guess of the end of the section.
+ * It gets the same frag states and addresses as the full passes.
+ *
+ * In a full pass a frag is visited with the frags before it already moved by
+ * this pass and the frags after it where the last pass left them.  Its growth
+ * depends only on the sizes of the frags between it and its target, or before
+ * it for an align or a branch to another section, and it does not grow if
+ * none of those sizes changed since it was last visited.  So the sizes are
+ * kept in a Fenwick tree that gives the address a full pass would give a frag
+ * or a target in the section, and each frag's range of sizes is put on a list
+ * for each node of a segment tree covering it.  When a frag grows the frags
+ * with ranges that hold it are looked up in the segment tree and are visited
+ * later in this pass if they are after it, else in the next pass.
+ */
+static
+void
+relax_frags_incremental(
+struct frag *frag_root,
+uint32_t nfrags,
+relax_addressT end_address)
+{
+    struct frag *fragP, **frags;
+    relax_addressT *sizes, *tree, address, was_address;
+    uint32_t i, j, k, p, size, lo, hi, nintervals, nheap, nnext, cursor;
+    uint32_t *ilo, *ihi, *counts, *lists, *heap, *next;
+    uint64_t first_index, frag_index;
+    unsigned char *queued;
+    symbolS *symbolP;
+    int32_t target, aim, growth;
+    int stretched;
+
+	frags = xmalloc(nfrags * sizeof(struct frag *));
+	sizes = xmalloc(nfrags * sizeof(relax_addressT));
+	tree = xmalloc((nfrags + 1) * sizeof(relax_addressT));
+	ilo = xmalloc(nfrags * sizeof(uint32_t));
+	ihi = xmalloc(nfrags * sizeof(uint32_t));
+	heap = xmalloc(nfrags * sizeof(uint32_t));
+	next = xmalloc(nfrags * sizeof(uint32_t));
+	queued = xmalloc(nfrags);
+	memset(queued, '\0', nfrags);
+
+	/*
+	 * Get the frags and their sizes from the first guess of fr_address.
+	 */
+	i = 0;
+	for(fragP = frag_root; fragP != NULL; fragP = fragP->fr_next)
+	    frags[i++] = fragP;
+	first_index = frags[0]->fr_relax_index;
+	for(i = 0; i < nfrags; i++){
+	    if(i + 1 < nfrags)
+		sizes[i] = frags[i + 1]->fr_address - frags[i]->fr_address;
+	    else
+		sizes[i] = end_address - frags[i]->fr_address;
+	    tree[i + 1] = sizes[i];
+	}
+	tree[0] = 0;
+	for(i = 1; i <= nfrags; i++){
+	    j = i + (i & -i);
+	    if(j <= nfrags)
+		tree[j] += tree[i];
+	}
+
+	/*
+	 * Set the range of frags whose sizes each frag's growth depends on.
+	 */
+	nintervals = 0;
+	for(i = 0; i < nfrags; i++){
+	    fragP = frags[i];
+	    ilo[i] = 0;
+	    ihi[i] = 0;
+	    if(fragP->fr_type == rs_align)
+		ihi[i] = i;
+	    else if(fragP->fr_type == rs_machine_dependent){
+		symbolP = fragP->fr_symbol;
+		frag_index = symbolP != NULL ?
+			     symbolP->sy_frag->fr_relax_index : 0;
+		if(frag_index >= first_index &&
+		   frag_index - first_index < nfrags){
+		    j = frag_index - first_index;
+		    ilo[i] = i < j ? i : j;
+		    ihi[i] = i < j ? j : i;
+		}
+		else
+		    ihi[i] = i;
+	    }
+	    if(ilo[i] < ihi[i])
+		nintervals++;
+	}
+
+	/*
+	 * Put each range on the lists of the nodes of the segment tree that
+	 * cover it, first counting them to size the lists.
+	 */
+	for(size = 1; size < nfrags; size <<= 1)
+	    ;
+	counts = xmalloc((2 * size + 1) * sizeof(uint32_t));
+	lists = NULL;
+	memset(counts, '\0', (2 * size + 1) * sizeof(uint32_t));
+	for(k = 0; k < 2; k++){
+	    for(i = 0; i < nfrags; i++){
+		for(lo = ilo[i] + size, hi = ihi[i] + size;
+		    lo < hi;
+		    lo >>= 1, hi >>= 1){
+		    if(lo & 1){
+			if(k == 0)
+			    counts[lo + 1]++;
+			else
+			    lists[counts[lo]++] = i;
+			lo++;
+		    }
+		    if(hi & 1){
+			hi--;
+			if(k == 0)
+			    counts[hi + 1]++;
+			else
+			    lists[counts[hi]++] = i;
+		    }
+		}
+	    }
+	    /*
+	     * After counting counts[p + 1] is the size of node p's list and is
+	     * turned into where it starts.  After filling counts[p] is where
+	     * node p's list ends and so where node p + 1's list starts.
+	     */
+	    if(k == 0){
+		for(p = 1; p <= 2 * size; p++)
+		    counts[p] += counts[p - 1];
+		lists = xmalloc((counts[2 * size] + 1) * sizeof(uint32_t));
+	    }
+	}
+
+	/*
+	 * The first pass visits all the frags, so the heap is all of them in
+	 * order which is already a heap.
+	 */
+	for(i = 0; i < nfrags; i++){
+	    heap[i] = i;
+	    queued[i] = 1;
+	}
+	nheap = nfrags;
+	nnext = 0;
+	do{
+	    stretched = 0;
+	    relax_stat_passes++;
+	    while(nheap != 0){
+		cursor = relax_heap_pop(heap, &nheap);
+		queued[cursor] &= ~1;
+		relax_stat_frags++;
+		fragP = frags[cursor];
+
+		address = 0;
+		for(j = cursor; j > 0; j -= j & -j)
+		    address += tree[j];
+		was_address = fragP->fr_address;
+		fragP->fr_address = address;
+		growth = 0;
+		switch(fragP->fr_type){
+		case rs_fill:	/* .fill never relaxes. */
+		    break;
+
+		case rs_align:
+		    growth = relax_align_frag(fragP, was_address, address);
+		    break;
+
+		case rs_machine_dependent:
+		    target = fragP->fr_offset;
+		    symbolP = fragP->fr_symbol;
+		    if(symbolP != NULL){
+			know(((symbolP->sy_type & N_TYPE) == N_ABS) ||
+			     ((symbolP->sy_type & N_TYPE) == N_SECT));
+			know(symbolP->sy_frag);
+			know((symbolP->sy_type & N_TYPE) != N_ABS ||
+			     symbolP->sy_frag == &zero_address_frag);
+			frag_index = symbolP->sy_frag->fr_relax_index;
+			if(frag_index >= first_index &&
+			   frag_index - first_index < nfrags){
+			    /*
+			     * The address a full pass uses for a target in the
+			     * section is its fr_address if already visited in
+			     * this pass, else its fr_address from the last pass
+			     * moved by this pass's stretch.  Both are the sum of
+			     * the current sizes of the frags before it.
+			     */
+			    target += symbolP->sy_value;
+			    for(j = frag_index - first_index;
+				j > 0;
+				j -= j & -j)
+				target += tree[j];
+			}
+			else
+			    target += symbolP->sy_value +
+				      symbolP->sy_frag->fr_address;
+		    }
+		    aim = target - address - fragP->fr_fix;
+		    growth = relax_md_frag(fragP, aim);
+		    break;
+
+		default:
+		    BAD_CASE(fragP->fr_type);
+		    break;
+		}
+		if(growth == 0)
+		    continue;
+		stretched = 1;
+		sizes[cursor] += growth;
+		for(j = cursor + 1; j <= nfrags; j += j & -j)
+		    tree[j] += growth;
+
+		/*
+		 * Queue the frags whose range holds this frag.
+		 */
+		for(p = cursor + size; p >= 1; p >>= 1){
+		    for(k = counts[p - 1]; k < counts[p]; k++){
+			i = lists[k];
+			if(i > cursor){
+			    if((queued[i] & 1) == 0){
+				queued[i] |= 1;
+				relax_heap_push(heap, &nheap, i);
+			    }
+			}
+			else{
+			    if((queued[i] & 2) == 0){
+				queued[i] |= 2;
+				next[nnext++] = i;
+			    }
+			}
+		    }
+		}
+	    }
+	    for(k = 0; k < nnext; k++){
+		queued[next[k]] = 1;
+		relax_heap_push(heap, &nheap, next[k]);
+	    }
+	    nnext = 0;
+	}while(stretched && nheap != 0);
+
+	/*
+	 * Set the addresses the last full pass would have left.
+	 */
+	address = 0;
+	for(i = 0; i < nfrags; i++){
+	    frags[i]->fr_address = address;
+	    address += sizes[i];
+	}
+
+	free(lists);
+	free(counts);
+	free(queued);
+	free(next);
+	free(heap);
+	free(ihi);
+	free(ilo);
+	free(tree);
+	free(sizes);
+	free(frags);
+}
+
+/*
+ * relax_heap_push() adds frag_index to the heap of *nheap frag indexes used by
+ * relax_frags_incremental() to visit the queued frags in order.
+ */
+static
+void
+relax_heap_push(
+uint32_t *heap,
+uint32_t *nheap,
+uint32_t frag_index)
+{
+    uint32_t i, parent;
+
+	i = (*nheap)++;
+	while(i > 0){
+	    parent = (i - 1) / 2;
+	    if(heap[parent] <= frag_index)
+		break;
+	    heap[i] = heap[parent];
+	    i = parent;
+	}
+	heap[i] = frag_index;
+}
+
+/*
+ * relax_heap_pop() removes and returns the smallest index in the heap of
+ * *nheap frag indexes, which must not be empty.
+ */
+static
+uint32_t
+relax_heap_pop(
+uint32_t *heap,
+uint32_t *nheap)
+{
+    uint32_t i, child, top, last;
+
+	top = heap[0];
+	last = heap[--(*nheap)];
+	i = 0;
+	for(;;){
+	    child = 2 * i + 1;
+	    if(child >= *nheap)
+		break;
+	    if(child + 1 < *nheap && heap[child + 1] < heap[child])
+		child++;
+	    if(last <= heap[child])
+		break;
+	    heap[i] = heap[child];
+	    i = child;
+	}
+	heap[i] = last;
+	return(top);
+}
+
 /*
  * is_down_range() is used in relax_section() to determine it one fragment is
- * after another to know if it will also be moved if the first is moved.
+ * after another to know if it will also be moved if the first is moved.  As
+ * relax_section() numbers the frags of the section being relaxed after all
+ * others this is true only if f2 is after f1 in the same section.
  */
 static
 int
@@ -1381,11 +1805,6 @@ is_down_range(
 struct frag *f1,
 struct frag *f2)
 {
-	while(f1){
-	    if(f1->fr_next == f2)
-		return(1);
-	    f1 = f1->fr_next;
-	}
-	return(0);
+	return(f2->fr_relax_index > f1->fr_relax_index);
 }
 #endif /* !defined(ARM) */
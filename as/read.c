@@ -37,6 +37,7 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include "stuff/rnd.h"
 #include "stuff/arch.h"
 #include "stuff/best_arch.h"
@@ -4896,16 +4897,20 @@ uintptr_t value)
 /*
  * s_incbin() implements the pseudo op:
  *	.incbin "filename"
+ * If the file can be mapped its contents are referenced by a frag from the
+ * mapping, which stays in place until the object file is written, rather than
+ * being copied in to the frags obstack.
  */
 static
 void
 s_incbin(
 uintptr_t value)
 {
-    char *filename, *whole_file_name, *p;
+    char *filename, *whole_file_name, *p, *addr;
     int length;
     FILE *fp;
     int the_char;
+    struct stat stat_buf;
 
 	/* Some assemblers tolerate immediately following '"' */
 	if((filename = demand_copy_string( & length ) )) {
@@ -4913,6 +4918,17 @@ uintptr_t value)
 	    whole_file_name = find_an_include_file(filename);
 	    if(whole_file_name != NULL &&
 	       (fp = fopen(whole_file_name, "r"))){
+		if(fstat(fileno(fp), &stat_buf) == 0 &&
+		   S_ISREG(stat_buf.st_mode) &&
+		   stat_buf.st_size > 0 && stat_buf.st_size <= INT32_MAX){
+		    addr = mmap(0, stat_buf.st_size, PROT_READ, MAP_PRIVATE,
+				fileno(fp), 0);
+		    if(addr != MAP_FAILED){
+			frag_mapped(addr, (int32_t)stat_buf.st_size);
+			fclose(fp);
+			return;
+		    }
+		}
 		do{
 		    the_char = getc_unlocked(fp);
 		    if (the_char != -1){
@@ -2,6 +2,8 @@
 #include <string.h>
 #include <ctype.h>
 #include <sys/file.h>
+#include <sys/time.h>
+#include <sys/resource.h>
 #include <libc.h>
 #include <mach/mach.h>
 #include "arch64_32.h"
@@ -129,6 +131,41 @@ static void
     I860_tweeks(void);
 #endif
 
+/*
+ * The object file is written by write_object() in file offset order through
+ * this buffer.
+ */
+#define OUTPUT_BUF_SIZE (64 * 1024)
+static char *output_buf = NULL;
+static uint32_t output_buf_used = 0;
+static uint32_t output_offset = 0;
+static int output_fd = -1;
+
+/*
+ * A regular output file is written to this temporary file next to it and
+ * renamed to it once complete, so an as_fatal() while writing it does not
+ * leave an incomplete object file with a new modification time.  It is
+ * removed by output_cleanup(), registered with atexit(3), if that happens.
+ */
+static char *output_temp_name = NULL;
+
+static void output_begin(
+    int fd);
+static void output_write(
+    const void *p,
+    uint32_t size);
+static void output_pad(
+    uint32_t offset);
+static void output_nlist(
+    nlist_t *nlistP,
+    enum byte_sex host_byte_sex);
+static void output_flush(
+    void);
+static void output_end(
+    void);
+static void output_cleanup(
+    void);
+
 /*
  * write_object() writes a Mach-O object file from the built up data structures.
  */
@@ -142,7 +179,6 @@ char *out_file_name)
     struct symtab_command	symbol_table;
     struct dysymtab_command	dynamic_symbol_table;
     uint32_t			section_type;
-    uint32_t			*indirect_symbols;
     isymbolS			*isymbolP;
     uint32_t			i, j, nsects, nsyms, strsize, nindirectsyms;
 
@@ -155,9 +191,12 @@ char *out_file_name)
     struct frag *fragP;
     struct fix *fixP;
 
-    uint32_t output_size;
-    char *output_addr;
-    kern_return_t r;
+    uint32_t output_size, size;
+    section_t section;
+    struct symtab_command symtab;
+    struct dysymtab_command dysymtab;
+    struct relocation_info relocs[2];
+    struct rusage rusage;
 
     enum byte_sex host_byte_sex;
     uint32_t reloff, nrelocs;
@@ -169,6 +208,8 @@ char *out_file_name)
     int fd;
     uint32_t local;
     struct stat stat_buf;
+    mode_t mask;
+    static int output_cleanup_registered = 0;
 
 #ifdef I860
 	I860_tweeks();
@@ -381,166 +422,167 @@ char *out_file_name)
 	 */
 
 	/*
-	 * Create the buffer to copy the parts of the output file into.
+	 * Set the values of the local symbols set to the difference of two
+	 * symbols before the relocation entries are created, as they may refer
+	 * to them, and check the symbols they are set from before the output
+	 * file is created.
 	 */
-	output_size = offset;
-	if((r = vm_allocate(mach_task_self(), (vm_address_t *)&output_addr,
-			    output_size, TRUE)) != KERN_SUCCESS)
-	    as_fatal("can't vm_allocate() buffer for output file of size %u",
-		     output_size);
+	for(symbolP = symbol_rootP; symbolP; symbolP = symbolP->sy_next){
+	    if((symbolP->sy_type & N_EXT) == 0 && symbolP->expression != 0){
+		expressionS *exp;
+
+		exp = (expressionS *)symbolP->expression;
+		if((exp->X_add_symbol->sy_type & N_TYPE) == N_UNDF)
+		    as_fatal("undefined symbol `%s' in operation setting "
+			     "`%s'", exp->X_add_symbol->sy_name,
+			     symbolP->sy_name);
+		if((exp->X_subtract_symbol->sy_type & N_TYPE) == N_UNDF)
+		    as_fatal("undefined symbol `%s' in operation setting "
+			     "`%s'", exp->X_subtract_symbol->sy_name,
+			     symbolP->sy_name);
+		if(exp->X_add_symbol->sy_other !=
+		   exp->X_subtract_symbol->sy_other)
+		    as_fatal("invalid sections for operation on `%s' and "
+			     "`%s' setting `%s'",exp->X_add_symbol->sy_name,
+			     exp->X_subtract_symbol->sy_name,
+			     symbolP->sy_name);
+		symbolP->sy_nlist.n_value +=
+		    exp->X_add_symbol->sy_value -
+		    exp->X_subtract_symbol->sy_value;
+	    }
+	}
 
-	/* put the headers in the output file's buffer */
+	/*
+	 * Create the output file.  If out_file_name is a regular file, or not
+	 * there, a temporary file is created next to it and renamed to it when
+	 * it is complete.  This also handles the problem when the out_file_name
+	 * is not writable but the directory allows the file to be replaced.
+	 * Special files are written directly.
+	 */
+	if(bad_error != 0)
+	    return;
+	if(stat(out_file_name, &stat_buf) == -1 ||
+	   (stat_buf.st_mode & S_IFMT) == S_IFREG){
+	    if(output_cleanup_registered == 0){
+		atexit(output_cleanup);
+		output_cleanup_registered = 1;
+	    }
+	    output_temp_name = xmalloc(strlen(out_file_name) +
+				       sizeof(".XXXXXX"));
+	    strcpy(output_temp_name, out_file_name);
+	    strcat(output_temp_name, ".XXXXXX");
+	    if((fd = mkstemp(output_temp_name)) == -1){
+		free(output_temp_name);
+		output_temp_name = NULL;
+		as_fatal("can't create output file: %s", out_file_name);
+	    }
+	    /* give it the mode open() would have with 0666 */
+	    mask = umask(0);
+	    umask(mask);
+	    (void)fchmod(fd, 0666 & ~mask);
+	}
+	else if((fd = open(out_file_name, O_WRONLY | O_CREAT | O_TRUNC,
+			   0666)) == -1)
+	    as_fatal("can't create output file: %s", out_file_name);
+
+	/*
+	 * The parts of the output file are written in file offset order through
+	 * a small buffer as they are created rather than building an image of
+	 * the whole file in memory.
+	 */
+	output_size = offset;
+	output_begin(fd);
 	host_byte_sex = get_host_byte_sex();
-	offset = 0;
 
-	/* put the mach_header in the buffer */
-	memcpy(output_addr + offset, &header, sizeof(mach_header_t));
+	/* put out the mach_header */
 	if(host_byte_sex != md_target_byte_sex)
-	    swap_mach_header_t((mach_header_t *)(output_addr + offset),
-			       md_target_byte_sex);
-	offset += sizeof(mach_header_t);
+	    swap_mach_header_t(&header, md_target_byte_sex);
+	output_write(&header, sizeof(mach_header_t));
 
-	/* put the segment_command in the buffer */
+	/* put out the segment_command */
 	if(nsects != 0){
-	    memcpy(output_addr + offset, &reloc_segment,
-		   sizeof(segment_command_t));
 	    if(host_byte_sex != md_target_byte_sex)
-		swap_segment_command_t((segment_command_t *)
-				       (output_addr + offset),
-				       md_target_byte_sex);
-	    offset += sizeof(segment_command_t);
+		swap_segment_command_t(&reloc_segment, md_target_byte_sex);
+	    output_write(&reloc_segment, sizeof(segment_command_t));
 	}
 
-	/* put the segment_command's section structures in the buffer */
+	/* put out the segment_command's section structures */
 	for(frchainP = frchain_root; frchainP; frchainP = frchainP->frch_next){
-	    memcpy(output_addr + offset, &(frchainP->frch_section),
-		   sizeof(section_t));
+	    memcpy(&section, &(frchainP->frch_section), sizeof(section_t));
 	    if(host_byte_sex != md_target_byte_sex)
-		swap_section_t((section_t *)(output_addr + offset), 1,
-			       md_target_byte_sex);
-	    offset += sizeof(section_t);
+		swap_section_t(&section, 1, md_target_byte_sex);
+	    output_write(&section, sizeof(section_t));
 	}
 
-	/* put the symbol_command in the buffer */
+	/* put out the symbol_command */
 	if(nsyms != 0){
-	    memcpy(output_addr + offset, &symbol_table,
-		   sizeof(struct symtab_command));
+	    memcpy(&symtab, &symbol_table, sizeof(struct symtab_command));
 	    if(host_byte_sex != md_target_byte_sex)
-		swap_symtab_command((struct symtab_command *)
-				     (output_addr + offset),
-				     md_target_byte_sex);
-	    offset += sizeof(struct symtab_command);
+		swap_symtab_command(&symtab, md_target_byte_sex);
+	    output_write(&symtab, sizeof(struct symtab_command));
 	}
 
 	if(flagseen['k']){
-	    /* put the dysymbol_command in the buffer */
+	    /* put out the dysymbol_command */
 	    if(nsyms != 0){
-		memcpy(output_addr + offset, &dynamic_symbol_table,
+		memcpy(&dysymtab, &dynamic_symbol_table,
 		       sizeof(struct dysymtab_command));
 		if(host_byte_sex != md_target_byte_sex)
-		    swap_dysymtab_command((struct dysymtab_command *)
-					  (output_addr + offset),
-					  md_target_byte_sex);
-		offset += sizeof(struct dysymtab_command);
+		    swap_dysymtab_command(&dysymtab, md_target_byte_sex);
+		output_write(&dysymtab, sizeof(struct dysymtab_command));
 	    }
 	}
 
-	/* put the section contents (frags) in the buffer */
+	/* put out the section contents (frags) */
 	for(frchainP = frchain_root; frchainP; frchainP = frchainP->frch_next){
-	    offset = frchainP->frch_section.offset;
+	    section_type = frchainP->frch_section.flags & SECTION_TYPE;
+	    if(section_type == S_ZEROFILL ||
+	       section_type == S_THREAD_LOCAL_ZEROFILL)
+		continue;
+	    output_pad(frchainP->frch_section.offset);
 	    for(fragP = frchainP->frch_root; fragP; fragP = fragP->fr_next){
 		know(fragP->fr_type == rs_fill);
-		/* put the fixed part of the frag in the buffer */
-		memcpy(output_addr + offset, fragP->fr_literal, fragP->fr_fix);
-		offset += fragP->fr_fix;
+		/* put out the fixed part of the frag */
+		output_write(fragP->fr_data != NULL ?
+			     fragP->fr_data : fragP->fr_literal,
+			     fragP->fr_fix);
 
-		/* put the variable repeated part of the frag in the buffer */
+		/* put out the variable repeated part of the frag */
 		fill_literal = fragP->fr_literal + fragP->fr_fix;
 		fill_size = fragP->fr_var;
 		num_bytes = fragP->fr_offset * fragP->fr_var;
-		for(count = 0; count < num_bytes; count += fill_size){
-		    memcpy(output_addr + offset, fill_literal, fill_size);
-		    offset += fill_size;
-		}
-	    }
-	}
-
-
-	/* put the symbols in the output file's buffer */
-	offset = symbol_table.symoff;
-	for(symbolP = symbol_rootP; symbolP; symbolP = symbolP->sy_next){
-	    if((symbolP->sy_type & N_EXT) == 0){
-		symbol_name = symbolP->sy_name;
-		symbolP->sy_nlist.n_un.n_strx = symbolP->sy_name_offset;
-		if(symbolP->expression != 0) {
-		    expressionS *exp;
-
-		    exp = (expressionS *)symbolP->expression;
-		    if((exp->X_add_symbol->sy_type & N_TYPE) == N_UNDF)
-	    		as_fatal("undefined symbol `%s' in operation setting "
-				 "`%s'", exp->X_add_symbol->sy_name,
-				 symbol_name);
-		    if((exp->X_subtract_symbol->sy_type & N_TYPE) == N_UNDF)
-	    		as_fatal("undefined symbol `%s' in operation setting "
-				 "`%s'", exp->X_subtract_symbol->sy_name,
-				 symbol_name);
-		    if(exp->X_add_symbol->sy_other !=
-		       exp->X_subtract_symbol->sy_other)
-	    		as_fatal("invalid sections for operation on `%s' and "
-				 "`%s' setting `%s'",exp->X_add_symbol->sy_name,
-				 exp->X_subtract_symbol->sy_name, symbol_name);
-		    symbolP->sy_nlist.n_value +=
-			exp->X_add_symbol->sy_value -
-			exp->X_subtract_symbol->sy_value;
-		}
-		memcpy(output_addr + offset, (char *)(&symbolP->sy_nlist),
-		       sizeof(nlist_t));
-		symbolP->sy_name = symbol_name;
-		offset += sizeof(nlist_t);
+		for(count = 0; count < num_bytes; count += fill_size)
+		    output_write(fill_literal, fill_size);
 	    }
 	}
-	for(i = 0; i < nextdefsym; i++){
-	    symbol_name = extdefsyms[i]->sy_name;
-	    extdefsyms[i]->sy_nlist.n_un.n_strx = extdefsyms[i]->sy_name_offset;
-	    memcpy(output_addr + offset, (char *)(&extdefsyms[i]->sy_nlist),
-	           sizeof(nlist_t));
-	    extdefsyms[i]->sy_name = symbol_name;
-	    offset += sizeof(nlist_t);
-	}
-	for(j = 0; j < nundefsym; j++){
-	    symbol_name = undefsyms[j]->sy_name;
-	    undefsyms[j]->sy_nlist.n_un.n_strx = undefsyms[j]->sy_name_offset;
-	    memcpy(output_addr + offset, (char *)(&undefsyms[j]->sy_nlist),
-	           sizeof(nlist_t));
-	    undefsyms[j]->sy_name = symbol_name;
-	    offset += sizeof(nlist_t);
-	}
-	if(host_byte_sex != md_target_byte_sex)
-	    swap_nlist_t((nlist_t *)(output_addr + symbol_table.symoff),
-		         symbol_table.nsyms, md_target_byte_sex);
 
 	/*
-	 * Put the relocation entries for each section in the buffer.
+	 * Put out the relocation entries for each section.
 	 */
+	output_pad(reloff);
 	for(frchainP = frchain_root; frchainP; frchainP = frchainP->frch_next){
-	    offset = frchainP->frch_section.reloff;
+	    if(frchainP->frch_section.nreloc != 0)
+		output_pad(frchainP->frch_section.reloff);
 	    for(fixP = frchainP->frch_fix_root; fixP; fixP = fixP->fx_next){
-		offset += fix_to_relocation_entries(
+		memset(relocs, '\0', sizeof(relocs));
+		size = fix_to_relocation_entries(
 					fixP,
 					frchainP->frch_section.addr,
-					(struct relocation_info *)(output_addr +
-								   offset),
+					relocs,
 				        frchainP->frch_section.flags &
 					  S_ATTR_DEBUG);
+		if(host_byte_sex != md_target_byte_sex)
+		    swap_relocation_info(relocs,
+			size / sizeof(struct relocation_info),
+			md_target_byte_sex);
+		output_write(relocs, size);
 	    }
 	}
-	if(host_byte_sex != md_target_byte_sex)
-	    swap_relocation_info((struct relocation_info *)
-		(output_addr + reloff), nrelocs, md_target_byte_sex);
 
 	if(flagseen['k']){
-	    /* put the indirect symbol table in the buffer */
-	    offset = dynamic_symbol_table.indirectsymoff;
+	    /* put out the indirect symbol table */
+	    if(nindirectsyms != 0)
+		output_pad(dynamic_symbol_table.indirectsymoff);
 	    for(frchainP = frchain_root;
 		frchainP != NULL;
 		frchainP = frchainP->frch_next){
@@ -570,40 +612,55 @@ char *out_file_name)
 			    if((isymbolP->isy_symbol->sy_nlist.n_type &
 				N_TYPE) == N_ABS)
 				local |= INDIRECT_SYMBOL_ABS;
-			    memcpy(output_addr + offset, (char *)(&local),
-	   			   sizeof(uint32_t));
 			}
 			else{
-			    memcpy(output_addr + offset,
-				   (char *)(&isymbolP->isy_symbol->sy_number),
-				   sizeof(uint32_t));
+			    local = isymbolP->isy_symbol->sy_number;
 			}
-			offset += sizeof(uint32_t);
+			if(host_byte_sex != md_target_byte_sex)
+			    swap_indirect_symbols(&local, 1,
+						  md_target_byte_sex);
+			output_write(&local, sizeof(uint32_t));
 		    }
 		}
 	    }
-	    if(host_byte_sex != md_target_byte_sex){
-		indirect_symbols = (uint32_t *)(output_addr +
-				    dynamic_symbol_table.indirectsymoff);
-		swap_indirect_symbols(indirect_symbols, nindirectsyms, 
-				      md_target_byte_sex);
+	}
+
+	/* put out the symbols */
+	if(nsyms != 0)
+	    output_pad(symbol_table.symoff);
+	for(symbolP = symbol_rootP; symbolP; symbolP = symbolP->sy_next){
+	    if((symbolP->sy_type & N_EXT) == 0){
+		symbol_name = symbolP->sy_name;
+		symbolP->sy_nlist.n_un.n_strx = symbolP->sy_name_offset;
+		output_nlist(&symbolP->sy_nlist, host_byte_sex);
+		symbolP->sy_name = symbol_name;
 	    }
 	}
+	for(i = 0; i < nextdefsym; i++){
+	    symbol_name = extdefsyms[i]->sy_name;
+	    extdefsyms[i]->sy_nlist.n_un.n_strx = extdefsyms[i]->sy_name_offset;
+	    output_nlist(&extdefsyms[i]->sy_nlist, host_byte_sex);
+	    extdefsyms[i]->sy_name = symbol_name;
+	}
+	for(j = 0; j < nundefsym; j++){
+	    symbol_name = undefsyms[j]->sy_name;
+	    undefsyms[j]->sy_nlist.n_un.n_strx = undefsyms[j]->sy_name_offset;
+	    output_nlist(&undefsyms[j]->sy_nlist, host_byte_sex);
+	    undefsyms[j]->sy_name = symbol_name;
+	}
 
-	/* put the strings in the output file's buffer */
-	offset = symbol_table.stroff;
+	/* put out the strings */
 	if(symbol_table.strsize != 0){
+	    output_pad(symbol_table.stroff);
 	    zero = 0;
-	    memcpy(output_addr + offset, (char *)&zero, sizeof(char));
-	    offset += sizeof(char);
+	    output_write(&zero, sizeof(char));
 	}
 	for(symbolP = symbol_rootP; symbolP; symbolP = symbolP->sy_next){
 	    /* Ordinary case: not .stabd. */
 	    if(symbolP->sy_name != NULL){
 		if((symbolP->sy_type & N_EXT) != 0){
-		    memcpy(output_addr + offset, symbolP->sy_name,
-			   strlen(symbolP->sy_name) + 1);
-		    offset += strlen(symbolP->sy_name) + 1;
+		    output_write(symbolP->sy_name,
+				 strlen(symbolP->sy_name) + 1);
 		}
 	    }
 	}
@@ -611,34 +668,165 @@ char *out_file_name)
 	    /* Ordinary case: not .stabd. */
 	    if(symbolP->sy_name != NULL){
 		if((symbolP->sy_type & N_EXT) == 0){
-		    memcpy(output_addr + offset, symbolP->sy_name,
-			   strlen(symbolP->sy_name) + 1);
-		    offset += strlen(symbolP->sy_name) + 1;
+		    output_write(symbolP->sy_name,
+				 strlen(symbolP->sy_name) + 1);
 		}
 	    }
 	}
+	output_pad(output_size);
+	output_end();
+
 	/*
-         * Create the output file.  The unlink() is done to handle the problem
-         * when the out_file_name is not writable but the directory allows the
-         * file to be removed (since the file may not be there the return code
-         * of the unlink() is ignored).
-         */
-	if(bad_error != 0)
-	    return;
-	/*
-	 * Avoid doing the unlink() on special files, just unlink regular files
-	 * that exist.
+	 * If an error was found while creating the relocation entries the
+	 * object file is not complete so remove it.
 	 */
-	if(stat(out_file_name, &stat_buf) != -1){
-	    if(stat_buf.st_mode & S_IFREG)
-		(void)unlink(out_file_name);
+	if(bad_error != 0){
+	    (void)close(fd);
+	    output_cleanup();
+	    return;
 	}
-	if((fd = open(out_file_name, O_WRONLY | O_CREAT | O_TRUNC, 0666)) == -1)
-	    as_fatal("can't create output file: %s", out_file_name);
-	if(write(fd, output_addr, output_size) != (int)output_size)
-	    as_fatal("can't write output file");
 	if(close(fd) == -1)
 	    as_fatal("can't close output file");
+	if(output_temp_name != NULL){
+	    if(rename(output_temp_name, out_file_name) == -1)
+		as_fatal("can't rename temporary file: %s to output file: %s",
+			 output_temp_name, out_file_name);
+	    free(output_temp_name);
+	    output_temp_name = NULL;
+	}
+
+	if(as_stats){
+	    getrusage(RUSAGE_SELF, &rusage);
+	    fprintf(stderr, "as: write_object: %u bytes written, maximum "
+		    "resident set size %ld\n", output_size,
+		    (long)rusage.ru_maxrss);
+	}
+}
+
+/*
+ * output_begin() sets up to write the object file to the file descriptor fd
+ * with output_write().
+ */
+static
+void
+output_begin(
+int fd)
+{
+	output_fd = fd;
+	output_offset = 0;
+	output_buf_used = 0;
+	if(output_buf == NULL)
+	    output_buf = xmalloc(OUTPUT_BUF_SIZE);
+}
+
+/*
+ * output_write() puts size bytes at p in the object file at the current offset.
+ */
+static
+void
+output_write(
+const void *p,
+uint32_t size)
+{
+    uint32_t n;
+
+	output_offset += size;
+	while(size != 0){
+	    /* large pieces, like .incbin files, are written directly */
+	    if(output_buf_used == 0 && size >= OUTPUT_BUF_SIZE){
+		if(write(output_fd, p, size) != (int)size)
+		    as_fatal("can't write output file");
+		return;
+	    }
+	    n = OUTPUT_BUF_SIZE - output_buf_used;
+	    if(n > size)
+		n = size;
+	    memcpy(output_buf + output_buf_used, p, n);
+	    output_buf_used += n;
+	    p = (const char *)p + n;
+	    size -= n;
+	    if(output_buf_used == OUTPUT_BUF_SIZE)
+		output_flush();
+	}
+}
+
+/*
+ * output_pad() puts zero bytes in the object file up to the offset.
+ */
+static
+void
+output_pad(
+uint32_t offset)
+{
+    static const char zeros[64] = { 0 };
+    uint32_t n;
+
+	if(offset < output_offset)
+	    as_fatal("internal error: object file contents out of order "
+		     "(offset %u, current offset %u)", offset, output_offset);
+	while(output_offset < offset){
+	    n = offset - output_offset;
+	    if(n > sizeof(zeros))
+		n = sizeof(zeros);
+	    output_write(zeros, n);
+	}
+}
+
+/*
+ * output_nlist() puts a copy of the nlist in the object file, swapped if the
+ * target byte sex is not the host's.
+ */
+static
+void
+output_nlist(
+nlist_t *nlistP,
+enum byte_sex host_byte_sex)
+{
+    nlist_t n;
+
+	n = *nlistP;
+	if(host_byte_sex != md_target_byte_sex)
+	    swap_nlist_t(&n, 1, md_target_byte_sex);
+	output_write(&n, sizeof(nlist_t));
+}
+
+static
+void
+output_flush(
+void)
+{
+	if(output_buf_used != 0 &&
+	   write(output_fd, output_buf, output_buf_used) !=
+		(int)output_buf_used)
+	    as_fatal("can't write output file");
+	output_buf_used = 0;
+}
+
+/*
+ * output_end() writes what is left in the buffer to the object file.
+ */
+static
+void
+output_end(
+void)
+{
+	output_flush();
+}
+
+/*
+ * output_cleanup() removes the temporary file the object file is being written
+ * to if it has not been renamed to the output file.
+ */
+static
+void
+output_cleanup(
+void)
+{
+	if(output_temp_name != NULL){
+	    (void)unlink(output_temp_name);
+	    free(output_temp_name);
+	    output_temp_name = NULL;
+	}
 }
 
 /*
@@ -34,6 +34,9 @@
 #include "stuff/errors.h"
 #include "stuff/allocate.h"
 #include "stuff/guess_short_name.h"
+#include "stuff/arch.h"
+#include "stuff/outbuf.h"
+#include "stuff/symbol_export.h"
 char *progname = NULL;
 
 static void nm(
@@ -85,6 +88,7 @@ struct cmd_flags {
 			     SUB_UMBRELLA, SUB_FRAMEWORK, etc */
     enum bool import;	/* Flag to identify were looking for imported symbols
 			   data */
+    enum bool export;	/* export all the symbols for SymInfoExport() */
 };
 
 /* flags set by processing a specific object file */
@@ -101,6 +105,10 @@ struct symbol {
     struct nlist_64 nl;
 };
 
+static void export_symbols(
+    struct ofile *ofile,
+    struct symbol *symbols,
+    uint32_t nsymbols);
 static void set_symbol_names(
     struct symbol *symbols,
     uint32_t nsymbols,
@@ -187,6 +195,47 @@ char *fileName)
 	return(rList);
 }
 
+/*
+ * SymInfoExport() writes all the symbols of fileName to stream in format with
+ * the same symbol export routines as nm -E, from the symbols selected by the
+ * nm callback without making a SymInfoList.
+ */
+void
+SymInfoExport(
+char *fileName,
+FILE *stream,
+int format)
+{
+    struct cmd_flags cmd_flags = { 0 };
+    struct selectedSymbolListInfo *saved_gInfo;
+
+	/* the nm callback uses gInfo so use one of our own */
+	saved_gInfo = gInfo;
+	gInfo = allocate(sizeof(struct selectedSymbolListInfo));
+	bzero(gInfo, sizeof(struct selectedSymbolListInfo));
+
+	cmd_flags.export = TRUE;
+	outbuf_stream(stream);
+	if(format == SymInfoExportBinary)
+	    symbol_export_start(SYMBOL_EXPORT_BINARY);
+	else
+	    symbol_export_start(SYMBOL_EXPORT_JSON);
+	ofile_process(fileName,	/* name */
+		      NULL,	/* arch_flags */
+		      0,	/* narch_flags */
+		      TRUE,	/* all_archs */
+		      FALSE,	/* process_non_objects */
+		      FALSE,	/* dylib_flat */
+		      TRUE,	/* use_member_syntax */
+		      nm,	/* processor */
+		      &cmd_flags); /* cookie */
+	outbuf_stream(NULL);
+
+	free(gInfo->cachedFileName);
+	free(gInfo);
+	gInfo = saved_gInfo;
+}
+
 void
 SymInfoFreeSymbol(
 SymInfoSymbol symbol)
@@ -575,6 +624,21 @@ void *cookie)
 	    }
 	}
 
+	/*
+	 * For SymInfoExport() all the symbols are selected and written out
+	 * rather than saved.
+	 */
+	if(cmd_flags->export == TRUE){
+	    symbols = select_symbols(ofile, st, dyst, cmd_flags, &process_flags,
+				     &nsymbols, all_symbols, all_symbols64);
+	    strings = ofile->object_addr + st->stroff;
+	    strsize = st->strsize;
+	    set_symbol_names(symbols, nsymbols, strings, strsize);
+	    export_symbols(ofile, symbols, nsymbols);
+	    free(symbols);
+	    goto done;
+	}
+
 	/* select export symbols to return */
 	cmd_flags->g = TRUE;
 	cmd_flags->d = TRUE;
@@ -736,6 +800,7 @@ void *cookie)
 	    }
 	}
 	
+done:
 	/* Free the memory that was malloced in this function */
 	for(i = 0; i < process_flags.nlibs; i++)
 	    free(process_flags.lib_names[i]);
@@ -747,6 +812,41 @@ void *cookie)
         }
 }
 
+/*
+ * export_symbols() writes the symbols selected for SymInfoExport() with the
+ * symbol export routines.
+ */
+static
+void
+export_symbols(
+struct ofile *ofile,
+struct symbol *symbols,
+uint32_t nsymbols)
+{
+    uint32_t i;
+    const char *member;
+    uint32_t member_size;
+
+	if(ofile->dylib_module_name != NULL){
+	    member = ofile->dylib_module_name;
+	    member_size = strlen(member);
+	}
+	else if(ofile->member_ar_hdr != NULL){
+	    member = ofile->member_name;
+	    member_size = ofile->member_name_size;
+	}
+	else{
+	    member = NULL;
+	    member_size = 0;
+	}
+	symbol_export_begin(ofile->file_name, member, member_size,
+			    get_arch_name_from_types(ofile->mh_cputype,
+						     ofile->mh_cpusubtype));
+	for(i = 0; i < nsymbols; i++)
+	    symbol_export_symbol(symbols[i].name, &symbols[i].nl);
+	symbol_export_end();
+}
+
 /*
  * set_symbol_names() sets the name and the indr_name fields of the symbols
  * passed to it from the symbol table pass to it.
@@ -21,6 +21,7 @@
  * @APPLE_LICENSE_HEADER_END@
  */
 #include <mach/mach.h>
+#include <stdio.h>
 
 #ifndef __SymInfoTypes__
 typedef void *SymInfoList;
@@ -31,6 +32,16 @@ typedef void *SymInfoDependencies;
 /* Creates a SymInfoList structure from a binary */
 SymInfoList SymInfoCreate(char *fileName);
 
+/* Formats for SymInfoExport() */
+#define SymInfoExportJSON	0	/* a JSON object on a line per symbol */
+#define SymInfoExportBinary	1	/* compact binary records */
+
+/*
+ * Writes all the symbols of a binary to stream in one of the formats above,
+ * as nm -E does.
+ */
+void SymInfoExport(char *fileName, FILE *stream, int format);
+
 /*Access to main structures in the SymInfoList */
 SymInfoSymbol *SymInfoGetImports(SymInfoList nmList);
 SymInfoSymbol *SymInfoGetExports(SymInfoList nmList);
@@ -132,6 +132,13 @@ struct member {
      */
     char *input_file_name;
     struct ar_hdr *input_ar_hdr;
+
+    /*
+     * If this member's object has been written to a spill file by
+     * spill_member() then spilled is TRUE and this is its offset in the file.
+     */
+    enum bool spilled;
+    uint64_t spill_offset;
 };
 
 struct object {
@@ -276,6 +283,13 @@ __private_extern__ void free_archs(
     struct arch *archs,
     uint32_t narchs);
 
+/*
+ * The number of processes writeout() and writeout_to_mem() may use to scan
+ * the symbols of a library with many symbols for its table of contents.  It
+ * is one unless the tool sets it from its -j option.
+ */
+__private_extern__ uint32_t writeout_toc_njobs;
+
 __private_extern__ void writeout(
     struct arch *archs,
     uint32_t narchs,
@@ -299,6 +313,33 @@ __private_extern__ void writeout_to_mem(
     enum bool library_warning,
     enum bool *seen_archive);
 
+/*
+ * A spill file holds the finished contents of archive members that a tool has
+ * written out with spill_member() as it goes through a large archive, so what
+ * it allocated for each member can be released before it goes on to the next.
+ * Then the memory used is bounded by the largest member not the archive.
+ * Before writeout() is called spill_map() maps the file and points the
+ * spilled members at their contents in it.  The struct starts out zeroed.
+ */
+struct spill {
+    enum bool opened;	/* TRUE once the spill file has been created */
+    int fd;		/* the file descriptor of the unlinked spill file */
+    uint64_t size;	/* the number of bytes written to the spill file */
+    char *addr;		/* the address spill_map() mapped the file at */
+};
+
+__private_extern__ void spill_member(
+    struct spill *spill,
+    struct member *member);
+
+__private_extern__ void spill_map(
+    struct spill *spill,
+    struct arch *archs,
+    uint32_t narchs);
+
+__private_extern__ void spill_free(
+    struct spill *spill);
+
 __private_extern__ void checkout(
     struct arch *archs,
     uint32_t narchs);
@@ -0,0 +1,53 @@
+#ifndef _STUFF_CHECK_CACHE_H_
+#define _STUFF_CHECK_CACHE_H_
+
+#include <stdint.h>
+#include "stuff/bool.h"
+
+#if defined(__MWERKS__) && !defined(__private_extern__)
+#define __private_extern__ __declspec(private_extern)
+#endif
+
+/*
+ * The check cache records the Mach-O slices whose headers have been validated
+ * by check_Mach_O() in ofile.c so that tools run again and again on the same
+ * files do not have to validate them again.  It is only used when the
+ * environment variable OFILE_CHECK_CACHE is set to the path of the cache file,
+ * which is only used if it is a regular file owned by the user and not
+ * writable by others.
+ * A slice is identified by the file it is in (dev, ino, size and mtime), its
+ * offset and size in the file, and a checksum of its mach header and load
+ * commands.
+ */
+struct check_cache_key {
+    uint64_t dev;		/* stat(2)'s st_dev of the file */
+    uint64_t ino;		/* stat(2)'s st_ino of the file */
+    uint64_t file_size;		/* size of the file */
+    uint64_t mtime;		/* stat(2)'s mtime of the file */
+    uint64_t offset;		/* offset of the slice in the file */
+    uint64_t object_size;	/* size of the slice */
+    uint32_t headers_size;	/* size of the mach header and load commands */
+    uint32_t headers_crc;	/* crc32() of the mach header and load cmds */
+};
+
+/*
+ * check_cache_enabled() returns TRUE if the cache is being used, so callers
+ * only need to compute keys if it is.
+ */
+__private_extern__ enum bool check_cache_enabled(
+    void);
+
+/*
+ * check_cache_lookup() returns TRUE if the slice for key has been recorded as
+ * valid in the cache.
+ */
+__private_extern__ enum bool check_cache_lookup(
+    const struct check_cache_key *key);
+
+/*
+ * check_cache_enter() records in the cache that the slice for key is valid.
+ */
+__private_extern__ void check_cache_enter(
+    const struct check_cache_key *key);
+
+#endif /* _STUFF_CHECK_CACHE_H_ */
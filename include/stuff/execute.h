@@ -20,6 +20,8 @@
  * 
  * @APPLE_LICENSE_HEADER_END@
  */
+#include <stdint.h>
+
 #if defined(__MWERKS__) && !defined(__private_extern__)
 #define __private_extern__ __declspec(private_extern)
 #endif
@@ -33,6 +35,39 @@ __private_extern__ int execute(
     char **argv,
     int verbose);
 
+/*
+ * execute_start() starts the program in argv like execute() but does not wait
+ * for it to finish.  It returns the process id to pass to execute_wait().
+ */
+__private_extern__ int execute_start(
+    char **argv,
+    int verbose);
+
+/*
+ * execute_wait() waits for the process started by execute_start() running the
+ * program name.  A non-zero return value indicates success zero indicates
+ * failure.  A process killed by a signal is reported with error() so the
+ * caller can still wait for any others it started.
+ */
+__private_extern__ int execute_wait(
+    int forkpid,
+    char *name);
+
+/*
+ * execute_jobs() runs the njobs programs whose argument lists are in argvs[],
+ * with at most maxjobs of them running at once, or as many as there are
+ * processors if maxjobs is zero.  The output of the jobs is written in the
+ * order of the jobs.  If results is not NULL the result of each job is stored
+ * in it, non-zero for success and zero for failure.  The number of jobs that
+ * failed is returned.
+ */
+__private_extern__ uint32_t execute_jobs(
+    char ***argvs,
+    uint32_t njobs,
+    uint32_t maxjobs,
+    int verbose,
+    int *results);
+
 __private_extern__ void add_execute_list(
     char *str);
 
@@ -42,6 +77,9 @@ __private_extern__ void add_execute_list_with_prefix(
 __private_extern__ char * cmd_with_prefix(
     char *str);
 
+__private_extern__ char ** copy_execute_list(
+    void);
+
 __private_extern__ void reset_execute_list(
     void);
 
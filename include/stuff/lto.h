@@ -31,6 +31,19 @@ __private_extern__ const char * lto_symbol_name(
 __private_extern__ void lto_free(
     void *mod);
 
+/*
+ * lto_prefetch() summarizes the llvm bitcode among the n files passed to it in
+ * parallel so later calls to is_llvm_bitcode_from_memory() for them are cheap.
+ * It does nothing unless lto_prefetch_njobs, the number of processes it may
+ * use, has been set greater than one by the tool from its -j option.
+ */
+__private_extern__ uint32_t lto_prefetch_njobs;
+
+__private_extern__ void lto_prefetch(
+    char **addrs,
+    uint32_t *sizes,
+    uint32_t n);
+
 #endif /* LTO_SUPPORT */
 
 #endif /* _STUFF_LTO_H_ */
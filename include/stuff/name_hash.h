@@ -0,0 +1,55 @@
+#ifndef _STUFF_NAME_HASH_H_
+#define _STUFF_NAME_HASH_H_
+
+#include <stdint.h>
+
+#if defined(__MWERKS__) && !defined(__private_extern__)
+#define __private_extern__ __declspec(private_extern)
+#endif
+
+/*
+ * A name_hash maps names to the order they were entered in, so a caller can
+ * index its own array of the things the names are for.  The names are not
+ * copied and must stay valid while the name_hash is used.
+ */
+struct name_hash {
+    uint32_t nbuckets;		/* number of buckets, a power of two */
+    uint32_t *buckets;		/* first entry + 1 in each bucket, or 0 */
+    uint32_t *next;		/* next entry + 1 in the same bucket, or 0 */
+    uint32_t *hashes;		/* the hash of each entry's name */
+    const char **names;		/* the name of each entry */
+    uint32_t nnames;		/* number of entries */
+    uint32_t max_names;		/* number of entries there is room for */
+};
+
+/*
+ * name_hash_init() sets up the name_hash for up to max_names names.
+ */
+__private_extern__ void name_hash_init(
+    struct name_hash *hash,
+    uint32_t max_names);
+
+/*
+ * name_hash_enter() enters name as the next entry and returns its index.  If
+ * the same name is entered more than once name_hash_lookup() returns the
+ * index of the first.
+ */
+__private_extern__ uint32_t name_hash_enter(
+    struct name_hash *hash,
+    const char *name);
+
+/*
+ * name_hash_lookup() returns the index of the entry for name, or -1 if there
+ * is none.
+ */
+__private_extern__ int32_t name_hash_lookup(
+    const struct name_hash *hash,
+    const char *name);
+
+/*
+ * name_hash_free() frees the memory of the name_hash.
+ */
+__private_extern__ void name_hash_free(
+    struct name_hash *hash);
+
+#endif /* _STUFF_NAME_HASH_H_ */
@@ -59,6 +59,8 @@ struct ofile {
     char *file_addr;		    /* pointer to vm_allocate'ed memory       */
     uint64_t file_size;	    	    /* size of vm_allocate'ed memory	      */
     uint64_t file_mtime;	    /* stat(2)'s mtime                        */
+    uint64_t file_dev;		    /* stat(2)'s st_dev, zero if not mapped   */
+    uint64_t file_ino;		    /* stat(2)'s st_ino, zero if not mapped   */
     enum ofile_type file_type;	    /* type of the file			      */
 
     struct fat_header *fat_header;  /* If a fat file these are filled in and */
@@ -145,8 +147,31 @@ struct ofile {
     /* these are translated from the lto's target_triple */
     cpu_type_t lto_cputype;	    /* cpu specifier */
     cpu_subtype_t lto_cpusubtype;   /* machine specifier */
+
+    /* If the file was mapped read-only (see ofile_map_read_only) then the
+       headers swapped to the host byte sex are copies in these buffers which
+       the pointers above point into.  These are freed by ofile_unmap(). */
+    enum bool read_only;	    /* TRUE if the file is mapped read-only */
+    char *fat_headers_copy;	    /* the fat_header and fat_arch structs */
+    char *member_fat_headers_copy;  /* the same for a fat archive member */
+    char *toc_copy;		    /* the ranlib or ranlib_64 structs */
+    char *headers_copy;		    /* the mach header and load commands */
 };
 
+/*
+ * When ofile_process_njobs is greater than one ofile_process() calls processor
+ * in that many worker processes at once, printing their output in order.  See
+ * the comments before ofile_process() in ofile.c for what a processor must
+ * meet to be used this way.
+ */
+extern uint32_t ofile_process_njobs __attribute__((visibility("hidden")));
+
+/*
+ * When ofile_map_read_only is TRUE ofile_map() maps files read-only and swaps
+ * headers in copies rather than in place.  See its comments in ofile.c.
+ */
+extern enum bool ofile_map_read_only __attribute__((visibility("hidden")));
+
 __private_extern__ void ofile_process(
     char *name,
     struct arch_flag *arch_flags,
@@ -0,0 +1,98 @@
+#ifndef _STUFF_OUTBUF_H_
+#define _STUFF_OUTBUF_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#if defined(__MWERKS__) && !defined(__private_extern__)
+#define __private_extern__ __declspec(private_extern)
+#endif
+
+/*
+ * The outbuf routines format output for stdout into a large buffer without
+ * parsing a format string for each field, for the tools that print a line or
+ * more for each symbol or each few bytes of a section.  The buffer is written
+ * to stdout with fwrite(3) when it fills and when outbuf_flush() is called.
+ * Anything printed to stdout with stdio must only be done after a call to
+ * outbuf_flush() so it is not put ahead of what is still in the buffer.
+ */
+
+/*
+ * outbuf_stream() flushes the buffer and has it written to stream from then
+ * on, or to stdout if stream is NULL.
+ */
+__private_extern__ void outbuf_stream(
+    FILE *stream);
+
+/*
+ * outbuf_flush() writes what is in the buffer to stdout, or the stream set
+ * with outbuf_stream().
+ */
+__private_extern__ void outbuf_flush(
+    void);
+
+/*
+ * outbuf_write() adds the n bytes at p.
+ */
+__private_extern__ void outbuf_write(
+    const void *p,
+    size_t n);
+
+/*
+ * outbuf_char() adds the character c.
+ */
+__private_extern__ void outbuf_char(
+    int c);
+
+/*
+ * outbuf_str() adds the string s.
+ */
+__private_extern__ void outbuf_str(
+    const char *s);
+
+/*
+ * outbuf_strn() adds the string s up to n characters as printf(3)'s "%.*s"
+ * would.
+ */
+__private_extern__ void outbuf_strn(
+    const char *s,
+    size_t n);
+
+/*
+ * outbuf_hex() adds value in lower case hex padded with zeros to width digits
+ * as printf(3)'s "%0*llx" would.
+ */
+__private_extern__ void outbuf_hex(
+    uint64_t value,
+    uint32_t width);
+
+/*
+ * outbuf_oct() adds value in octal padded with zeros to width digits as
+ * printf(3)'s "%0*llo" would.
+ */
+__private_extern__ void outbuf_oct(
+    uint64_t value,
+    uint32_t width);
+
+/*
+ * outbuf_dec() adds value in decimal padded on the left with spaces to width
+ * characters as printf(3)'s "%*llu" would.
+ */
+__private_extern__ void outbuf_dec(
+    uint64_t value,
+    uint32_t width);
+
+/*
+ * outbuf_printf() adds the output of printf(3) for the less common things
+ * that are not worth a routine of their own.
+ */
+__private_extern__ void outbuf_printf(
+    const char *format, ...)
+#ifdef __GNUC__
+    __attribute__ ((format (printf, 1, 2)))
+#endif
+    ;
+
+#endif /* _STUFF_OUTBUF_H_ */
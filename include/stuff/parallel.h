@@ -0,0 +1,55 @@
+#ifndef _STUFF_PARALLEL_H_
+#define _STUFF_PARALLEL_H_
+
+#include <stdint.h>
+
+#if defined(__MWERKS__) && !defined(__private_extern__)
+#define __private_extern__ __declspec(private_extern)
+#endif
+
+/*
+ * parallel_njobs() returns the number of processes to split work between,
+ * which is the number of processors that are online.
+ */
+__private_extern__ uint32_t parallel_njobs(
+    void);
+
+/*
+ * parallel_allocate() returns size bytes of zero filled memory that is shared
+ * with the processes forked by parallel_for(), so what they store in it is
+ * seen by the caller.  It is released with parallel_deallocate().
+ */
+__private_extern__ void *parallel_allocate(
+    uint64_t size);
+
+__private_extern__ void parallel_deallocate(
+    void *p,
+    uint64_t size);
+
+/*
+ * parallel_for() calls func(i, cookie) for each i from 0 to n - 1 split
+ * between njobs forked processes.  The calls can only return results through
+ * memory from parallel_allocate(), anything else they change is lost.  If
+ * njobs is less than two the calls are made in this process.
+ */
+__private_extern__ void parallel_for(
+    uint32_t n,
+    uint32_t njobs,
+    void (*func)(uint32_t i, void *cookie),
+    void *cookie);
+
+/*
+ * parallel_for_ordered() calls func(i, cookie) for each i from 0 to n - 1,
+ * each in a forked process of its own with up to njobs of them at a time.
+ * What each call writes to stdout and stderr is printed in the order of the
+ * calls and the calls to error() it makes are added to errors, so the output
+ * is the same as if the calls were made one after the other.  As with
+ * parallel_for() anything else the calls change is lost.
+ */
+__private_extern__ void parallel_for_ordered(
+    uint32_t n,
+    uint32_t njobs,
+    void (*func)(uint32_t i, void *cookie),
+    void *cookie);
+
+#endif /* _STUFF_PARALLEL_H_ */
@@ -0,0 +1,32 @@
+#ifndef _STUFF_SORT_NAMES_H_
+#define _STUFF_SORT_NAMES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "stuff/bool.h"
+
+#if defined(__MWERKS__) && !defined(__private_extern__)
+#define __private_extern__ __declspec(private_extern)
+#endif
+
+/*
+ * sort_names() sorts the nel elements of width bytes at base, each of which
+ * starts with a char * to a name, into the order strcmp() puts the names in.
+ * Elements with the same name are left in no particular order.
+ */
+__private_extern__ void sort_names(
+    void *base,
+    uint64_t nel,
+    size_t width);
+
+/*
+ * names_unique() returns TRUE if no two of the nel elements of width bytes at
+ * base, each of which starts with a char * to a name, have the same name.  The
+ * elements do not need to be sorted.
+ */
+__private_extern__ enum bool names_unique(
+    void *base,
+    uint64_t nel,
+    size_t width);
+
+#endif /* _STUFF_SORT_NAMES_H_ */
@@ -0,0 +1,81 @@
+#ifndef _STUFF_SYMBOL_EXPORT_H_
+#define _STUFF_SYMBOL_EXPORT_H_
+
+#include <stdint.h>
+#include <mach-o/nlist.h>
+#include "stuff/bool.h"
+
+#if defined(__MWERKS__) && !defined(__private_extern__)
+#define __private_extern__ __declspec(private_extern)
+#endif
+
+/*
+ * The symbol export routines write symbol tables in a form for other programs
+ * to read rather than for people.  They are written with the outbuf routines
+ * so go to stdout unless outbuf_stream() has been called.
+ *
+ * SYMBOL_EXPORT_JSON writes one JSON object on a line for each symbol:
+ *
+ *	{"file":"libx.a","member":"x.o","arch":"x86_64","name":"_x",
+ *	 "type":15,"sect":1,"desc":0,"value":4096}
+ *
+ * where "member" is null if the symbol is not from an archive member or
+ * dylib module.  Names are written byte for byte other than the characters
+ * JSON requires to be escaped.
+ *
+ * SYMBOL_EXPORT_BINARY writes the 8 byte header "SYMX\001\0\0\0" followed by
+ * records that each start with a byte giving its kind.  All numbers are little
+ * endian and strings are a uint32_t length followed by that many bytes.
+ *
+ *	'O'  the object the symbols that follow are from: the file, member
+ *	     (empty if none) and arch strings
+ *	'S'  a symbol: uint8_t n_type, uint8_t n_sect, uint16_t n_desc,
+ *	     uint64_t n_value and the name string
+ */
+enum symbol_export_format {
+    SYMBOL_EXPORT_JSON,
+    SYMBOL_EXPORT_BINARY
+};
+
+/*
+ * get_symbol_export_format() returns TRUE and sets *format for the format
+ * named name, "json" or "binary", and returns FALSE for any other name.
+ */
+__private_extern__ enum bool get_symbol_export_format(
+    const char *name,
+    enum symbol_export_format *format);
+
+/*
+ * symbol_export_start() is called once before anything else is exported in
+ * format, and writes the header if the format has one.
+ */
+__private_extern__ void symbol_export_start(
+    enum symbol_export_format format);
+
+/*
+ * symbol_export_begin() is called before the symbols of an object are
+ * exported.  member is member_size bytes that need not be nul terminated,
+ * and is NULL if the object is not an archive member or dylib module.  The
+ * strings must stay valid until symbol_export_end() is called.
+ */
+__private_extern__ void symbol_export_begin(
+    const char *file_name,
+    const char *member,
+    uint32_t member_size,
+    const char *arch_name);
+
+/*
+ * symbol_export_symbol() exports the symbol with name and nlist nl.
+ */
+__private_extern__ void symbol_export_symbol(
+    const char *name,
+    const struct nlist_64 *nl);
+
+/*
+ * symbol_export_end() is called after the symbols of an object are exported
+ * and flushes what has been written.
+ */
+__private_extern__ void symbol_export_end(
+    void);
+
+#endif /* _STUFF_SYMBOL_EXPORT_H_ */
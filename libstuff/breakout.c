@@ -69,6 +69,7 @@ enum bool calculate_input_prebind_cksum)
 	*archs = NULL;
 	*narchs = 0;
 	ofile = allocate(sizeof(struct ofile));
+	memset(ofile, '\0', sizeof(struct ofile));
 	
 	/*
 	 * If the file_name is NULL, we will use a dummy file name so 
@@ -183,6 +183,11 @@
 #define __dr7 dr7
 
 #include <string.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 #include <mach-o/fat.h>
 #include <mach-o/loader.h>
 #include <mach/m68k/thread_status.h>
@@ -2704,6 +2709,94 @@ enum byte_sex target_byte_sex)
 	nc->size = SWAP_LONG_LONG(nc->size);
 }
 
+/*
+ * The arrays of fixed layout structures swapped below (symbol tables, ranlib
+ * structs, dylib table of contents and reference entries and indirect symbol
+ * tables) are swapped by applying the same byte permutation to every element.
+ * When the compiler targets SSSE3 or AArch64 NEON, swap_vector() does that 48
+ * bytes at a time with byte shuffles, since 48 is a multiple of each of the
+ * element sizes (4, 8, 12 and 16) and no field of these elements straddles a
+ * 16 byte boundary within the 48 bytes.  The pattern is for one element where
+ * pattern[j] is the index of the byte of the element that ends up in byte j.
+ * swap_vector() returns the number of elements it swapped, which is a
+ * multiple of 48 / element_size and is zero if there is no vector support,
+ * and the callers swap the remaining elements with their scalar loops.
+ */
+#define SWAP_VECTOR_BLOCK 48
+
+static
+uint64_t
+swap_vector(
+void *elements,
+uint64_t nelements,
+uint32_t element_size,
+const unsigned char *pattern)
+{
+#if defined(__SSSE3__) || (defined(__ARM_NEON) && defined(__aarch64__))
+    unsigned char masks[SWAP_VECTOR_BLOCK], *p, *end;
+    uint32_t j, per_block;
+    uint64_t nblocks;
+#if defined(__SSSE3__)
+    __m128i m0, m1, m2;
+#else
+    uint8x16_t m0, m1, m2;
+#endif
+
+	per_block = SWAP_VECTOR_BLOCK / element_size;
+	nblocks = nelements / per_block;
+	if(nblocks == 0)
+	    return(0);
+
+	/*
+	 * The shuffle masks index within each 16 byte vector, so the element's
+	 * pattern is repeated over the block and rebased to each vector.
+	 */
+	for(j = 0; j < SWAP_VECTOR_BLOCK; j++)
+	    masks[j] = (unsigned char)(((j / element_size) * element_size +
+			pattern[j % element_size]) - (j & ~15));
+#if defined(__SSSE3__)
+	m0 = _mm_loadu_si128((__m128i *)(masks + 0));
+	m1 = _mm_loadu_si128((__m128i *)(masks + 16));
+	m2 = _mm_loadu_si128((__m128i *)(masks + 32));
+#else
+	m0 = vld1q_u8(masks + 0);
+	m1 = vld1q_u8(masks + 16);
+	m2 = vld1q_u8(masks + 32);
+#endif
+
+	p = (unsigned char *)elements;
+	end = p + nblocks * SWAP_VECTOR_BLOCK;
+	for( ; p < end; p += SWAP_VECTOR_BLOCK){
+#if defined(__SSSE3__)
+	    _mm_storeu_si128((__m128i *)(p + 0), _mm_shuffle_epi8(
+		_mm_loadu_si128((__m128i *)(p + 0)), m0));
+	    _mm_storeu_si128((__m128i *)(p + 16), _mm_shuffle_epi8(
+		_mm_loadu_si128((__m128i *)(p + 16)), m1));
+	    _mm_storeu_si128((__m128i *)(p + 32), _mm_shuffle_epi8(
+		_mm_loadu_si128((__m128i *)(p + 32)), m2));
+#else
+	    vst1q_u8(p + 0, vqtbl1q_u8(vld1q_u8(p + 0), m0));
+	    vst1q_u8(p + 16, vqtbl1q_u8(vld1q_u8(p + 16), m1));
+	    vst1q_u8(p + 32, vqtbl1q_u8(vld1q_u8(p + 32), m2));
+#endif
+	}
+	return(nblocks * per_block);
+#else /* no vector support */
+	return(0);
+#endif
+}
+
+static const unsigned char nlist_pattern[12] =
+    { 3, 2, 1, 0, 4, 5, 7, 6, 11, 10, 9, 8 };
+static const unsigned char nlist_64_pattern[16] =
+    { 3, 2, 1, 0, 4, 5, 7, 6, 15, 14, 13, 12, 11, 10, 9, 8 };
+static const unsigned char int_pattern[4] =
+    { 3, 2, 1, 0 };
+static const unsigned char int_pair_pattern[8] =
+    { 3, 2, 1, 0, 7, 6, 5, 4 };
+static const unsigned char long_long_pair_pattern[16] =
+    { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 };
+
 __private_extern__
 void
 swap_nlist(
@@ -2717,7 +2810,9 @@ enum byte_sex target_byte_sex)
         dummy = target_byte_sex;
 #endif
 
-	for(i = 0; i < nsymbols; i++){
+	i = (uint32_t)swap_vector(symbols, nsymbols, sizeof(struct nlist),
+				  nlist_pattern);
+	for( ; i < nsymbols; i++){
 	    symbols[i].n_un.n_strx = SWAP_INT(symbols[i].n_un.n_strx);
 	    /* n_type */
 	    /* n_sect */
@@ -2739,7 +2834,9 @@ enum byte_sex target_byte_sex)
         dummy = target_byte_sex;
 #endif
 
-	for(i = 0; i < nsymbols; i++){
+	i = (uint32_t)swap_vector(symbols, nsymbols, sizeof(struct nlist_64),
+				  nlist_64_pattern);
+	for( ; i < nsymbols; i++){
 	    symbols[i].n_un.n_strx = SWAP_INT(symbols[i].n_un.n_strx);
 	    /* n_type */
 	    /* n_sect */
@@ -2761,7 +2858,9 @@ enum byte_sex target_byte_sex)
         dummy = target_byte_sex;
 #endif
 
-	for(i = 0; i < nranlibs; i++){
+	i = (uint32_t)swap_vector(ranlibs, nranlibs, sizeof(struct ranlib),
+				  int_pair_pattern);
+	for( ; i < nranlibs; i++){
 	    ranlibs[i].ran_un.ran_strx = SWAP_INT(ranlibs[i].ran_un.ran_strx);
 	    ranlibs[i].ran_off = SWAP_INT(ranlibs[i].ran_off);
 	}
@@ -2776,7 +2875,9 @@ enum byte_sex target_byte_sex)
 {
     uint64_t i;
 
-	for(i = 0; i < nranlibs; i++){
+	i = swap_vector(ranlibs, nranlibs, sizeof(struct ranlib_64),
+			long_long_pair_pattern);
+	for( ; i < nranlibs; i++){
 	    ranlibs[i].ran_un.ran_strx =
 		SWAP_LONG_LONG(ranlibs[i].ran_un.ran_strx);
 	    ranlibs[i].ran_off = SWAP_LONG_LONG(ranlibs[i].ran_off);
@@ -2869,13 +2970,21 @@ enum byte_sex target_byte_sex)
         dummy = target_byte_sex;
 #endif
 
-	for(i = 0; i < nindirect_symbols; i++)
+	i = (uint32_t)swap_vector(indirect_symbols, nindirect_symbols,
+				  sizeof(uint32_t), int_pattern);
+	for( ; i < nindirect_symbols; i++)
 	    indirect_symbols[i] = SWAP_INT(indirect_symbols[i]);
 }
 
-__private_extern__
+/*
+ * swap_dylib_reference_scalar() swaps dylib_reference structs one at a time
+ * through their bit fields.  Its result is a byte permutation of each struct
+ * that depends on how the compiler lays out bit fields, so swap_dylib_reference()
+ * gets the pattern for swap_vector() by running it on one probe struct.
+ */
+static
 void
-swap_dylib_reference(
+swap_dylib_reference_scalar(
 struct dylib_reference *refs,
 uint32_t nrefs,
 enum byte_sex target_byte_sex)
@@ -2910,7 +3019,29 @@ enum byte_sex target_byte_sex)
 		memcpy(refs + i, &sref, sizeof(struct swapped_dylib_reference));
 	    }
 	}
+}
+
+__private_extern__
+void
+swap_dylib_reference(
+struct dylib_reference *refs,
+uint32_t nrefs,
+enum byte_sex target_byte_sex)
+{
+    static const unsigned char probe_bytes[4] = { 0, 1, 2, 3 };
+    unsigned char pattern[4];
+    struct dylib_reference probe;
+    uint32_t i;
 
+	i = 0;
+	if(nrefs >= SWAP_VECTOR_BLOCK / sizeof(struct dylib_reference)){
+	    memcpy(&probe, probe_bytes, sizeof(struct dylib_reference));
+	    swap_dylib_reference_scalar(&probe, 1, target_byte_sex);
+	    memcpy(pattern, &probe, sizeof(struct dylib_reference));
+	    i = (uint32_t)swap_vector(refs, nrefs,
+				      sizeof(struct dylib_reference), pattern);
+	}
+	swap_dylib_reference_scalar(refs + i, nrefs - i, target_byte_sex);
 }
 
 __private_extern__
@@ -2990,7 +3121,10 @@ enum byte_sex target_byte_sex)
         dummy = target_byte_sex;
 #endif
 
-	for(i = 0; i < ntocs; i++){
+	i = (uint32_t)swap_vector(tocs, ntocs,
+				  sizeof(struct dylib_table_of_contents),
+				  int_pair_pattern);
+	for( ; i < ntocs; i++){
 	    tocs[i].symbol_index = SWAP_INT(tocs[i].symbol_index);
 	    tocs[i].module_index = SWAP_INT(tocs[i].module_index);
 	}
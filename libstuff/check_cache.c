@@ -0,0 +1,194 @@
+#ifndef RLD
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "stuff/bool.h"
+#include "stuff/allocate.h"
+#include "stuff/crc32.h"
+#include "stuff/check_cache.h"
+
+/*
+ * The cache file is a sequence of these records which processes append to
+ * with single writes, so it needs no locking.  A record that is not complete
+ * or does not have a matching magic number and crc is ignored, and as the
+ * cache is only an optimization any problem reading or writing the file just
+ * means slices get validated again.
+ */
+struct check_cache_record {
+    struct check_cache_key key;
+    uint32_t magic;		/* CHECK_CACHE_MAGIC */
+    uint32_t crc;		/* crc32() of the key and magic */
+};
+
+/*
+ * The version of the validation done by check_Mach_O() is part of the magic
+ * number so records made by older code are ignored once it is changed.
+ */
+#define CHECK_CACHE_MAGIC 0xc4ec0001
+
+/*
+ * When the cache file gets larger than this it is started over.
+ */
+#define CHECK_CACHE_MAX_SIZE (16 * 1024 * 1024)
+
+static enum bool check_cache_loaded = FALSE;
+static int check_cache_fd = -1;
+static struct check_cache_key *check_cache_keys = NULL;
+static uint32_t check_cache_nkeys = 0;
+
+static int
+check_cache_key_compare(
+const void *p1,
+const void *p2)
+{
+	return(memcmp(p1, p2, sizeof(struct check_cache_key)));
+}
+
+/*
+ * check_cache_load() is called the first time the cache is used.  If the
+ * cache is enabled it opens the cache file for appending and reads the valid
+ * records in it into check_cache_keys sorted for bsearch(3).
+ */
+static
+void
+check_cache_load(
+void)
+{
+    char *path;
+    struct stat stat_buf;
+    struct check_cache_record *records;
+    uint32_t i, nrecords;
+    ssize_t n;
+
+	check_cache_loaded = TRUE;
+	path = getenv("OFILE_CHECK_CACHE");
+	if(path == NULL || *path == '\0')
+	    return;
+
+	/*
+	 * As a record makes ofile skip validating a slice, the cache is only
+	 * used if it is a regular file owned by this user that others can't
+	 * write to, and it is created that way.
+	 */
+#ifdef O_NOFOLLOW
+	check_cache_fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_NOFOLLOW,
+			      0600);
+#else
+	check_cache_fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0600);
+#endif
+	if(check_cache_fd == -1)
+	    return;
+	if(fstat(check_cache_fd, &stat_buf) == -1 ||
+	   (stat_buf.st_mode & S_IFMT) != S_IFREG ||
+	   stat_buf.st_uid != geteuid() ||
+	   (stat_buf.st_mode & (S_IWGRP | S_IWOTH)) != 0){
+	    close(check_cache_fd);
+	    check_cache_fd = -1;
+	    return;
+	}
+
+	/*
+	 * A file whose size is not a multiple of the record size had a write
+	 * that failed part way, which leaves the records after it misaligned,
+	 * so it is started over as is one that has grown too large.
+	 */
+	if(stat_buf.st_size > CHECK_CACHE_MAX_SIZE ||
+	   stat_buf.st_size % sizeof(struct check_cache_record) != 0){
+	    if(ftruncate(check_cache_fd, 0) == -1){
+		close(check_cache_fd);
+		check_cache_fd = -1;
+	    }
+	    return;
+	}
+	if(stat_buf.st_size < (off_t)sizeof(struct check_cache_record))
+	    return;
+
+	nrecords = stat_buf.st_size / sizeof(struct check_cache_record);
+	records = allocate(nrecords * sizeof(struct check_cache_record));
+	n = pread(check_cache_fd, records,
+		  nrecords * sizeof(struct check_cache_record), 0);
+	if(n < 0)
+	    n = 0;
+	nrecords = n / sizeof(struct check_cache_record);
+
+	check_cache_keys = allocate(nrecords * sizeof(struct check_cache_key) +
+				    1);
+	for(i = 0; i < nrecords; i++){
+	    if(records[i].magic != CHECK_CACHE_MAGIC ||
+	       records[i].crc != crc32(records + i,
+			sizeof(struct check_cache_record) - sizeof(uint32_t)))
+		continue;
+	    check_cache_keys[check_cache_nkeys++] = records[i].key;
+	}
+	free(records);
+	qsort(check_cache_keys, check_cache_nkeys,
+	      sizeof(struct check_cache_key), check_cache_key_compare);
+}
+
+/*
+ * check_cache_enabled() returns TRUE if the cache is being used, so callers
+ * only need to compute keys if it is.
+ */
+__private_extern__
+enum bool
+check_cache_enabled(
+void)
+{
+	if(check_cache_loaded == FALSE)
+	    check_cache_load();
+	return((enum bool)(check_cache_fd != -1));
+}
+
+/*
+ * check_cache_lookup() returns TRUE if the slice for key has been recorded as
+ * valid in the cache.
+ */
+__private_extern__
+enum bool
+check_cache_lookup(
+const struct check_cache_key *key)
+{
+	if(check_cache_loaded == FALSE)
+	    check_cache_load();
+	if(check_cache_nkeys == 0)
+	    return(FALSE);
+	if(bsearch(key, check_cache_keys, check_cache_nkeys,
+		   sizeof(struct check_cache_key), check_cache_key_compare) ==
+	   NULL)
+	    return(FALSE);
+	return(TRUE);
+}
+
+/*
+ * check_cache_enter() records in the cache that the slice for key is valid.
+ * The record is appended to the cache file right away so it is not lost if
+ * this process is one forked to work in parallel or exits with an error.
+ */
+__private_extern__
+void
+check_cache_enter(
+const struct check_cache_key *key)
+{
+    struct check_cache_record record;
+
+	if(check_cache_loaded == FALSE)
+	    check_cache_load();
+	if(check_cache_fd == -1)
+	    return;
+
+	memset(&record, '\0', sizeof(struct check_cache_record));
+	record.key = *key;
+	record.magic = CHECK_CACHE_MAGIC;
+	record.crc = crc32(&record,
+			   sizeof(struct check_cache_record) - sizeof(uint32_t));
+	if(write(check_cache_fd, &record, sizeof(struct check_cache_record)) !=
+	   sizeof(struct check_cache_record)){
+	    close(check_cache_fd);
+	    check_cache_fd = -1;
+	}
+}
+#endif /* !defined(RLD) */
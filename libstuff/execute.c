@@ -27,12 +27,31 @@
 #include <signal.h>
 #include <sys/wait.h>
 #include <sys/file.h>
+#include <fcntl.h>
 #include <errno.h>
 #include "stuff/errors.h"
 #include "stuff/allocate.h"
 #include "stuff/execute.h"
+#include "stuff/parallel.h"
 #include "mach-o/dyld.h"
 
+static int execute_start_with_output(
+    char **argv,
+    int verbose,
+    int stdout_fd,
+    int stderr_fd);
+static int execute_reap(
+    int forkpid,
+    int *termsig);
+static int execute_status(
+    int waitstatus,
+    int *termsig);
+static int execute_output_file(
+    void);
+static void execute_copy_output(
+    int fd,
+    int output_fd);
+
 /*
  * execute() does an execvp using the argv passed to it.  If the parameter
  * verbose is non-zero the command is printed to stderr.  A non-zero return
@@ -43,14 +62,45 @@ int
 execute(
 char **argv,
 int verbose)
+{
+    int success, termsig;
+
+	success = execute_reap(execute_start(argv, verbose), &termsig);
+	if(termsig != 0 && termsig != SIGINT && termsig != SIGPIPE)
+	    fatal("fatal error in %s", argv[0]);
+	return(success);
+}
+
+/*
+ * execute_start() forks and does an execvp using the argv passed to it, as
+ * execute() does, but returns without waiting for the child.  If the parameter
+ * verbose is non-zero the command is printed to stderr.  The process id of the
+ * child is returned to be passed to execute_wait().
+ */
+__private_extern__
+int
+execute_start(
+char **argv,
+int verbose)
+{
+	return(execute_start_with_output(argv, verbose, -1, -1));
+}
+
+/*
+ * execute_start_with_output() is execute_start() but if stdout_fd and
+ * stderr_fd are not -1 the child's standard output and standard error are
+ * redirected to them.
+ */
+static
+int
+execute_start_with_output(
+char **argv,
+int verbose,
+int stdout_fd,
+int stderr_fd)
 {
     char *name, **p;
-    int forkpid, waitpid, termsig;
-#ifndef __OPENSTEP__
-    int waitstatus;
-#else
-    union wait waitstatus;
-#endif
+    int forkpid;
 
     name = argv[0];
 
@@ -67,31 +117,220 @@ int verbose)
 	    system_fatal("can't fork a new process to execute: %s", name);
 
 	if(forkpid == 0){
+	    if(stdout_fd != -1){
+		if(dup2(stdout_fd, 1) == -1 || dup2(stderr_fd, 2) == -1)
+		    system_fatal("can't redirect the output of: %s", name);
+	    }
 	    if(execvp(name, argv) == -1)
 		system_fatal("can't find or exec: %s", name);
-	    return(1); /* can't get here, removes a warning from the compiler */
 	}
-	else{
-            waitpid = -1;
-	    do{
-	        waitpid = wait(&waitstatus);
-	    } while (waitpid == -1 && errno == EINTR);
-	    if(waitpid == -1)
-		system_fatal("wait on forked process %d failed", forkpid);
-#ifndef __OPENSTEP__
-	    termsig = WTERMSIG(waitstatus);
-#else
-	    termsig = waitstatus.w_termsig;
-#endif
-	    if(termsig != 0 && termsig != SIGINT && termsig != SIGPIPE)
-		fatal("fatal error in %s", name);
-	    return(
+	return(forkpid);
+}
+
+/*
+ * execute_wait() waits for the child with the process id forkpid, started by
+ * execute_start() to run the program name, to exit.  A non-zero return value
+ * indicates success zero indicates failure.  Unlike execute() a child killed
+ * by a signal is reported as an error, not a fatal error, so the caller can
+ * still wait for its other children.
+ */
+__private_extern__
+int
+execute_wait(
+int forkpid,
+char *name)
+{
+    int termsig, success;
+
+	success = execute_reap(forkpid, &termsig);
+	if(termsig != 0 && termsig != SIGINT && termsig != SIGPIPE)
+	    error("fatal error in %s", name);
+	return(success);
+}
+
+/*
+ * execute_reap() waits for the child with the process id forkpid to exit, sets
+ * termsig to the signal that terminated it, or zero, and returns non-zero if it
+ * succeeded.
+ */
+static
+int
+execute_reap(
+int forkpid,
+int *termsig)
+{
+    int waitpid_ret;
+    int waitstatus;
+
+	do{
+	    waitpid_ret = waitpid(forkpid, (void *)&waitstatus, 0);
+	} while (waitpid_ret == -1 && errno == EINTR);
+	if(waitpid_ret == -1)
+	    system_fatal("wait on forked process %d failed", forkpid);
+	return(execute_status(waitstatus, termsig));
+}
+
+/*
+ * execute_status() is passed the status from waitpid() of a child.  It sets
+ * termsig to the signal that terminated the child, or zero, and returns
+ * non-zero if the child succeeded.
+ */
+static
+int
+execute_status(
+int waitstatus,
+int *termsig)
+{
 #ifndef __OPENSTEP__
-		WEXITSTATUS(waitstatus) == 0 &&
+	*termsig = WTERMSIG(waitstatus);
+	return(WEXITSTATUS(waitstatus) == 0 && *termsig == 0);
 #else
-		waitstatus.w_retcode == 0 &&
+    union wait *w;
+
+	w = (union wait *)&waitstatus;
+	*termsig = w->w_termsig;
+	return(w->w_retcode == 0 && *termsig == 0);
 #endif
-		termsig == 0);
+}
+
+/*
+ * execute_jobs() runs the njobs programs whose argument lists are in argvs[],
+ * with at most maxjobs of them running at once.  If maxjobs is zero the
+ * number of processors is used.  As each job can finish at any time, when more
+ * than one runs at once their standard output and standard error are saved in
+ * separate temporary files and copied to this process's standard output and
+ * standard error in the order of the jobs, each job's output after that of the
+ * jobs before it.  Only the jobs started here are waited for, the oldest one
+ * first, so the status of any other children of the caller is left for it.  A
+ * job killed by a signal is reported as an error, however many run at once.
+ * The result of each job is stored in results[] if it is not NULL, non-zero
+ * for success and zero for failure, and the number of jobs that failed is
+ * returned.  All the jobs are waited for even after one fails, so the caller
+ * can remove any files they were writing.
+ */
+__private_extern__
+uint32_t
+execute_jobs(
+char ***argvs,
+uint32_t njobs,
+uint32_t maxjobs,
+int verbose,
+int *results)
+{
+    uint32_t i, next_start, next_output, nfailed;
+    int *pids, *out_fds, *err_fds;
+    int success;
+
+	if(maxjobs == 0)
+	    maxjobs = parallel_njobs();
+	if(maxjobs > njobs)
+	    maxjobs = njobs;
+	if(maxjobs <= 1){
+	    nfailed = 0;
+	    for(i = 0; i < njobs; i++){
+		if(execute_wait(execute_start(argvs[i], verbose),
+				argvs[i][0]) == 0){
+		    nfailed++;
+		    if(results != NULL)
+			results[i] = 0;
+		}
+		else if(results != NULL)
+		    results[i] = 1;
+	    }
+	    return(nfailed);
+	}
+
+	pids = allocate(njobs * sizeof(int));
+	out_fds = allocate(njobs * sizeof(int));
+	err_fds = allocate(njobs * sizeof(int));
+
+	/*
+	 * Flush the stdio buffers so the output of the jobs copied to the file
+	 * descriptors comes after what this process has already printed.
+	 */
+	fflush(stdout);
+	fflush(stderr);
+	next_start = 0;
+	next_output = 0;
+	nfailed = 0;
+	while(next_output < njobs){
+	    while(next_start - next_output < maxjobs && next_start < njobs){
+		out_fds[next_start] = execute_output_file();
+		err_fds[next_start] = execute_output_file();
+		pids[next_start] = execute_start_with_output(argvs[next_start],
+				verbose, out_fds[next_start], err_fds[next_start]);
+		next_start++;
+	    }
+
+	    /*
+	     * Wait for the oldest job, whose output is the next to be copied
+	     * out, and start another in its place.
+	     */
+	    success = execute_wait(pids[next_output], argvs[next_output][0]);
+	    execute_copy_output(out_fds[next_output], 1);
+	    execute_copy_output(err_fds[next_output], 2);
+	    close(out_fds[next_output]);
+	    close(err_fds[next_output]);
+	    if(success == 0)
+		nfailed++;
+	    if(results != NULL)
+		results[next_output] = success;
+	    next_output++;
+	}
+
+	free(pids);
+	free(out_fds);
+	free(err_fds);
+	return(nfailed);
+}
+
+/*
+ * execute_output_file() creates and returns the file descriptor of an unlinked
+ * temporary file to save the output of a job run by execute_jobs().  It is
+ * close-on-exec so the other jobs started while it is open do not inherit it.
+ */
+static
+int
+execute_output_file(
+void)
+{
+    char *tmpdir, *path;
+    int fd;
+
+	tmpdir = getenv("TMPDIR");
+	if(tmpdir == NULL || *tmpdir == '\0')
+	    tmpdir = "/tmp";
+	path = makestr(tmpdir, "/execute.XXXXXX", NULL);
+	fd = mkstemp(path);
+	if(fd == -1)
+	    system_fatal("can't create temporary file: %s", path);
+	if(fcntl(fd, F_SETFD, FD_CLOEXEC) == -1)
+	    system_fatal("can't set close-on-exec for temporary file: %s",
+			 path);
+	unlink(path);
+	free(path);
+	return(fd);
+}
+
+/*
+ * execute_copy_output() copies the output saved in the temporary file fd by
+ * a job run by execute_jobs() to the file descriptor output_fd.
+ */
+static
+void
+execute_copy_output(
+int fd,
+int output_fd)
+{
+    char buf[8192];
+    ssize_t n;
+    off_t offset;
+
+	offset = 0;
+	while((n = pread(fd, buf, sizeof(buf), offset)) > 0){
+	    if(write(output_fd, buf, n) != n)
+		return;
+	    offset += n;
 	}
 }
 
@@ -173,6 +412,24 @@ char *str)
 	return(makestr(prefix, str, NULL));
 }
 
+/*
+ * copy_execute_list() returns a copy of the list of strings of command line
+ * arguments built up in the runlist, so it can be saved to be passed to
+ * execute_jobs() and the runlist reset to build another.
+ */
+__private_extern__
+char **
+copy_execute_list(
+void)
+{
+    char **argv;
+
+	argv = allocate((runlist.next + 1) * sizeof(char *));
+	memcpy(argv, runlist.strings, runlist.next * sizeof(char *));
+	argv[runlist.next] = (char *)0;
+	return(argv);
+}
+
 /*
  * This routine reset the list of strings of command line arguments so that
  * an new command line argument list can be built.
@@ -4,17 +4,131 @@
 #include <stdlib.h>
 #include <libc.h>
 #include <sys/file.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <dlfcn.h>
 #include <llvm-c/lto.h>
 #include "stuff/ofile.h"
 #include "stuff/lto.h"
 #include "stuff/allocate.h"
+#include "stuff/errors.h"
+#include "stuff/parallel.h"
+#include "stuff/crc32.h"
 #include <mach-o/nlist.h>
 #include <mach-o/dyld.h>
 
+/*
+ * The symbols of an llvm bitcode file are gathered from the lto module created
+ * for it into an lto_summary and the module is disposed of right away.  The
+ * summaries are what the void * module pointers handed out by this file point
+ * to.  Summaries are kept for the life of the process in a hash table keyed by
+ * two independent hashes of the bitcode's contents and its size, so bitcode
+ * that is seen again is not parsed again.  If the environment variable
+ * LTO_SYMBOL_CACHE is set to a directory the summaries are also saved there,
+ * one file for each bitcode contents and libLTO version, so later runs on the
+ * same bitcode do not parse it either.
+ *
+ * The data of a summary has the same form in memory, in the cache directory
+ * and when passed back from the processes forked by lto_prefetch(): an
+ * lto_summary_header followed by the symbols and then the strings for their
+ * names.
+ */
+struct lto_summary_header {
+    uint32_t magic;		/* LTO_SUMMARY_MAGIC */
+    uint32_t cputype;		/* from the target triple, zero if unknown */
+    uint32_t cpusubtype;	/* from the target triple, zero if unknown */
+    uint32_t nsyms;		/* number of lto_summary_symbol structs */
+    uint32_t strsize;		/* size of the strings for the names */
+};
+struct lto_summary_symbol {
+    uint32_t name;		/* offset of the name in the strings */
+    uint32_t attr;		/* the symbol's lto_symbol_attributes */
+};
+#define LTO_SUMMARY_MAGIC 0x17051a01
+
+/*
+ * What identifies the contents of bitcode, set by lto_content_key().
+ */
+struct lto_key {
+    uint64_t hash;		/* 64-bit FNV-1a hash of the bitcode */
+    uint32_t crc;		/* crc32() of the bitcode */
+    uint32_t size;		/* size of the bitcode */
+};
+
+/*
+ * A file in the cache directory starts with this header and the version
+ * string of the libLTO that made it, which must all match for the summary
+ * data that follows to be used.
+ */
+struct lto_cache_header {
+    uint32_t magic;		/* LTO_CACHE_MAGIC */
+    uint32_t version_size;	/* size of the version string, with its '\0' */
+    struct lto_key key;		/* the key of the bitcode */
+};
+#define LTO_CACHE_MAGIC 0x17051a02
+
+struct lto_summary {
+    struct lto_key key;		/* lto_content_key() of the bitcode */
+    enum bool cached;		/* TRUE if in lto_summaries[] */
+    char *data;			/* the header, symbols and strings */
+    uint32_t data_size;
+    struct lto_summary_header *header;
+    struct lto_summary_symbol *symbols;
+    char *strings;
+    struct lto_summary *next;	/* next in the hash chain */
+};
+#define LTO_SUMMARY_HASH_SIZE 1024
+static struct lto_summary *lto_summaries[LTO_SUMMARY_HASH_SIZE];
+
+/*
+ * lto_prefetch() passes the summaries made by its forked processes back in
+ * temporary files, one for each process, as this header followed by the data.
+ */
+struct lto_prefetch_record {
+    uint32_t index;		/* index of the bitcode passed to lto_prefetch */
+    uint32_t data_size;		/* size of the summary data that follows */
+};
+struct lto_prefetch_job {
+    char **addrs;		/* the bitcode to summarize */
+    uint32_t *sizes;
+    uint32_t njobs;
+    int *fds;			/* the temporary file for each process */
+};
+
+static int load_lto(
+    void);
 static int get_lto_cputype(
     struct arch_flag *arch_flag,
     const char *target_triple);
+static int lto_bitcode_magic(
+    const char *addr,
+    uint32_t size);
+static void lto_content_key(
+    const char *addr,
+    uint32_t size,
+    struct lto_key *key);
+static char *lto_summarize(
+    const char *addr,
+    uint32_t size,
+    uint32_t *data_size);
+static struct lto_summary *lto_summary_make(
+    struct lto_key *key,
+    char *data,
+    uint32_t data_size);
+static struct lto_summary *lto_summary_lookup(
+    struct lto_key *key);
+static void lto_summary_enter(
+    struct lto_summary *summary);
+static char *lto_summary_path(
+    struct lto_key *key);
+static char *lto_summary_read(
+    struct lto_key *key,
+    uint32_t *data_size);
+static void lto_summary_write(
+    struct lto_summary *summary);
+static void lto_prefetch_member(
+    uint32_t i,
+    void *cookie);
 
 static int tried_to_load_lto = 0;
 static void *lto_handle = NULL;
@@ -28,6 +142,16 @@ static unsigned int (*lto_get_num_symbols)(void *mod) = NULL;
 static lto_symbol_attributes (*lto_get_sym_attr)(void *mod,
                               unsigned int n) = NULL;
 static const char * (*lto_get_sym_name)(void *mod, unsigned int n) = NULL;
+static const char * (*lto_get_version)(void) = NULL;
+
+/* the version string of the libLTO loaded, or "" if it has none */
+static const char *lto_version = "";
+
+/*
+ * The number of processes lto_prefetch() splits its work between.  It is zero,
+ * and lto_prefetch() does nothing, unless a tool sets it from its -j option.
+ */
+__private_extern__ uint32_t lto_prefetch_njobs = 0;
 
 /*
  * is_llvm_bitcode() is passed an ofile struct pointer and a pointer and size
@@ -79,11 +203,10 @@ uint32_t size,
 struct arch_flag *arch_flag,
 void **pmod) /* maybe NULL */
 {
-
-   uint32_t bufsize;
-   char *p, *prefix, *lto_path, buf[MAXPATHLEN], resolved_name[PATH_MAX];
-   int i;
-   void *mod;
+    struct lto_summary *summary;
+    struct lto_key key;
+    uint32_t data_size;
+    char *data;
 
 	/*
 	 * The libLTO API's can't handle empty files.  So return 0 to indicate
@@ -92,6 +215,74 @@ void **pmod) /* maybe NULL */
 	if(size == 0)
 	    return(0);
 
+	if(load_lto() == 0)
+	    return(0);
+
+	/*
+	 * Only what starts like bitcode is looked up and entered in the cache,
+	 * anything else is handed to libLTO to decide as it always has been.
+	 */
+	summary = NULL;
+	if(lto_bitcode_magic(addr, size)){
+	    lto_content_key(addr, size, &key);
+	    summary = lto_summary_lookup(&key);
+	    if(summary == NULL){
+		data = lto_summarize(addr, size, &data_size);
+		if(data == NULL)
+		    return(0);
+		summary = lto_summary_make(&key, data, data_size);
+		if(summary == NULL)
+		    return(0);
+		lto_summary_enter(summary);
+		lto_summary_write(summary);
+	    }
+	}
+	else{
+	    data = lto_summarize(addr, size, &data_size);
+	    if(data == NULL)
+		return(0);
+	    memset(&key, '\0', sizeof(struct lto_key));
+	    key.size = size;
+	    summary = lto_summary_make(&key, data, data_size);
+	    if(summary == NULL)
+		return(0);
+	}
+
+	/*
+	 * It is possible for new targets to be added to lto that are not yet
+	 * known to this code.  So we will try to get lucky and let them pass
+	 * through with the cputype set to 0. This should work for things
+	 * like libtool(1) as long as we don't get two different unknown
+	 * targets.  But we'll hope that just doesn't happen.
+	 */
+	arch_flag->cputype = summary->header->cputype;
+	arch_flag->cpusubtype = summary->header->cpusubtype;
+	arch_flag->name = NULL;
+	if(arch_flag->cputype != 0)
+	    arch_flag->name = (char *)get_arch_name_from_types(
+				arch_flag->cputype, arch_flag->cpusubtype);
+
+	if(pmod != NULL)
+	    *pmod = summary;
+	else
+	    lto_free(summary);
+
+	return(1);
+}
+
+/*
+ * load_lto() loads libLTO the first time it is called and returns 1 if it is
+ * loaded and 0 if it could not be.
+ */
+static
+int
+load_lto(
+void)
+{
+    uint32_t bufsize;
+    char *p, *prefix, *lto_path, buf[MAXPATHLEN], resolved_name[PATH_MAX];
+    int i;
+
 	if(tried_to_load_lto == 0){
 	    tried_to_load_lto = 1;
 	    /*
@@ -138,6 +329,7 @@ void **pmod) /* maybe NULL */
 	    lto_get_sym_attr = dlsym(lto_handle,
 				     "lto_module_get_symbol_attribute");
 	    lto_get_sym_name = dlsym(lto_handle, "lto_module_get_symbol_name");
+	    lto_get_version = dlsym(lto_handle, "lto_get_version");
 
 	    if(lto_is_object == NULL ||
 	       lto_create == NULL ||
@@ -151,37 +343,11 @@ void **pmod) /* maybe NULL */
 		    free(lto_path);
 		return(0);
 	    }
+	    if(lto_get_version != NULL && lto_get_version() != NULL)
+		lto_version = lto_get_version();
 	}
 	if(lto_handle == NULL)
 	    return(0);
-	    
-	if(!lto_is_object(addr, size))
-	    return(0);
-	
-	if(lto_create_local)
-	    mod = lto_create_local(addr, size, "is_llvm_bitcode_from_memory");
-	else
-	    mod = lto_create(addr, size);
-	if(mod == NULL)
-	    return(0);
-
-	/*
-	 * It is possible for new targets to be added to lto that are not yet
-	 * known to this code.  So we will try to get lucky and let them pass
-	 * through with the cputype set to 0. This should work for things
-	 * like libtool(1) as long as we don't get two different unknown
-	 * targets.  But we'll hope that just doesn't happen.
-	 */
-	arch_flag->cputype = 0;
-	arch_flag->cpusubtype = 0;
-	arch_flag->name = NULL;
-	(void)get_lto_cputype(arch_flag, lto_get_target(mod));
-
-	if(pmod != NULL)
-	    *pmod = mod;
-	else
-	    lto_free(mod);
-
 	return(1);
 }
 
@@ -298,6 +464,344 @@ const char *target_triple)
 	return(1);
 }
 
+/*
+ * lto_bitcode_magic() returns 1 if the bytes at addr start with the magic
+ * number of llvm bitcode, either raw or in a bitcode wrapper, and 0 if not.
+ */
+static
+int
+lto_bitcode_magic(
+const char *addr,
+uint32_t size)
+{
+    const unsigned char *p;
+
+	if(size < 4)
+	    return(0);
+	p = (const unsigned char *)addr;
+	if(p[0] == 'B' && p[1] == 'C' && p[2] == 0xc0 && p[3] == 0xde)
+	    return(1);
+	if(p[0] == 0xde && p[1] == 0xc0 && p[2] == 0x17 && p[3] == 0x0b)
+	    return(1);
+	return(0);
+}
+
+/*
+ * lto_content_key() sets key from the size bytes of bitcode at addr, with both
+ * the 64-bit FNV-1a hash and the crc32() of them so a collision of one does
+ * not have the summary of other bitcode used.
+ */
+static
+void
+lto_content_key(
+const char *addr,
+uint32_t size,
+struct lto_key *key)
+{
+    const unsigned char *p;
+    uint64_t hash;
+    uint32_t i;
+
+	p = (const unsigned char *)addr;
+	hash = 0xcbf29ce484222325ULL;
+	for(i = 0; i < size; i++){
+	    hash ^= p[i];
+	    hash *= 0x100000001b3ULL;
+	}
+	memset(key, '\0', sizeof(struct lto_key));
+	key->hash = hash;
+	key->crc = crc32(addr, size);
+	key->size = size;
+}
+
+/*
+ * lto_summarize() creates an lto module for the bitcode at addr and returns
+ * the data of a summary of it, with its size in data_size.  If the bytes at
+ * addr are not bitcode libLTO can use it returns NULL.
+ */
+static
+char *
+lto_summarize(
+const char *addr,
+uint32_t size,
+uint32_t *data_size)
+{
+    lto_module_t mod;
+    struct arch_flag arch_flag;
+    struct lto_summary_header header;
+    struct lto_summary_symbol *symbols;
+    const char *name;
+    char *data, *strings;
+    uint32_t i, len;
+
+	if(!lto_is_object(addr, size))
+	    return(NULL);
+
+	if(lto_create_local)
+	    mod = lto_create_local(addr, size, "is_llvm_bitcode_from_memory");
+	else
+	    mod = lto_create(addr, size);
+	if(mod == NULL)
+	    return(NULL);
+
+	memset(&header, '\0', sizeof(struct lto_summary_header));
+	header.magic = LTO_SUMMARY_MAGIC;
+	if(get_lto_cputype(&arch_flag, lto_get_target(mod)) != 0){
+	    header.cputype = arch_flag.cputype;
+	    header.cpusubtype = arch_flag.cpusubtype;
+	}
+	header.nsyms = lto_get_num_symbols(mod);
+	header.strsize = 0;
+	for(i = 0; i < header.nsyms; i++){
+	    name = lto_get_sym_name(mod, i);
+	    header.strsize += (name == NULL ? 0 : strlen(name)) + 1;
+	}
+
+	*data_size = sizeof(struct lto_summary_header) +
+		     header.nsyms * sizeof(struct lto_summary_symbol) +
+		     header.strsize;
+	data = allocate(*data_size);
+	memcpy(data, &header, sizeof(struct lto_summary_header));
+	symbols = (struct lto_summary_symbol *)
+		  (data + sizeof(struct lto_summary_header));
+	strings = (char *)(symbols + header.nsyms);
+	len = 0;
+	for(i = 0; i < header.nsyms; i++){
+	    name = lto_get_sym_name(mod, i);
+	    if(name == NULL)
+		name = "";
+	    symbols[i].name = len;
+	    symbols[i].attr = lto_get_sym_attr(mod, i);
+	    strcpy(strings + len, name);
+	    len += strlen(name) + 1;
+	}
+	lto_dispose(mod);
+	return(data);
+}
+
+/*
+ * lto_summary_make() returns a summary for the data, which it takes ownership
+ * of, for the bitcode with the key.  As the data may have come from
+ * the cache directory it is checked and if it is not valid it is freed and
+ * NULL is returned.
+ */
+static
+struct lto_summary *
+lto_summary_make(
+struct lto_key *key,
+char *data,
+uint32_t data_size)
+{
+    struct lto_summary *summary;
+    struct lto_summary_header header;
+    uint32_t i;
+
+	if(data_size < sizeof(struct lto_summary_header))
+	    goto invalid;
+	memcpy(&header, data, sizeof(struct lto_summary_header));
+	if(header.magic != LTO_SUMMARY_MAGIC ||
+	   header.nsyms > (data_size - sizeof(struct lto_summary_header)) /
+			  sizeof(struct lto_summary_symbol) ||
+	   data_size != sizeof(struct lto_summary_header) +
+			header.nsyms * sizeof(struct lto_summary_symbol) +
+			header.strsize)
+	    goto invalid;
+	if(header.strsize != 0 && data[data_size - 1] != '\0')
+	    goto invalid;
+
+	summary = allocate(sizeof(struct lto_summary));
+	memset(summary, '\0', sizeof(struct lto_summary));
+	summary->key = *key;
+	summary->cached = FALSE;
+	summary->data = data;
+	summary->data_size = data_size;
+	summary->header = (struct lto_summary_header *)data;
+	summary->symbols = (struct lto_summary_symbol *)
+			   (data + sizeof(struct lto_summary_header));
+	summary->strings = (char *)(summary->symbols + header.nsyms);
+	for(i = 0; i < header.nsyms; i++){
+	    if(summary->symbols[i].name >= header.strsize){
+		free(summary);
+		goto invalid;
+	    }
+	}
+	return(summary);
+
+invalid:
+	free(data);
+	return(NULL);
+}
+
+/*
+ * lto_summary_lookup() returns the summary of the bitcode with the key,
+ * looking in the cache directory if it is not in the hash table.  If there is
+ * no summary for it NULL is returned.
+ */
+static
+struct lto_summary *
+lto_summary_lookup(
+struct lto_key *key)
+{
+    struct lto_summary *summary;
+    char *data;
+    uint32_t data_size;
+
+	for(summary = lto_summaries[key->hash % LTO_SUMMARY_HASH_SIZE];
+	    summary != NULL;
+	    summary = summary->next){
+	    if(summary->key.hash == key->hash &&
+	       summary->key.crc == key->crc &&
+	       summary->key.size == key->size)
+		return(summary);
+	}
+	data = lto_summary_read(key, &data_size);
+	if(data == NULL)
+	    return(NULL);
+	summary = lto_summary_make(key, data, data_size);
+	if(summary != NULL)
+	    lto_summary_enter(summary);
+	return(summary);
+}
+
+/*
+ * lto_summary_enter() enters the summary in the hash table.  Summaries in the
+ * hash table are never freed.
+ */
+static
+void
+lto_summary_enter(
+struct lto_summary *summary)
+{
+    uint32_t bucket;
+
+	bucket = summary->key.hash % LTO_SUMMARY_HASH_SIZE;
+	summary->next = lto_summaries[bucket];
+	lto_summaries[bucket] = summary;
+	summary->cached = TRUE;
+}
+
+/*
+ * lto_summary_path() returns the path of the file in the cache directory for
+ * the summary of the bitcode with the key, or NULL if the cache directory is
+ * not being used.  The name also has the crc32() of the libLTO version string
+ * so the summaries made by different versions are kept apart.
+ */
+static
+char *
+lto_summary_path(
+struct lto_key *key)
+{
+    char *dir, name[48];
+
+	dir = getenv("LTO_SYMBOL_CACHE");
+	if(dir == NULL || *dir == '\0')
+	    return(NULL);
+	snprintf(name, sizeof(name), "%016llx-%08x-%u-%08x",
+		 (unsigned long long)key->hash, key->crc, key->size,
+		 crc32(lto_version, strlen(lto_version)));
+	return(makestr(dir, "/", name, NULL));
+}
+
+/*
+ * lto_summary_read() returns the data of the summary saved in the cache
+ * directory for the bitcode with the key, with its size in data_size, or NULL
+ * if there is none.  The file's header and version string must match the key
+ * and the libLTO loaded exactly.
+ */
+static
+char *
+lto_summary_read(
+struct lto_key *key,
+uint32_t *data_size)
+{
+    char *path, *version, *data;
+    struct stat stat_buf;
+    struct lto_cache_header header;
+    uint32_t version_size;
+    int fd;
+
+	path = lto_summary_path(key);
+	if(path == NULL)
+	    return(NULL);
+	fd = open(path, O_RDONLY);
+	free(path);
+	if(fd == -1)
+	    return(NULL);
+	data = NULL;
+	version_size = strlen(lto_version) + 1;
+	if(fstat(fd, &stat_buf) == -1 ||
+	   stat_buf.st_size < (off_t)(sizeof(struct lto_cache_header) +
+				      version_size +
+				      sizeof(struct lto_summary_header)) ||
+	   stat_buf.st_size > UINT32_MAX ||
+	   read(fd, &header, sizeof(struct lto_cache_header)) !=
+	   (ssize_t)sizeof(struct lto_cache_header) ||
+	   header.magic != LTO_CACHE_MAGIC ||
+	   header.version_size != version_size ||
+	   memcmp(&header.key, key, sizeof(struct lto_key)) != 0){
+	    close(fd);
+	    return(NULL);
+	}
+	version = allocate(version_size);
+	if(read(fd, version, version_size) == (ssize_t)version_size &&
+	   memcmp(version, lto_version, version_size) == 0){
+	    *data_size = (uint32_t)stat_buf.st_size -
+			 sizeof(struct lto_cache_header) - version_size;
+	    data = allocate(*data_size);
+	    if(read(fd, data, *data_size) != (ssize_t)*data_size){
+		free(data);
+		data = NULL;
+	    }
+	}
+	free(version);
+	close(fd);
+	return(data);
+}
+
+/*
+ * lto_summary_write() saves the summary in the cache directory if it is being
+ * used.  The data is written to a temporary file that is then renamed, so
+ * other processes never see a partial file.  As the cache is only an
+ * optimization, failing to save the summary is not an error.
+ */
+static
+void
+lto_summary_write(
+struct lto_summary *summary)
+{
+    char *path, *tmp_path;
+    struct lto_cache_header header;
+    int fd;
+
+	path = lto_summary_path(&summary->key);
+	if(path == NULL)
+	    return;
+	memset(&header, '\0', sizeof(struct lto_cache_header));
+	header.magic = LTO_CACHE_MAGIC;
+	header.version_size = strlen(lto_version) + 1;
+	header.key = summary->key;
+	tmp_path = makestr(path, ".XXXXXX", NULL);
+	fd = mkstemp(tmp_path);
+	if(fd != -1){
+	    if(write(fd, &header, sizeof(struct lto_cache_header)) ==
+	       (ssize_t)sizeof(struct lto_cache_header) &&
+	       write(fd, lto_version, header.version_size) ==
+	       (ssize_t)header.version_size &&
+	       write(fd, summary->data, summary->data_size) ==
+	       (ssize_t)summary->data_size &&
+	       close(fd) == 0){
+		if(rename(tmp_path, path) == -1)
+		    unlink(tmp_path);
+	    }
+	    else{
+		close(fd);
+		unlink(tmp_path);
+	    }
+	}
+	free(tmp_path);
+	free(path);
+}
+
 /*
  * lto_get_nsyms() returns the number of symbol in the lto module passed to it.
  */
@@ -306,7 +810,10 @@ uint32_t
 lto_get_nsyms(
 void *mod)
 {
-	return(lto_get_num_symbols(mod));
+    struct lto_summary *summary;
+
+	summary = (struct lto_summary *)mod;
+	return(summary->header->nsyms);
 }
 
 /*
@@ -324,7 +831,7 @@ int commons_in_toc)
 {
     lto_symbol_attributes attr;
 
-	attr = lto_get_sym_attr(mod, symbol_index);
+	attr = ((struct lto_summary *)mod)->symbols[symbol_index].attr;
 	if((attr & LTO_SYMBOL_SCOPE_MASK) == LTO_SYMBOL_SCOPE_INTERNAL)
 	   return(0);
 
@@ -355,7 +862,7 @@ uint32_t symbol_index)
     lto_symbol_attributes attr;
 
 	memset(nl, '\0', sizeof(struct nlist_64));
-	attr = lto_get_sym_attr(mod, symbol_index);
+	attr = ((struct lto_summary *)mod)->symbols[symbol_index].attr;
 
 	switch(attr & LTO_SYMBOL_SCOPE_MASK){
 	case LTO_SYMBOL_SCOPE_INTERNAL:
@@ -409,15 +916,180 @@ lto_symbol_name(
 void *mod,
 uint32_t symbol_index)
 {
-	return(lto_get_sym_name(mod, symbol_index));
+    struct lto_summary *summary;
+
+	summary = (struct lto_summary *)mod;
+	return(summary->strings + summary->symbols[symbol_index].name);
 }
 
+/*
+ * lto_free() is passed an lto module when the caller is done with it.  The
+ * summaries in the hash table are kept for the life of the process so only
+ * the ones that are not in it are freed.
+ */
 __private_extern__
 void
 lto_free(
 void *mod)
 {
-	lto_dispose(mod);
+    struct lto_summary *summary;
+
+	summary = (struct lto_summary *)mod;
+	if(summary->cached == TRUE)
+	    return;
+	free(summary->data);
+	free(summary);
+}
+
+/*
+ * lto_prefetch() is passed the addresses and sizes of n files, such as the
+ * members of an archive, and summarizes the ones that are llvm bitcode that
+ * has not been summarized yet, splitting the work between lto_prefetch_njobs
+ * processes with parallel_for().  The summaries are entered in the hash table
+ * so the later calls to is_llvm_bitcode_from_memory() for them do not parse
+ * the bitcode.  It does nothing unless the tool has set lto_prefetch_njobs.
+ */
+__private_extern__
+void
+lto_prefetch(
+char **addrs,
+uint32_t *sizes,
+uint32_t n)
+{
+    struct lto_prefetch_job job;
+    struct lto_prefetch_record record;
+    struct lto_summary *summary;
+    struct stat stat_buf;
+    struct lto_key key, *todo_keys;
+    char **todo_addrs, *buf, *data, *tmpdir, *tmp_path;
+    uint32_t *todo_sizes, i, j, ntodo;
+    uint64_t offset;
+
+	if(n < 2 || lto_prefetch_njobs < 2)
+	    return;
+	if(load_lto() == 0)
+	    return;
+
+	todo_addrs = allocate(n * sizeof(char *));
+	todo_sizes = allocate(n * sizeof(uint32_t));
+	todo_keys = allocate(n * sizeof(struct lto_key));
+	ntodo = 0;
+	for(i = 0; i < n; i++){
+	    if(lto_bitcode_magic(addrs[i], sizes[i]) == 0)
+		continue;
+	    lto_content_key(addrs[i], sizes[i], &key);
+	    if(lto_summary_lookup(&key) != NULL)
+		continue;
+	    todo_addrs[ntodo] = addrs[i];
+	    todo_sizes[ntodo] = sizes[i];
+	    todo_keys[ntodo] = key;
+	    ntodo++;
+	}
+	if(ntodo < 2)
+	    goto done;
+
+	/*
+	 * Each worker process writes its summaries to a temporary file that is
+	 * created here, and already unlinked, so it can be read back after the
+	 * workers are done.
+	 */
+	job.addrs = todo_addrs;
+	job.sizes = todo_sizes;
+	job.njobs = lto_prefetch_njobs;
+	if(job.njobs > ntodo)
+	    job.njobs = ntodo;
+	job.fds = allocate(job.njobs * sizeof(int));
+	tmpdir = getenv("TMPDIR");
+	if(tmpdir == NULL || *tmpdir == '\0')
+	    tmpdir = "/tmp";
+	for(i = 0; i < job.njobs; i++){
+	    tmp_path = makestr(tmpdir, "/lto_prefetch.XXXXXX", NULL);
+	    job.fds[i] = mkstemp(tmp_path);
+	    if(job.fds[i] != -1)
+		unlink(tmp_path);
+	    free(tmp_path);
+	    if(job.fds[i] == -1){
+		for(j = 0; j < i; j++)
+		    close(job.fds[j]);
+		free(job.fds);
+		goto done;
+	    }
+	}
+
+	parallel_for(ntodo, job.njobs, lto_prefetch_member, &job);
+
+	for(i = 0; i < job.njobs; i++){
+	    if(fstat(job.fds[i], &stat_buf) == -1 || stat_buf.st_size == 0){
+		close(job.fds[i]);
+		continue;
+	    }
+	    buf = allocate(stat_buf.st_size);
+	    if(pread(job.fds[i], buf, stat_buf.st_size, 0) != stat_buf.st_size){
+		free(buf);
+		close(job.fds[i]);
+		continue;
+	    }
+	    close(job.fds[i]);
+	    offset = 0;
+	    while(offset + sizeof(struct lto_prefetch_record) <=
+		  (uint64_t)stat_buf.st_size){
+		memcpy(&record, buf + offset,
+		       sizeof(struct lto_prefetch_record));
+		offset += sizeof(struct lto_prefetch_record);
+		if(record.index >= ntodo ||
+		   offset + record.data_size > (uint64_t)stat_buf.st_size)
+		    break;
+		data = allocate(record.data_size);
+		memcpy(data, buf + offset, record.data_size);
+		offset += record.data_size;
+		summary = lto_summary_make(todo_keys + record.index, data,
+					   record.data_size);
+		if(summary == NULL)
+		    continue;
+		lto_summary_enter(summary);
+		lto_summary_write(summary);
+	    }
+	    free(buf);
+	}
+	free(job.fds);
+
+done:
+	free(todo_addrs);
+	free(todo_sizes);
+	free(todo_keys);
+}
+
+/*
+ * lto_prefetch_member() is called by parallel_for() to summarize the i'th
+ * bitcode file of an lto_prefetch_job and write the summary to the temporary
+ * file of the worker process it is called in.  If the bitcode is not something
+ * libLTO can use nothing is written, and is_llvm_bitcode_from_memory() will
+ * find that out again later.
+ */
+static
+void
+lto_prefetch_member(
+uint32_t i,
+void *cookie)
+{
+    struct lto_prefetch_job *job;
+    struct lto_prefetch_record record;
+    char *data;
+    uint32_t data_size;
+    int fd;
+
+	job = (struct lto_prefetch_job *)cookie;
+	fd = job->fds[i % job->njobs];
+	data = lto_summarize(job->addrs[i], job->sizes[i], &data_size);
+	if(data == NULL)
+	    return;
+	record.index = i;
+	record.data_size = data_size;
+	if(write(fd, &record, sizeof(struct lto_prefetch_record)) !=
+	   sizeof(struct lto_prefetch_record) ||
+	   write(fd, data, data_size) != (ssize_t)data_size)
+	    fatal("can't write llvm bitcode symbols to temporary file");
+	free(data);
 }
 
 #endif /* LTO_SUPPORT */
@@ -0,0 +1,119 @@
+#ifndef RLD
+#include <stdlib.h>
+#include <string.h>
+#include "stuff/allocate.h"
+#include "stuff/errors.h"
+#include "stuff/name_hash.h"
+
+static uint32_t name_hash_string(
+    const char *name);
+
+/*
+ * name_hash_init() sets up the name_hash for up to max_names names.  There are
+ * at least twice as many buckets as names so the chains stay short.
+ */
+__private_extern__
+void
+name_hash_init(
+struct name_hash *hash,
+uint32_t max_names)
+{
+	hash->nbuckets = 16;
+	while(hash->nbuckets < max_names * 2 && hash->nbuckets < 0x80000000)
+	    hash->nbuckets *= 2;
+	hash->buckets = allocate(hash->nbuckets * sizeof(uint32_t));
+	memset(hash->buckets, '\0', hash->nbuckets * sizeof(uint32_t));
+	hash->next = allocate((max_names + 1) * sizeof(uint32_t));
+	hash->hashes = allocate((max_names + 1) * sizeof(uint32_t));
+	hash->names = allocate((max_names + 1) * sizeof(const char *));
+	hash->nnames = 0;
+	hash->max_names = max_names;
+}
+
+/*
+ * name_hash_enter() enters name as the next entry and returns its index.  The
+ * entry is added at the end of its chain so when the same name is entered
+ * more than once name_hash_lookup() finds the first.
+ */
+__private_extern__
+uint32_t
+name_hash_enter(
+struct name_hash *hash,
+const char *name)
+{
+    uint32_t h, i, *p;
+
+	if(hash->nnames >= hash->max_names)
+	    fatal("internal error: name_hash_enter() called with more than "
+		  "%u names", hash->max_names);
+	h = name_hash_string(name);
+	i = hash->nnames++;
+	hash->hashes[i] = h;
+	hash->names[i] = name;
+	hash->next[i] = 0;
+	p = hash->buckets + (h & (hash->nbuckets - 1));
+	while(*p != 0)
+	    p = hash->next + (*p - 1);
+	*p = i + 1;
+	return(i);
+}
+
+/*
+ * name_hash_lookup() returns the index of the first entry for name, or -1 if
+ * there is none.
+ */
+__private_extern__
+int32_t
+name_hash_lookup(
+const struct name_hash *hash,
+const char *name)
+{
+    uint32_t h, i;
+
+	if(hash->nnames == 0)
+	    return(-1);
+	h = name_hash_string(name);
+	for(i = hash->buckets[h & (hash->nbuckets - 1)];
+	    i != 0;
+	    i = hash->next[i - 1]){
+	    if(hash->hashes[i - 1] == h &&
+	       strcmp(hash->names[i - 1], name) == 0)
+		return(i - 1);
+	}
+	return(-1);
+}
+
+/*
+ * name_hash_free() frees the memory of the name_hash.
+ */
+__private_extern__
+void
+name_hash_free(
+struct name_hash *hash)
+{
+	free(hash->buckets);
+	free(hash->next);
+	free(hash->hashes);
+	free(hash->names);
+	memset(hash, '\0', sizeof(struct name_hash));
+}
+
+/*
+ * name_hash_string() returns the 32-bit FNV-1a hash of name.
+ */
+static
+uint32_t
+name_hash_string(
+const char *name)
+{
+    const unsigned char *p;
+    uint32_t h;
+
+	h = 2166136261U;
+	for(p = (const unsigned char *)name; *p != '\0'; p++){
+	    h ^= *p;
+	    h *= 16777619U;
+	}
+	return(h);
+}
+#endif /* !defined(RLD) */
@@ -48,6 +48,7 @@
 #include <sys/file.h>
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <sys/wait.h>
 #include <mach-o/fat.h>
 #include <mach-o/loader.h>
 #import <mach/m68k/thread_status.h>
@@ -68,6 +69,8 @@
 #include <mach-o/dyld.h>
 #else
 #include "stuff/lto.h"
+#include "stuff/crc32.h"
+#include "stuff/check_cache.h"
 #endif
 #include "stuff/bytesex.h"
 #include "stuff/arch.h"
@@ -129,8 +132,23 @@ static enum check_type check_archive_toc(
     struct ofile *ofile);
 static enum check_type check_Mach_O(
     struct ofile *ofile);
+#if !defined(OTOOL) && !defined(OFI)
+static enum bool check_Mach_O_cache_key(
+    struct ofile *ofile,
+    uint32_t sizeofhdrs,
+    struct check_cache_key *key);
+#endif /* !defined(OTOOL) && !defined(OFI) */
 static void swap_back_Mach_O(
     struct ofile *ofile);
+#ifdef LTO_SUPPORT
+static void ofile_lto_prefetch(
+    char *addr,
+    uint64_t size);
+#endif /* LTO_SUPPORT */
+static struct fat_header *ofile_fat_headers_copy(
+    char **copy,
+    char *addr,
+    uint64_t size);
 #ifndef OTOOL
 static enum check_type check_overlaping_element(
     struct ofile *ofile,
@@ -147,6 +165,85 @@ static enum check_type check_dylib_module(
     struct dysymtab_command *dyst,
     char *strings,
     uint32_t module_index);
+#ifndef OFI
+/*
+ * If ofile_map_read_only is TRUE then ofile_map() maps files read-only.  Then
+ * the headers that need to be swapped to the host byte sex are copied into
+ * buffers in the ofile struct and swapped there, so the file's pages are never
+ * written.  A tool sets this only if it does not write to the file's contents
+ * itself, for example by swapping symbol tables in place.
+ */
+__private_extern__ enum bool ofile_map_read_only = FALSE;
+
+static void ofile_process_walk(
+    char *name,
+    struct arch_flag *arch_flags,
+    uint32_t narch_flags,
+    enum bool all_archs,
+    enum bool process_non_objects,
+    enum bool dylib_flat,
+    enum bool use_member_syntax,
+    void (*processor)(struct ofile *ofile, char *arch_name, void *cookie),
+    void *cookie);
+static void ofile_process_worker_call(
+    struct ofile *ofile,
+    char *arch_name,
+    void *cookie);
+static void ofile_process_splice(
+    struct ofile *ofile,
+    char *arch_name,
+    void *cookie);
+static void ofile_process_copy(
+    int fd,
+    off_t offset,
+    off_t size,
+    int to_fd);
+static void ofile_process_worker_died(
+    uint32_t worker);
+
+/*
+ * If ofile_process_njobs is greater than one then ofile_process() makes its
+ * calls to the processor routine in that many worker processes (see the
+ * comments before ofile_process() below).  Tools set this to opt in.
+ */
+__private_extern__ uint32_t ofile_process_njobs = 0;
+
+/*
+ * When ofile_process() is run in parallel each worker process and the parent
+ * process walk the file the same way and so make the same sequence of calls
+ * to the processor.  Call number n is done by worker n % njobs which writes
+ * its output for the call to its own temporary files and then writes an
+ * ofile_process_record for it to a pipe.  The parent process reads the
+ * records in call order and copies the output of each call to its stdout and
+ * stderr, so the output is in the same order as if done serially.
+ */
+struct ofile_process_record {
+    off_t out_offset;	/* offset of this call's output in the stdout file */
+    off_t out_size;	/* size of this call's output in the stdout file */
+    off_t err_offset;	/* offset of this call's output in the stderr file */
+    off_t err_size;	/* size of this call's output in the stderr file */
+    uint32_t nerrors;	/* number of calls to error() made by this call */
+};
+
+struct ofile_process_worker {
+    pid_t pid;		/* process id of the worker */
+    FILE *out;		/* temporary file for the worker's stdout */
+    FILE *err;		/* temporary file for the worker's stderr */
+    int record_fd;	/* read end of the pipe of ofile_process_records */
+    off_t err_end;	/* end of last call's output in the stderr file */
+};
+
+static struct ofile_process_worker *ofile_process_workers = NULL;
+static uint32_t ofile_process_nworkers = 0;
+static uint32_t ofile_process_worker_index = 0;
+static uint32_t ofile_process_ncalls = 0;
+static int ofile_process_record_fd = -1;
+static char *ofile_process_name = NULL;
+static void (*ofile_process_processor)(
+    struct ofile *ofile,
+    char *arch_name,
+    void *cookie) = NULL;
+#endif /* !defined(OFI) */
 
 #ifndef OTOOL
 #if defined(ALIGNMENT_CHECKS) || defined(ALIGNMENT_CHECKS_ARCHIVE_64_BIT)
@@ -188,6 +285,14 @@ const char *format, ...)
  * the corresponding ofile struct, the arch_name pass to it is either NULL or
  * an architecture name (when it should be printed or show by processor) and
  * cookie is the same value as passed to ofile_process.
+ *
+ * If ofile_process_njobs is greater than one the calls to processor are done
+ * by that many worker processes at the same time.  The output each call
+ * writes to stdout and stderr is saved and printed in the order of the calls
+ * and the calls to error() are counted in errors.  Any other side effects a
+ * processor has, on globals or through cookie, are lost as they happen in the
+ * worker processes.  So a tool only sets ofile_process_njobs when its
+ * processor only prints and reports errors.
  */
 __private_extern__
 void
@@ -201,6 +306,109 @@ enum bool dylib_flat,
 enum bool use_member_syntax,
 void (*processor)(struct ofile *ofile, char *arch_name, void *cookie),
 void *cookie)
+{
+    uint32_t i;
+    int fds[2];
+    pid_t pid;
+    struct ofile_process_worker *worker;
+    int waitstatus;
+
+	if(ofile_process_njobs <= 1){
+	    ofile_process_walk(name, arch_flags, narch_flags, all_archs,
+			       process_non_objects, dylib_flat,
+			       use_member_syntax, processor, cookie);
+	    return;
+	}
+
+	ofile_process_nworkers = ofile_process_njobs;
+	ofile_process_workers = allocate(ofile_process_nworkers *
+					 sizeof(struct ofile_process_worker));
+	ofile_process_name = name;
+	ofile_process_processor = processor;
+	ofile_process_ncalls = 0;
+
+	/*
+	 * Anything still buffered would otherwise be written again by each
+	 * of the workers.
+	 */
+	fflush(stdout);
+	fflush(stderr);
+	for(i = 0; i < ofile_process_nworkers; i++){
+	    worker = ofile_process_workers + i;
+	    worker->out = tmpfile();
+	    worker->err = tmpfile();
+	    if(worker->out == NULL || worker->err == NULL)
+		system_fatal("can't create temporary file for worker process");
+	    if(pipe(fds) == -1)
+		system_fatal("can't create pipe for worker process");
+	    worker->err_end = 0;
+	    pid = fork();
+	    if(pid == -1)
+		system_fatal("can't fork worker process");
+	    if(pid == 0){
+		close(fds[0]);
+		if(dup2(fileno(worker->out), STDOUT_FILENO) == -1 ||
+		   dup2(fileno(worker->err), STDERR_FILENO) == -1)
+		    system_fatal("can't redirect output of worker process");
+		ofile_process_worker_index = i;
+		ofile_process_record_fd = fds[1];
+		ofile_process_walk(name, arch_flags, narch_flags, all_archs,
+				   process_non_objects, dylib_flat,
+				   use_member_syntax, ofile_process_worker_call,
+				   cookie);
+		fflush(stdout);
+		fflush(stderr);
+		_exit(EXIT_SUCCESS);
+	    }
+	    close(fds[1]);
+	    worker->pid = pid;
+	    worker->record_fd = fds[0];
+	}
+
+	/*
+	 * The parent walks the file too, printing what the walk itself prints,
+	 * and in place of each call to processor prints its output from the
+	 * worker that did the call.
+	 */
+	ofile_process_walk(name, arch_flags, narch_flags, all_archs,
+			   process_non_objects, dylib_flat, use_member_syntax,
+			   ofile_process_splice, cookie);
+
+	for(i = 0; i < ofile_process_nworkers; i++){
+	    worker = ofile_process_workers + i;
+	    close(worker->record_fd);
+	    while(waitpid(worker->pid, &waitstatus, 0) == -1){
+		if(errno != EINTR)
+		    system_fatal("wait on worker process %d failed",
+				 (int)worker->pid);
+	    }
+	    if(WIFSIGNALED(waitstatus))
+		fatal("worker process for: %s terminated by signal %d",
+		      name, WTERMSIG(waitstatus));
+	    fclose(worker->out);
+	    fclose(worker->err);
+	}
+	free(ofile_process_workers);
+	ofile_process_workers = NULL;
+	ofile_process_nworkers = 0;
+}
+
+/*
+ * ofile_process_walk() does the work for ofile_process() calling processor
+ * for each ofile to be processed.
+ */
+static
+void
+ofile_process_walk(
+char *name,
+struct arch_flag *arch_flags,
+uint32_t narch_flags,
+enum bool all_archs,
+enum bool process_non_objects,
+enum bool dylib_flat,
+enum bool use_member_syntax,
+void (*processor)(struct ofile *ofile, char *arch_name, void *cookie),
+void *cookie)
 {
     char *member_name, *p, *arch_name;
     uint32_t len, i;
@@ -802,6 +1010,157 @@ void *cookie)
 	}
 	ofile_unmap(&ofile);
 }
+
+/*
+ * ofile_process_worker_call() is the processor routine ofile_process_walk()
+ * calls in a worker process.  It calls the real processor for the calls this
+ * worker does and records where the output of each is.
+ */
+static
+void
+ofile_process_worker_call(
+struct ofile *ofile,
+char *arch_name,
+void *cookie)
+{
+    struct ofile_process_record record;
+    uint32_t previous_errors;
+    ssize_t n;
+
+	if(ofile_process_ncalls++ % ofile_process_nworkers !=
+	   ofile_process_worker_index)
+	    return;
+
+	fflush(stdout);
+	fflush(stderr);
+	memset(&record, '\0', sizeof(struct ofile_process_record));
+	record.out_offset = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+	record.err_offset = lseek(STDERR_FILENO, 0, SEEK_CUR);
+	previous_errors = errors;
+
+	ofile_process_processor(ofile, arch_name, cookie);
+
+	fflush(stdout);
+	fflush(stderr);
+	record.out_size = lseek(STDOUT_FILENO, 0, SEEK_CUR) - record.out_offset;
+	record.err_size = lseek(STDERR_FILENO, 0, SEEK_CUR) - record.err_offset;
+	record.nerrors = errors - previous_errors;
+	do{
+	    n = write(ofile_process_record_fd, &record,
+		      sizeof(struct ofile_process_record));
+	}while(n == -1 && errno == EINTR);
+	if(n != sizeof(struct ofile_process_record))
+	    _exit(EXIT_FAILURE);
+}
+
+/*
+ * ofile_process_splice() is the processor routine ofile_process_walk() calls
+ * in the parent process.  It waits for the worker doing this call to finish
+ * it and copies that call's output to stdout and stderr.
+ */
+static
+void
+ofile_process_splice(
+struct ofile *ofile,
+char *arch_name,
+void *cookie)
+{
+    uint32_t worker_index;
+    struct ofile_process_worker *worker;
+    struct ofile_process_record record;
+    ssize_t n;
+    size_t size;
+
+	worker_index = ofile_process_ncalls++ % ofile_process_nworkers;
+	worker = ofile_process_workers + worker_index;
+	size = 0;
+	while(size < sizeof(struct ofile_process_record)){
+	    n = read(worker->record_fd, (char *)&record + size,
+		     sizeof(struct ofile_process_record) - size);
+	    if(n == -1 && errno == EINTR)
+		continue;
+	    if(n <= 0)
+		ofile_process_worker_died(worker_index);
+	    size += n;
+	}
+	fflush(stdout);
+	ofile_process_copy(fileno(worker->out), record.out_offset,
+			   record.out_size, STDOUT_FILENO);
+	fflush(stderr);
+	ofile_process_copy(fileno(worker->err), record.err_offset,
+			   record.err_size, STDERR_FILENO);
+	worker->err_end = record.err_offset + record.err_size;
+	errors += record.nerrors;
+}
+
+/*
+ * ofile_process_copy() copies size bytes at offset in the file fd to to_fd.
+ */
+static
+void
+ofile_process_copy(
+int fd,
+off_t offset,
+off_t size,
+int to_fd)
+{
+    static char buf[64 * 1024];
+    ssize_t n, w, written;
+
+	while(size > 0){
+	    n = pread(fd, buf, size < (off_t)sizeof(buf) ? size : sizeof(buf),
+		      offset);
+	    if(n == -1 && errno == EINTR)
+		continue;
+	    if(n <= 0)
+		system_fatal("can't read output of worker process");
+	    for(written = 0; written < n; written += w){
+		w = write(to_fd, buf + written, n - written);
+		if(w == -1){
+		    if(errno == EINTR){
+			w = 0;
+			continue;
+		    }
+		    system_fatal("can't write output of worker process");
+		}
+	    }
+	    offset += n;
+	    size -= n;
+	}
+}
+
+/*
+ * ofile_process_worker_died() is called when a worker process exits before
+ * doing all of its calls, as when the processor calls fatal().  What the
+ * worker wrote to stderr after its last call is printed and then this exits
+ * as the worker did.
+ */
+static
+void
+ofile_process_worker_died(
+uint32_t worker_index)
+{
+    struct ofile_process_worker *worker;
+    off_t end;
+    int waitstatus;
+
+	worker = ofile_process_workers + worker_index;
+	while(waitpid(worker->pid, &waitstatus, 0) == -1){
+	    if(errno != EINTR)
+		system_fatal("wait on worker process %d failed",
+			     (int)worker->pid);
+	}
+	fflush(stdout);
+	fflush(stderr);
+	end = lseek(fileno(worker->err), 0, SEEK_END);
+	if(end > worker->err_end)
+	    ofile_process_copy(fileno(worker->err), worker->err_end,
+			       end - worker->err_end, STDERR_FILENO);
+	if(WIFSIGNALED(waitstatus))
+	    fatal("worker process for: %s terminated by signal %d",
+		  ofile_process_name, WTERMSIG(waitstatus));
+	exit(EXIT_FAILURE);
+}
 #endif /* !defined(OFI) */
 
 /*
@@ -868,6 +1227,13 @@ enum bool archives_with_fat_objects)
 	
 	addr = NULL;
 	if(size != 0){
+#ifndef OFI
+	    if(ofile_map_read_only == TRUE){
+		ofile->read_only = TRUE;
+		addr = mmap(0, size, PROT_READ, MAP_FILE|MAP_SHARED, fd, 0);
+	    }
+	    else
+#endif /* !defined(OFI) */
 	    addr = mmap(0, size, PROT_READ|PROT_WRITE, MAP_FILE|MAP_PRIVATE, fd,
 		        0);
 	    if((intptr_t)addr == -1){
@@ -882,6 +1248,8 @@ enum bool archives_with_fat_objects)
 	    printf("Modification time = %ld\n", (long int)stat_buf.st_mtime);
 #endif /* OTOOL */
 
+	ofile->file_dev = stat_buf.st_dev;
+	ofile->file_ino = stat_buf.st_ino;
 	return(ofile_map_from_memory(addr, size, file_name, stat_buf.st_mtime,
 		  arch_flag, object_name, ofile, archives_with_fat_objects));
 }
@@ -947,6 +1315,9 @@ enum bool archives_with_fat_objects)
 	    ofile->file_type = OFILE_FAT;
 	    ofile->fat_header = (struct fat_header *)addr;
 #ifdef __LITTLE_ENDIAN__
+	    if(ofile->read_only == TRUE)
+		ofile->fat_header = ofile_fat_headers_copy(
+		    &ofile->fat_headers_copy, addr, size);
 	    swap_fat_header(ofile->fat_header, host_byte_sex);
 #endif /* __LITTLE_ENDIAN__ */
 #ifdef OTOOL
@@ -1009,7 +1380,7 @@ enum bool archives_with_fat_objects)
 	    }
 	    if(ofile->fat_header->magic == FAT_MAGIC_64){
 		ofile->fat_archs64 = (struct fat_arch_64 *)
-				     (addr + sizeof(struct fat_header));
+		    ((char *)ofile->fat_header + sizeof(struct fat_header));
 #ifdef __LITTLE_ENDIAN__
 		swap_fat_arch_64(ofile->fat_archs64,
 				 ofile->fat_header->nfat_arch, host_byte_sex);
@@ -1017,7 +1388,7 @@ enum bool archives_with_fat_objects)
 	    }
 	    else{
 		ofile->fat_archs = (struct fat_arch *)
-				   (addr + sizeof(struct fat_header));
+		    ((char *)ofile->fat_header + sizeof(struct fat_header));
 #ifdef __LITTLE_ENDIAN__
 		swap_fat_arch(ofile->fat_archs, ofile->fat_header->nfat_arch,
 			      host_byte_sex);
@@ -1493,6 +1864,14 @@ struct ofile *ofile)
 	    free(ofile->file_name);
 	if(ofile->arch_flag.name != NULL)
 	    free(ofile->arch_flag.name);
+	if(ofile->fat_headers_copy != NULL)
+	    free(ofile->fat_headers_copy);
+	if(ofile->member_fat_headers_copy != NULL)
+	    free(ofile->member_fat_headers_copy);
+	if(ofile->toc_copy != NULL)
+	    free(ofile->toc_copy);
+	if(ofile->headers_copy != NULL)
+	    free(ofile->headers_copy);
 	memset(ofile, '\0', sizeof(struct ofile));
 }
 
@@ -1863,6 +2242,14 @@ struct ofile *ofile)
 	if(size == offset)
 	    return(FALSE);
 
+#ifdef LTO_SUPPORT
+	/*
+	 * Get the llvm bitcode members summarized in parallel before they are
+	 * walked one at a time.
+	 */
+	ofile_lto_prefetch(addr, size);
+#endif /* LTO_SUPPORT */
+
 	/* now we know there is a first member so set it up */
 	ar_hdr = (struct ar_hdr *)(addr + offset);
 	offset += sizeof(struct ar_hdr);
@@ -1927,6 +2314,10 @@ struct ofile *ofile)
 		ofile->fat_header =
 			(struct fat_header *)(ofile->member_addr);
 #ifdef __LITTLE_ENDIAN__
+		if(ofile->read_only == TRUE)
+		    ofile->fat_header = ofile_fat_headers_copy(
+			&ofile->member_fat_headers_copy,
+			(char *)ofile->fat_header, ofile->member_size);
 		swap_fat_header(ofile->fat_header, host_byte_sex);
 #endif /* __LITTLE_ENDIAN__ */
 		if(ofile->fat_header->magic == FAT_MAGIC_64)
@@ -1946,7 +2337,7 @@ struct ofile *ofile)
 		}
 		if(ofile->fat_header->magic == FAT_MAGIC_64){
 		    ofile->fat_archs64 = (struct fat_arch_64 *)
-			(ofile->member_addr + sizeof(struct fat_header));
+			((char *)ofile->fat_header + sizeof(struct fat_header));
 #ifdef __LITTLE_ENDIAN__
 		    swap_fat_arch_64(ofile->fat_archs64,
 				     ofile->fat_header->nfat_arch,
@@ -1955,7 +2346,7 @@ struct ofile *ofile)
 		}
 		else{
 		    ofile->fat_archs = (struct fat_arch *)
-			(ofile->member_addr + sizeof(struct fat_header));
+			((char *)ofile->fat_header + sizeof(struct fat_header));
 #ifdef __LITTLE_ENDIAN__
 		    swap_fat_arch(ofile->fat_archs,
 				  ofile->fat_header->nfat_arch, host_byte_sex);
@@ -2082,6 +2473,71 @@ cleanup:
 	return(FALSE);
 }
 
+#ifdef LTO_SUPPORT
+/*
+ * ofile_lto_prefetch() is passed the address and size of an archive and
+ * passes the members of it that start with the llvm bitcode magic number to
+ * lto_prefetch().  Members with malformed headers are left for the checks
+ * done as the members are walked, so this just stops at the first one.
+ */
+static
+void
+ofile_lto_prefetch(
+char *addr,
+uint64_t size)
+{
+    uint64_t offset, member_size;
+    uint32_t ar_name_size, n, max;
+    struct ar_hdr *ar_hdr;
+    char *member_addr, **addrs;
+    uint32_t *sizes;
+    unsigned char *p;
+
+	n = 0;
+	max = 0;
+	addrs = NULL;
+	sizes = NULL;
+	offset = SARMAG;
+	while(offset + sizeof(struct ar_hdr) <= size){
+	    ar_hdr = (struct ar_hdr *)(addr + offset);
+	    offset += sizeof(struct ar_hdr);
+	    member_size = strtoul(ar_hdr->ar_size, NULL, 10);
+	    if(member_size > size - offset)
+		break;
+	    member_addr = addr + offset;
+	    offset += rnd(member_size, sizeof(short));
+	    if(strncmp(ar_hdr->ar_name, AR_EFMT1, sizeof(AR_EFMT1) - 1) == 0){
+		ar_name_size = strtoul(ar_hdr->ar_name + sizeof(AR_EFMT1) - 1,
+				       NULL, 10);
+		if(ar_name_size > member_size)
+		    break;
+		member_addr += ar_name_size;
+		member_size -= ar_name_size;
+	    }
+	    if(member_size < 4 || member_size > UINT32_MAX)
+		continue;
+	    p = (unsigned char *)member_addr;
+	    if((p[0] != 'B' || p[1] != 'C' || p[2] != 0xc0 || p[3] != 0xde) &&
+	       (p[0] != 0xde || p[1] != 0xc0 || p[2] != 0x17 || p[3] != 0x0b))
+		continue;
+	    if(n == max){
+		max = max == 0 ? 64 : max * 2;
+		addrs = reallocate(addrs, max * sizeof(char *));
+		sizes = reallocate(sizes, max * sizeof(uint32_t));
+	    }
+	    addrs[n] = member_addr;
+	    sizes[n] = (uint32_t)member_size;
+	    n++;
+	}
+	if(n != 0)
+	    lto_prefetch(addrs, sizes, n);
+	if(addrs != NULL){
+	    free(addrs);
+	    free(sizes);
+	}
+}
+#endif /* LTO_SUPPORT */
+
 /*
  * ofile_next_member() set up the ofile structure (the member_* fields and
  * the object file fields if the next member is an object file) for the next
@@ -2241,6 +2697,10 @@ struct ofile *ofile)
 		ofile->member_type = OFILE_FAT;
 		ofile->fat_header = (struct fat_header *)(ofile->member_addr);
 #ifdef __LITTLE_ENDIAN__
+		if(ofile->read_only == TRUE)
+		    ofile->fat_header = ofile_fat_headers_copy(
+			&ofile->member_fat_headers_copy,
+			(char *)ofile->fat_header, ofile->member_size);
 		swap_fat_header(ofile->fat_header, host_byte_sex);
 #endif /* __LITTLE_ENDIAN__ */
 		if(ofile->fat_header->magic == FAT_MAGIC_64)
@@ -2260,7 +2720,7 @@ struct ofile *ofile)
 		}
 		if(ofile->fat_header->magic == FAT_MAGIC_64){
 		    ofile->fat_archs64 = (struct fat_arch_64 *)
-			(ofile->member_addr + sizeof(struct fat_header));
+			((char *)ofile->fat_header + sizeof(struct fat_header));
 #ifdef __LITTLE_ENDIAN__
 		    swap_fat_arch_64(ofile->fat_archs64,
 				     ofile->fat_header->nfat_arch,
@@ -2269,7 +2729,7 @@ struct ofile *ofile)
 		}
 		else{
 		    ofile->fat_archs = (struct fat_arch *)
-			(ofile->member_addr + sizeof(struct fat_header));
+			((char *)ofile->fat_header + sizeof(struct fat_header));
 #ifdef __LITTLE_ENDIAN__
 		    swap_fat_arch(ofile->fat_archs,
 				  ofile->fat_header->nfat_arch, host_byte_sex);
@@ -2542,6 +3002,10 @@ struct ofile *ofile)
 			ofile->fat_header =
 			    (struct fat_header *)(addr + offset + ar_name_size);
 #ifdef __LITTLE_ENDIAN__
+			if(ofile->read_only == TRUE)
+			    ofile->fat_header = ofile_fat_headers_copy(
+				&ofile->member_fat_headers_copy,
+				(char *)ofile->fat_header, ofile->member_size);
 			swap_fat_header(ofile->fat_header, host_byte_sex);
 #endif /* __LITTLE_ENDIAN__ */
 			if(ofile->fat_header->magic == FAT_MAGIC_64)
@@ -2562,8 +3026,8 @@ struct ofile *ofile)
 			if(ofile->fat_header->magic == FAT_MAGIC_64){
 			    ofile->fat_archs64 =
 				(struct fat_arch_64 *)
-				(addr + offset + ar_name_size +
-					        sizeof(struct fat_header));
+				((char *)ofile->fat_header +
+				 sizeof(struct fat_header));
 #ifdef __LITTLE_ENDIAN__
 			    swap_fat_arch_64(ofile->fat_archs64,
 					     ofile->fat_header->nfat_arch,
@@ -2573,8 +3037,8 @@ struct ofile *ofile)
 			else{
 			    ofile->fat_archs =
 				(struct fat_arch *)
-				(addr + offset + ar_name_size +
-					        sizeof(struct fat_header));
+				((char *)ofile->fat_header +
+				 sizeof(struct fat_header));
 #ifdef __LITTLE_ENDIAN__
 			    swap_fat_arch(ofile->fat_archs,
 					  ofile->fat_header->nfat_arch,
@@ -3741,6 +4205,22 @@ struct ofile *ofile)
 	 * Check the string offset and the member offsets of the ranlib structs.
 	 */
 	if(toc_byte_sex != host_byte_sex){
+	    if(ofile->read_only == TRUE){
+		if(toc_is_32bit == TRUE){
+		    ofile->toc_copy = reallocate(ofile->toc_copy,
+					sizeof(struct ranlib) * nranlibs);
+		    memcpy(ofile->toc_copy, ranlibs,
+			   sizeof(struct ranlib) * nranlibs);
+		    ranlibs = (struct ranlib *)ofile->toc_copy;
+		}
+		else{
+		    ofile->toc_copy = reallocate(ofile->toc_copy,
+					sizeof(struct ranlib_64) * nranlibs64);
+		    memcpy(ofile->toc_copy, ranlibs64,
+			   sizeof(struct ranlib_64) * nranlibs64);
+		    ranlibs64 = (struct ranlib_64 *)ofile->toc_copy;
+		}
+	    }
 	    if(toc_is_32bit == TRUE)
 	        swap_ranlib(ranlibs, nranlibs, host_byte_sex);
 	    else
@@ -3903,6 +4383,10 @@ struct ofile *ofile)
     uint64_t big_size, big_end, big_load_end;
     struct element elements;
     cpu_type_t fat_cputype;
+#ifndef OFI
+    struct check_cache_key cache_key;
+    enum bool use_cache;
+#endif
 
 	elements.offset = 0;
 	elements.size = 0;
@@ -3917,6 +4401,39 @@ struct ofile *ofile)
 	host_byte_sex = get_host_byte_sex();
 	swapped = (enum bool)(host_byte_sex != ofile->object_byte_sex);
 
+	/*
+	 * If the file is mapped read-only the headers are swapped in a copy.
+	 * The copy is always made from the object's original headers as a
+	 * previous copy may have already been swapped.
+	 */
+	if(swapped && ofile->read_only == TRUE){
+	    if(mh != NULL){
+		big_size = SWAP_INT(((struct mach_header *)addr)->sizeofcmds);
+		big_size += sizeof(struct mach_header);
+	    }
+	    else{
+		big_size = SWAP_INT(((struct mach_header_64 *)addr)->sizeofcmds);
+		big_size += sizeof(struct mach_header_64);
+	    }
+	    if(big_size > size)
+		big_size = size;
+	    ofile->headers_copy = reallocate(ofile->headers_copy, big_size);
+	    memcpy(ofile->headers_copy, addr, big_size);
+	    if(mh != NULL){
+		mh = (struct mach_header *)ofile->headers_copy;
+		ofile->mh = mh;
+		load_commands = (struct load_command *)((char *)mh +
+				sizeof(struct mach_header));
+	    }
+	    else{
+		mh64 = (struct mach_header_64 *)ofile->headers_copy;
+		ofile->mh64 = mh64;
+		load_commands = (struct load_command *)((char *)mh64 +
+				sizeof(struct mach_header_64));
+	    }
+	    ofile->load_commands = load_commands;
+	}
+
 	if(ofile->mh != NULL){
 	    if(swapped)
 		swap_mach_header(mh, host_byte_sex);
@@ -3980,6 +4497,21 @@ struct ofile *ofile)
 		goto return_bad;
 	    }
 	}
+#ifndef OFI
+	/*
+	 * If the check cache says this slice has been validated before then
+	 * the checks of its load commands below are skipped.  This is only
+	 * done for headers in the host byte sex, as otherwise the pass below
+	 * is also what swaps the load commands.
+	 */
+	use_cache = FALSE;
+	if(swapped == FALSE)
+	    use_cache = check_Mach_O_cache_key(ofile, sizeofhdrs, &cache_key);
+	if(use_cache == TRUE && check_cache_lookup(&cache_key) == TRUE){
+	    free_elements(&elements);
+	    return(CHECK_GOOD);
+	}
+#endif /* !defined(OFI) */
 	/*
 	 * Make a pass through the load commands checking them to the level
 	 * that they can be parsed and all fields with offsets and sizes do
@@ -6751,6 +7283,11 @@ check_dylinker_command:
 	if(swapped == TRUE)
 	    ofile->headers_swapped = TRUE;
 
+#ifndef OFI
+	if(use_cache == TRUE)
+	    check_cache_enter(&cache_key);
+#endif /* !defined(OFI) */
+
 	/* looks good return ok */
 	free_elements(&elements);
 	return(CHECK_GOOD);
@@ -6761,6 +7298,35 @@ return_bad:
 #endif /* OTOOL */
 }
 
+#if !defined(OTOOL) && !defined(OFI)
+/*
+ * check_Mach_O_cache_key() fills in the check cache key for the slice the
+ * ofile is referencing, whose mach header and load commands are the first
+ * sizeofhdrs bytes of it.  It returns FALSE if the cache is not being used or
+ * the slice did not come from a file that was mapped by ofile_map().
+ */
+static
+enum bool
+check_Mach_O_cache_key(
+struct ofile *ofile,
+uint32_t sizeofhdrs,
+struct check_cache_key *key)
+{
+	if(ofile->file_ino == 0 || check_cache_enabled() == FALSE)
+	    return(FALSE);
+	memset(key, '\0', sizeof(struct check_cache_key));
+	key->dev = ofile->file_dev;
+	key->ino = ofile->file_ino;
+	key->file_size = ofile->file_size;
+	key->mtime = ofile->file_mtime;
+	key->offset = ofile->object_addr - ofile->file_addr;
+	key->object_size = ofile->object_size;
+	key->headers_size = sizeofhdrs;
+	key->headers_crc = crc32(ofile->object_addr, sizeofhdrs);
+	return(TRUE);
+}
+#endif /* !defined(OTOOL) && !defined(OFI) */
+
 /*
  * swap_back_Mach_O() is called after the ofile has been processed to swap back
  * the mach header and load commands if check_Mach_O() above swapped them.
@@ -6772,13 +7338,62 @@ struct ofile *ofile)
 {
 	if(ofile->headers_swapped == TRUE){
 	    ofile->headers_swapped = FALSE;
-	    if(ofile->mh != NULL)
+	    /*
+	     * If the headers were swapped in a copy then just point back at the
+	     * original headers in the file.
+	     */
+	    if(ofile->read_only == TRUE){
+		if(ofile->mh != NULL){
+		    ofile->mh = (struct mach_header *)ofile->object_addr;
+		    ofile->load_commands = (struct load_command *)
+			(ofile->object_addr + sizeof(struct mach_header));
+		}
+		else if(ofile->mh64 != NULL){
+		    ofile->mh64 = (struct mach_header_64 *)ofile->object_addr;
+		    ofile->load_commands = (struct load_command *)
+			(ofile->object_addr + sizeof(struct mach_header_64));
+		}
+	    }
+	    else if(ofile->mh != NULL)
 		swap_object_headers(ofile->mh, ofile->load_commands);
 	    else if(ofile->mh64 != NULL)
 		swap_object_headers(ofile->mh64, ofile->load_commands);
 	}
 }
 
+/*
+ * ofile_fat_headers_copy() copies the fat_header and fat_arch structs at addr,
+ * limited to size bytes, into the buffer *copy (which is reallocated to fit)
+ * and returns the copy.  It is used when the ofile is mapped read-only so the
+ * fat headers can be swapped to the host byte sex in the copy.
+ */
+static
+struct fat_header *
+ofile_fat_headers_copy(
+char **copy,
+char *addr,
+uint64_t size)
+{
+    struct fat_header fat_header;
+    uint64_t headers_size;
+
+	memcpy(&fat_header, addr, sizeof(struct fat_header));
+#ifdef __LITTLE_ENDIAN__
+	swap_fat_header(&fat_header, get_host_byte_sex());
+#endif /* __LITTLE_ENDIAN__ */
+	headers_size = fat_header.nfat_arch;
+	if(fat_header.magic == FAT_MAGIC_64)
+	    headers_size *= sizeof(struct fat_arch_64);
+	else
+	    headers_size *= sizeof(struct fat_arch);
+	headers_size += sizeof(struct fat_header);
+	if(headers_size > size)
+	    headers_size = size;
+	*copy = reallocate(*copy, headers_size);
+	memcpy(*copy, addr, headers_size);
+	return((struct fat_header *)*copy);
+}
+
 #ifndef OTOOL
 /*
  * check_overlaping_element() checks that the element in the ofile described by
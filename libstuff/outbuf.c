@@ -0,0 +1,235 @@
+#ifndef RLD
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include "stuff/outbuf.h"
+
+/*
+ * The buffer is big enough that it is written with few calls to fwrite(3),
+ * each of which is large enough for stdio to write it without copying it.
+ * Each process has its own, including the ones forked to work in parallel
+ * which flush it before their output is collected.
+ */
+#define OUTBUF_SIZE (64 * 1024)
+
+/*
+ * The most characters a number is formatted to, more than the 22 octal
+ * digits of the largest uint64_t.  Larger widths are limited to this.
+ */
+#define OUTBUF_MAX_DIGITS 32
+
+static char outbuf[OUTBUF_SIZE];
+static size_t outbuf_used = 0;
+static FILE *outbuf_file = NULL;
+
+static const char outbuf_digits[] = "0123456789abcdef";
+
+static void outbuf_number(
+    uint64_t value,
+    uint32_t base,
+    uint32_t width,
+    char pad);
+
+/*
+ * outbuf_stream() flushes the buffer and has it written to stream from then
+ * on, or to stdout if stream is NULL.
+ */
+__private_extern__
+void
+outbuf_stream(
+FILE *stream)
+{
+	outbuf_flush();
+	outbuf_file = stream;
+}
+
+/*
+ * outbuf_flush() writes what is in the buffer to stdout, or the stream set
+ * with outbuf_stream().
+ */
+__private_extern__
+void
+outbuf_flush(
+void)
+{
+	if(outbuf_used != 0)
+	    fwrite(outbuf, 1, outbuf_used,
+		   outbuf_file != NULL ? outbuf_file : stdout);
+	outbuf_used = 0;
+}
+
+/*
+ * outbuf_write() adds the n bytes at p.
+ */
+__private_extern__
+void
+outbuf_write(
+const void *p,
+size_t n)
+{
+	if(outbuf_used + n > OUTBUF_SIZE){
+	    outbuf_flush();
+	    if(n > OUTBUF_SIZE){
+		fwrite(p, 1, n, outbuf_file != NULL ? outbuf_file : stdout);
+		return;
+	    }
+	}
+	memcpy(outbuf + outbuf_used, p, n);
+	outbuf_used += n;
+}
+
+/*
+ * outbuf_char() adds the character c.
+ */
+__private_extern__
+void
+outbuf_char(
+int c)
+{
+	if(outbuf_used == OUTBUF_SIZE)
+	    outbuf_flush();
+	outbuf[outbuf_used++] = c;
+}
+
+/*
+ * outbuf_str() adds the string s.
+ */
+__private_extern__
+void
+outbuf_str(
+const char *s)
+{
+	outbuf_strn(s, SIZE_MAX);
+}
+
+/*
+ * outbuf_strn() adds the string s up to n characters as printf(3)'s "%.*s"
+ * would.
+ */
+__private_extern__
+void
+outbuf_strn(
+const char *s,
+size_t n)
+{
+    char *p;
+
+	while(n != 0 && *s != '\0'){
+	    if(outbuf_used == OUTBUF_SIZE)
+		outbuf_flush();
+	    p = outbuf + outbuf_used;
+	    while(n != 0 && *s != '\0' && p < outbuf + OUTBUF_SIZE){
+		*p++ = *s++;
+		n--;
+	    }
+	    outbuf_used = p - outbuf;
+	}
+}
+
+/*
+ * outbuf_hex() adds value in lower case hex padded with zeros to width digits
+ * as printf(3)'s "%0*llx" would.
+ */
+__private_extern__
+void
+outbuf_hex(
+uint64_t value,
+uint32_t width)
+{
+	outbuf_number(value, 16, width, '0');
+}
+
+/*
+ * outbuf_oct() adds value in octal padded with zeros to width digits as
+ * printf(3)'s "%0*llo" would.
+ */
+__private_extern__
+void
+outbuf_oct(
+uint64_t value,
+uint32_t width)
+{
+	outbuf_number(value, 8, width, '0');
+}
+
+/*
+ * outbuf_dec() adds value in decimal padded on the left with spaces to width
+ * characters as printf(3)'s "%*llu" would.
+ */
+__private_extern__
+void
+outbuf_dec(
+uint64_t value,
+uint32_t width)
+{
+	outbuf_number(value, 10, width, ' ');
+}
+
+/*
+ * outbuf_number() does the work for the routines above.  The digits are put
+ * in a small array from the right and then copied into the buffer.
+ */
+static
+void
+outbuf_number(
+uint64_t value,
+uint32_t base,
+uint32_t width,
+char pad)
+{
+    char digits[OUTBUF_MAX_DIGITS], *p;
+    size_t n;
+
+	if(width > OUTBUF_MAX_DIGITS)
+	    width = OUTBUF_MAX_DIGITS;
+	p = digits + OUTBUF_MAX_DIGITS;
+	do{
+	    *--p = outbuf_digits[value % base];
+	    value /= base;
+	}while(value != 0);
+	while(p > digits + OUTBUF_MAX_DIGITS - width)
+	    *--p = pad;
+
+	n = digits + OUTBUF_MAX_DIGITS - p;
+	if(outbuf_used + n > OUTBUF_SIZE)
+	    outbuf_flush();
+	memcpy(outbuf + outbuf_used, p, n);
+	outbuf_used += n;
+}
+
+/*
+ * outbuf_printf() adds the output of printf(3) for the less common things
+ * that are not worth a routine of their own.  If the output does not fit in
+ * what is left of the buffer it is flushed and the output formatted again,
+ * and output too large for the buffer is printed directly to stdout.
+ */
+__private_extern__
+void
+outbuf_printf(
+const char *format,
+...)
+{
+    va_list ap, ap2;
+    int n;
+
+	va_start(ap, format);
+	va_copy(ap2, ap);
+	n = vsnprintf(outbuf + outbuf_used, OUTBUF_SIZE - outbuf_used, format,
+		      ap);
+	if(n >= 0 && (size_t)n >= OUTBUF_SIZE - outbuf_used){
+	    outbuf_flush();
+	    if(n < OUTBUF_SIZE)
+		n = vsnprintf(outbuf, OUTBUF_SIZE, format, ap2);
+	    else{
+		vfprintf(outbuf_file != NULL ? outbuf_file : stdout, format,
+			 ap2);
+		n = 0;
+	    }
+	}
+	if(n > 0)
+	    outbuf_used += n;
+	va_end(ap2);
+	va_end(ap);
+}
+#endif /* !defined(RLD) */
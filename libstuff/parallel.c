@@ -0,0 +1,299 @@
+#ifndef RLD
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "stuff/bool.h"
+#include "stuff/errors.h"
+#include "stuff/allocate.h"
+#include "stuff/parallel.h"
+
+/*
+ * A call being made by parallel_for_ordered() in a worker process and the
+ * temporary files its stdout and stderr are written to.
+ */
+struct ordered_call {
+    pid_t pid;		/* the worker process or -1 if none */
+    FILE *out;		/* temporary file for the worker's stdout */
+    FILE *err;		/* temporary file for the worker's stderr */
+};
+
+static void ordered_call_finish(
+    struct ordered_call *call,
+    uint32_t nerrors);
+static void ordered_call_copy(
+    FILE *from,
+    FILE *to);
+
+/*
+ * parallel_njobs() returns the number of processes to split work between,
+ * which is the number of processors that are online.
+ */
+__private_extern__
+uint32_t
+parallel_njobs(
+void)
+{
+    long ncpus;
+
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if(ncpus < 1)
+	    return(1);
+	return(ncpus);
+}
+
+/*
+ * parallel_allocate() returns size bytes of zero filled memory that is shared
+ * with the processes forked by parallel_for(), so what they store in it is
+ * seen by the caller.  It is released with parallel_deallocate().
+ */
+__private_extern__
+void *
+parallel_allocate(
+uint64_t size)
+{
+    void *p;
+
+	if(size == 0)
+	    size = 1;
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_SHARED,
+		 -1, 0);
+	if(p == MAP_FAILED)
+	    system_fatal("can't allocate shared memory of size %llu", size);
+	return(p);
+}
+
+__private_extern__
+void
+parallel_deallocate(
+void *p,
+uint64_t size)
+{
+	if(size == 0)
+	    size = 1;
+	if(munmap(p, size) == -1)
+	    system_fatal("can't deallocate shared memory");
+}
+
+/*
+ * parallel_for() calls func(i, cookie) for each i from 0 to n - 1 split
+ * between njobs forked processes, the worker process w making the calls where
+ * i % njobs == w.  The calls can only return results through memory from
+ * parallel_allocate(), anything else they change is lost.  If njobs is less
+ * than two the calls are made in this process, as are the calls of any worker
+ * that can't be forked.  If a worker process calls fatal() or is terminated by
+ * a signal, this exits after all the workers are done.
+ */
+__private_extern__
+void
+parallel_for(
+uint32_t n,
+uint32_t njobs,
+void (*func)(uint32_t i, void *cookie),
+void *cookie)
+{
+    uint32_t i, w, nworkers;
+    pid_t *pids;
+    int waitstatus, termsig;
+    enum bool failed;
+
+	if(njobs > n)
+	    njobs = n;
+	if(njobs < 2){
+	    for(i = 0; i < n; i++)
+		func(i, cookie);
+	    return;
+	}
+
+	/*
+	 * Flush the stdio buffers so they are not written out again by the
+	 * worker processes.
+	 */
+	fflush(stdout);
+	fflush(stderr);
+	pids = allocate(njobs * sizeof(pid_t));
+	for(w = 0; w < njobs; w++){
+	    if((pids[w] = fork()) == -1)
+		break;
+	    if(pids[w] == 0){
+		for(i = w; i < n; i += njobs)
+		    func(i, cookie);
+		fflush(stdout);
+		fflush(stderr);
+		_exit(EXIT_SUCCESS);
+	    }
+	}
+	nworkers = w;
+	for(w = nworkers; w < njobs; w++){
+	    for(i = w; i < n; i += njobs)
+		func(i, cookie);
+	}
+
+	failed = FALSE;
+	termsig = 0;
+	for(w = 0; w < nworkers; w++){
+	    while(waitpid(pids[w], &waitstatus, 0) == -1){
+		if(errno != EINTR)
+		    system_fatal("wait on worker process %d failed",
+				 (int)pids[w]);
+	    }
+	    if(WIFSIGNALED(waitstatus)){
+		failed = TRUE;
+		termsig = WTERMSIG(waitstatus);
+	    }
+	    else if(WEXITSTATUS(waitstatus) != 0)
+		failed = TRUE;
+	}
+	free(pids);
+	if(failed == TRUE){
+	    if(termsig != 0)
+		fatal("worker process terminated by signal %d", termsig);
+	    exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * parallel_for_ordered() calls func(i, cookie) for each i from 0 to n - 1,
+ * each in a forked worker process of its own with up to njobs of them running
+ * at a time.  What each call writes to stdout and stderr is saved in temporary
+ * files and printed in the order of the calls, and the calls to error() it
+ * makes are added to errors, so the output is the same as if the calls were
+ * made one after the other.  As with parallel_for() anything else the calls
+ * change in memory is lost.  If a call calls fatal() or its worker is
+ * terminated by a signal, this prints its output and exits once the workers
+ * already started are done, without printing the output of the calls after
+ * it.  If njobs is less than two, or a worker can't be forked, the calls are
+ * made in this process.
+ */
+__private_extern__
+void
+parallel_for_ordered(
+uint32_t n,
+uint32_t njobs,
+void (*func)(uint32_t i, void *cookie),
+void *cookie)
+{
+    uint32_t i, next, *nerrors;
+    struct ordered_call *calls, *call;
+
+	if(njobs > n)
+	    njobs = n;
+	if(njobs < 2){
+	    for(i = 0; i < n; i++)
+		func(i, cookie);
+	    return;
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+	nerrors = parallel_allocate(n * sizeof(uint32_t));
+	calls = allocate(njobs * sizeof(struct ordered_call));
+	next = 0;
+	for(i = 0; i < n; i++){
+	    /*
+	     * Start the calls up to njobs ahead of the one to be finished next,
+	     * call i using calls[i % njobs].
+	     */
+	    for( ; next < n && next < i + njobs; next++){
+		call = calls + next % njobs;
+		call->out = tmpfile();
+		call->err = tmpfile();
+		if(call->out == NULL || call->err == NULL)
+		    system_fatal("can't create temporary file for worker "
+				 "process");
+		call->pid = fork();
+		if(call->pid == 0){
+		    if(dup2(fileno(call->out), STDOUT_FILENO) == -1 ||
+		       dup2(fileno(call->err), STDERR_FILENO) == -1)
+			system_fatal("can't redirect output of worker process");
+		    errors = 0;
+		    func(next, cookie);
+		    fflush(stdout);
+		    fflush(stderr);
+		    nerrors[next] = errors;
+		    _exit(EXIT_SUCCESS);
+		}
+		if(call->pid == -1){
+		    fclose(call->out);
+		    fclose(call->err);
+		    break;
+		}
+	    }
+
+	    call = calls + i % njobs;
+	    if(i == next){
+		/*
+		 * The worker for this call could not be forked and the calls
+		 * before it are finished, so it is made in this process.
+		 */
+		func(i, cookie);
+		fflush(stdout);
+		fflush(stderr);
+		next++;
+		continue;
+	    }
+	    ordered_call_finish(call, nerrors[i]);
+	}
+	free(calls);
+	parallel_deallocate(nerrors, n * sizeof(uint32_t));
+}
+
+/*
+ * ordered_call_finish() waits for the worker making a call for
+ * parallel_for_ordered() and prints its output.  If the call did not return
+ * normally the workers still running are waited for and this exits.
+ */
+static
+void
+ordered_call_finish(
+struct ordered_call *call,
+uint32_t nerrors)
+{
+    int waitstatus;
+
+	while(waitpid(call->pid, &waitstatus, 0) == -1){
+	    if(errno != EINTR)
+		system_fatal("wait on worker process %d failed",
+			     (int)call->pid);
+	}
+	ordered_call_copy(call->out, stdout);
+	ordered_call_copy(call->err, stderr);
+	fclose(call->out);
+	fclose(call->err);
+	errors += nerrors;
+
+	if(WIFSIGNALED(waitstatus) || WEXITSTATUS(waitstatus) != 0){
+	    while(wait(NULL) != -1 || errno == EINTR)
+		;
+	    if(WIFSIGNALED(waitstatus))
+		fatal("worker process terminated by signal %d",
+		      WTERMSIG(waitstatus));
+	    exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * ordered_call_copy() copies what a worker wrote to the temporary file from
+ * to to.  The worker's writes moved the file offset it shares with from, so
+ * that is set back to the start first.
+ */
+static
+void
+ordered_call_copy(
+FILE *from,
+FILE *to)
+{
+    char buf[8192];
+    size_t n;
+
+	if(fseek(from, 0, SEEK_SET) == -1)
+	    system_fatal("can't seek in temporary file for worker process");
+	while((n = fread(buf, 1, sizeof(buf), from)) != 0)
+	    fwrite(buf, 1, n, to);
+	fflush(to);
+}
+#endif /* !defined(RLD) */
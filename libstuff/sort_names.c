@@ -0,0 +1,256 @@
+#ifndef RLD
+#include <stdlib.h>
+#include <string.h>
+#include "stuff/allocate.h"
+#include "stuff/sort_names.h"
+
+/*
+ * Ranges smaller than this are sorted with an insertion sort.
+ */
+#define SORT_NAMES_SMALL 16
+
+/*
+ * While sorting, each element has a key of the next eight bytes of its name
+ * packed big endian into a 64-bit integer, padded with zeros past the end of
+ * the name, so that comparing keys compares the bytes as strcmp() does.
+ */
+struct name_key {
+    uint64_t key;	/* the next eight bytes of the name */
+    char *element;	/* the element the name is in */
+};
+
+static void sort_names_radix(
+    struct name_key *keys,
+    char **a,
+    uint64_t n,
+    uint64_t d);
+
+static void sort_name_keys(
+    struct name_key *keys,
+    uint64_t n);
+
+static uint64_t names_hash(
+    const char *name);
+
+/*
+ * sort_names() sorts the nel elements of width bytes at base, each of which
+ * starts with a char * to a name, into the order strcmp() puts the names in.
+ * Elements with the same name are left in no particular order.
+ *
+ * This is a most significant digit first radix sort that uses eight bytes of
+ * the names as a digit.  The elements are sorted on their keys for one digit
+ * with integer compares, then each run of elements with the same key is sorted
+ * on the next digit.  Each byte of a name is looked at about once instead of
+ * once for every strcmp() a qsort() of the elements would do.  Pointers to the
+ * elements are sorted and then the elements are put in that order.
+ */
+__private_extern__
+void
+sort_names(
+void *base,
+uint64_t nel,
+size_t width)
+{
+    uint64_t i;
+    char **a, *sorted;
+    struct name_key *keys;
+
+	if(nel < 2)
+	    return;
+	a = allocate(nel * sizeof(char *));
+	for(i = 0; i < nel; i++)
+	    a[i] = (char *)base + i * width;
+	keys = allocate(nel * sizeof(struct name_key));
+	sort_names_radix(keys, a, nel, 0);
+	free(keys);
+	sorted = allocate(nel * width);
+	for(i = 0; i < nel; i++)
+	    memcpy(sorted + i * width, a[i], width);
+	memcpy(base, sorted, nel * width);
+	free(sorted);
+	free(a);
+}
+
+/*
+ * sort_names_radix() sorts the n element pointers in a whose names are known to
+ * be the same in the first d bytes.  keys is space for n name_key structs.
+ */
+static
+void
+sort_names_radix(
+struct name_key *keys,
+char **a,
+uint64_t n,
+uint64_t d)
+{
+    uint64_t i, j, k;
+    unsigned char *p;
+    char *t;
+
+	if(n < SORT_NAMES_SMALL){
+	    for(i = 1; i < n; i++){
+		t = a[i];
+		for(j = i;
+		    j > 0 && strcmp(*(char **)a[j - 1] + d, *(char **)t + d) > 0;
+		    j--)
+		    a[j] = a[j - 1];
+		a[j] = t;
+	    }
+	    return;
+	}
+
+	for(i = 0; i < n; i++){
+	    p = (unsigned char *)*(char **)a[i] + d;
+	    keys[i].key = 0;
+	    for(k = 0; k < 8; k++){
+		keys[i].key = (keys[i].key << 8) | *p;
+		if(*p != '\0')
+		    p++;
+	    }
+	    keys[i].element = a[i];
+	}
+	sort_name_keys(keys, n);
+	for(i = 0; i < n; i++)
+	    a[i] = keys[i].element;
+
+	/*
+	 * Sort each run of elements with the same key on the next eight bytes,
+	 * unless the key's last byte is zero so the names ended and are equal.
+	 */
+	for(i = 0; i < n; i = j){
+	    for(j = i + 1; j < n && keys[j].key == keys[i].key; j++)
+		;
+	    if(j - i > 1 && (keys[i].key & 0xff) != 0)
+		sort_names_radix(keys + i, a + i, j - i, d + 8);
+	}
+}
+
+/*
+ * sort_name_keys() sorts the n name_key structs in keys on their key.  This is
+ * a quicksort with three way partitioning, as names often have long common
+ * prefixes and so many equal keys.  It recurses on the smaller partition and
+ * loops on the larger one so the depth of the recursion is at most log2(n).
+ */
+static
+void
+sort_name_keys(
+struct name_key *keys,
+uint64_t n)
+{
+    uint64_t i, j, lt, gt;
+    uint64_t v, v0, v1, v2;
+    struct name_key t;
+
+	while(n >= SORT_NAMES_SMALL){
+	    /* use the median of three keys as the partitioning value */
+	    v0 = keys[0].key;
+	    v1 = keys[n / 2].key;
+	    v2 = keys[n - 1].key;
+	    if((v0 <= v1 && v1 <= v2) || (v2 <= v1 && v1 <= v0))
+		v = v1;
+	    else if((v1 <= v0 && v0 <= v2) || (v2 <= v0 && v0 <= v1))
+		v = v0;
+	    else
+		v = v2;
+
+	    /*
+	     * Partition keys so that keys[0 .. lt) are less than v, keys[lt ..
+	     * gt) are equal to v and keys[gt .. n) are greater than v.
+	     */
+	    lt = 0;
+	    i = 0;
+	    gt = n;
+	    while(i < gt){
+		if(keys[i].key < v){
+		    t = keys[lt];
+		    keys[lt++] = keys[i];
+		    keys[i++] = t;
+		}
+		else if(keys[i].key > v){
+		    t = keys[--gt];
+		    keys[gt] = keys[i];
+		    keys[i] = t;
+		}
+		else
+		    i++;
+	    }
+	    if(lt < n - gt){
+		sort_name_keys(keys, lt);
+		keys += gt;
+		n -= gt;
+	    }
+	    else{
+		sort_name_keys(keys + gt, n - gt);
+		n = lt;
+	    }
+	}
+
+	for(i = 1; i < n; i++){
+	    t = keys[i];
+	    for(j = i; j > 0 && keys[j - 1].key > t.key; j--)
+		keys[j] = keys[j - 1];
+	    keys[j] = t;
+	}
+}
+
+/*
+ * names_unique() returns TRUE if no two of the nel elements of width bytes at
+ * base, each of which starts with a char * to a name, have the same name.  The
+ * elements do not need to be sorted.  The names are put in an open addressed
+ * hash table at least twice the size of the number of elements.
+ */
+__private_extern__
+enum bool
+names_unique(
+void *base,
+uint64_t nel,
+size_t width)
+{
+    uint64_t i, size, mask, h;
+    char **table, *name;
+    enum bool unique;
+
+	if(nel < 2)
+	    return(TRUE);
+	size = 1;
+	while(size < nel * 2)
+	    size <<= 1;
+	mask = size - 1;
+	table = allocate(size * sizeof(char *));
+	memset(table, '\0', size * sizeof(char *));
+
+	unique = TRUE;
+	for(i = 0; i < nel && unique == TRUE; i++){
+	    name = *(char **)((char *)base + i * width);
+	    for(h = names_hash(name) & mask;
+		table[h] != NULL;
+		h = (h + 1) & mask){
+		if(strcmp(table[h], name) == 0){
+		    unique = FALSE;
+		    break;
+		}
+	    }
+	    table[h] = name;
+	}
+	free(table);
+	return(unique);
+}
+
+/*
+ * names_hash() is the 64-bit FNV-1a hash of the name.
+ */
+static
+uint64_t
+names_hash(
+const char *name)
+{
+    uint64_t h;
+
+	h = 0xcbf29ce484222325ULL;
+	while(*name != '\0'){
+	    h ^= (unsigned char)*name++;
+	    h *= 0x100000001b3ULL;
+	}
+	return(h);
+}
+#endif /* !defined(RLD) */
@@ -0,0 +1,217 @@
+#ifndef RLD
+#include <stdint.h>
+#include <string.h>
+#include <mach-o/nlist.h>
+#include "stuff/bool.h"
+#include "stuff/outbuf.h"
+#include "stuff/symbol_export.h"
+
+static enum symbol_export_format export_format = SYMBOL_EXPORT_JSON;
+
+/* the object set by symbol_export_begin() for SYMBOL_EXPORT_JSON */
+static const char *export_file_name = NULL;
+static const char *export_member = NULL;
+static uint32_t export_member_size = 0;
+static const char *export_arch_name = NULL;
+
+static void export_uint(
+    uint64_t value,
+    uint32_t size);
+static void export_string(
+    const char *s,
+    uint32_t size);
+static void export_json_string(
+    const char *s,
+    uint32_t size);
+
+/*
+ * get_symbol_export_format() returns TRUE and sets *format for the format
+ * named name, "json" or "binary", and returns FALSE for any other name.
+ */
+__private_extern__
+enum bool
+get_symbol_export_format(
+const char *name,
+enum symbol_export_format *format)
+{
+	if(strcmp(name, "json") == 0){
+	    *format = SYMBOL_EXPORT_JSON;
+	    return(TRUE);
+	}
+	if(strcmp(name, "binary") == 0){
+	    *format = SYMBOL_EXPORT_BINARY;
+	    return(TRUE);
+	}
+	return(FALSE);
+}
+
+/*
+ * symbol_export_start() is called once before anything else is exported in
+ * format, and writes the header if the format has one.
+ */
+__private_extern__
+void
+symbol_export_start(
+enum symbol_export_format format)
+{
+	export_format = format;
+	if(format == SYMBOL_EXPORT_BINARY){
+	    outbuf_write("SYMX", 4);
+	    export_uint(1, 4);
+	    outbuf_flush();
+	}
+}
+
+/*
+ * symbol_export_begin() is called before the symbols of an object are
+ * exported.  For SYMBOL_EXPORT_BINARY the object record is written now and for
+ * SYMBOL_EXPORT_JSON the strings are saved to be written in each symbol's line.
+ */
+__private_extern__
+void
+symbol_export_begin(
+const char *file_name,
+const char *member,
+uint32_t member_size,
+const char *arch_name)
+{
+	if(export_format == SYMBOL_EXPORT_BINARY){
+	    outbuf_char('O');
+	    export_string(file_name, strlen(file_name));
+	    export_string(member, member != NULL ? member_size : 0);
+	    export_string(arch_name, strlen(arch_name));
+	}
+	else{
+	    export_file_name = file_name;
+	    export_member = member;
+	    export_member_size = member_size;
+	    export_arch_name = arch_name;
+	}
+}
+
+/*
+ * symbol_export_symbol() exports the symbol with name and nlist nl.
+ */
+__private_extern__
+void
+symbol_export_symbol(
+const char *name,
+const struct nlist_64 *nl)
+{
+	if(export_format == SYMBOL_EXPORT_BINARY){
+	    outbuf_char('S');
+	    outbuf_char(nl->n_type);
+	    outbuf_char(nl->n_sect);
+	    export_uint(nl->n_desc, 2);
+	    export_uint(nl->n_value, 8);
+	    export_string(name, strlen(name));
+	    return;
+	}
+
+	outbuf_str("{\"file\":");
+	export_json_string(export_file_name, strlen(export_file_name));
+	outbuf_str(",\"member\":");
+	if(export_member != NULL)
+	    export_json_string(export_member, export_member_size);
+	else
+	    outbuf_str("null");
+	outbuf_str(",\"arch\":");
+	export_json_string(export_arch_name, strlen(export_arch_name));
+	outbuf_str(",\"name\":");
+	export_json_string(name, strlen(name));
+	outbuf_str(",\"type\":");
+	outbuf_dec(nl->n_type, 0);
+	outbuf_str(",\"sect\":");
+	outbuf_dec(nl->n_sect, 0);
+	outbuf_str(",\"desc\":");
+	outbuf_dec((uint16_t)nl->n_desc, 0);
+	outbuf_str(",\"value\":");
+	outbuf_dec(nl->n_value, 0);
+	outbuf_str("}\n");
+}
+
+/*
+ * symbol_export_end() is called after the symbols of an object are exported
+ * and flushes what has been written.
+ */
+__private_extern__
+void
+symbol_export_end(
+void)
+{
+	outbuf_flush();
+	export_file_name = NULL;
+	export_member = NULL;
+	export_member_size = 0;
+	export_arch_name = NULL;
+}
+
+/*
+ * export_uint() writes the low size bytes of value in little endian order.
+ */
+static
+void
+export_uint(
+uint64_t value,
+uint32_t size)
+{
+    unsigned char bytes[8];
+    uint32_t i;
+
+	for(i = 0; i < size; i++){
+	    bytes[i] = value & 0xff;
+	    value >>= 8;
+	}
+	outbuf_write(bytes, size);
+}
+
+/*
+ * export_string() writes the size bytes of s preceded by size for
+ * SYMBOL_EXPORT_BINARY.
+ */
+static
+void
+export_string(
+const char *s,
+uint32_t size)
+{
+	export_uint(size, 4);
+	if(size != 0)
+	    outbuf_write(s, size);
+}
+
+/*
+ * export_json_string() writes the size bytes of s, or up to a nul, as a JSON
+ * string escaping the quote and backslash, and writing each byte that is not
+ * printable ASCII as \u00XX so the output is valid ASCII JSON whatever the
+ * bytes of the name are.
+ */
+static
+void
+export_json_string(
+const char *s,
+uint32_t size)
+{
+    const char *p, *end;
+
+	outbuf_char('"');
+	end = s + size;
+	for(p = s; s < end && *s != '\0'; s++){
+	    if(*s != '"' && *s != '\\' &&
+	       (unsigned char)*s >= 0x20 && (unsigned char)*s < 0x7f)
+		continue;
+	    outbuf_write(p, s - p);
+	    if(*s == '"' || *s == '\\'){
+		outbuf_char('\\');
+		outbuf_char(*s);
+	    }
+	    else{
+		outbuf_str("\\u00");
+		outbuf_hex((unsigned char)*s, 2);
+	    }
+	    p = s + 1;
+	}
+	outbuf_write(p, s - p);
+	outbuf_char('"');
+}
+#endif /* !defined(RLD) */
@@ -28,17 +28,93 @@
 #ifndef __OPENSTEP__
 #include <utime.h>
 #endif
+#include <errno.h>
+#include <sys/mman.h>
 #include "stuff/ofile.h"
 #include "stuff/breakout.h"
 #include "stuff/allocate.h"
 #include "stuff/rnd.h"
 #include "stuff/errors.h"
+#include "stuff/parallel.h"
+#include "stuff/sort_names.h"
 #ifdef LTO_SUPPORT
 #include "stuff/lto.h"
 #endif /* LTO_SUPPORT */
 
+/*
+ * The output of put_archs() either goes into a memory buffer, for
+ * writeout_to_mem() and for throttled writes, or it is streamed to a file
+ * descriptor by writeout().  When streaming, small pieces like the headers are
+ * gathered in buf and large pieces are written directly from where they are.
+ * For the unchanged contents of objects and members that is the mapped input
+ * file, so the output file is never copied as a whole into memory.
+ */
+struct sink {
+    char *file;		/* the memory buffer, or NULL when streaming */
+    int fd;		/* the file descriptor when streaming */
+    char *filename;	/* the name of the output for error messages */
+    uint64_t offset;	/* the offset in the output of the next byte */
+    char *buf;		/* the buffer for small pieces when streaming */
+    uint32_t buf_size;	/* the number of bytes in buf */
+    enum bool failed;	/* TRUE if a write to fd has failed */
+};
+#define SINK_BUF_SIZE (64 * 1024)
+
+static void sink_write(
+    struct sink *sink,
+    const void *data,
+    uint64_t size);
+
+static void sink_fill(
+    struct sink *sink,
+    char c,
+    uint64_t size);
+
+static void sink_seek(
+    struct sink *sink,
+    uint64_t offset);
+
+static void sink_flush(
+    struct sink *sink);
+
+static void sink_write_fd(
+    struct sink *sink,
+    const char *data,
+    uint64_t size);
+
+static enum bool layout_archs(
+    struct arch *archs,
+    uint32_t narchs,
+    char *filename,
+    time_t toc_time,
+    enum bool sort_toc,
+    enum bool commons_in_toc,
+    enum bool force_64bit_toc,
+    enum bool library_warnings,
+    uint64_t *file_size,
+    char **fat_headers,
+    uint32_t *fat_headers_size,
+    uint64_t **offsets,
+    enum bool *seen_archive);
+
+static void put_archs(
+    struct arch *archs,
+    uint32_t narchs,
+    char *filename,
+    time_t toc_time,
+    enum bool library_warnings,
+    char *fat_headers,
+    uint32_t fat_headers_size,
+    uint64_t *offsets,
+    uint64_t file_size,
+    struct sink *sink);
+
+static uint32_t put_member_object(
+    struct object *object,
+    struct sink *sink);
+
 static void copy_new_symbol_info(
-    char *p,
+    struct sink *sink,
     uint32_t *size,
     struct dysymtab_command *dyst,
     struct dysymtab_command *old_dyst,
@@ -55,6 +131,44 @@ static void make_table_of_contents(
     enum bool force_64bit_toc,
     enum bool library_warnings);
 
+/*
+ * The state make_table_of_contents() passes to toc_member_job() for scanning
+ * the symbols of the members of an arch.  When the scan is split between
+ * worker processes with parallel_for() the results are in shared memory.
+ */
+struct toc_job {
+    struct arch *arch;		/* the arch being scanned */
+    enum bool commons_in_toc;	/* if common symbols go in the toc */
+    uint32_t njobs;		/* number of processes scanning */
+    uint32_t *ntocs;		/* number of toc entries of each member */
+    uint64_t *strsizes;		/* size of the toc strings of each member */
+    uint64_t *toc_offsets;	/* index of each member's first toc entry */
+    uint64_t *str_offsets;	/* offset of each member's first toc string */
+    struct toc_entry *toc_entries; /* toc entries to fill in or NULL */
+    char *toc_strings;		/* toc strings to fill in */
+};
+
+/*
+ * Libraries with at least this many symbols have their members' symbols
+ * scanned in parallel, by writeout_toc_njobs processes.  It is one unless the
+ * tool sets it from its -j option.
+ */
+#define TOC_PARALLEL_NSYMBOLS 65536
+__private_extern__ uint32_t writeout_toc_njobs = 1;
+
+static void toc_member_job(
+    uint32_t i,
+    void *cookie);
+
+static void toc_member(
+    struct arch *arch,
+    uint32_t i,
+    enum bool commons_in_toc,
+    struct toc_entry *toc_entries,
+    char *toc_strings,
+    uint32_t *ntocs,
+    uint64_t *strsize);
+
 static enum bool toc_symbol(
     struct nlist *symbol,
     enum bool commons_in_toc,
@@ -107,6 +221,11 @@ static void warn_member(
  * unusual libraries are printed if library_warnings == TRUE.  If throttle is
  * not NULL is is set to a value of bytes per second to limiting the writes to
  * in order to not eat all I/O bandwidth.
+ *
+ * Unless throttle is not NULL the file is streamed out with put_archs() and
+ * is not first created in memory.  It is also created in memory first if the
+ * output file can't be removed, as it may be one of the input files that the
+ * output is streamed from and it is truncated when it is opened.
  */
 __private_extern__
 void
@@ -129,11 +248,13 @@ uint32_t *throttle)
     time_t timep[2];
 #endif
     mach_port_t my_mach_host_self;
-    char *file, *p;
-    uint64_t file_size;
+    char *file, *p, *filename, *fat_headers;
+    uint64_t file_size, *offsets;
+    uint32_t fat_headers_size;
     time_t toc_time;
-    enum bool seen_archive;
+    enum bool seen_archive, in_memory;
     kern_return_t r;
+    struct sink sink;
    
 	seen_archive = FALSE;
 	/*
@@ -146,17 +267,54 @@ uint32_t *throttle)
 	else
 	    toc_time = 0;
 
-	writeout_to_mem(archs, narchs, output, (void **)&file, &file_size, 
-                        sort_toc, commons_in_toc, force_64bit_toc,
-			library_warnings, &seen_archive);
+	if(output != NULL)
+	    filename = output;
+	else
+	    filename = "(standard output)";
+	if(layout_archs(archs, narchs, filename, toc_time, sort_toc,
+			commons_in_toc, force_64bit_toc, library_warnings,
+			&file_size, &fat_headers, &fat_headers_size, &offsets,
+			&seen_archive) == FALSE)
+	    return;
+	file = NULL;
+	memset(&sink, '\0', sizeof(struct sink));
 
 	/*
 	 * Create the output file.  The unlink() is done to handle the problem
 	 * when the outputfile is not writable but the directory allows the
 	 * file to be removed (since the file may not be there the return code
 	 * of the unlink() is ignored).
+	 *
+	 * When the unlink() does not remove an existing file it is truncated
+	 * and written in place, and it may be an input file still mapped.  So
+	 * then, as for throttled writes, the whole output is created in memory
+	 * before the file is opened.
 	 */
-	(void)unlink(output);
+	in_memory = FALSE;
+	if(output != NULL){
+	    if(unlink(output) == -1 && errno != ENOENT)
+		in_memory = TRUE;
+	}
+	else
+	    throttle = NULL;
+	if(throttle != NULL)
+	    in_memory = TRUE;
+	if(in_memory == TRUE){
+	    /*
+	     * This buffer is vm_allocate'ed to make sure all holes are
+	     * filled with zero bytes.
+	     */
+	    if((r = vm_allocate(mach_task_self(), (vm_address_t *)&file,
+				file_size, TRUE)) != KERN_SUCCESS)
+		mach_fatal(r, "can't vm_allocate() buffer for output file: %s "
+			   "of size %llu", filename, file_size);
+	    sink.file = file;
+	    sink.filename = filename;
+	    put_archs(archs, narchs, filename, toc_time, library_warnings,
+		      fat_headers, fat_headers_size, offsets, file_size, &sink);
+	    sink.file = NULL;
+	}
+
 	if(throttle != NULL)
 	    fsync = O_FSYNC;
 	else
@@ -172,7 +330,6 @@ uint32_t *throttle)
 #endif
         }
         else{
-            throttle = NULL;
             fd = fileno(stdout);
         }
         if(throttle != NULL){
@@ -185,6 +342,10 @@ uint32_t *throttle)
             unsigned int count;
             kern_return_t r;
 
+	    /*
+	     * The throttled writes are paced out of the buffer holding the
+	     * whole file created above.
+	     */
             p = file;
             bytes_written = 0;
             bytes_per_second = 0;
@@ -253,9 +414,23 @@ uint32_t *throttle)
         }
         else{
 no_throttle:
-	    if(write(fd, file, file_size) != (int)file_size){
-		system_error("can't write output file: %s", output);
-		goto cleanup;
+	    if(file != NULL){
+		sink.fd = fd;
+		sink.filename = filename;
+		sink_write_fd(&sink, file, file_size);
+		if(sink.failed == TRUE)
+		    goto cleanup;
+	    }
+	    else{
+		sink.fd = fd;
+		sink.filename = filename;
+		sink.buf = allocate(SINK_BUF_SIZE);
+		put_archs(archs, narchs, filename, toc_time, library_warnings,
+			  fat_headers, fat_headers_size, offsets, file_size,
+			  &sink);
+		sink_flush(&sink);
+		if(sink.failed == TRUE)
+		    goto cleanup;
 	    }
 	}
 	if(output != NULL && close(fd) == -1){
@@ -294,7 +469,13 @@ no_throttle:
 	    }
 	}
 cleanup:
-	if((r = vm_deallocate(mach_task_self(), (vm_address_t)file,
+	if(sink.buf != NULL)
+	    free(sink.buf);
+	if(fat_headers != NULL)
+	    free(fat_headers);
+	free(offsets);
+	if(file != NULL &&
+	   (r = vm_deallocate(mach_task_self(), (vm_address_t)file,
 			      file_size)) != KERN_SUCCESS){
 	    my_mach_error(r, "can't vm_deallocate() buffer for output file");
 	    return;
@@ -332,24 +513,12 @@ enum bool force_64bit_toc,
 enum bool library_warnings,
 enum bool *seen_archive)
 {
-    uint32_t i, j, k, pad, size;
-    uint64_t file_size, offset;
-    uint32_t i32;
-    uint64_t i64;
-    enum byte_sex target_byte_sex, host_byte_sex;
-    char *file, *p;
+    uint64_t file_size, *offsets;
+    char *file, *fat_headers;
+    uint32_t fat_headers_size;
     kern_return_t r;
-    struct fat_header *fat_header;
-    struct fat_arch *fat_arch;
-    struct fat_arch_64 *fat_arch64;
-    struct dysymtab_command dyst;
-    struct twolevel_hints_command hints_cmd;
-    struct load_command lc, *lcp;
-    struct dylib_command dl, *dlp;
     time_t toc_time;
-    int32_t timestamp, index;
-    uint32_t ncmds;
-    enum bool swapped;
+    struct sink sink;
 
 	/* 
 	 * If filename is NULL, we use a dummy file name.
@@ -372,16 +541,234 @@ enum bool *seen_archive)
 	else
 	    toc_time = 0;
 
-	fat_arch = NULL; /* here to quite compiler maybe warning message */
-	fat_arch64 = NULL;
-	fat_header = NULL;
+	if(layout_archs(archs, narchs, filename, toc_time, sort_toc,
+			commons_in_toc, force_64bit_toc, library_warnings,
+			&file_size, &fat_headers, &fat_headers_size, &offsets,
+			seen_archive) == FALSE)
+	    return;
 
-	if(narchs == 0){
-	    error("no contents for file: %s (not created)", filename);
+	/*
+	 * This buffer is vm_allocate'ed to make sure all holes are filled with
+	 * zero bytes.
+	 */
+	if((r = vm_allocate(mach_task_self(), (vm_address_t *)&file,
+			    file_size, TRUE)) != KERN_SUCCESS)
+	    mach_fatal(r, "can't vm_allocate() buffer for output file: %s of "
+		       "size %llu", filename, file_size);
+
+	memset(&sink, '\0', sizeof(struct sink));
+	sink.file = file;
+	sink.filename = filename;
+	put_archs(archs, narchs, filename, toc_time, library_warnings,
+		  fat_headers, fat_headers_size, offsets, file_size, &sink);
+	if(fat_headers != NULL)
+	    free(fat_headers);
+	free(offsets);
+
+        *outputbuf = file;
+        *length = file_size;
+}
+
+/*
+ * spill_member() writes the finished contents of the object of the archive
+ * member to the spill file, creating the file if this is the first member
+ * spilled.  Then it releases what the object's new symbolic information and
+ * any ld -r output were using and leaves the object as if it had been broken
+ * out unchanged, but with its contents in the spill file.  The member can't be
+ * used again until spill_map() is called except for its size.  The headers
+ * are kept in the host byte sex in the spill file, as breakout() leaves them,
+ * and everything else is in the object's byte sex.
+ */
+__private_extern__
+void
+spill_member(
+struct spill *spill,
+struct member *member)
+{
+    struct object *object, spilled;
+    struct sink sink;
+    char *headers, *tmpdir, *spill_name;
+    uint32_t headers_size, size;
+
+	/*
+	 * An object with no new symbolic information is still all in the input
+	 * file and is left there.
+	 */
+	object = member->object;
+	if(object->output_sym_info_size == 0 &&
+	   object->input_sym_info_size == 0 &&
+	   object->ld_r_ofile == NULL)
 	    return;
+
+	if(spill->opened == FALSE){
+	    tmpdir = getenv("TMPDIR");
+	    if(tmpdir == NULL || *tmpdir == '\0')
+		tmpdir = "/tmp";
+	    spill_name = makestr(tmpdir, "/spill.XXXXXX", NULL);
+	    if((spill->fd = mkstemp(spill_name)) == -1)
+		system_fatal("can't create temporary file: %s", spill_name);
+	    /* the file goes away when it is closed by spill_free() */
+	    (void)unlink(spill_name);
+	    free(spill_name);
+	    spill->opened = TRUE;
+	    spill->size = 0;
 	}
 
-	host_byte_sex = get_host_byte_sex();
+	if(object->mh != NULL)
+	    headers_size = sizeof(struct mach_header) + object->mh->sizeofcmds;
+	else
+	    headers_size = sizeof(struct mach_header_64) +
+			   object->mh64->sizeofcmds;
+	headers = allocate(headers_size);
+	if(object->mh != NULL)
+	    memcpy(headers, object->mh, headers_size);
+	else
+	    memcpy(headers, object->mh64, headers_size);
+
+	memset(&sink, '\0', sizeof(struct sink));
+	sink.fd = spill->fd;
+	sink.filename = "(spill file)";
+	sink.offset = spill->size;
+	sink.buf = allocate(SINK_BUF_SIZE);
+	size = put_member_object(object, &sink);
+	sink_fill(&sink, '\0', rnd(size, 8) - size);
+	sink_flush(&sink);
+	free(sink.buf);
+	if(sink.failed == FALSE &&
+	   pwrite(spill->fd, headers, headers_size, spill->size) !=
+	   (ssize_t)headers_size){
+	    system_error("can't write temporary file");
+	    sink.failed = TRUE;
+	}
+	free(headers);
+	if(sink.failed == TRUE)
+	    return;
+	member->spilled = TRUE;
+	member->spill_offset = spill->size;
+	spill->size = sink.offset;
+
+	/*
+	 * What is left of the object is what breakout() sets for an unchanged
+	 * object, with the object's address set by spill_map().
+	 */
+	if(object->sections != NULL)
+	    free(object->sections);
+	if(object->sections64 != NULL)
+	    free(object->sections64);
+	if(object->ld_r_ofile != NULL)
+	    ofile_unmap(object->ld_r_ofile);
+	memset(&spilled, '\0', sizeof(struct object));
+	spilled.object_size = size;
+	spilled.object_byte_sex = object->object_byte_sex;
+	spilled.mh_cputype = object->mh_cputype;
+	spilled.mh_cpusubtype = object->mh_cpusubtype;
+	spilled.mh_filetype = object->mh_filetype;
+	*object = spilled;
+}
+
+/*
+ * spill_map() maps the spill file and points the objects of the members that
+ * were spilled at their contents in it, so they are written out like members
+ * that were not changed.  The mapping is private so the headers and symbols
+ * can be swapped in place as writeout() does for unchanged members.
+ */
+__private_extern__
+void
+spill_map(
+struct spill *spill,
+struct arch *archs,
+uint32_t narchs)
+{
+    uint32_t i, j, magic;
+    struct object *object;
+
+	if(spill->opened == FALSE || spill->size == 0)
+	    return;
+	spill->addr = mmap(0, spill->size, PROT_READ|PROT_WRITE,
+			   MAP_FILE|MAP_PRIVATE, spill->fd, 0);
+	if(spill->addr == MAP_FAILED){
+	    spill->addr = NULL;
+	    system_fatal("can't map temporary file");
+	}
+	for(i = 0; i < narchs; i++){
+	    if(archs[i].type != OFILE_ARCHIVE)
+		continue;
+	    for(j = 0; j < archs[i].nmembers; j++){
+		if(archs[i].members[j].spilled == FALSE)
+		    continue;
+		object = archs[i].members[j].object;
+		object->object_addr = spill->addr +
+				      archs[i].members[j].spill_offset;
+		memcpy(&magic, object->object_addr, sizeof(uint32_t));
+		if(magic == MH_MAGIC_64){
+		    object->mh64 = (struct mach_header_64 *)object->object_addr;
+		    object->load_commands = (struct load_command *)
+			(object->object_addr + sizeof(struct mach_header_64));
+		}
+		else{
+		    object->mh = (struct mach_header *)object->object_addr;
+		    object->load_commands = (struct load_command *)
+			(object->object_addr + sizeof(struct mach_header));
+		}
+	    }
+	}
+}
+
+/*
+ * spill_free() unmaps and closes the spill file, which removes it.
+ */
+__private_extern__
+void
+spill_free(
+struct spill *spill)
+{
+	if(spill->addr != NULL)
+	    (void)munmap(spill->addr, spill->size);
+	if(spill->opened == TRUE)
+	    (void)close(spill->fd);
+	memset(spill, '\0', sizeof(struct spill));
+}
+
+/*
+ * layout_archs() creates the table of contents for each archive and calculates
+ * the total size of the file and the final size of each architecture.  If the
+ * output is a fat file *fat_headers is set to an allocated fat header and
+ * fat_arch or fat_arch64 structures, in big endian byte sex, and its size is
+ * returned in *fat_headers_size, else they are set to NULL and zero.  The
+ * offset in the output of each arch is returned in the allocated array
+ * *offsets.  If an error is encountered it is reported and FALSE is returned.
+ */
+static
+enum bool
+layout_archs(
+struct arch *archs,
+uint32_t narchs,
+char *filename,
+time_t toc_time,
+enum bool sort_toc,
+enum bool commons_in_toc,
+enum bool force_64bit_toc,
+enum bool library_warnings,
+uint64_t *file_size,
+char **fat_headers,
+uint32_t *fat_headers_size,
+uint64_t **offsets,
+enum bool *seen_archive)
+{
+    uint32_t i, size;
+    uint64_t offset;
+    struct fat_header *fat_header;
+    struct fat_arch *fat_arch;
+    struct fat_arch_64 *fat_arch64;
+
+	*fat_headers = NULL;
+	*fat_headers_size = 0;
+	*offsets = NULL;
+
+	if(narchs == 0){
+	    error("no contents for file: %s (not created)", filename);
+	    return(FALSE);
+	}
 
 	/*
 	 * Calculate the total size of the file and the final size of each
@@ -389,14 +776,14 @@ enum bool *seen_archive)
 	 */
 	if(narchs > 1 ||
 	   archs[0].fat_arch != NULL || archs[0].fat_arch64 != NULL){
-	    file_size = sizeof(struct fat_header);
+	    *file_size = sizeof(struct fat_header);
 	    if(archs[0].fat_arch64 != NULL)
-		file_size += sizeof(struct fat_arch_64) * narchs;
+		*file_size += sizeof(struct fat_arch_64) * narchs;
 	    else
-		file_size += sizeof(struct fat_arch) * narchs;
+		*file_size += sizeof(struct fat_arch) * narchs;
 	}
 	else
-	    file_size = 0;
+	    *file_size = 0;
 	for(i = 0; i < narchs; i++){
 	    /*
 	     * For each arch that is an archive recreate the table of contents.
@@ -408,10 +795,11 @@ enum bool *seen_archive)
 				       library_warnings);
 		archs[i].library_size += SARMAG + archs[i].toc_size;
 		if(archs[i].fat_arch64 != NULL)
-		    file_size = rnd(file_size, 1 << archs[i].fat_arch64->align);
+		    *file_size = rnd(*file_size,
+				     1 << archs[i].fat_arch64->align);
 		else if(archs[i].fat_arch != NULL)
-		    file_size = rnd(file_size, 1 << archs[i].fat_arch->align);
-		file_size += archs[i].library_size;
+		    *file_size = rnd(*file_size, 1 << archs[i].fat_arch->align);
+		*file_size += archs[i].library_size;
 		if(archs[i].fat_arch64 != NULL)
 		    archs[i].fat_arch64->size = archs[i].library_size;
 		else if(archs[i].fat_arch != NULL)
@@ -423,10 +811,11 @@ enum bool *seen_archive)
 		       + archs[i].object->output_new_content_size
 		       + archs[i].object->output_sym_info_size;
 		if(archs[i].fat_arch64 != NULL)
-		    file_size = rnd(file_size, 1 << archs[i].fat_arch64->align);
+		    *file_size = rnd(*file_size,
+				     1 << archs[i].fat_arch64->align);
 		else if(archs[i].fat_arch != NULL)
-		    file_size = rnd(file_size, 1 << archs[i].fat_arch->align);
-		file_size += size;
+		    *file_size = rnd(*file_size, 1 << archs[i].fat_arch->align);
+		*file_size += size;
 		if(archs[i].fat_arch64 != NULL)
 		    archs[i].fat_arch64->size = size;
 		else if(archs[i].fat_arch != NULL)
@@ -434,10 +823,11 @@ enum bool *seen_archive)
 	    }
 	    else{ /* archs[i].type == OFILE_UNKNOWN */
 		if(archs[i].fat_arch64 != NULL)
-		    file_size = rnd(file_size, 1 << archs[i].fat_arch64->align);
+		    *file_size = rnd(*file_size,
+				     1 << archs[i].fat_arch64->align);
 		else if(archs[i].fat_arch != NULL)
-		    file_size = rnd(file_size, 1 << archs[i].fat_arch->align);
-		file_size += archs[i].unknown_size;
+		    *file_size = rnd(*file_size, 1 << archs[i].fat_arch->align);
+		*file_size += archs[i].unknown_size;
 		if(archs[i].fat_arch64 != NULL)
 		    archs[i].fat_arch64->size = archs[i].unknown_size;
 		else if(archs[i].fat_arch != NULL)
@@ -445,38 +835,37 @@ enum bool *seen_archive)
 	    }
 	}
 
-	/*
-	 * This buffer is vm_allocate'ed to make sure all holes are filled with
-	 * zero bytes.
-	 */
-	if((r = vm_allocate(mach_task_self(), (vm_address_t *)&file,
-			    file_size, TRUE)) != KERN_SUCCESS)
-	    mach_fatal(r, "can't vm_allocate() buffer for output file: %s of "
-		       "size %llu", filename, file_size);
+	*offsets = allocate(narchs * sizeof(uint64_t));
+	memset(*offsets, '\0', narchs * sizeof(uint64_t));
 
 	/*
 	 * If there is more than one architecture then fill in the fat file
-	 * header and the fat_arch or fat_arch64 structures in the buffer.
+	 * header and the fat_arch or fat_arch64 structures.
 	 */
 	if(narchs > 1 ||
 	   archs[0].fat_arch != NULL || archs[0].fat_arch64 != NULL){
-	    fat_header = (struct fat_header *)file;
+	    offset = sizeof(struct fat_header);
+	    if(archs[0].fat_arch64 != NULL)
+		offset += sizeof(struct fat_arch_64) * narchs;
+	    else
+		offset += sizeof(struct fat_arch) * narchs;
+	    *fat_headers_size = offset;
+	    *fat_headers = allocate(*fat_headers_size);
+	    memset(*fat_headers, '\0', *fat_headers_size);
+	    fat_header = (struct fat_header *)*fat_headers;
 	    if(archs[0].fat_arch64 != NULL)
 		fat_header->magic = FAT_MAGIC_64;
 	    else
 		fat_header->magic = FAT_MAGIC;
 	    fat_header->nfat_arch = narchs;
-	    offset = sizeof(struct fat_header);
 	    if(archs[0].fat_arch64 != NULL){
-		offset += sizeof(struct fat_arch_64) * narchs;
 		fat_arch64 = (struct fat_arch_64 *)
-			     (file + sizeof(struct fat_header));
+			     (*fat_headers + sizeof(struct fat_header));
 		fat_arch = NULL;
 	    }
 	    else{
-		offset += sizeof(struct fat_arch) * narchs;
 		fat_arch = (struct fat_arch *)
-			   (file + sizeof(struct fat_header));
+			   (*fat_headers + sizeof(struct fat_header));
 		fat_arch64 = NULL;
 	    }
 	    for(i = 0; i < narchs; i++){
@@ -493,11 +882,16 @@ enum bool *seen_archive)
 			  "offset field in struct fat_arch is only 32-bits and "
 			  "offset (%llu) to architecture %s exceeds that",
 			  offset, archs[i].fat_arch_name);
-		    return;
+		    free(*fat_headers);
+		    free(*offsets);
+		    *fat_headers = NULL;
+		    *offsets = NULL;
+		    return(FALSE);
 		}
 		if(archs[i].fat_arch64 != NULL){
 		    offset = rnd(offset, 1 << archs[i].fat_arch64->align);
 		    fat_arch64[i].offset = offset;
+		    (*offsets)[i] = offset;
 		    fat_arch64[i].size = archs[i].fat_arch64->size;
 		    fat_arch64[i].align = archs[i].fat_arch64->align;
 		    offset += archs[i].fat_arch64->size;
@@ -505,28 +899,66 @@ enum bool *seen_archive)
 		else{
 		    offset = rnd(offset, 1 << archs[i].fat_arch->align);
 		    fat_arch[i].offset = offset;
+		    (*offsets)[i] = offset;
 		    fat_arch[i].size = archs[i].fat_arch->size;
 		    fat_arch[i].align = archs[i].fat_arch->align;
 		    offset += archs[i].fat_arch->size;
 		}
 	    }
+#ifdef __LITTLE_ENDIAN__
+	    swap_fat_header(fat_header, BIG_ENDIAN_BYTE_SEX);
+	    if(archs[0].fat_arch64 != NULL)
+		swap_fat_arch_64(fat_arch64, narchs, BIG_ENDIAN_BYTE_SEX);
+	    else
+		swap_fat_arch(fat_arch, narchs, BIG_ENDIAN_BYTE_SEX);
+#endif /* __LITTLE_ENDIAN__ */
 	}
+	return(TRUE);
+}
+
+/*
+ * put_archs() puts the header of the fat file, if any, and each arch in the
+ * output with the sink.  The table of contents of each archive and the fat
+ * headers and offsets are those created by layout_archs() and file_size is the
+ * size of the output it calculated.
+ */
+static
+void
+put_archs(
+struct arch *archs,
+uint32_t narchs,
+char *filename,
+time_t toc_time,
+enum bool library_warnings,
+char *fat_headers,
+uint32_t fat_headers_size,
+uint64_t *offsets,
+uint64_t file_size,
+struct sink *sink)
+{
+    uint32_t i, j, pad, size;
+    uint32_t i32;
+    uint64_t i64;
+    enum byte_sex target_byte_sex, host_byte_sex;
+    struct dysymtab_command dyst;
+    struct twolevel_hints_command hints_cmd;
+    struct load_command lc, *lcp;
+    struct dylib_command dl, *dlp;
+    int32_t timestamp, index;
+    uint32_t ncmds;
+    enum bool swapped;
+
+	host_byte_sex = get_host_byte_sex();
+
+	sink_write(sink, fat_headers, fat_headers_size);
 
 	/*
-	 * Now put each arch in the buffer.
+	 * Now put each arch in the output.
 	 */
 	for(i = 0; i < narchs; i++){
-	    if(archs[i].fat_arch != NULL || archs[i].fat_arch64 != NULL){
-		if(archs[i].fat_arch64 != NULL)
-		    p = file + fat_arch64[i].offset;
-		else
-		    p = file + fat_arch[i].offset;
-	    }
-	    else
-		p = file;
+	    sink_seek(sink, offsets[i]);
 
 	    if(archs[i].type == OFILE_ARCHIVE){
-		*seen_archive = TRUE;
 		/*
 		 * If the input files only contains non-object files then the
 		 * byte sex of the output can't be determined which is needed
@@ -537,8 +969,7 @@ enum bool *seen_archive)
 		 */
 
 		/* put in the archive magic string */
-		memcpy(p, ARMAG, SARMAG);
-		p += SARMAG;
+		sink_write(sink, ARMAG, SARMAG);
 
 		/*
 		 * Warn for what really is a bad library that has an empty
@@ -589,158 +1020,83 @@ enum bool *seen_archive)
 		 *   a 64-bit for the number of bytes of the ranlib strings
 		 *   the strings for the ranlib structs
 		 */
-		memcpy(p, (char *)(&archs[i].toc_ar_hdr),sizeof(struct ar_hdr));
-		p += sizeof(struct ar_hdr);
+		sink_write(sink, &archs[i].toc_ar_hdr, sizeof(struct ar_hdr));
 
 		if(archs[i].toc_long_name == TRUE){
-		    memcpy(p, archs[i].toc_name, archs[i].toc_name_size);
-		    p += archs[i].toc_name_size +
-			 (rnd(sizeof(struct ar_hdr), 8) -
-			  sizeof(struct ar_hdr));
+		    sink_write(sink, archs[i].toc_name,
+			       archs[i].toc_name_size);
+		    sink_fill(sink, '\0', rnd(sizeof(struct ar_hdr), 8) -
+					   sizeof(struct ar_hdr));
 		}
 
 		if(archs[i].using_64toc == FALSE){
 		    i32 = archs[i].ntocs * sizeof(struct ranlib);
 		    if(target_byte_sex != host_byte_sex)
 			i32 = SWAP_INT(i32);
-		    memcpy(p, (char *)&i32, sizeof(uint32_t));
-		    p += sizeof(uint32_t);
+		    sink_write(sink, &i32, sizeof(uint32_t));
 
 		    if(target_byte_sex != host_byte_sex)
 			swap_ranlib(archs[i].toc_ranlibs, archs[i].ntocs,
 				    target_byte_sex);
-		    memcpy(p, (char *)archs[i].toc_ranlibs,
-			   archs[i].ntocs * sizeof(struct ranlib));
-		    p += archs[i].ntocs * sizeof(struct ranlib);
+		    sink_write(sink, archs[i].toc_ranlibs,
+			       archs[i].ntocs * sizeof(struct ranlib));
 
 		    i32 = archs[i].toc_strsize;
 		    if(target_byte_sex != host_byte_sex)
 			i32 = SWAP_INT(i32);
-		    memcpy(p, (char *)&i32, sizeof(uint32_t));
-		    p += sizeof(uint32_t);
+		    sink_write(sink, &i32, sizeof(uint32_t));
 		}
 		else{
 		    i64 = archs[i].ntocs * sizeof(struct ranlib_64);
 		    if(target_byte_sex != host_byte_sex)
 			i64 = SWAP_LONG_LONG(i64);
-		    memcpy(p, (char *)&i64, sizeof(uint64_t));
-		    p += sizeof(uint64_t);
+		    sink_write(sink, &i64, sizeof(uint64_t));
 
 		    if(target_byte_sex != host_byte_sex)
 			swap_ranlib_64(archs[i].toc_ranlibs64, archs[i].ntocs,
 				       target_byte_sex);
-		    memcpy(p, (char *)archs[i].toc_ranlibs64,
-			   archs[i].ntocs * sizeof(struct ranlib_64));
-		    p += archs[i].ntocs * sizeof(struct ranlib_64);
+		    sink_write(sink, archs[i].toc_ranlibs64,
+			       archs[i].ntocs * sizeof(struct ranlib_64));
 
 		    i64 = archs[i].toc_strsize;
 		    if(target_byte_sex != host_byte_sex)
 			i64 = SWAP_LONG_LONG(i64);
-		    memcpy(p, (char *)&i64, sizeof(uint64_t));
-		    p += sizeof(uint64_t);
+		    sink_write(sink, &i64, sizeof(uint64_t));
 		}
 
-		memcpy(p, (char *)archs[i].toc_strings, archs[i].toc_strsize);
-		p += archs[i].toc_strsize;
+		sink_write(sink, archs[i].toc_strings, archs[i].toc_strsize);
 
 		/*
 		 * Put in the archive header and member contents for each
-		 * member in the buffer.
+		 * member in the output.
 		 */
 		for(j = 0; j < archs[i].nmembers; j++){
-		    memcpy(p, (char *)(archs[i].members[j].ar_hdr),
-			   sizeof(struct ar_hdr));
-		    p += sizeof(struct ar_hdr);
+		    sink_write(sink, archs[i].members[j].ar_hdr,
+			       sizeof(struct ar_hdr));
 
 		    if(archs[i].members[j].member_long_name == TRUE){
-			memcpy(p, archs[i].members[j].member_name,
-			       archs[i].members[j].member_name_size);
-			p += rnd(archs[i].members[j].member_name_size, 8) +
-				   (rnd(sizeof(struct ar_hdr), 8) -
-				    sizeof(struct ar_hdr));
+			sink_write(sink, archs[i].members[j].member_name,
+				   archs[i].members[j].member_name_size);
+			sink_fill(sink, '\0',
+			    rnd(archs[i].members[j].member_name_size, 8) -
+			    archs[i].members[j].member_name_size +
+			    (rnd(sizeof(struct ar_hdr), 8) -
+			     sizeof(struct ar_hdr)));
 		    }
 
 		    if(archs[i].members[j].type == OFILE_Mach_O){
-			/*
-			 * ofile_map swaps the headers to the host_byte_sex if
-			 * the object's byte sex is not the same as the host
-			 * byte sex so if this is the case swap them back
-			 * before writing them out.
-			 */
-			memset(&dyst, '\0', sizeof(struct dysymtab_command));
-			if(archs[i].members[j].object->dyst != NULL)
-			    dyst = *(archs[i].members[j].object->dyst);
-			if(archs[i].members[j].object->hints_cmd != NULL)
-			   hints_cmd = *(archs[i].members[j].object->hints_cmd);
-			if(archs[i].members[j].object->object_byte_sex !=
-								host_byte_sex){
-			    if(archs[i].members[j].object->mh != NULL){
-				if(swap_object_headers(
-				    archs[i].members[j].object->mh,
-				    archs[i].members[j].object->load_commands)
-				    == FALSE)
-					fatal("internal error: "
-					    "swap_object_headers() failed");
-				if(archs[i].members[j].object->output_nsymbols
-				   != 0)
-				    swap_nlist(
-				       archs[i].members[j].object->
-					   output_symbols,
-				       archs[i].members[j].object->
-					   output_nsymbols,
-				       archs[i].members[j].object->
-					   object_byte_sex);
-			    }
-			    else{
-				if(swap_object_headers(
-				    archs[i].members[j].object->mh64,
-				    archs[i].members[j].object->load_commands)
-				    == FALSE)
-					fatal("internal error: "
-					    "swap_object_headers() failed");
-				if(archs[i].members[j].object->output_nsymbols
-				   != 0)
-				    swap_nlist_64(
-				       archs[i].members[j].object->
-					   output_symbols64,
-				       archs[i].members[j].object->
-					   output_nsymbols,
-				       archs[i].members[j].object->
-					   object_byte_sex);
-			    }
-			}
-			if(archs[i].members[j].object->
-				output_sym_info_size == 0 &&
-			   archs[i].members[j].object->
-				input_sym_info_size == 0){
-			    size = archs[i].members[j].object->object_size;
-			    memcpy(p, archs[i].members[j].object->object_addr,
-				   size);
-			}
-			else{
-			    size = archs[i].members[j].object->object_size
-				   - archs[i].members[j].object->
-							input_sym_info_size;
-			    memcpy(p, archs[i].members[j].object->object_addr,
-				   size);
-			    copy_new_symbol_info(p, &size, &dyst,
-				archs[i].members[j].object->dyst, &hints_cmd,
-				archs[i].members[j].object->hints_cmd,
-				archs[i].members[j].object);
-			}
-			p += size;
+			size = put_member_object(archs[i].members[j].object,
+						 sink);
 			pad = rnd(size, 8) - size;
 		    }
 		    else{
-			memcpy(p, archs[i].members[j].unknown_addr, 
-			       archs[i].members[j].unknown_size);
-			p += archs[i].members[j].unknown_size;
+			sink_write(sink, archs[i].members[j].unknown_addr, 
+				   archs[i].members[j].unknown_size);
 			pad = rnd(archs[i].members[j].unknown_size, 8) -
 				    archs[i].members[j].unknown_size;
 		    }
 		    /* as with the UNIX ar(1) program pad with '\n' chars */
-		    for(k = 0; k < pad; k++)
-			*p++ = '\n';
+		    sink_fill(sink, '\n', pad);
 		}
 	    }
 	    else if(archs[i].type == OFILE_Mach_O){
@@ -831,49 +1187,96 @@ enum bool *seen_archive)
 		if(archs[i].object->output_sym_info_size == 0 &&
 		   archs[i].object->input_sym_info_size == 0){
 		    size = archs[i].object->object_size;
-		    memcpy(p, archs[i].object->object_addr, size);
+		    sink_write(sink, archs[i].object->object_addr, size);
 		}
 		else{
 		    size = archs[i].object->object_size
 			   - archs[i].object->input_sym_info_size;
-		    memcpy(p, archs[i].object->object_addr, size);
+		    sink_write(sink, archs[i].object->object_addr, size);
 		    if(archs[i].object->output_new_content_size != 0){
-			memcpy(p + size, archs[i].object->output_new_content,
-			       archs[i].object->output_new_content_size);
+			sink_write(sink, archs[i].object->output_new_content,
+				   archs[i].object->output_new_content_size);
 			size += archs[i].object->output_new_content_size;
 		    }
-		    copy_new_symbol_info(p, &size, &dyst,
+		    copy_new_symbol_info(sink, &size, &dyst,
 				archs[i].object->dyst, &hints_cmd,
 				archs[i].object->hints_cmd,
 				archs[i].object);
 		}
 	    }
 	    else{ /* archs[i].type == OFILE_UNKNOWN */
-		memcpy(p, archs[i].unknown_addr, archs[i].unknown_size);
+		sink_write(sink, archs[i].unknown_addr, archs[i].unknown_size);
 	    }
 	}
-#ifdef __LITTLE_ENDIAN__
-	if(narchs > 1 ||
-	   archs[0].fat_arch != NULL || archs[0].fat_arch64 != NULL){
-	    swap_fat_header(fat_header, BIG_ENDIAN_BYTE_SEX);
-	    if(archs[0].fat_arch64 != NULL)
-		swap_fat_arch_64(fat_arch64, narchs, BIG_ENDIAN_BYTE_SEX);
-	    else
-		swap_fat_arch(fat_arch, narchs, BIG_ENDIAN_BYTE_SEX);
+	sink_seek(sink, file_size);
+}
+
+/*
+ * put_member_object() puts the contents of the object of an archive member in
+ * the output with the sink and returns its size.  ofile_map() swaps the headers
+ * to the host byte sex if the object's byte sex is not the same as the host
+ * byte sex, so if this is the case they are swapped back before they are put
+ * in the output (and are left in the object's byte sex).
+ */
+static
+uint32_t
+put_member_object(
+struct object *object,
+struct sink *sink)
+{
+    uint32_t size;
+    enum byte_sex host_byte_sex;
+    struct dysymtab_command dyst;
+    struct twolevel_hints_command hints_cmd;
+
+	host_byte_sex = get_host_byte_sex();
+	memset(&dyst, '\0', sizeof(struct dysymtab_command));
+	if(object->dyst != NULL)
+	    dyst = *(object->dyst);
+	if(object->hints_cmd != NULL)
+	    hints_cmd = *(object->hints_cmd);
+	if(object->object_byte_sex != host_byte_sex){
+	    if(object->mh != NULL){
+		if(swap_object_headers(object->mh, object->load_commands) ==
+		   FALSE)
+		    fatal("internal error: swap_object_headers() failed");
+		if(object->output_nsymbols != 0)
+		    swap_nlist(object->output_symbols, object->output_nsymbols,
+			       object->object_byte_sex);
+	    }
+	    else{
+		if(swap_object_headers(object->mh64, object->load_commands) ==
+		   FALSE)
+		    fatal("internal error: swap_object_headers() failed");
+		if(object->output_nsymbols != 0)
+		    swap_nlist_64(object->output_symbols64,
+				  object->output_nsymbols,
+				  object->object_byte_sex);
+	    }
 	}
-#endif /* __LITTLE_ENDIAN__ */
-        *outputbuf = file;
-        *length = file_size;
+	if(object->output_sym_info_size == 0 &&
+	   object->input_sym_info_size == 0){
+	    size = object->object_size;
+	    sink_write(sink, object->object_addr, size);
+	}
+	else{
+	    size = object->object_size - object->input_sym_info_size;
+	    sink_write(sink, object->object_addr, size);
+	    copy_new_symbol_info(sink, &size, &dyst, object->dyst, &hints_cmd,
+				 object->hints_cmd, object);
+	}
+	return(size);
 }
 
 /*
- * copy_new_symbol_info() copies the new and updated symbolic information into
- * the buffer for the object.
+ * copy_new_symbol_info() puts the new and updated symbolic information for
+ * the object in the output with the sink.  Pieces of the information that are
+ * not there are left as zero bytes.
  */
 static
 void
 copy_new_symbol_info(
-char *p,
+struct sink *sink,
 uint32_t *size,
 struct dysymtab_command *dyst,
 struct dysymtab_command *old_dyst,
@@ -884,149 +1287,307 @@ struct object *object)
 	if(old_dyst != NULL){
 	    if(object->output_dyld_info_size != 0){
 		if(object->output_dyld_info != NULL)
-		    memcpy(p + *size, object->output_dyld_info,
-			   object->output_dyld_info_size);
+		    sink_write(sink, object->output_dyld_info,
+			       object->output_dyld_info_size);
+		else
+		    sink_fill(sink, '\0', object->output_dyld_info_size);
 		*size += object->output_dyld_info_size;
 	    }
-	    memcpy(p + *size, object->output_loc_relocs,
-		   dyst->nlocrel * sizeof(struct relocation_info));
+	    sink_write(sink, object->output_loc_relocs,
+		       dyst->nlocrel * sizeof(struct relocation_info));
 	    *size += dyst->nlocrel *
 		     sizeof(struct relocation_info);
 	    if(object->output_split_info_data_size != 0){
 		if(object->output_split_info_data != NULL)
-		    memcpy(p + *size, object->output_split_info_data,
-			   object->output_split_info_data_size);
+		    sink_write(sink, object->output_split_info_data,
+			       object->output_split_info_data_size);
+		else
+		    sink_fill(sink, '\0', object->output_split_info_data_size);
 		*size += object->output_split_info_data_size;
 	    }
 	    if(object->output_func_start_info_data_size != 0){
 		if(object->output_func_start_info_data != NULL)
-		    memcpy(p + *size, object->output_func_start_info_data,
-			   object->output_func_start_info_data_size);
+		    sink_write(sink, object->output_func_start_info_data,
+			       object->output_func_start_info_data_size);
+		else
+		    sink_fill(sink, '\0',
+			      object->output_func_start_info_data_size);
 		*size += object->output_func_start_info_data_size;
 	    }
 	    if(object->output_data_in_code_info_data_size != 0){
 		if(object->output_data_in_code_info_data != NULL)
-		    memcpy(p + *size, object->output_data_in_code_info_data,
-			   object->output_data_in_code_info_data_size);
+		    sink_write(sink, object->output_data_in_code_info_data,
+			       object->output_data_in_code_info_data_size);
+		else
+		    sink_fill(sink, '\0',
+			      object->output_data_in_code_info_data_size);
 		*size += object->output_data_in_code_info_data_size;
 	    }
 	    if(object->output_code_sign_drs_info_data_size != 0){
 		if(object->output_code_sign_drs_info_data != NULL)
-		    memcpy(p + *size, object->output_code_sign_drs_info_data,
-			   object->output_code_sign_drs_info_data_size);
+		    sink_write(sink, object->output_code_sign_drs_info_data,
+			       object->output_code_sign_drs_info_data_size);
+		else
+		    sink_fill(sink, '\0',
+			      object->output_code_sign_drs_info_data_size);
 		*size += object->output_code_sign_drs_info_data_size;
 	    }
 	    if(object->output_link_opt_hint_info_data_size != 0){
 		if(object->output_link_opt_hint_info_data != NULL)
-		    memcpy(p + *size, object->output_link_opt_hint_info_data,
-			   object->output_link_opt_hint_info_data_size);
+		    sink_write(sink, object->output_link_opt_hint_info_data,
+			       object->output_link_opt_hint_info_data_size);
+		else
+		    sink_fill(sink, '\0',
+			      object->output_link_opt_hint_info_data_size);
 		*size += object->output_link_opt_hint_info_data_size;
 	    }
 	    if(object->mh != NULL){
-		memcpy(p + *size, object->output_symbols,
-		       object->output_nsymbols * sizeof(struct nlist));
+		sink_write(sink, object->output_symbols,
+			   object->output_nsymbols * sizeof(struct nlist));
 		*size += object->output_nsymbols *
 			 sizeof(struct nlist);
 	    }
 	    else{
-		memcpy(p + *size, object->output_symbols64,
-		       object->output_nsymbols * sizeof(struct nlist_64));
+		sink_write(sink, object->output_symbols64,
+			   object->output_nsymbols * sizeof(struct nlist_64));
 		*size += object->output_nsymbols *
 			 sizeof(struct nlist_64);
 	    }
 	    if(old_hints_cmd != NULL){
-		memcpy(p + *size, object->output_hints,
-		       hints_cmd->nhints * sizeof(struct twolevel_hint));
+		sink_write(sink, object->output_hints,
+			   hints_cmd->nhints * sizeof(struct twolevel_hint));
 		*size += hints_cmd->nhints *
 			 sizeof(struct twolevel_hint);
 	    }
-	    memcpy(p + *size, object->output_ext_relocs,
-		   dyst->nextrel * sizeof(struct relocation_info));
+	    sink_write(sink, object->output_ext_relocs,
+		       dyst->nextrel * sizeof(struct relocation_info));
 	    *size += dyst->nextrel *
 		     sizeof(struct relocation_info);
-	    memcpy(p + *size, object->output_indirect_symtab,
-		   dyst->nindirectsyms * sizeof(uint32_t));
+	    sink_write(sink, object->output_indirect_symtab,
+		       dyst->nindirectsyms * sizeof(uint32_t));
+	    sink_fill(sink, '\0', object->input_indirectsym_pad);
 	    *size += dyst->nindirectsyms * sizeof(uint32_t) +
 		     object->input_indirectsym_pad;
-	    memcpy(p + *size, object->output_tocs,
-		   object->output_ntoc *sizeof(struct dylib_table_of_contents));
+	    sink_write(sink, object->output_tocs,
+		       object->output_ntoc *
+		       sizeof(struct dylib_table_of_contents));
 	    *size += object->output_ntoc *
 		     sizeof(struct dylib_table_of_contents);
 	    if(object->mh != NULL){
-		memcpy(p + *size, object->output_mods,
-		       object->output_nmodtab * sizeof(struct dylib_module));
+		sink_write(sink, object->output_mods,
+			   object->output_nmodtab *
+			   sizeof(struct dylib_module));
 		*size += object->output_nmodtab *
 			 sizeof(struct dylib_module);
 	    }
 	    else{
-		memcpy(p + *size, object->output_mods64,
-		       object->output_nmodtab * sizeof(struct dylib_module_64));
+		sink_write(sink, object->output_mods64,
+			   object->output_nmodtab *
+			   sizeof(struct dylib_module_64));
 		*size += object->output_nmodtab *
 			 sizeof(struct dylib_module_64);
 	    }
-	    memcpy(p + *size, object->output_refs,
-		   object->output_nextrefsyms * sizeof(struct dylib_reference));
+	    sink_write(sink, object->output_refs,
+		       object->output_nextrefsyms *
+		       sizeof(struct dylib_reference));
 	    *size += object->output_nextrefsyms *
 		     sizeof(struct dylib_reference);
-	    memcpy(p + *size, object->output_strings,
-		   object->output_strings_size);
+	    sink_write(sink, object->output_strings,
+		       object->output_strings_size);
 	    *size += object->output_strings_size;
-	    memset(p + *size, '\0', object->output_strings_size_pad);
+	    sink_fill(sink, '\0', object->output_strings_size_pad);
 	    *size += object->output_strings_size_pad;
 	    if(object->output_code_sig_data_size != 0){
+		sink_fill(sink, '\0', rnd(*size, 16) - *size);
 		*size = rnd(*size, 16);
 		if(object->output_code_sig_data != NULL)
-		    memcpy(p + *size, object->output_code_sig_data,
-			   object->output_code_sig_data_size);
+		    sink_write(sink, object->output_code_sig_data,
+			       object->output_code_sig_data_size);
+		else
+		    sink_fill(sink, '\0', object->output_code_sig_data_size);
 		*size += object->output_code_sig_data_size;
 	    }
 	}
 	else{
 	    if(object->output_func_start_info_data_size != 0){
 		if(object->output_func_start_info_data != NULL)
-		    memcpy(p + *size, object->output_func_start_info_data,
-			   object->output_func_start_info_data_size);
+		    sink_write(sink, object->output_func_start_info_data,
+			       object->output_func_start_info_data_size);
+		else
+		    sink_fill(sink, '\0',
+			      object->output_func_start_info_data_size);
 		*size += object->output_func_start_info_data_size;
 	    }
 	    if(object->output_data_in_code_info_data_size != 0){
 		if(object->output_data_in_code_info_data != NULL)
-		    memcpy(p + *size, object->output_data_in_code_info_data,
-			   object->output_data_in_code_info_data_size);
+		    sink_write(sink, object->output_data_in_code_info_data,
+			       object->output_data_in_code_info_data_size);
+		else
+		    sink_fill(sink, '\0',
+			      object->output_data_in_code_info_data_size);
 		*size += object->output_data_in_code_info_data_size;
 	    }
 	    if(object->output_link_opt_hint_info_data_size != 0){
 		if(object->output_link_opt_hint_info_data != NULL)
-		    memcpy(p + *size, object->output_link_opt_hint_info_data,
-			   object->output_link_opt_hint_info_data_size);
+		    sink_write(sink, object->output_link_opt_hint_info_data,
+			       object->output_link_opt_hint_info_data_size);
+		else
+		    sink_fill(sink, '\0',
+			      object->output_link_opt_hint_info_data_size);
 		*size += object->output_link_opt_hint_info_data_size;
 	    }
 	    if(object->mh != NULL){
-		memcpy(p + *size, object->output_symbols,
-		       object->output_nsymbols * sizeof(struct nlist));
+		sink_write(sink, object->output_symbols,
+			   object->output_nsymbols * sizeof(struct nlist));
 		*size += object->output_nsymbols *
 			 sizeof(struct nlist);
 	    }
 	    else{
-		memcpy(p + *size, object->output_symbols64,
-		       object->output_nsymbols * sizeof(struct nlist_64));
+		sink_write(sink, object->output_symbols64,
+			   object->output_nsymbols * sizeof(struct nlist_64));
 		*size += object->output_nsymbols *
 			 sizeof(struct nlist_64);
 	    }
-	    memcpy(p + *size, object->output_strings,
-		   object->output_strings_size);
+	    sink_write(sink, object->output_strings,
+		       object->output_strings_size);
 	    *size += object->output_strings_size;
-	    memset(p + *size, '\0', object->output_strings_size_pad);
+	    sink_fill(sink, '\0', object->output_strings_size_pad);
 	    *size += object->output_strings_size_pad;
 	    if(object->output_code_sig_data_size != 0){
+		sink_fill(sink, '\0', rnd(*size, 16) - *size);
 		*size = rnd(*size, 16);
 		if(object->output_code_sig_data != NULL)
-		    memcpy(p + *size, object->output_code_sig_data,
-			   object->output_code_sig_data_size);
+		    sink_write(sink, object->output_code_sig_data,
+			       object->output_code_sig_data_size);
+		else
+		    sink_fill(sink, '\0', object->output_code_sig_data_size);
 		*size += object->output_code_sig_data_size;
 	    }
 	}
 }
 
+
+/*
+ * sink_write() puts size bytes of data in the output at the sink's offset.
+ * When streaming, pieces smaller than the sink's buffer are gathered in it and
+ * larger pieces are written directly from data.
+ */
+static
+void
+sink_write(
+struct sink *sink,
+const void *data,
+uint64_t size)
+{
+	if(size == 0)
+	    return;
+	if(sink->file != NULL){
+	    memcpy(sink->file + sink->offset, data, size);
+	}
+	else if(sink->buf_size + size <= SINK_BUF_SIZE){
+	    memcpy(sink->buf + sink->buf_size, data, size);
+	    sink->buf_size += size;
+	}
+	else{
+	    sink_flush(sink);
+	    if(size < SINK_BUF_SIZE){
+		memcpy(sink->buf, data, size);
+		sink->buf_size = size;
+	    }
+	    else
+		sink_write_fd(sink, data, size);
+	}
+	sink->offset += size;
+}
+
+/*
+ * sink_fill() puts size bytes with the value c in the output at the sink's
+ * offset.
+ */
+static
+void
+sink_fill(
+struct sink *sink,
+char c,
+uint64_t size)
+{
+    uint64_t n;
+
+	if(sink->file != NULL){
+	    memset(sink->file + sink->offset, c, size);
+	    sink->offset += size;
+	    return;
+	}
+	while(size != 0){
+	    if(sink->buf_size == SINK_BUF_SIZE)
+		sink_flush(sink);
+	    n = SINK_BUF_SIZE - sink->buf_size;
+	    if(n > size)
+		n = size;
+	    memset(sink->buf + sink->buf_size, c, n);
+	    sink->buf_size += n;
+	    sink->offset += n;
+	    size -= n;
+	}
+}
+
+/*
+ * sink_seek() fills the output with zero bytes up to offset, which is used for
+ * the alignment padding between the archs of a fat file.
+ */
+static
+void
+sink_seek(
+struct sink *sink,
+uint64_t offset)
+{
+	if(offset > sink->offset)
+	    sink_fill(sink, '\0', offset - sink->offset);
+}
+
+/*
+ * sink_flush() writes out what is gathered in the sink's buffer when
+ * streaming.
+ */
+static
+void
+sink_flush(
+struct sink *sink)
+{
+	if(sink->file == NULL && sink->buf_size != 0){
+	    sink_write_fd(sink, sink->buf, sink->buf_size);
+	    sink->buf_size = 0;
+	}
+}
+
+/*
+ * sink_write_fd() writes size bytes of data to the sink's file descriptor.  If
+ * the write fails an error is reported once and later writes are not done.
+ */
+static
+void
+sink_write_fd(
+struct sink *sink,
+const char *data,
+uint64_t size)
+{
+    ssize_t n;
+
+	while(size != 0 && sink->failed == FALSE){
+	    n = write(sink->fd, data, size > INT_MAX ? INT_MAX : size);
+	    if(n == -1){
+		if(errno == EINTR)
+		    continue;
+		system_error("can't write output file: %s", sink->filename);
+		sink->failed = TRUE;
+	    }
+	    else{
+		data += n;
+		size -= n;
+	    }
+	}
+}
+
 /*
  * make_table_of_contents() make the table of contents for the specified arch
  * and fills in the toc_* fields in the arch.  Output is the name of the output
@@ -1043,17 +1604,14 @@ enum bool commons_in_toc,
 enum bool force_64bit_toc,
 enum bool library_warnings)
 {
-    uint32_t i, j, k, r, s, nsects;
+    uint32_t i, j, k, nsects;
+    uint64_t nsymbols;
     struct member *member;
     struct object *object;
     struct load_command *lc;
     struct segment_command *sg;
     struct segment_command_64 *sg64;
-    struct nlist *symbols;
-    struct nlist_64 *symbols64;
-    uint32_t nsymbols;
-    char *strings;
-    uint32_t strings_size;
+    struct toc_job job;
     enum bool sorted;
     unsigned short toc_mode;
     int oumask, numask;
@@ -1062,19 +1620,17 @@ enum bool library_warnings)
     struct section_64 *section64;
     uint32_t ncmds;
 
-	symbols = NULL; /* here to quite compiler maybe warning message */
-	symbols64 = NULL;
-	strings = NULL; /* here to quite compiler maybe warning message */
-
 	/*
-	 * First pass over the members to count how many ranlib structs are
-	 * needed and the size of the strings in the toc that are needed.
+	 * First pass over the members to set up each object's array of
+	 * section pointers and symbol table, and to swap its symbols to the
+	 * host byte sex.  The number of symbols is totaled to see if it is
+	 * worth scanning the symbols in parallel.
 	 */
+	nsymbols = 0;
 	for(i = 0; i < arch->nmembers; i++){
 	    member = arch->members + i;
 	    if(member->type == OFILE_Mach_O){
 		object = member->object;
-		nsymbols = 0;
 		nsects = 0;
 		lc = object->load_commands;
 		if(object->mh != NULL)
@@ -1133,67 +1689,67 @@ enum bool library_warnings)
 			lc = (struct load_command *)((char *)lc + lc->cmdsize);
 		    }
 		    if(object->st != NULL && object->st->nsyms != 0){
-			if(object->mh != NULL){
-			    symbols = (struct nlist *)(object->object_addr +
-						       object->st->symoff);
-			    if(object->object_byte_sex != get_host_byte_sex())
-				swap_nlist(symbols, object->st->nsyms,
-					   get_host_byte_sex());
-			}
-			else{
-			    symbols64 = (struct nlist_64 *)
-				(object->object_addr + object->st->symoff);
-			    if(object->object_byte_sex != get_host_byte_sex())
-				swap_nlist_64(symbols64, object->st->nsyms,
-					      get_host_byte_sex());
-			}
-			nsymbols = object->st->nsyms;
-			strings = object->object_addr + object->st->stroff;
-			strings_size = object->st->strsize;
-		    }
-		}
-		else /* object->output_sym_info_size != 0 */ {
-		    if(object->mh != NULL)
-			symbols = object->output_symbols;
-		    else
-			symbols64 = object->output_symbols64;
-		    nsymbols = object->output_nsymbols;
-		    strings = object->output_strings;
-		    strings_size = object->output_strings_size;
-		}
-		for(j = 0; j < nsymbols; j++){
-		    if(object->mh != NULL){
-			if(toc_symbol(symbols + j, commons_in_toc,
-			   object->sections) == TRUE){
-			    arch->ntocs++;
-			    arch->toc_strsize +=
-				strlen(strings + symbols[j].n_un.n_strx) + 1;
-			}
-		    }
-		    else{
-			if(toc_symbol_64(symbols64 + j, commons_in_toc,
-			   object->sections64) == TRUE){
-			    arch->ntocs++;
-			    arch->toc_strsize +=
-				strlen(strings + symbols64[j].n_un.n_strx) + 1;
+			if(object->object_byte_sex != get_host_byte_sex()){
+			    if(object->mh != NULL)
+				swap_nlist((struct nlist *)
+				    (object->object_addr + object->st->symoff),
+				    object->st->nsyms, get_host_byte_sex());
+			    else
+				swap_nlist_64((struct nlist_64 *)
+				    (object->object_addr + object->st->symoff),
+				    object->st->nsyms, get_host_byte_sex());
 			}
+			nsymbols += object->st->nsyms;
 		    }
 		}
+		else
+		    nsymbols += object->output_nsymbols;
 	    }
 #ifdef LTO_SUPPORT
 	    else if(member->type == OFILE_LLVM_BITCODE){
-                nsymbols = lto_get_nsyms(member->lto);
-                for(j = 0; j < nsymbols; j++){
-                    if(lto_toc_symbol(member->lto, j, commons_in_toc) == TRUE){
-			arch->ntocs++;
-			arch->toc_strsize +=
-                            strlen(lto_symbol_name(member->lto, j)) + 1;
-                    }
-                }
+		nsymbols += lto_get_nsyms(member->lto);
 	    }
 #endif /* LTO_SUPPORT */
 	}
 
+	/*
+	 * For large libraries the members' symbols are scanned in worker
+	 * processes, with the per member results in shared memory.
+	 */
+	job.arch = arch;
+	job.commons_in_toc = commons_in_toc;
+	if(nsymbols >= TOC_PARALLEL_NSYMBOLS && arch->nmembers > 1)
+	    job.njobs = writeout_toc_njobs;
+	else
+	    job.njobs = 1;
+	if(job.njobs > 1){
+	    job.ntocs = parallel_allocate(arch->nmembers * sizeof(uint32_t));
+	    job.strsizes = parallel_allocate(arch->nmembers *
+					     sizeof(uint64_t));
+	}
+	else{
+	    job.ntocs = allocate(arch->nmembers * sizeof(uint32_t));
+	    job.strsizes = allocate(arch->nmembers * sizeof(uint64_t));
+	}
+	job.toc_entries = NULL;
+	job.toc_strings = NULL;
+
+	/*
+	 * Second pass over the members to count how many ranlib structs are
+	 * needed and the size of the strings in the toc that are needed.
+	 */
+	parallel_for(arch->nmembers, job.njobs, toc_member_job, &job);
+	job.toc_offsets = allocate(arch->nmembers * sizeof(uint64_t));
+	job.str_offsets = allocate(arch->nmembers * sizeof(uint64_t));
+	arch->ntocs = 0;
+	arch->toc_strsize = 0;
+	for(i = 0; i < arch->nmembers; i++){
+	    job.toc_offsets[i] = arch->ntocs;
+	    job.str_offsets[i] = arch->toc_strsize;
+	    arch->ntocs += job.ntocs[i];
+	    arch->toc_strsize += job.strsizes[i];
+	}
+
 	/*
 	 * Allocate the space for the table of content entries, the ranlib
 	 * structs and strings for the table of contents.
@@ -1206,121 +1762,96 @@ enum bool library_warnings)
 	    memset(arch->toc_strings + arch->toc_strsize - 7, '\0', 7);
 
 	/*
-	 * Second pass over the members to fill in the toc_entry structs and
+	 * Third pass over the members to fill in the toc_entry structs and
 	 * the strings for the table of contents.  The symbol_name field is
 	 * filled in with a pointer to a string contained in arch->toc_strings
 	 * for easy sorting and conversion to an index.  The member_index field
          * is filled in with the member index plus one to allow marking with
 	 * its negative value by check_sort_toc_entries() and easy conversion to
-	 * the real offset.
+	 * the real offset.  When this is done by worker processes they fill in
+	 * shared copies which are then copied to the arch.
+	 */
+	if(job.njobs > 1){
+	    job.toc_entries = parallel_allocate(sizeof(struct toc_entry) *
+						arch->ntocs);
+	    job.toc_strings = parallel_allocate(arch->toc_strsize);
+	}
+	else{
+	    job.toc_entries = arch->toc_entries;
+	    job.toc_strings = arch->toc_strings;
+	}
+	parallel_for(arch->nmembers, job.njobs, toc_member_job, &job);
+	if(job.njobs > 1){
+	    memcpy(arch->toc_strings, job.toc_strings, arch->toc_strsize);
+	    for(i = 0; i < arch->ntocs; i++){
+		arch->toc_entries[i].symbol_name = arch->toc_strings +
+		    (job.toc_entries[i].symbol_name - job.toc_strings);
+		arch->toc_entries[i].member_index =
+		    job.toc_entries[i].member_index;
+	    }
+	    parallel_deallocate(job.toc_entries,
+				sizeof(struct toc_entry) * arch->ntocs);
+	    parallel_deallocate(job.toc_strings, arch->toc_strsize);
+	    parallel_deallocate(job.ntocs, arch->nmembers * sizeof(uint32_t));
+	    parallel_deallocate(job.strsizes,
+				arch->nmembers * sizeof(uint64_t));
+	}
+	else{
+	    free(job.ntocs);
+	    free(job.strsizes);
+	}
+	free(job.toc_offsets);
+	free(job.str_offsets);
+
+	/*
+	 * Swap the symbols of objects not in the host byte sex back.
 	 */
-	r = 0;
-	s = 0;
 	for(i = 0; i < arch->nmembers; i++){
 	    member = arch->members + i;
 	    if(member->type == OFILE_Mach_O){
 		object = member->object;
-		nsymbols = 0;
-		if(object->output_sym_info_size == 0){
-		    if(object->st != NULL){
-			if(object->mh != NULL)
-			    symbols = (struct nlist *)
-				(object->object_addr + object->st->symoff);
-			else
-			    symbols64 = (struct nlist_64 *)
-				(object->object_addr + object->st->symoff);
-			nsymbols = object->st->nsyms;
-			strings = object->object_addr + object->st->stroff;
-			strings_size = object->st->strsize;
-		    }
-		    else{
-			symbols = NULL;
-			nsymbols = 0;
-			strings = NULL;
-			strings_size = 0;
-		    }
-		}
-		else{
+		if(object->output_sym_info_size == 0 &&
+		   object->st != NULL && object->st->nsyms != 0 &&
+		   object->object_byte_sex != get_host_byte_sex()){
 		    if(object->mh != NULL)
-			symbols = object->output_symbols;
+			swap_nlist((struct nlist *)
+			    (object->object_addr + object->st->symoff),
+			    object->st->nsyms, object->object_byte_sex);
 		    else
-			symbols64 = object->output_symbols64;
-		    nsymbols = object->output_nsymbols;
-		    strings = object->output_strings;
-		    strings_size = object->output_strings_size;
+			swap_nlist_64((struct nlist_64 *)
+			    (object->object_addr + object->st->symoff),
+			    object->st->nsyms, object->object_byte_sex);
 		}
-		for(j = 0; j < nsymbols; j++){
-		    if(object->mh != NULL){
-			if((uint32_t)symbols[j].n_un.n_strx > strings_size)
-			    continue;
-			if(toc_symbol(symbols + j, commons_in_toc,
-			   object->sections) == TRUE){
-			    strcpy(arch->toc_strings + s, 
-				   strings + symbols[j].n_un.n_strx);
-			    arch->toc_entries[r].symbol_name =
-							arch->toc_strings + s;
-			    arch->toc_entries[r].member_index = i + 1;
-			    r++;
-			    s += strlen(strings + symbols[j].n_un.n_strx) + 1;
-			}
-		    }
-		    else{
-			if((uint32_t)symbols64[j].n_un.n_strx >
-			   strings_size)
-			    continue;
-			if(toc_symbol_64(symbols64 + j, commons_in_toc,
-			   object->sections64) == TRUE){
-			    strcpy(arch->toc_strings + s, 
-				   strings + symbols64[j].n_un.n_strx);
-			    arch->toc_entries[r].symbol_name =
-							arch->toc_strings + s;
-			    arch->toc_entries[r].member_index = i + 1;
-			    r++;
-			    s += strlen(strings + symbols64[j].n_un.n_strx) + 1;
-			}
-		    }
-		}
-		if(object->output_sym_info_size == 0){
-		    if(object->object_byte_sex != get_host_byte_sex()){
-			if(object->mh != NULL)
-			    swap_nlist(symbols, nsymbols,
-				       object->object_byte_sex);
-			else
-			    swap_nlist_64(symbols64, nsymbols,
-				          object->object_byte_sex);
-		    }
-		}
-	    }
-#ifdef LTO_SUPPORT
-	    else if(member->type == OFILE_LLVM_BITCODE){
-                nsymbols = lto_get_nsyms(member->lto);
-                for(j = 0; j < nsymbols; j++){
-                    if(lto_toc_symbol(member->lto, j, commons_in_toc) == TRUE){
-			strcpy(arch->toc_strings + s, 
-			       lto_symbol_name(member->lto, j));
-			arch->toc_entries[r].symbol_name =
-						    arch->toc_strings + s;
-			arch->toc_entries[r].member_index = i + 1;
-			r++;
-			s += strlen(lto_symbol_name(member->lto, j)) + 1;
-                    }
-                }
 	    }
-#endif /* LTO_SUPPORT */
 	}
 
 	/*
 	 * If the table of contents is to be sorted by symbol name then try to
-	 * sort it and leave it sorted if no duplicates.
+	 * sort it and leave it sorted if no duplicates.  The names are first
+	 * checked for duplicates with a hash table, and if there are none they
+	 * are sorted with sort_names().  Else this is done as it always has
+	 * been with qsort() so the unsorted table of contents and the warnings
+	 * about the duplicates are the same.
 	 */
 	if(sort_toc == TRUE){
-	    qsort(arch->toc_entries, arch->ntocs, sizeof(struct toc_entry),
-		  (int (*)(const void *, const void *))toc_entry_name_qsort);
-	    sorted = check_sort_toc_entries(arch, output, library_warnings);
-	    if(sorted == FALSE){
+	    if(names_unique(arch->toc_entries, arch->ntocs,
+			    sizeof(struct toc_entry)) == TRUE){
+		sort_names(arch->toc_entries, arch->ntocs,
+			   sizeof(struct toc_entry));
+		sorted = TRUE;
+	    }
+	    else{
 		qsort(arch->toc_entries, arch->ntocs, sizeof(struct toc_entry),
 		      (int (*)(const void *, const void *))
-		      toc_entry_index_qsort);
+		      toc_entry_name_qsort);
+		sorted = check_sort_toc_entries(arch, output,
+						library_warnings);
+		if(sorted == FALSE){
+		    qsort(arch->toc_entries, arch->ntocs,
+			  sizeof(struct toc_entry),
+			  (int (*)(const void *, const void *))
+			  toc_entry_index_qsort);
+		}
 	    }
 	}
 	else{
@@ -1495,6 +2026,139 @@ enum bool library_warnings)
 	       (int)sizeof(arch->toc_ar_hdr.ar_fmag));
 }
 
+/*
+ * toc_member_job() is called by parallel_for() to scan the symbols of the
+ * member at index i for make_table_of_contents().  If job->toc_entries is NULL
+ * the number of toc entries and the size of their strings are stored for the
+ * member, else its toc entries and strings are filled in.
+ */
+static
+void
+toc_member_job(
+uint32_t i,
+void *cookie)
+{
+    struct toc_job *job;
+    uint32_t ntocs;
+    uint64_t strsize;
+
+	job = (struct toc_job *)cookie;
+	if(job->toc_entries == NULL)
+	    toc_member(job->arch, i, job->commons_in_toc, NULL, NULL,
+		       job->ntocs + i, job->strsizes + i);
+	else
+	    toc_member(job->arch, i, job->commons_in_toc,
+		       job->toc_entries + job->toc_offsets[i],
+		       job->toc_strings + job->str_offsets[i],
+		       &ntocs, &strsize);
+}
+
+/*
+ * toc_member() scans the symbols of the member at index i of the arch for the
+ * ones that go in the table of contents.  It returns their number and the size
+ * of their strings in *ntocs and *strsize.  If toc_entries is not NULL the
+ * strings are copied to toc_strings and the toc_entry structs for them are
+ * filled in.  An object's symbols must have been set up and swapped to the
+ * host byte sex by make_table_of_contents().
+ */
+static
+void
+toc_member(
+struct arch *arch,
+uint32_t i,
+enum bool commons_in_toc,
+struct toc_entry *toc_entries,
+char *toc_strings,
+uint32_t *ntocs,
+uint64_t *strsize)
+{
+    uint32_t j, n_strx, nsymbols, strings_size, len;
+    struct member *member;
+    struct object *object;
+    struct nlist *symbols;
+    struct nlist_64 *symbols64;
+    char *strings;
+    enum bool is_toc_symbol;
+
+	*ntocs = 0;
+	*strsize = 0;
+	member = arch->members + i;
+	if(member->type == OFILE_Mach_O){
+	    object = member->object;
+	    symbols = NULL;
+	    symbols64 = NULL;
+	    if(object->output_sym_info_size == 0){
+		if(object->st == NULL)
+		    return;
+		if(object->mh != NULL)
+		    symbols = (struct nlist *)
+			(object->object_addr + object->st->symoff);
+		else
+		    symbols64 = (struct nlist_64 *)
+			(object->object_addr + object->st->symoff);
+		nsymbols = object->st->nsyms;
+		strings = object->object_addr + object->st->stroff;
+		strings_size = object->st->strsize;
+	    }
+	    else{
+		if(object->mh != NULL)
+		    symbols = object->output_symbols;
+		else
+		    symbols64 = object->output_symbols64;
+		nsymbols = object->output_nsymbols;
+		strings = object->output_strings;
+		strings_size = object->output_strings_size;
+	    }
+	    for(j = 0; j < nsymbols; j++){
+		if(object->mh != NULL){
+		    n_strx = symbols[j].n_un.n_strx;
+		    if(n_strx > strings_size)
+			continue;
+		    is_toc_symbol = toc_symbol(symbols + j, commons_in_toc,
+					       object->sections);
+		}
+		else{
+		    n_strx = symbols64[j].n_un.n_strx;
+		    if(n_strx > strings_size)
+			continue;
+		    is_toc_symbol = toc_symbol_64(symbols64 + j,
+						  commons_in_toc,
+						  object->sections64);
+		}
+		if(is_toc_symbol == TRUE){
+		    len = strlen(strings + n_strx) + 1;
+		    if(toc_entries != NULL){
+			memcpy(toc_strings + *strsize, strings + n_strx, len);
+			toc_entries[*ntocs].symbol_name = toc_strings +
+							  *strsize;
+			toc_entries[*ntocs].member_index = i + 1;
+		    }
+		    (*ntocs)++;
+		    *strsize += len;
+		}
+	    }
+	}
+#ifdef LTO_SUPPORT
+	else if(member->type == OFILE_LLVM_BITCODE){
+	    nsymbols = lto_get_nsyms(member->lto);
+	    for(j = 0; j < nsymbols; j++){
+		if(lto_toc_symbol(member->lto, j, commons_in_toc) == TRUE){
+		    len = strlen(lto_symbol_name(member->lto, j)) + 1;
+		    if(toc_entries != NULL){
+			memcpy(toc_strings + *strsize,
+			       lto_symbol_name(member->lto, j), len);
+			toc_entries[*ntocs].symbol_name = toc_strings +
+							  *strsize;
+			toc_entries[*ntocs].member_index = i + 1;
+		    }
+		    (*ntocs)++;
+		    *strsize += len;
+		}
+	    }
+	}
+#endif /* LTO_SUPPORT */
+}
+
 /*
  * toc_symbol() returns TRUE if the symbol is to be included in the table of
  * contents otherwise it returns FALSE.
@@ -117,6 +117,7 @@ char **envp)
     char **files;
 
 	progname = argv[0];
+	ofile_map_read_only = TRUE;
 
 	arch_flags = NULL;
 	narch_flags = 0;
@@ -275,8 +276,8 @@ void *cookie)
     uint32_t i, mh_flags, mh_ncmds, n_type;
     struct load_command *lc;
     struct symtab_command *st;
-    struct nlist *symbols;
-    struct nlist_64 *symbols64;
+    struct nlist *symbols, *allocated_symbols;
+    struct nlist_64 *symbols64, *allocated_symbols64;
     struct symbol *syms;
     uint32_t nsymbols;
     char *strings;
@@ -353,15 +354,33 @@ void *cookie)
 	nsymbols = st->nsyms;
 	symbols = NULL;
 	symbols64 = NULL;
+	allocated_symbols = NULL;
+	allocated_symbols64 = NULL;
+	/*
+	 * The file is mapped read-only so symbols in another byte sex are
+	 * swapped in a copy.
+	 */
 	if(ofile->mh != NULL){
 	    symbols = (struct nlist *)(ofile->object_addr + st->symoff);
-	    if(ofile->object_byte_sex != get_host_byte_sex())
-		swap_nlist(symbols, nsymbols, get_host_byte_sex());
+	    if(ofile->object_byte_sex != get_host_byte_sex()){
+		allocated_symbols = allocate(sizeof(struct nlist) * nsymbols);
+		memcpy(allocated_symbols, symbols,
+		       sizeof(struct nlist) * nsymbols);
+		swap_nlist(allocated_symbols, nsymbols, get_host_byte_sex());
+		symbols = allocated_symbols;
+	    }
 	}
 	else{
 	    symbols64 = (struct nlist_64 *)(ofile->object_addr + st->symoff);
-	    if(ofile->object_byte_sex != get_host_byte_sex())
-		swap_nlist_64(symbols64, nsymbols, get_host_byte_sex());
+	    if(ofile->object_byte_sex != get_host_byte_sex()){
+		allocated_symbols64 = allocate(sizeof(struct nlist_64) *
+					       nsymbols);
+		memcpy(allocated_symbols64, symbols64,
+		       sizeof(struct nlist_64) * nsymbols);
+		swap_nlist_64(allocated_symbols64, nsymbols,
+			      get_host_byte_sex());
+		symbols64 = allocated_symbols64;
+	    }
 	}
 	syms = allocate(nsymbols * sizeof(struct symbol));
 
@@ -452,6 +471,10 @@ void *cookie)
 		}
 	    }
 	}
+	if(allocated_symbols != NULL)
+	    free(allocated_symbols);
+	if(allocated_symbols64 != NULL)
+	    free(allocated_symbols64);
 
 	if(nfiledefs == 0 && ncats == 0 && nlocal == 0 && nstabs == 0)
 	    return;
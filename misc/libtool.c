@@ -46,6 +46,9 @@
 #include "stuff/errors.h"
 #include "stuff/allocate.h"
 #include "stuff/execute.h"
+#include "stuff/parallel.h"
+#include "stuff/sort_names.h"
+#include "stuff/crc32.h"
 #include "stuff/version_number.h"
 #include "stuff/unix_standard_mode.h"
 #ifdef LTO_SUPPORT
@@ -106,6 +109,7 @@ struct cmd_flags {
     enum bool t;	/* just "touch" the archives to get the date right */
     enum bool f;	/* warn if the output archive is fat,used by ar(1) -s */
     enum bool q;	/* only write archive if NOT fat, used by ar(1) */
+    enum bool i;	/* reuse the toc entries of unchanged members */
     char *output;	/* the output file specified by -o */
     enum bool final_output_specified; /* if -final_output is specified */
     enum bool dynamic;	/* create a dynamic shared library, static by default */
@@ -152,6 +156,7 @@ struct cmd_flags {
     enum bool toc64;	/* force the use of the 64-bit toc */
     enum bool fat64;	/* force the use of 64-bit fat files
 			   when a fat is to be created */
+    uint32_t njobs;	/* number of processes to work in, from -j or 1 */
 };
 static struct cmd_flags cmd_flags = { 0 };
 
@@ -192,6 +197,8 @@ struct arch {
     uint64_t       toc_nranlibs;/* number of ranlib structs */
     char	  *toc_strings;	/* strings of symbol names for ranlib structs */
     uint64_t       toc_strsize;	/* number of bytes for the strings above */
+    char **input_toc_names;	/* names in the input's toc for the members
+				   that use them, for ranlib -i */
 
     /* the members of this architecture in the library */
     struct member *members;	/* the members of the library for this arch */
@@ -212,6 +219,7 @@ struct member {
     struct symtab_command *st;	    /* the symbol table command */
     struct section **sections;	    /* array of section structs for 32-bit */
     struct section_64 **sections64; /* array of section structs for 64-bit */
+    uint32_t nsects;		    /* the number of section structs */
 #ifdef LTO_SUPPORT
     enum bool lto_contents;	    /* TRUE if this member has lto contents */
     uint32_t lto_toc_nsyms;	    /* number of symbols for the toc */
@@ -231,12 +239,23 @@ struct member {
     uint32_t  input_base_name_size;	/* the size of the base name */
     struct ar_hdr *input_ar_hdr;
     uint64_t      input_member_offset;  /* if from a thin archive */
+    enum bool use_input_toc;		/* TRUE if the member is unchanged and
+					   its names in the input's toc are
+					   used instead of its symbols */
+    char	 **input_toc_names;	/* the names in the input's toc */
+    uint32_t	  input_toc_nnames;	/* the number of the above */
 };
 
 static void usage(
     void);
 static void process(
     void);
+static void ranlib_file_job(
+    uint32_t i,
+    void *cookie);
+static void process_file(
+    struct ofile *ofile,
+    char *file_name);
 static char *file_name_from_l_flag(
     char *l_flag);
 static char *search_for_file(
@@ -253,6 +272,15 @@ static void free_archs(
 static void create_library(
     char *output,
     struct ofile *ofile);
+static void put_arch(
+    char *library,
+    uint64_t library_size,
+    uint64_t offset,
+    struct arch *arch,
+    int fd);
+static void put_arch_job(
+    uint32_t i,
+    void *cookie);
 static enum byte_sex get_target_byte_sex(
     struct arch *arch,
     enum byte_sex host_byte_sex);
@@ -265,9 +293,141 @@ static void create_dynamic_shared_library(
     char *output);
 static void create_dynamic_shared_library_cleanup(
     int sig);
-static void make_table_of_contents(
+static void make_tables_of_contents(
+    char *output);
+static uint64_t setup_toc_symbols(
+    struct arch *arch);
+static void finish_table_of_contents(
+    struct arch *arch,
+    char *output);
+
+/*
+ * The state create_library() passes to put_arch_job() for putting the archs of
+ * a fat library in the output buffer in parallel.
+ */
+struct arch_job {
+    char *library;		/* the output buffer shared with the workers */
+    uint64_t library_size;	/* size of the above */
+    uint64_t *offsets;		/* offset of each arch in the buffer */
+};
+
+/*
+ * Fat libraries at least this large have their archs put in the output buffer
+ * in parallel.
+ */
+#define ARCH_PARALLEL_SIZE (8 * 1024 * 1024)
+
+/*
+ * The state make_tables_of_contents() passes to toc_member_job() for scanning
+ * the symbols of the members of the archs, which are numbered one arch after
+ * another.  When the scan is split between worker processes with
+ * parallel_for() the results are in shared memory.
+ */
+struct toc_job {
+    uint32_t njobs;		/* number of processes scanning */
+    uint32_t nmembers;		/* number of members of all the archs */
+    uint32_t *first_members;	/* number of each arch's first member */
+    uint32_t *member_archs;	/* index of the arch of each member */
+    uint32_t *ntocs;		/* number of toc entries of each member */
+    uint64_t *strsizes;		/* size of the toc strings of each member */
+    uint32_t *nerrors;		/* number of malformed symbols of each member*/
+    uint64_t *toc_offsets;	/* index of each member's first toc struct */
+    uint64_t *str_offsets;	/* offset of each member's first toc string */
+    struct toc **tocs;		/* each arch's toc structs to fill in or NULL */
+    char **toc_strings;		/* each arch's toc strings to fill in */
+    struct toc *shared_tocs;	/* toc structs shared with the workers */
+    uint64_t shared_ntocs;	/* number of the above */
+    char *shared_toc_strings;	/* toc strings shared with the workers */
+    uint64_t shared_strsize;	/* size of the above */
+};
+
+/*
+ * Libraries with at least this many symbols have their members' symbols
+ * scanned in parallel.
+ */
+#define TOC_PARALLEL_NSYMBOLS 65536
+
+static void toc_member_job(
+    uint32_t i,
+    void *cookie);
+static void toc_member(
     struct arch *arch,
+    uint32_t i,
+    struct toc *tocs,
+    char *toc_strings,
+    enum bool report,
+    uint32_t *ntocs,
+    uint64_t *strsize,
+    uint32_t *nerrors);
+static void toc_job_free(
+    struct toc_job *job);
+
+/*
+ * For ranlib -i a cache file is kept next to the archive, named with this
+ * suffix, recording the archive header and offset of each member when the
+ * table of contents was built.  A member with the same archive header (name,
+ * date, size, uid, gid and mode) the next time is taken to be unchanged and its
+ * names are taken from the table of contents instead of its symbol table.  A
+ * header with a zero date, as ar(1) writes with ZERO_AR_DATE set, does not
+ * show the member changed so for those the crc of the member's contents is
+ * also recorded and must match.  The cache is only used with the table of
+ * contents it was written for, which is
+ * checked with its size and crc.  It is in the host byte sex and as it is only
+ * an optimization any problem reading or writing it just means all the
+ * members' symbols are scanned.
+ */
+#define TOC_CACHE_SUFFIX ".toc_cache"
+#define TOC_CACHE_MAGIC 0x70cc0002
+
+struct toc_cache_header {
+    uint32_t magic;		/* TOC_CACHE_MAGIC */
+    uint32_t flags;		/* TOC_CACHE_COMMONS if -c was used */
+    uint32_t nmembers;		/* number of toc_cache_member structs */
+    uint32_t toc_size;		/* size of the toc member it was written for */
+    uint32_t toc_crc;		/* crc32() of that toc member */
+    uint32_t crc;		/* crc32() of the toc_cache_member structs */
+};
+#define TOC_CACHE_COMMONS	0x1
+
+struct toc_cache_member {
+    struct ar_hdr ar_hdr;	/* the member's archive header */
+    uint32_t name_crc;		/* crc32() of its extended format #1 name */
+    uint32_t contents_crc;	/* crc32() of its contents if its date is 0 */
+    uint64_t offset;		/* offset of its archive header in the file */
+};
+/* the part of the toc_cache_member struct that identifies the member */
+#define TOC_CACHE_KEY_SIZE (sizeof(struct ar_hdr) + 2 * sizeof(uint32_t))
+
+/*
+ * An entry of the input's table of contents, for sorting them by the member
+ * they are for while keeping their order.
+ */
+struct input_toc_entry {
+    uint64_t ran_off;		/* offset of the member defining the symbol */
+    uint64_t index;		/* index of the entry in the toc */
+};
+
+static void use_toc_cache(
+    struct ofile *ofile,
+    char *file_name);
+static void write_toc_cache(
     char *output);
+static enum bool toc_cache_key(
+    char *addr,
+    uint64_t size,
+    struct toc_cache_member *key);
+static enum bool toc_cache_contents_crc(
+    int fd,
+    uint64_t offset,
+    struct toc_cache_member *key);
+static uint32_t efmt1_name_size(
+    struct ar_hdr *ar_hdr);
+static int toc_cache_member_qsort(
+    const struct toc_cache_member *member1,
+    const struct toc_cache_member *member2);
+static int input_toc_entry_qsort(
+    const struct input_toc_entry *entry1,
+    const struct input_toc_entry *entry2);
 #ifdef LTO_SUPPORT
 static void save_lto_member_toc_info(
     struct member *member,
@@ -331,6 +491,10 @@ static void output_flush(
 static void final_output_flush(
     char *library,
     int fd);
+static enum bool write_library(
+    int fd,
+    char *library,
+    uint64_t library_size);
 #ifdef DEBUG
 static void print_block_list(void);
 #endif /* DEBUG */
@@ -1007,6 +1171,22 @@ char **envp)
 		else if(strcmp(argv[i], "-fat64") == 0){
 		    cmd_flags.fat64 = TRUE;
 		}
+		else if(strcmp(argv[i], "-j") == 0){
+		    if(i + 1 == argc){
+			error("missing argument to: %s option", argv[i]);
+			usage();
+		    }
+		    cmd_flags.njobs = strtoul(argv[i+1], &endp, 10);
+		    if(*endp != '\0' || cmd_flags.njobs == 0){
+			error("argument to %s option: %s is not a positive "
+			      "number", argv[i], argv[i+1]);
+			usage();
+		    }
+#ifdef LTO_SUPPORT
+		    lto_prefetch_njobs = cmd_flags.njobs;
+#endif /* LTO_SUPPORT */
+		    i++;
+		}
 #ifdef DEBUG
 		else if(strcmp(argv[i], "-debug") == 0){
 		    if(i + 1 >= argc){
@@ -1077,6 +1257,16 @@ char **envp)
 				      argv[i][j], argv[i]);
 				usage();
 			    }
+			case 'i':
+			    if(cmd_flags.ranlib == TRUE){
+				cmd_flags.i = TRUE;
+				break;
+			    }
+			    else {
+				error("unknown option character `%c' in: %s",
+				      argv[i][j], argv[i]);
+				usage();
+			    }
 			default:
 			    error("unknown option character `%c' in: %s",
 				  argv[i][j], argv[i]);
@@ -1273,6 +1463,8 @@ char **envp)
 	/* set the defaults if not specified */
 	if(cmd_flags.a == FALSE)
 	    cmd_flags.s = TRUE; /* sort table of contents by default */
+	if(cmd_flags.njobs == 0)
+	    cmd_flags.njobs = 1; /* one process unless -j is given */
 
 	process();
 
@@ -1291,12 +1483,13 @@ usage(
 void)
 {
 	if(cmd_flags.ranlib)
-	    fprintf(stderr, "Usage: %s [-sactfqLT] [-] archive [...]\n",
-		    progname);
+	    fprintf(stderr, "Usage: %s [-sactfqiLT] [-j jobs] [-] archive "
+		    "[...]\n", progname);
 	else{
 	    fprintf(stderr, "Usage: %s -static [-] file [...] "
 		    "[-filelist listfile[,dirname]] [-arch_only arch] "
-		    "[-sacLT] [-no_warning_for_no_symbols]\n", progname);
+		    "[-sacLT] [-j jobs] [-no_warning_for_no_symbols]\n",
+		    progname);
 	    fprintf(stderr, "Usage: %s -dynamic [-] file [...] "
 		    "[-filelist listfile[,dirname]] [-arch_only arch] "
 		    "[-o output] [-install_name name] "
@@ -1318,10 +1511,9 @@ void
 process(
 void)
 {
-    uint32_t i, j, k, previous_errors;
+    uint32_t i, njobs;
     struct ofile *ofiles;
     char *file_name;
-    enum bool flag, ld_trace_archive_printed;
 
 	/*
 	 * For libtool processing put all input files in the specified output
@@ -1331,6 +1523,27 @@ void)
 	 * a thin archive is supported here also.
 	 */
 	ofiles = allocate(sizeof(struct ofile) * cmd_flags.nfiles);
+
+	/*
+	 * As ranlib's archives are each processed by themselves, when there is
+	 * more than one they are processed in worker processes at the same
+	 * time with their messages printed in order.  Not with -q as that
+	 * exits without processing the rest of the archives if it does not add
+	 * a table of contents.  The jobs are used for the archives, so each
+	 * worker does its own scanning and writing with one job.
+	 */
+	if(cmd_flags.ranlib == TRUE && cmd_flags.nfiles > 1 &&
+	   cmd_flags.njobs > 1 && cmd_flags.q == FALSE){
+	    njobs = cmd_flags.njobs;
+	    cmd_flags.njobs = 1;
+#ifdef LTO_SUPPORT
+	    lto_prefetch_njobs = 1;
+#endif /* LTO_SUPPORT */
+	    parallel_for_ordered(cmd_flags.nfiles, njobs, ranlib_file_job,
+				 ofiles);
+	    return;
+	}
+
 	for(i = 0; i < cmd_flags.nfiles; i++){
 	    if(strncmp(cmd_flags.files[i], "-l", 2) == 0 ||
 	       strncmp(cmd_flags.files[i], "-weak-l", 7) == 0){
@@ -1354,220 +1567,260 @@ void)
 		    continue;
 	    }
 
-	    previous_errors = errors;
-	    errors = 0;
-	    ld_trace_archive_printed = FALSE;
-
-	    if(ofiles[i].file_type == OFILE_FAT){
-		(void)ofile_first_arch(ofiles + i);
-		do{
-		    if(ofiles[i].arch_type == OFILE_ARCHIVE){
-			if(cmd_flags.ld_trace_archives == TRUE &&
-			   cmd_flags.dynamic == FALSE &&
-			   ld_trace_archive_printed == FALSE){
-			    char resolvedname[MAXPATHLEN];
-                	    if(realpath(ofiles[i].file_name, resolvedname) !=
-			       NULL)
-				ld_trace("[Logging for XBS] Used static "
-					 "archive: %s\n", resolvedname);
-			    else
-				ld_trace("[Logging for XBS] Used static "
-					 "archive: %s\n", ofiles[i].file_name);
-			    ld_trace_archive_printed = TRUE;
-			}
-			/* loop through archive */
-			if((flag = ofile_first_member(ofiles + i)) == TRUE){
-			    if(ofiles[i].member_ar_hdr != NULL &&
-			       strncmp(ofiles[i].member_name, SYMDEF,
-				       sizeof(SYMDEF) - 1) == 0)
-				flag = ofile_next_member(ofiles + i);
-			    while(flag == TRUE){
-				/* No fat members in a fat file */
-				if(ofiles[i].mh != NULL ||
-				   ofiles[i].mh64 != NULL ||
+	    process_file(ofiles + i, cmd_flags.files[i]);
+	}
+	if(cmd_flags.ranlib == FALSE && errors == 0)
+	    create_library(cmd_flags.output, NULL);
+
+	/*
+	 * Clean-up of ofiles[] and archs could be done here but since this
+	 * program is now done it is faster to just exit.
+	 */
+}
+
+/*
+ * ranlib_file_job() is called by parallel_for_ordered() to have ranlib process
+ * the archive cmd_flags.files[i] in a worker process.
+ */
+static
+void
+ranlib_file_job(
+uint32_t i,
+void *cookie)
+{
+    struct ofile *ofiles;
+
+	ofiles = (struct ofile *)cookie;
+	if(ofile_map(cmd_flags.files[i], NULL, NULL, ofiles + i, TRUE) == FALSE)
+	    return;
+	process_file(ofiles + i, cmd_flags.files[i]);
+}
+
+/*
+ * process_file() adds the object files in the input file mapped in ofile to
+ * the archs.  For ranlib the library for the archive is then created in place
+ * of it.
+ */
+static
+void
+process_file(
+struct ofile *ofile,
+char *file_name)
+{
+    uint32_t j, k, previous_errors;
+    enum bool flag, ld_trace_archive_printed;
+
+	previous_errors = errors;
+	errors = 0;
+	ld_trace_archive_printed = FALSE;
+
+	if(ofile->file_type == OFILE_FAT){
+	    (void)ofile_first_arch(ofile);
+	    do{
+		if(ofile->arch_type == OFILE_ARCHIVE){
+		    if(cmd_flags.ld_trace_archives == TRUE &&
+		       cmd_flags.dynamic == FALSE &&
+		       ld_trace_archive_printed == FALSE){
+			char resolvedname[MAXPATHLEN];
+			if(realpath(ofile->file_name, resolvedname) !=
+			   NULL)
+			    ld_trace("[Logging for XBS] Used static "
+				     "archive: %s\n", resolvedname);
+			else
+			    ld_trace("[Logging for XBS] Used static "
+				     "archive: %s\n", ofile->file_name);
+			ld_trace_archive_printed = TRUE;
+		    }
+		    /* loop through archive */
+		    if((flag = ofile_first_member(ofile)) == TRUE){
+			if(ofile->member_ar_hdr != NULL &&
+			   strncmp(ofile->member_name, SYMDEF,
+				   sizeof(SYMDEF) - 1) == 0)
+			    flag = ofile_next_member(ofile);
+			while(flag == TRUE){
+			    /* No fat members in a fat file */
+			    if(ofile->mh != NULL ||
+			       ofile->mh64 != NULL ||
 #ifdef LTO_SUPPORT
-				   ofiles[i].lto != NULL ||
+			       ofile->lto != NULL ||
 #endif /* LTO_SUPPORT */
-				   cmd_flags.ranlib == TRUE)
-				    add_member(ofiles + i);
-				else{
-				    error("for architecture: %s file: %s(%.*s) "
-					  "is not an object file (not allowed "
-					  "in a library)",
-					  ofiles[i].arch_flag.name,
-					  cmd_flags.files[i],
-					  (int)ofiles[i].member_name_size,
-					  ofiles[i].member_name);
-				}
-				flag = ofile_next_member(ofiles + i);
+			       cmd_flags.ranlib == TRUE)
+				add_member(ofile);
+			    else{
+				error("for architecture: %s file: %s(%.*s) "
+				      "is not an object file (not allowed "
+				      "in a library)",
+				      ofile->arch_flag.name,
+				      file_name,
+				      (int)ofile->member_name_size,
+				      ofile->member_name);
 			    }
+			    flag = ofile_next_member(ofile);
 			}
 		    }
-		    else if(ofiles[i].arch_type == OFILE_Mach_O
+		}
+		else if(ofile->arch_type == OFILE_Mach_O
 #ifdef LTO_SUPPORT
-			    || ofiles[i].arch_type == OFILE_LLVM_BITCODE
+			|| ofile->arch_type == OFILE_LLVM_BITCODE
 #endif
-			   ){
-			if(cmd_flags.ranlib == TRUE){
-			    error("for architecture: %s file: %s is not an "
-				  "archive (no processing done on this file)",
-				  ofiles[i].arch_flag.name, cmd_flags.files[i]);
-			    goto ranlib_fat_error;
-			}
-			else
-			    add_member(ofiles + i);
-		    }
-		    else if(ofiles[i].arch_type == OFILE_UNKNOWN){
-			if(cmd_flags.ranlib == TRUE){
-			    error("for architecture: %s file: %s is not an "
-				  "archive (no processing done on this file)",
-				  ofiles[i].arch_flag.name, cmd_flags.files[i]);
-			    goto ranlib_fat_error;
-			}
-			else{
-			    error("for architecture: %s file: %s is not an "
-				  "object file (not allowed in a library)",
-				  ofiles[i].arch_flag.name, cmd_flags.files[i]);
-			}
+		       ){
+		    if(cmd_flags.ranlib == TRUE){
+			error("for architecture: %s file: %s is not an "
+			      "archive (no processing done on this file)",
+			      ofile->arch_flag.name, file_name);
+			goto ranlib_fat_error;
 		    }
-		}while(ofile_next_arch(ofiles + i) == TRUE);
-	    }
-	    else if(ofiles[i].file_type == OFILE_ARCHIVE){
-		if(cmd_flags.ld_trace_archives == TRUE &&
-		   cmd_flags.dynamic == FALSE &&
-		   ld_trace_archive_printed == FALSE){
-		    char resolvedname[MAXPATHLEN];
-		    if(realpath(ofiles[i].file_name, resolvedname) != NULL)
-			ld_trace("[Logging for XBS] Used static archive: "
-				 "%s\n", resolvedname);
 		    else
-			ld_trace("[Logging for XBS] Used static archive: "
-				 "%s\n", ofiles[i].file_name);
-		    ld_trace_archive_printed = TRUE;
+			add_member(ofile);
 		}
-		/* loop through archive */
-		if((flag = ofile_first_member(ofiles + i)) == TRUE){
-		    if(ofiles[i].member_ar_hdr != NULL &&
-		       strncmp(ofiles[i].member_name, SYMDEF,
-			       sizeof(SYMDEF) - 1) == 0){
-			flag = ofile_next_member(ofiles + i);
+		else if(ofile->arch_type == OFILE_UNKNOWN){
+		    if(cmd_flags.ranlib == TRUE){
+			error("for architecture: %s file: %s is not an "
+			      "archive (no processing done on this file)",
+			      ofile->arch_flag.name, file_name);
+			goto ranlib_fat_error;
 		    }
-		    while(flag == TRUE){
-			/* incorrect form: archive with fat object members */
-			if(ofiles[i].member_type == OFILE_FAT){
-			    (void)ofile_first_arch(ofiles + i);
-			    do{
-				if(ofiles[i].mh != NULL ||
-				   ofiles[i].mh64 != NULL ||
-				   ofiles[i].lto != NULL ||
-				   cmd_flags.ranlib == TRUE){
-				    add_member(ofiles + i);
-				}
-				else{
-				    /*
-				     * Can't really get here because ofile_*()
-				     * routines will refuse to process this
-				     * type of file (but I'll leave it here).
-				     */
-				    error("file: %s(%.*s) for architecture: %s "
-					"is not an object file (not allowed in "
-					"a library)", cmd_flags.files[i],
-					(int)ofiles[i].member_name_size,
-					ofiles[i].member_name,
-					ofiles[i].arch_flag.name);
-				}
+		    else{
+			error("for architecture: %s file: %s is not an "
+			      "object file (not allowed in a library)",
+			      ofile->arch_flag.name, file_name);
+		    }
+		}
+	    }while(ofile_next_arch(ofile) == TRUE);
+	}
+	else if(ofile->file_type == OFILE_ARCHIVE){
+	    if(cmd_flags.ld_trace_archives == TRUE &&
+	       cmd_flags.dynamic == FALSE &&
+	       ld_trace_archive_printed == FALSE){
+		char resolvedname[MAXPATHLEN];
+		if(realpath(ofile->file_name, resolvedname) != NULL)
+		    ld_trace("[Logging for XBS] Used static archive: "
+			     "%s\n", resolvedname);
+		else
+		    ld_trace("[Logging for XBS] Used static archive: "
+			     "%s\n", ofile->file_name);
+		ld_trace_archive_printed = TRUE;
+	    }
+	    /* loop through archive */
+	    if((flag = ofile_first_member(ofile)) == TRUE){
+		if(ofile->member_ar_hdr != NULL &&
+		   strncmp(ofile->member_name, SYMDEF,
+			   sizeof(SYMDEF) - 1) == 0){
+		    flag = ofile_next_member(ofile);
+		}
+		while(flag == TRUE){
+		    /* incorrect form: archive with fat object members */
+		    if(ofile->member_type == OFILE_FAT){
+			(void)ofile_first_arch(ofile);
+			do{
+			    if(ofile->mh != NULL ||
+			       ofile->mh64 != NULL ||
+			       ofile->lto != NULL ||
+			       cmd_flags.ranlib == TRUE){
+				add_member(ofile);
+			    }
+			    else{
+				/*
+				 * Can't really get here because ofile_*()
+				 * routines will refuse to process this
+				 * type of file (but I'll leave it here).
+				 */
+				error("file: %s(%.*s) for architecture: %s "
+				    "is not an object file (not allowed in "
+				    "a library)", file_name,
+				    (int)ofile->member_name_size,
+				    ofile->member_name,
+				    ofile->arch_flag.name);
+			    }
 
-			    }while(ofile_next_arch(ofiles + i) == TRUE);
-			}
-			else if(ofiles[i].mh != NULL ||
-			        ofiles[i].mh64 != NULL ||
+			}while(ofile_next_arch(ofile) == TRUE);
+		    }
+		    else if(ofile->mh != NULL ||
+			    ofile->mh64 != NULL ||
 #ifdef LTO_SUPPORT
-			        ofiles[i].lto != NULL ||
+			    ofile->lto != NULL ||
 #endif /* LTO_SUPPORT */
-				cmd_flags.ranlib == TRUE){
-			    add_member(ofiles + i);
-			}
-			else{
-			    error("file: %s(%.*s) is not an object file (not "
-				  "allowed in a library)", cmd_flags.files[i],
-				  (int)ofiles[i].member_name_size,
-				  ofiles[i].member_name);
-			}
-			flag = ofile_next_member(ofiles + i);
+			    cmd_flags.ranlib == TRUE){
+			add_member(ofile);
+		    }
+		    else{
+			error("file: %s(%.*s) is not an object file (not "
+			      "allowed in a library)", file_name,
+			      (int)ofile->member_name_size,
+			      ofile->member_name);
 		    }
+		    flag = ofile_next_member(ofile);
 		}
 	    }
-	    else if(ofiles[i].file_type == OFILE_Mach_O){
-		if(cmd_flags.ranlib == TRUE){
-		    error("file: %s is not an archive", cmd_flags.files[i]);
-		    continue;
-		}
-		add_member(ofiles + i);
+	}
+	else if(ofile->file_type == OFILE_Mach_O){
+	    if(cmd_flags.ranlib == TRUE){
+		error("file: %s is not an archive", file_name);
+		return;
 	    }
+	    add_member(ofile);
+	}
 #ifdef LTO_SUPPORT
-	    else if(ofiles[i].file_type == OFILE_LLVM_BITCODE){
-		if(cmd_flags.ranlib == TRUE){
-		    error("file: %s is not an archive", cmd_flags.files[i]);
-		    continue;
-		}
-		add_member(ofiles + i);
+	else if(ofile->file_type == OFILE_LLVM_BITCODE){
+	    if(cmd_flags.ranlib == TRUE){
+		error("file: %s is not an archive", file_name);
+		return;
 	    }
+	    add_member(ofile);
+	}
 #endif /* LTO_SUPPORT */
-	    else{ /* ofiles[i].file_type == OFILE_UNKNOWN */
-		if(cmd_flags.ranlib == TRUE){
-		    error("file: %s is not an archive", cmd_flags.files[i]);
-		    continue;
-		}
-		else{
-		    error("file: %s is not an object file (not allowed in a "
-			  "library)", cmd_flags.files[i]);
-		}
+	else{ /* ofile->file_type == OFILE_UNKNOWN */
+	    if(cmd_flags.ranlib == TRUE){
+		error("file: %s is not an archive", file_name);
+		return;
+	    }
+	    else{
+		error("file: %s is not an object file (not allowed in a "
+		      "library)", file_name);
 	    }
+	}
 
-	    if(cmd_flags.ranlib == TRUE){
-		/*
-		 * In the case where ranlib is being used on an archive that
-		 * contains fat object files with multiple members and non-
-		 * object members this has to be treated as an error because
-		 * it is not known which architecture(s) the non-object file
-		 * belong to.
-		 */
-		if(narchs > 1){
-		    for(j = 0; j < narchs; j++){
-			for(k = 0; k < archs[j].nmembers; k++){
-			    if(archs[j].members[k].mh == NULL &&
+	if(cmd_flags.ranlib == TRUE){
+	    /*
+	     * In the case where ranlib is being used on an archive that
+	     * contains fat object files with multiple members and non-
+	     * object members this has to be treated as an error because
+	     * it is not known which architecture(s) the non-object file
+	     * belong to.
+	     */
+	    if(narchs > 1){
+		for(j = 0; j < narchs; j++){
+		    for(k = 0; k < archs[j].nmembers; k++){
+			if(archs[j].members[k].mh == NULL &&
 #ifdef LTO_SUPPORT
-			       archs[j].members[k].lto_contents == FALSE &&
+			   archs[j].members[k].lto_contents == FALSE &&
 #endif /* LTO_SUPPORT */
-			       archs[j].members[k].mh64 == NULL){
-				error("library member: %s(%.*s) is not an "
-				      "object file (not allowed in a library "
-				      "with multiple architectures)",
-				      cmd_flags.files[i],
-				      (int)archs[j].members[k].
-					input_base_name_size,
-				      archs[j].members[k].input_base_name);
-			    }
+			   archs[j].members[k].mh64 == NULL){
+			    error("library member: %s(%.*s) is not an "
+				  "object file (not allowed in a library "
+				  "with multiple architectures)",
+				  file_name,
+				  (int)archs[j].members[k].
+				    input_base_name_size,
+				  archs[j].members[k].input_base_name);
 			}
 		    }
 		}
-		if(errors == 0)
-		    create_library(cmd_flags.files[i], ofiles + i);
-		if(cmd_flags.nfiles > 1){
+	    }
+	    if(errors == 0){
+		if(cmd_flags.i == TRUE)
+		    use_toc_cache(ofile, file_name);
+		create_library(file_name, ofile);
+		if(cmd_flags.i == TRUE && errors == 0 && narchs == 1)
+		    write_toc_cache(file_name);
+	    }
+	    if(cmd_flags.nfiles > 1){
 ranlib_fat_error:
-		    free_archs();
-		    ofile_unmap(ofiles + i);
-		}
+		free_archs();
+		ofile_unmap(ofile);
 	    }
-	    errors += previous_errors;
 	}
-	if(cmd_flags.ranlib == FALSE && errors == 0)
-	    create_library(cmd_flags.output, NULL);
-
-	/*
-	 * Clean-up of ofiles[] and archs could be done here but since this
-	 * program is now done it is faster to just exit.
-	 */
+	errors += previous_errors;
 }
 
 /*
@@ -2270,6 +2523,8 @@ void)
 		free(archs[i].toc_ranlibs64);
 	    if(archs[i].toc_strings != NULL)
 		free(archs[i].toc_strings);
+	    if(archs[i].input_toc_names != NULL)
+		free(archs[i].input_toc_names);
 	    if(archs[i].members != NULL)
 		free(archs[i].members);
 	}
@@ -2295,10 +2550,11 @@ create_library(
 char *output,
 struct ofile *ofile)
 {
-    uint32_t i, j, k, pad;
-    uint64_t library_size, offset, *time_offsets;
+    uint32_t i, j, pad;
+    uint64_t library_size, offset, *time_offsets, *arch_offsets;
+    uint64_t input_toc_size;
     enum byte_sex target_byte_sex;
-    char *library, *p, *flush_start;
+    char *library, *p, *toc_strings;
     kern_return_t r;
     struct arch *arch;
     struct fat_header *fat_header;
@@ -2312,8 +2568,10 @@ struct ofile *ofile)
 #endif
     struct stat stat_buf;
     struct ar_hdr toc_ar_hdr;
-    enum bool some_tocs, same_toc, different_offsets;
+    char ar_size_buf[sizeof(toc_ar_hdr.ar_size) + 1];
+    enum bool some_tocs, same_toc, different_offsets, parallel;
     uint32_t toc_mtime;
+    struct arch_job arch_job;
 
 	if(narchs == 0){
 	    if(cmd_flags.ranlib == TRUE){
@@ -2341,6 +2599,7 @@ struct ofile *ofile)
 	    create_dynamic_shared_library(output);
 	    return;
 	}
+	parallel = FALSE;
 
 	/* if this is libtool warn about duplicate member names */
 	if(cmd_flags.ranlib == FALSE)
@@ -2376,12 +2635,12 @@ struct ofile *ofile)
 	else
 	    library_size = 0;
 	some_tocs = FALSE;
+	make_tables_of_contents(output);
+	if(errors != 0)
+	    return;
 	for(i = 0; i < narchs; i++){
 	    if(narchs > 1 && (archs[i].arch_flag.cputype & CPU_ARCH_ABI64))
 		library_size = rnd(library_size, 1 << 3);
-	    make_table_of_contents(archs + i, output);
-	    if(errors != 0)
-		return;
 	    if(archs[i].toc_nranlibs != 0)
 		some_tocs = TRUE;
 	    archs[i].size += SARMAG + archs[i].toc_size;
@@ -2413,13 +2672,23 @@ struct ofile *ofile)
 	 * ranlib structs and string size, as this is the most common case that
 	 * the defined global symbols have not changed when rebuilding and it
 	 * will just be the offset to archive members that will have changed.
+	 * With ranlib -i it is also updated in place if it is no larger than
+	 * the existing one, with its strings padded to be the same size.
 	 */
+	input_toc_size = 0;
+	if(ofile != NULL && ofile->toc_addr != NULL &&
+	   (char *)ofile->toc_ar_hdr == ofile->file_addr + SARMAG)
+	    input_toc_size = (ofile->toc_addr + ofile->toc_size) -
+			     (char *)ofile->toc_ar_hdr;
 	if(cmd_flags.ranlib == TRUE && narchs == 1 &&
 	   ofile != NULL && ofile->toc_addr != NULL &&
 	   ofile->toc_bad == FALSE &&
 	   archs[0].using_64toc != ofile->toc_is_32bit &&
-	   archs[0].toc_nranlibs == ofile->toc_nranlibs &&
-	   archs[0].toc_strsize == ofile->toc_strsize){
+	   ((archs[0].toc_nranlibs == ofile->toc_nranlibs &&
+	     archs[0].toc_strsize == ofile->toc_strsize) ||
+	    (cmd_flags.i == TRUE &&
+	     archs[0].toc_size <= input_toc_size &&
+	     (input_toc_size - archs[0].toc_size) % 8 == 0))){
 
 	    /*
 	     * If the table of contents in the input does have a long name and
@@ -2477,35 +2746,52 @@ struct ofile *ofile)
 	    time_offsets[0] = SARMAG +
 			 ((char *)&toc_ar_hdr.ar_date - (char *)&toc_ar_hdr);
 
+	    /*
+	     * A table of contents smaller than the existing one has its
+	     * strings padded with '\0's so it is the same size.  The names of
+	     * the toc structs point into the strings so they are moved to the
+	     * padded copy.
+	     */
+	    if(archs[0].toc_size < input_toc_size){
+		pad = input_toc_size - archs[0].toc_size;
+		toc_strings = allocate(archs[0].toc_strsize + pad);
+		memcpy(toc_strings, archs[0].toc_strings, archs[0].toc_strsize);
+		memset(toc_strings + archs[0].toc_strsize, '\0', pad);
+		for(i = 0; i < archs[0].toc_nranlibs; i++)
+		    archs[0].tocs[i].name = toc_strings +
+			(archs[0].tocs[i].name - archs[0].toc_strings);
+		free(archs[0].toc_strings);
+		archs[0].toc_strings = toc_strings;
+		archs[0].toc_strsize += pad;
+		archs[0].toc_size += pad;
+		/*
+		 * Since sprintf() writes a '\0' at the end of the string the
+		 * memcpy is needed to preserve the ARFMAG string that follows.
+		 */
+		sprintf(ar_size_buf, "%-*ld",
+			(int)sizeof(archs[0].toc_ar_hdr.ar_size),
+			(long)(archs[0].toc_size - sizeof(struct ar_hdr)));
+		memcpy(archs[0].toc_ar_hdr.ar_size, ar_size_buf,
+		       sizeof(archs[0].toc_ar_hdr.ar_size));
+	    }
+
 	    /*
 	     * If we had different member offsets in the input thin archive
-	     * we adjust the ranlib structs ran_off to use them.
+	     * we adjust the ranlib structs ran_off to use them.  The ranlib
+	     * structs are in the same order as the toc structs, which have the
+	     * index of the member plus one.
 	     */
 	    if(different_offsets == TRUE){
 		same_toc = FALSE;
 		if(archs[0].using_64toc == FALSE){
-		    for(i = 0; i < archs[0].toc_nranlibs; i++){
-			for(j = 0; j < archs[0].nmembers; j++){
-			    if(archs[0].members[j].offset == 
-			       archs[0].toc_ranlibs[i].ran_off){
-				archs[0].toc_ranlibs[i].ran_off = 
-				    archs[0].members[j].input_member_offset;
-				break;
-			    }
-			}
-		    }
+		    for(i = 0; i < archs[0].toc_nranlibs; i++)
+			archs[0].toc_ranlibs[i].ran_off = archs[0].members[
+			    archs[0].tocs[i].index1 - 1].input_member_offset;
 		}
 		else{
-		    for(i = 0; i < archs[0].toc_nranlibs; i++){
-			for(j = 0; j < archs[0].nmembers; j++){
-			    if(archs[0].members[j].offset == 
-			       archs[0].toc_ranlibs64[i].ran_off){
-				archs[0].toc_ranlibs64[i].ran_off = 
-				    archs[0].members[j].input_member_offset;
-				break;
-			    }
-			}
-		    }
+		    for(i = 0; i < archs[0].toc_nranlibs; i++)
+			archs[0].toc_ranlibs64[i].ran_off = archs[0].members[
+			    archs[0].tocs[i].index1 - 1].input_member_offset;
 		}
 	    }
 	    else{
@@ -2514,8 +2800,10 @@ struct ofile *ofile)
 		 * same as the old then the archive only needs to be "touched"
 		 * and the time field of the toc needs to be updated.
 		 */
-		same_toc = TRUE;
-		for(i = 0; i < archs[0].toc_nranlibs; i++){
+		same_toc = (enum bool)
+		    (archs[0].toc_nranlibs == ofile->toc_nranlibs &&
+		     archs[0].toc_strsize == ofile->toc_strsize);
+		for(i = 0; same_toc == TRUE && i < archs[0].toc_nranlibs; i++){
 		    if(archs[0].using_64toc == FALSE){
 			if(archs[0].toc_ranlibs[i].ran_un.ran_strx != 
 			   ofile->toc_ranlibs[i].ran_un.ran_strx ||
@@ -2545,6 +2833,13 @@ struct ofile *ofile)
 		}
 	    }
 
+	    /*
+	     * The members are left where they are in the file.
+	     */
+	    for(i = 0; i < archs[0].nmembers; i++)
+		archs[0].members[i].offset =
+		    archs[0].members[i].input_member_offset;
+
 	    library_size = SARMAG;
 	    if(same_toc == FALSE)
 		library_size += archs[0].toc_size;
@@ -2568,7 +2863,7 @@ struct ofile *ofile)
 		system_error("can't open output file: %s", output);
 		return;
 	    }
-	    if(write(fd, library, library_size) != (int)library_size){
+	    if(write_library(fd, library, library_size) == FALSE){
 		system_error("can't write output file: %s", output);
 		return;
 	    }
@@ -2582,10 +2877,16 @@ fail_to_update_toc_in_place:
 
 	/*
 	 * This buffer is vm_allocate'ed to make sure all holes are filled with
-	 * zero bytes.
+	 * zero bytes.  If the archs are to be put in it in parallel it is
+	 * allocated with parallel_allocate() instead, which also zero fills it,
+	 * so the worker processes share it.
 	 */
-	if((r = vm_allocate(mach_task_self(), (vm_address_t *)&library,
-			    library_size, TRUE)) != KERN_SUCCESS)
+	parallel = (enum bool)(narchs > 1 && cmd_flags.njobs > 1 &&
+			       library_size >= ARCH_PARALLEL_SIZE);
+	if(parallel == TRUE)
+	    library = parallel_allocate(library_size);
+	else if((r = vm_allocate(mach_task_self(), (vm_address_t *)&library,
+				 library_size, TRUE)) != KERN_SUCCESS)
 	    mach_fatal(r, "can't vm_allocate() buffer for output file: %s of "
 		       "size %llu", output, library_size);
 
@@ -2695,13 +2996,15 @@ fail_to_update_toc_in_place:
 	    offset = 0;
 
 	/* flush out the fat headers if any */
-	output_flush(library, library_size, fd, 0, offset);
+	if(parallel == FALSE)
+	    output_flush(library, library_size, fd, 0, offset);
 
 	/*
 	 * The time_offsets array records the offsets to the table of conternts
 	 * archive header's ar_date fields.
 	 */
 	time_offsets = allocate(narchs * sizeof(uint64_t));
+	arch_offsets = allocate(narchs * sizeof(uint64_t));
 
 	/*
 	 * Now put each arch in the buffer.
@@ -2710,23 +3013,11 @@ fail_to_update_toc_in_place:
 	    arch = archs + i;
 	    if(narchs > 1 && (arch->arch_flag.cputype & CPU_ARCH_ABI64)){
 		pad = rnd(offset, 1 << 3) - offset;
-		output_flush(library, library_size, fd, offset, pad);
+		if(parallel == FALSE)
+		    output_flush(library, library_size, fd, offset, pad);
 		offset = rnd(offset, 1 << 3);
 	    }
-	    p = library + offset;
-	    flush_start = p;
-
-	    /*
-	     * If the input files only contains non-object files then the
-	     * byte sex of the output can't be determined which is needed for
-	     * the two binary long's of the table of contents.  But since these
-	     * will be zero (the same in both byte sexes) because there are no
-	     * symbols in the table of contents if there are no object files.
-	     */
-
-	    /* put in the archive magic string */
-	    memcpy(p, ARMAG, SARMAG);
-	    p += SARMAG;
+	    arch_offsets[i] = offset;
 
 	    /*
 	     * Warn for what really is a bad library that has an empty table of
@@ -2744,93 +3035,37 @@ fail_to_update_toc_in_place:
 			    "define global symbols)", output);
 	    }
 
-	    /*
-	     * Pick the byte sex to write the table of contents in.
-	     */
-	    target_byte_sex = get_target_byte_sex(arch, host_byte_sex);
-
 	    /*
 	     * Remember the offset to the archive header's time field for this
 	     * arch's table of contents member.
 	     */
-	    time_offsets[i] =
-			 (p - library) +
+	    time_offsets[i] = offset + SARMAG +
 			 ((char *)&toc_ar_hdr.ar_date - (char *)&toc_ar_hdr);
 
-	    /*
-	     * Put in the table of contents member in the output buffer.
-	     */
-	    p = put_toc_member(p, arch, host_byte_sex, target_byte_sex);
-
-	    output_flush(library, library_size, fd, flush_start - library,
-			 p - flush_start);
-
-	    /*
-	     * Put in the archive header and member contents for each member.
-	     */
-	    for(j = 0; j < arch->nmembers; j++){
-		flush_start = p;
-		memcpy(p, (char *)&(arch->members[j].ar_hdr),
-		       sizeof(struct ar_hdr));
-		p += sizeof(struct ar_hdr);
-
-		/*
-		 * If we are using extended format #1 for long names write out
-		 * the name.  Note the name is padded with '\0' and the
-		 * member_name_size is the unrounded size.
-		 */
-		if(arch->members[j].output_long_name == TRUE){
-		    strncpy(p, arch->members[j].member_name,
-			    arch->members[j].member_name_size);
-		    p += rnd(arch->members[j].member_name_size, 8) +
-			       (rnd(sizeof(struct ar_hdr), 8) -
-				sizeof(struct ar_hdr));
-		}
-
-		/*
-		 * ofile_map swaps the headers to the host_byte_sex if the
-		 * object's byte sex is not the same as the host byte sex so
-		 * if this is the case swap them back before writing them out.
-		 */
-		if(arch->members[j].mh != NULL &&
-		   arch->members[j].object_byte_sex != host_byte_sex){
-		    if(swap_object_headers(arch->members[j].mh,
-		       arch->members[j].load_commands) == FALSE)
-			fatal("internal error: swap_object_headers() failed");
-		}
-		else if(arch->members[j].mh64 != NULL &&
-		   arch->members[j].object_byte_sex != host_byte_sex){
-		    if(swap_object_headers(arch->members[j].mh64,
-		       arch->members[j].load_commands) == FALSE)
-			fatal("internal error: swap_object_headers() failed");
-		}
-		memcpy(p, arch->members[j].object_addr,
-		       arch->members[j].object_size);
-#ifdef VM_SYNC_DEACTIVATE
-		vm_msync(mach_task_self(),
-			 (vm_address_t)arch->members[j].object_addr,
-			 (vm_size_t)arch->members[j].object_size,
-			 VM_SYNC_DEACTIVATE);
-#endif /* VM_SYNC_DEACTIVATE */
-		p += arch->members[j].object_size;
-		pad = rnd(arch->members[j].object_size, 8) -
-		      arch->members[j].object_size;
-		/* as with the UNIX ar(1) program pad with '\n' characters */
-		for(k = 0; k < pad; k++)
-		    *p++ = '\n';
-
-		output_flush(library, library_size, fd, flush_start - library,
-			     p - flush_start);
-	    }
+	    if(parallel == FALSE)
+		put_arch(library, library_size, offset, arch, fd);
 	    offset += arch->size;
 	}
 
+	/*
+	 * For a fat library that is large enough the archs are put in the
+	 * buffer by worker processes at the same time.  The buffer is shared
+	 * with them and is written all at once below.
+	 */
+	if(parallel == TRUE){
+	    arch_job.library = library;
+	    arch_job.library_size = library_size;
+	    arch_job.offsets = arch_offsets;
+	    parallel_for(narchs, cmd_flags.njobs, put_arch_job, &arch_job);
+	}
+	free(arch_offsets);
+
 	/*
 	 * Write the library to the file or flush the remaining buffer to the
 	 * file.
 	 */
-	if(cmd_flags.noflush == TRUE){
-	    if(write(fd, library, library_size) != (int)library_size){
+	if(cmd_flags.noflush == TRUE || parallel == TRUE){
+	    if(write_library(fd, library, library_size) == FALSE){
 		system_error("can't write output file: %s", output);
 		return;
 	    }
@@ -2903,48 +3138,175 @@ update_toc_ar_dates:
 			 output);
 	    return;
 	}
-	if((r = vm_deallocate(mach_task_self(), (vm_address_t)library,
-			      library_size)) != KERN_SUCCESS){
+	if(parallel == TRUE)
+	    parallel_deallocate(library, library_size);
+	else if((r = vm_deallocate(mach_task_self(), (vm_address_t)library,
+				   library_size)) != KERN_SUCCESS){
 	    my_mach_error(r, "can't vm_deallocate() buffer for output file");
 	    return;
 	}
 }
 
 /*
- * get_target_byte_sex() pick the byte sex to write the table of contents in
- * for the arch.
+ * put_arch() puts the archive for the arch in the library buffer at offset:
+ * the archive magic string, the table of contents member and the members.  If
+ * fd is not -1 each part is flushed to the output file with output_flush()
+ * once it is in the buffer.
  */
 static
-enum byte_sex
-get_target_byte_sex(
+void
+put_arch(
+char *library,
+uint64_t library_size,
+uint64_t offset,
 struct arch *arch,
-enum byte_sex host_byte_sex)
+int fd)
 {
-    uint32_t i;
+    uint32_t j, k, pad;
     enum byte_sex target_byte_sex;
+    char *p, *flush_start;
 
-	target_byte_sex = UNKNOWN_BYTE_SEX;
-	for(i = 0;
-	    i < arch->nmembers && target_byte_sex == UNKNOWN_BYTE_SEX;
-	    i++){
-	    target_byte_sex = arch->members[i].object_byte_sex;
-	}
-	if(target_byte_sex == UNKNOWN_BYTE_SEX)
-	    target_byte_sex = host_byte_sex;
-	return(target_byte_sex);
-}
+	p = library + offset;
+	flush_start = p;
 
-/*
- * put_toc_member() put the contents member for arch into the buffer p and 
- * returns the pointer to the buffer after the table of contents.
- * The table of contents member uses either a 32-bit toc or a 64-bit toc.
- * Both forms start with:
- *  the archive header
- *  the archive member name (if using a long name)
- * then for a 32-bit toc the rest is this:
- *  a uint32_t for the number of bytes of the ranlib structs
- *  the ranlib structs
- *  a uint32_t for the number of bytes of the strings for the ranlibs
+	/*
+	 * If the input files only contains non-object files then the
+	 * byte sex of the output can't be determined which is needed for
+	 * the two binary long's of the table of contents.  But since these
+	 * will be zero (the same in both byte sexes) because there are no
+	 * symbols in the table of contents if there are no object files.
+	 */
+
+	/* put in the archive magic string */
+	memcpy(p, ARMAG, SARMAG);
+	p += SARMAG;
+
+	/*
+	 * Pick the byte sex to write the table of contents in.
+	 */
+	target_byte_sex = get_target_byte_sex(arch, host_byte_sex);
+
+	/*
+	 * Put in the table of contents member in the output buffer.
+	 */
+	p = put_toc_member(p, arch, host_byte_sex, target_byte_sex);
+
+	if(fd != -1)
+	    output_flush(library, library_size, fd, flush_start - library,
+			 p - flush_start);
+
+	/*
+	 * Put in the archive header and member contents for each member.
+	 */
+	for(j = 0; j < arch->nmembers; j++){
+	    flush_start = p;
+	    memcpy(p, (char *)&(arch->members[j].ar_hdr),
+		   sizeof(struct ar_hdr));
+	    p += sizeof(struct ar_hdr);
+
+	    /*
+	     * If we are using extended format #1 for long names write out
+	     * the name.  Note the name is padded with '\0' and the
+	     * member_name_size is the unrounded size.
+	     */
+	    if(arch->members[j].output_long_name == TRUE){
+		strncpy(p, arch->members[j].member_name,
+		    arch->members[j].member_name_size);
+		p += rnd(arch->members[j].member_name_size, 8) +
+		       (rnd(sizeof(struct ar_hdr), 8) -
+			sizeof(struct ar_hdr));
+	    }
+
+	    /*
+	     * ofile_map swaps the headers to the host_byte_sex if the
+	     * object's byte sex is not the same as the host byte sex so
+	     * if this is the case swap them back before writing them out.
+	     */
+	    if(arch->members[j].mh != NULL &&
+	       arch->members[j].object_byte_sex != host_byte_sex){
+		if(swap_object_headers(arch->members[j].mh,
+		   arch->members[j].load_commands) == FALSE)
+		fatal("internal error: swap_object_headers() failed");
+	    }
+	    else if(arch->members[j].mh64 != NULL &&
+	       arch->members[j].object_byte_sex != host_byte_sex){
+		if(swap_object_headers(arch->members[j].mh64,
+		   arch->members[j].load_commands) == FALSE)
+		fatal("internal error: swap_object_headers() failed");
+	    }
+	    memcpy(p, arch->members[j].object_addr,
+		   arch->members[j].object_size);
+#ifdef VM_SYNC_DEACTIVATE
+	    vm_msync(mach_task_self(),
+		 (vm_address_t)arch->members[j].object_addr,
+		 (vm_size_t)arch->members[j].object_size,
+		 VM_SYNC_DEACTIVATE);
+#endif /* VM_SYNC_DEACTIVATE */
+	    p += arch->members[j].object_size;
+	    pad = rnd(arch->members[j].object_size, 8) -
+		  arch->members[j].object_size;
+	    /* as with the UNIX ar(1) program pad with '\n' characters */
+	    for(k = 0; k < pad; k++)
+		*p++ = '\n';
+
+	    if(fd != -1)
+		output_flush(library, library_size, fd, flush_start - library,
+			     p - flush_start);
+	}
+}
+
+/*
+ * put_arch_job() is called by parallel_for() to put the arch at index i in the
+ * shared library buffer.
+ */
+static
+void
+put_arch_job(
+uint32_t i,
+void *cookie)
+{
+    struct arch_job *job;
+
+	job = (struct arch_job *)cookie;
+	put_arch(job->library, job->library_size, job->offsets[i], archs + i,
+		 -1);
+}
+
+/*
+ * get_target_byte_sex() pick the byte sex to write the table of contents in
+ * for the arch.
+ */
+static
+enum byte_sex
+get_target_byte_sex(
+struct arch *arch,
+enum byte_sex host_byte_sex)
+{
+    uint32_t i;
+    enum byte_sex target_byte_sex;
+
+	target_byte_sex = UNKNOWN_BYTE_SEX;
+	for(i = 0;
+	    i < arch->nmembers && target_byte_sex == UNKNOWN_BYTE_SEX;
+	    i++){
+	    target_byte_sex = arch->members[i].object_byte_sex;
+	}
+	if(target_byte_sex == UNKNOWN_BYTE_SEX)
+	    target_byte_sex = host_byte_sex;
+	return(target_byte_sex);
+}
+
+/*
+ * put_toc_member() put the contents member for arch into the buffer p and 
+ * returns the pointer to the buffer after the table of contents.
+ * The table of contents member uses either a 32-bit toc or a 64-bit toc.
+ * Both forms start with:
+ *  the archive header
+ *  the archive member name (if using a long name)
+ * then for a 32-bit toc the rest is this:
+ *  a uint32_t for the number of bytes of the ranlib structs
+ *  the ranlib structs
+ *  a uint32_t for the number of bytes of the strings for the ranlibs
  *  the strings for the ranlib structs
  * and for a 64-bit toc the rest is this:
  *  a uint64_t for the number of bytes of the ranlib structs
@@ -3317,6 +3679,32 @@ int fd)
 	output_blocks = NULL;
 }
 
+/*
+ * write_library() writes the library_size bytes of the library to fd, no more
+ * than MAX_WRITE at a time as write(2) fails for sizes above INT_MAX on some
+ * systems.  It returns FALSE if a write fails, with errno set.
+ */
+static
+enum bool
+write_library(
+int fd,
+char *library,
+uint64_t library_size)
+{
+    uint64_t nwritten, nbytes_to_write;
+
+#define MAX_WRITE 0x10000000
+	for(nwritten = 0; nwritten < library_size; nwritten += nbytes_to_write){
+	    nbytes_to_write = library_size - nwritten;
+	    if(nbytes_to_write > MAX_WRITE)
+		nbytes_to_write = MAX_WRITE;
+	    if(write(fd, library + nwritten, nbytes_to_write) !=
+	       (ssize_t)nbytes_to_write)
+		return(FALSE);
+	}
+	return(TRUE);
+}
+
 #ifdef DEBUG
 /*
  * print_block_list() prints the list of blocks.  Used for debugging.
@@ -3395,8 +3783,8 @@ void
 create_dynamic_shared_library(
 char *output)
 {
-    uint32_t i, j;
-    char *p, *filelist;
+    uint32_t i, j, nlinks;
+    char *p, *filelist, ***link_argvs;
     struct stat stat_buf;
     enum bool use_force_cpusubtype_ALL;
     const struct arch_flag *family_arch_flag;
@@ -3426,9 +3814,12 @@ char *output)
 
 	/*
 	 * For each architecture run ld(1) -dylib to create the dynamic shared
-	 * library.
+	 * library.  The link edits are independent of each other so they are
+	 * run at the same time.
 	 */
-	for(i = 0; i < narchs || (i == 0 && narchs == 0); i++){
+	nlinks = narchs == 0 ? 1 : narchs;
+	link_argvs = allocate(nlinks * sizeof(char **));
+	for(i = 0; i < nlinks; i++){
 	    reset_execute_list();
 	    add_execute_list_with_prefix("ld");
 	    if(narchs != 0 && cmd_flags.arch_only_flag.name == NULL)
@@ -3542,9 +3933,14 @@ char *output)
 		    add_execute_list(cmd_flags.output);
 		}
 	    }
-	    if(execute_list(cmd_flags.verbose) == 0)
-		fatal("internal link edit command failed");
+	    link_argvs[i] = copy_execute_list();
 	}
+	if(execute_jobs(link_argvs, nlinks, cmd_flags.njobs, cmd_flags.verbose,
+		       NULL) != 0)
+	    fatal("internal link edit command failed");
+	for(i = 0; i < nlinks; i++)
+	    free(link_argvs[i]);
+	free(link_argvs);
 	/*
 	 * If there is more than one architecture then run lipo to put them
 	 * in a fat file.
@@ -3606,39 +4002,214 @@ int sig)
 }
 
 /*
- * make_table_of_contents() make the table of contents for the specified arch
- * and fills in the toc_* fields in the arch.  Output is the name of the output
- * file for error messages.
+ * make_tables_of_contents() makes the tables of contents for all the archs and
+ * fills in the toc_* fields in each.  Output is the name of the output file
+ * for error messages.
  */
 static
 void
-make_table_of_contents(
-struct arch *arch,
+make_tables_of_contents(
 char *output)
 {
-    uint32_t i, j, k, r, s, nsects, ncmds, n_strx;
+    uint32_t a, i, m, ntocs, nerrors;
+    uint64_t nsymbols, strsize, nranlibs;
+    struct arch *arch;
+    struct member *member;
+    struct toc_job job;
+
+	/*
+	 * Set up the symbols of the members of each arch and total their number
+	 * to see if it is worth scanning them in parallel.  The members of all
+	 * the archs are scanned together, numbered one arch after another, so
+	 * the archs of a fat library are scanned at the same time.
+	 */
+	nsymbols = 0;
+	job.nmembers = 0;
+	job.first_members = allocate(narchs * sizeof(uint32_t));
+	for(a = 0; a < narchs; a++){
+	    nsymbols += setup_toc_symbols(archs + a);
+	    job.first_members[a] = job.nmembers;
+	    job.nmembers += archs[a].nmembers;
+	}
+	job.member_archs = allocate(job.nmembers * sizeof(uint32_t));
+	for(a = 0; a < narchs; a++)
+	    for(m = 0; m < archs[a].nmembers; m++)
+		job.member_archs[job.first_members[a] + m] = a;
+
+	/*
+	 * For large libraries the members' symbols are scanned in worker
+	 * processes, with the per member results in shared memory.
+	 */
+	if(nsymbols >= TOC_PARALLEL_NSYMBOLS && job.nmembers > 1)
+	    job.njobs = cmd_flags.njobs;
+	else
+	    job.njobs = 1;
+	if(job.njobs > 1){
+	    job.ntocs = parallel_allocate(job.nmembers * sizeof(uint32_t));
+	    job.strsizes = parallel_allocate(job.nmembers * sizeof(uint64_t));
+	    job.nerrors = parallel_allocate(job.nmembers * sizeof(uint32_t));
+	}
+	else{
+	    job.ntocs = allocate(job.nmembers * sizeof(uint32_t));
+	    job.strsizes = allocate(job.nmembers * sizeof(uint64_t));
+	    job.nerrors = allocate(job.nmembers * sizeof(uint32_t));
+	}
+	job.tocs = NULL;
+	job.toc_strings = NULL;
+	job.shared_tocs = NULL;
+	job.shared_toc_strings = NULL;
+	job.toc_offsets = NULL;
+	job.str_offsets = NULL;
+
+	/*
+	 * Second pass over the members to count how many ranlib structs are
+	 * needed and the size of the strings in the toc that are needed.
+	 */
+	parallel_for(job.nmembers, job.njobs, toc_member_job, &job);
+
+	/*
+	 * Report problems with the members in order.  The symbols of members
+	 * with malformed symbols are scanned again to report them.  As when
+	 * the tables of contents were made one arch at a time nothing is
+	 * reported for the archs after one with errors.
+	 */
+	for(a = 0; a < narchs; a++){
+	    arch = archs + a;
+	    for(m = 0; m < arch->nmembers; m++){
+		i = job.first_members[a] + m;
+		member = arch->members + m;
+		if(member->mh != NULL || member->mh64 != NULL){
+		    if(member->st != NULL && member->st->nsyms != 0){
+			if(job.nerrors[i] != 0)
+			    toc_member(arch, m, NULL, NULL, TRUE, &ntocs,
+				       &strsize, &nerrors);
+		    }
+		    else{
+			if(cmd_flags.no_warning_for_no_symbols == FALSE)
+			    warn_member(arch, member, "has no symbols");
+		    }
+		}
+#ifdef LTO_SUPPORT
+		else if(member->lto_contents == TRUE){
+		    ;
+		}
+#endif /* LTO_SUPPORT */
+		else{
+		    if(cmd_flags.ranlib == FALSE){
+			warn_member(arch, member, "is not an object file");
+			errors++;
+		    }
+		}
+	    }
+	    if(errors != 0){
+		toc_job_free(&job);
+		return;
+	    }
+	}
+
+	/*
+	 * Allocate the space for the ranlib structs and strings for the
+	 * table of contents of each arch.
+	 */
+	job.toc_offsets = allocate(job.nmembers * sizeof(uint64_t));
+	job.str_offsets = allocate(job.nmembers * sizeof(uint64_t));
+	job.shared_ntocs = 0;
+	job.shared_strsize = 0;
+	for(a = 0; a < narchs; a++){
+	    arch = archs + a;
+	    arch->toc_nranlibs = 0;
+	    arch->toc_strsize = 0;
+	    for(m = 0; m < arch->nmembers; m++){
+		i = job.first_members[a] + m;
+		job.toc_offsets[i] = arch->toc_nranlibs;
+		job.str_offsets[i] = arch->toc_strsize;
+		arch->toc_nranlibs += job.ntocs[i];
+		arch->toc_strsize += job.strsizes[i];
+	    }
+	    arch->toc_ranlibs = allocate(sizeof(struct ranlib) *
+					 arch->toc_nranlibs);
+	    arch->tocs = allocate(sizeof(struct toc) * arch->toc_nranlibs);
+	    arch->toc_strsize = rnd(arch->toc_strsize, 8);
+	    arch->toc_strings = allocate(arch->toc_strsize);
+	    if(arch->toc_strsize >= 8)
+		memset(arch->toc_strings + arch->toc_strsize - 7, '\0', 7);
+	    job.shared_ntocs += arch->toc_nranlibs;
+	    job.shared_strsize += arch->toc_strsize;
+	}
+
+	/*
+	 * Third pass over the members to fill in the toc structs and
+	 * the strings for the table of contents.  The toc name field is
+	 * filled in with a pointer to a string contained in arch->toc_strings
+	 * for easy sorting and conversion to an index.  The toc index1 field is
+	 * filled in with the member index plus one to allow marking with it's
+	 * negative value by check_sort_tocs() and easy conversion to the
+	 * real offset.  When this is done by worker processes they fill in
+	 * shared copies, a part for each arch, which are then copied to the
+	 * archs.
+	 */
+	job.tocs = allocate(narchs * sizeof(struct toc *));
+	job.toc_strings = allocate(narchs * sizeof(char *));
+	if(job.njobs > 1){
+	    job.shared_tocs = parallel_allocate(sizeof(struct toc) *
+						job.shared_ntocs);
+	    job.shared_toc_strings = parallel_allocate(job.shared_strsize);
+	    nranlibs = 0;
+	    strsize = 0;
+	    for(a = 0; a < narchs; a++){
+		job.tocs[a] = job.shared_tocs + nranlibs;
+		job.toc_strings[a] = job.shared_toc_strings + strsize;
+		nranlibs += archs[a].toc_nranlibs;
+		strsize += archs[a].toc_strsize;
+	    }
+	}
+	else{
+	    for(a = 0; a < narchs; a++){
+		job.tocs[a] = archs[a].tocs;
+		job.toc_strings[a] = archs[a].toc_strings;
+	    }
+	}
+	parallel_for(job.nmembers, job.njobs, toc_member_job, &job);
+	if(job.njobs > 1){
+	    for(a = 0; a < narchs; a++){
+		arch = archs + a;
+		memcpy(arch->toc_strings, job.toc_strings[a],
+		       arch->toc_strsize);
+		for(i = 0; i < arch->toc_nranlibs; i++){
+		    arch->tocs[i].name = arch->toc_strings +
+			(job.tocs[a][i].name - job.toc_strings[a]);
+		    arch->tocs[i].index1 = job.tocs[a][i].index1;
+		}
+	    }
+	}
+	toc_job_free(&job);
+
+	for(a = 0; a < narchs; a++)
+	    finish_table_of_contents(archs + a, output);
+}
+
+/*
+ * setup_toc_symbols() is the first pass over the members of the arch for
+ * make_tables_of_contents().  It sets up each object's symbol table and array
+ * of section pointers, swaps its symbols to the host byte sex and returns the
+ * total number of symbols.  The symbols of members using the names in the
+ * input's table of contents are not used so they are left alone.
+ */
+static
+uint64_t
+setup_toc_symbols(
+struct arch *arch)
+{
+    uint32_t i, j, k, nsects, ncmds;
+    uint64_t nsymbols;
     struct member *member;
     struct load_command *lc;
     struct segment_command *sg;
     struct segment_command_64 *sg64;
-    struct nlist *symbols;
-    struct nlist_64 *symbols64;
-    char *strings;
-    enum bool sorted, is_toc_symbol;
-    char *ar_name;
     struct section *section;
     struct section_64 *section64;
-    uint8_t n_type, n_sect;
-#ifdef LTO_SUPPORT
-    char *lto_toc_string;
-#endif /* LTO_SUPPORT */
 
-	symbols = NULL;
-	symbols64 = NULL;
-	/*
-	 * First pass over the members to count how many ranlib structs are
-	 * needed and the size of the strings in the toc that are needed.
-	 */
+	nsymbols = 0;
 	for(i = 0; i < arch->nmembers; i++){
 	    member = arch->members + i;
 	    if(member->mh != NULL || member->mh64 != NULL){
@@ -3663,6 +4234,7 @@ char *output)
 		    }
 		    lc = (struct load_command *)((char *)lc + lc->cmdsize);
 		}
+		member->nsects = nsects;
 		if(member->mh != NULL)
 		    member->sections = allocate(nsects *
 						sizeof(struct section *));
@@ -3690,177 +4262,80 @@ char *output)
 		    }
 		    lc = (struct load_command *)((char *)lc + lc->cmdsize);
 		}
-		if(member->st != NULL && member->st->nsyms != 0){
-		    if(member->mh != NULL){
-			symbols = (struct nlist *)(member->object_addr +
-					           member->st->symoff);
-			if(member->object_byte_sex != get_host_byte_sex())
-			    swap_nlist(symbols, member->st->nsyms,
-				       get_host_byte_sex());
-		    }
-		    else{
-			symbols64 = (struct nlist_64 *)(member->object_addr +
-					                member->st->symoff);
-			if(member->object_byte_sex != get_host_byte_sex())
-			    swap_nlist_64(symbols64, member->st->nsyms,
-				          get_host_byte_sex());
-		    }
-		    strings = member->object_addr + member->st->stroff;
-		    for(j = 0; j < member->st->nsyms; j++){
-			if(member->mh != NULL){
-			    n_strx = symbols[j].n_un.n_strx;
-			    n_type = symbols[j].n_type;
-			    n_sect = symbols[j].n_sect;
-			}
-			else{
-			    n_strx = symbols64[j].n_un.n_strx;
-			    n_type = symbols64[j].n_type;
-			    n_sect = symbols64[j].n_sect;
-			}
-			if(n_strx > member->st->strsize){
-			    warn_member(arch, member, "malformed object "
-				"(symbol %u n_strx field extends past the "
-				"end of the string table)", j);
-			    errors++;
-			    continue;
-			}
-			if((n_type & N_TYPE) == N_SECT){
-			    if(n_sect == NO_SECT){
-				warn_member(arch, member, "malformed object "
-				    "(symbol %u must not have NO_SECT for its "
-				    "n_sect field given its type (N_SECT))", j);
-				errors++;
-				continue;
-			    }
-			    if(n_sect > nsects){
-				warn_member(arch, member, "malformed object "
-				    "(symbol %u n_sect field greater than the "
-				    "number of sections in the file)", j);
-				errors++;
-				continue;
-			    }
-			}
+		if(member->st != NULL && member->st->nsyms != 0 &&
+		   member->use_input_toc == FALSE){
+		    if(member->object_byte_sex != get_host_byte_sex()){
 			if(member->mh != NULL)
-			    is_toc_symbol = toc_symbol(symbols + j,
-						       member->sections);
+			    swap_nlist((struct nlist *)(member->object_addr +
+					                member->st->symoff),
+				       member->st->nsyms, get_host_byte_sex());
 			else
-			    is_toc_symbol = toc_symbol_64(symbols64 + j,
-						          member->sections64);
-			if(is_toc_symbol == TRUE){
-			    arch->toc_nranlibs++;
-			    arch->toc_strsize += strlen(strings + n_strx) + 1;
-			}
+			    swap_nlist_64((struct nlist_64 *)
+				(member->object_addr + member->st->symoff),
+				member->st->nsyms, get_host_byte_sex());
 		    }
-		}
-		else{
-		    if(cmd_flags.no_warning_for_no_symbols == FALSE)
-			warn_member(arch, member, "has no symbols");
-		}
-	    }
-#ifdef LTO_SUPPORT
-	    else if(member->lto_contents == TRUE){
-		arch->toc_nranlibs += member->lto_toc_nsyms;
-		arch->toc_strsize += member->lto_toc_strsize;
-	    }
-#endif /* LTO_SUPPORT */
-	    else{
-		if(cmd_flags.ranlib == FALSE){
-		    warn_member(arch, member, "is not an object file");
-		    errors++;
+		    nsymbols += member->st->nsyms;
 		}
 	    }
 	}
-	if(errors != 0)
-	    return;
 
-	/*
-	 * Allocate the space for the ranlib structs and strings for the
-	 * table of contents.
-	 */
-	arch->toc_ranlibs = allocate(sizeof(struct ranlib) *arch->toc_nranlibs);
-	arch->tocs = allocate(sizeof(struct toc) * arch->toc_nranlibs);
-	arch->toc_strsize = rnd(arch->toc_strsize, 8);
-	arch->toc_strings = allocate(arch->toc_strsize);
-	if(arch->toc_strsize >= 8)
-	    memset(arch->toc_strings + arch->toc_strsize - 7, '\0', 7);
+	return(nsymbols);
+}
+
+/*
+ * finish_table_of_contents() finishes the table of contents for the arch once
+ * make_tables_of_contents() has filled in its toc structs and strings.  It
+ * sorts them if they are to be sorted and sets the rest of the toc_* fields.
+ */
+static
+void
+finish_table_of_contents(
+struct arch *arch,
+char *output)
+{
+    uint32_t i;
+    struct member *member;
+    enum bool sorted;
+    char *ar_name;
 
 	/*
-	 * Second pass over the members to fill in the toc structs and
-	 * the strings for the table of contents.  The toc name field is
-	 * filled in with a pointer to a string contained in arch->toc_strings
-	 * for easy sorting and conversion to an index.  The toc index1 field is
-	 * filled in with the member index plus one to allow marking with it's
-	 * negative value by check_sort_tocs() and easy conversion to the
-	 * real offset.
+	 * Swap the symbols of objects not in the host byte sex back.
 	 */
-	r = 0;
-	s = 0;
 	for(i = 0; i < arch->nmembers; i++){
 	    member = arch->members + i;
-	    if(member->mh != NULL || member->mh64 != NULL){
-		if(member->st != NULL && member->st->nsyms != 0){
-		    if(member->mh != NULL)
-			symbols = (struct nlist *)(member->object_addr +
-					           member->st->symoff);
-		    else
-			symbols64 = (struct nlist_64 *)(member->object_addr +
-					                member->st->symoff);
-		    strings = member->object_addr + member->st->stroff;
-		    for(j = 0; j < member->st->nsyms; j++){
-			if(member->mh != NULL)
-			    n_strx = symbols[j].n_un.n_strx;
-			else
-			    n_strx = symbols64[j].n_un.n_strx;
-			if(n_strx > member->st->strsize)
-			    continue;
-			if(member->mh != NULL)
-			    is_toc_symbol = toc_symbol(symbols + j,
-						       member->sections);
-			else
-			    is_toc_symbol = toc_symbol_64(symbols64 + j,
-						          member->sections64);
-			if(is_toc_symbol == TRUE){
-			    strcpy(arch->toc_strings + s,
-				   strings + n_strx);
-			    arch->tocs[r].name = arch->toc_strings + s;
-			    arch->tocs[r].index1 = i + 1;
-			    r++;
-			    s += strlen(strings + n_strx) + 1;
-			}
-		    }
-		    if(member->object_byte_sex != get_host_byte_sex()){
-			if(member->mh != NULL)
-			    swap_nlist(symbols, member->st->nsyms,
-				       member->object_byte_sex);
-			else
-			    swap_nlist_64(symbols64, member->st->nsyms,
-				          member->object_byte_sex);
-		    }
-		}
-	    }
-#ifdef LTO_SUPPORT
-	    else if(member->lto_contents == TRUE){
-		lto_toc_string = member->lto_toc_strings;
-		for(j = 0; j < member->lto_toc_nsyms; j++){
-		    strcpy(arch->toc_strings + s, lto_toc_string);
-		    arch->tocs[r].name = arch->toc_strings + s;
-		    arch->tocs[r].index1 = i + 1;
-		    r++;
-		    s += strlen(lto_toc_string) + 1;
-		    lto_toc_string += strlen(lto_toc_string) + 1;
-		}
+	    if((member->mh != NULL || member->mh64 != NULL) &&
+	       member->st != NULL && member->st->nsyms != 0 &&
+	       member->use_input_toc == FALSE &&
+	       member->object_byte_sex != get_host_byte_sex()){
+		if(member->mh != NULL)
+		    swap_nlist((struct nlist *)(member->object_addr +
+					        member->st->symoff),
+			       member->st->nsyms, member->object_byte_sex);
+		else
+		    swap_nlist_64((struct nlist_64 *)(member->object_addr +
+					              member->st->symoff),
+				  member->st->nsyms, member->object_byte_sex);
 	    }
-#endif /* LTO_SUPPORT */
 	}
 
 	/*
 	 * If the table of contents is to be sorted by symbol name then try to
-	 * sort it and leave it sorted if no duplicates.
+	 * sort it and leave it sorted if no duplicates.  The names are first
+	 * checked for duplicates with a hash table, and if there are none they
+	 * are sorted with sort_names().  Else this is done as it always has
+	 * been with qsort() so the unsorted table of contents is the same.
 	 */
 	if(cmd_flags.s == TRUE){
-	    qsort(arch->tocs, arch->toc_nranlibs, sizeof(struct toc),
-		  (int (*)(const void *, const void *))toc_name_qsort);
-	    sorted = check_sort_tocs(arch, output, FALSE);
+	    if(names_unique(arch->tocs, arch->toc_nranlibs,
+			    sizeof(struct toc)) == TRUE){
+		sort_names(arch->tocs, arch->toc_nranlibs, sizeof(struct toc));
+		sorted = TRUE;
+	    }
+	    else{
+		qsort(arch->tocs, arch->toc_nranlibs, sizeof(struct toc),
+		      (int (*)(const void *, const void *))toc_name_qsort);
+		sorted = check_sort_tocs(arch, output, FALSE);
+	    }
 	    if(sorted == FALSE){
 		qsort(arch->tocs, arch->toc_nranlibs, sizeof(struct toc),
 		      (int (*)(const void *, const void *))toc_index1_qsort);
@@ -4065,6 +4540,601 @@ char *output)
 	       (int)sizeof(arch->toc_ar_hdr.ar_fmag));
 }
 
+/*
+ * toc_member_job() is called by parallel_for() to scan the symbols of the
+ * member numbered i for make_tables_of_contents().  If job->tocs is NULL the
+ * number of toc structs, the size of their strings and the number of malformed
+ * symbols are stored for the member, else its toc structs and strings are
+ * filled in.
+ */
+static
+void
+toc_member_job(
+uint32_t i,
+void *cookie)
+{
+    struct toc_job *job;
+    uint32_t a, m, ntocs, nerrors;
+    uint64_t strsize;
+
+	job = (struct toc_job *)cookie;
+	a = job->member_archs[i];
+	m = i - job->first_members[a];
+	if(job->tocs == NULL)
+	    toc_member(archs + a, m, NULL, NULL, FALSE, job->ntocs + i,
+		       job->strsizes + i, job->nerrors + i);
+	else
+	    toc_member(archs + a, m, job->tocs[a] + job->toc_offsets[i],
+		       job->toc_strings[a] + job->str_offsets[i], FALSE,
+		       &ntocs, &strsize, &nerrors);
+}
+
+/*
+ * toc_member() scans the symbols of the member at index i of the arch for the
+ * ones that go in the table of contents.  It returns their number and the size
+ * of their strings in *ntocs and *strsize, and the number of malformed symbols
+ * in *nerrors.  If report is TRUE the malformed symbols are also reported as
+ * errors.  If tocs is not NULL the strings are copied to toc_strings and the
+ * toc structs for them are filled in.  An object's symbols must have been set
+ * up and swapped to the host byte sex by setup_toc_symbols().  For a member
+ * using the names in the input's table of contents they are used instead.
+ */
+static
+void
+toc_member(
+struct arch *arch,
+uint32_t i,
+struct toc *tocs,
+char *toc_strings,
+enum bool report,
+uint32_t *ntocs,
+uint64_t *strsize,
+uint32_t *nerrors)
+{
+    uint32_t j, n_strx, len;
+    struct member *member;
+    struct nlist *symbols;
+    struct nlist_64 *symbols64;
+    char *strings;
+    enum bool is_toc_symbol;
+    uint8_t n_type, n_sect;
+#ifdef LTO_SUPPORT
+    char *lto_toc_string;
+#endif /* LTO_SUPPORT */
+
+	*ntocs = 0;
+	*strsize = 0;
+	*nerrors = 0;
+	member = arch->members + i;
+	if(member->use_input_toc == TRUE){
+	    for(j = 0; j < member->input_toc_nnames; j++){
+		len = strlen(member->input_toc_names[j]) + 1;
+		if(tocs != NULL){
+		    memcpy(toc_strings + *strsize, member->input_toc_names[j],
+			   len);
+		    tocs[*ntocs].name = toc_strings + *strsize;
+		    tocs[*ntocs].index1 = i + 1;
+		}
+		(*ntocs)++;
+		*strsize += len;
+	    }
+	}
+	else if(member->mh != NULL || member->mh64 != NULL){
+	    if(member->st == NULL || member->st->nsyms == 0)
+		return;
+	    symbols = NULL;
+	    symbols64 = NULL;
+	    if(member->mh != NULL)
+		symbols = (struct nlist *)(member->object_addr +
+					   member->st->symoff);
+	    else
+		symbols64 = (struct nlist_64 *)(member->object_addr +
+						member->st->symoff);
+	    strings = member->object_addr + member->st->stroff;
+	    for(j = 0; j < member->st->nsyms; j++){
+		if(member->mh != NULL){
+		    n_strx = symbols[j].n_un.n_strx;
+		    n_type = symbols[j].n_type;
+		    n_sect = symbols[j].n_sect;
+		}
+		else{
+		    n_strx = symbols64[j].n_un.n_strx;
+		    n_type = symbols64[j].n_type;
+		    n_sect = symbols64[j].n_sect;
+		}
+		if(n_strx > member->st->strsize){
+		    if(report == TRUE){
+			warn_member(arch, member, "malformed object (symbol %u "
+			    "n_strx field extends past the end of the string "
+			    "table)", j);
+			errors++;
+		    }
+		    (*nerrors)++;
+		    continue;
+		}
+		if((n_type & N_TYPE) == N_SECT){
+		    if(n_sect == NO_SECT){
+			if(report == TRUE){
+			    warn_member(arch, member, "malformed object "
+				"(symbol %u must not have NO_SECT for its "
+				"n_sect field given its type (N_SECT))", j);
+			    errors++;
+			}
+			(*nerrors)++;
+			continue;
+		    }
+		    if(n_sect > member->nsects){
+			if(report == TRUE){
+			    warn_member(arch, member, "malformed object "
+				"(symbol %u n_sect field greater than the "
+				"number of sections in the file)", j);
+			    errors++;
+			}
+			(*nerrors)++;
+			continue;
+		    }
+		}
+		if(member->mh != NULL)
+		    is_toc_symbol = toc_symbol(symbols + j, member->sections);
+		else
+		    is_toc_symbol = toc_symbol_64(symbols64 + j,
+						  member->sections64);
+		if(is_toc_symbol == TRUE){
+		    len = strlen(strings + n_strx) + 1;
+		    if(tocs != NULL){
+			memcpy(toc_strings + *strsize, strings + n_strx, len);
+			tocs[*ntocs].name = toc_strings + *strsize;
+			tocs[*ntocs].index1 = i + 1;
+		    }
+		    (*ntocs)++;
+		    *strsize += len;
+		}
+	    }
+	}
+#ifdef LTO_SUPPORT
+	else if(member->lto_contents == TRUE){
+	    if(tocs != NULL){
+		lto_toc_string = member->lto_toc_strings;
+		for(j = 0; j < member->lto_toc_nsyms; j++){
+		    len = strlen(lto_toc_string) + 1;
+		    memcpy(toc_strings + *strsize, lto_toc_string, len);
+		    tocs[j].name = toc_strings + *strsize;
+		    tocs[j].index1 = i + 1;
+		    *strsize += len;
+		    lto_toc_string += len;
+		}
+	    }
+	    *ntocs = member->lto_toc_nsyms;
+	    *strsize = member->lto_toc_strsize;
+	}
+#endif /* LTO_SUPPORT */
+}
+
+/*
+ * toc_job_free() frees the memory make_tables_of_contents() allocated for the
+ * job.
+ */
+static
+void
+toc_job_free(
+struct toc_job *job)
+{
+	if(job->njobs > 1){
+	    parallel_deallocate(job->ntocs, job->nmembers * sizeof(uint32_t));
+	    parallel_deallocate(job->strsizes,
+				job->nmembers * sizeof(uint64_t));
+	    parallel_deallocate(job->nerrors, job->nmembers * sizeof(uint32_t));
+	    if(job->shared_tocs != NULL)
+		parallel_deallocate(job->shared_tocs,
+				    sizeof(struct toc) * job->shared_ntocs);
+	    if(job->shared_toc_strings != NULL)
+		parallel_deallocate(job->shared_toc_strings,
+				    job->shared_strsize);
+	}
+	else{
+	    free(job->ntocs);
+	    free(job->strsizes);
+	    free(job->nerrors);
+	}
+	free(job->first_members);
+	free(job->member_archs);
+	if(job->toc_offsets != NULL)
+	    free(job->toc_offsets);
+	if(job->str_offsets != NULL)
+	    free(job->str_offsets);
+	if(job->tocs != NULL)
+	    free(job->tocs);
+	if(job->toc_strings != NULL)
+	    free(job->toc_strings);
+}
+
+/*
+ * use_toc_cache() is called for ranlib -i with the thin archive in ofile that
+ * is to have its table of contents rebuilt.  If the cache for file_name was
+ * written for its table of contents, each member with an archive header that
+ * is in the cache is set to use the names in the table of contents for the
+ * member at the offset it had then.
+ */
+static
+void
+use_toc_cache(
+struct ofile *ofile,
+char *file_name)
+{
+    int fd, archive_fd;
+    char *cache_name, *buf, *toc_start;
+    struct stat stat_buf;
+    struct toc_cache_header *header;
+    struct toc_cache_member *cache_members, *found, key;
+    struct input_toc_entry *entries;
+    enum bool *used;
+    uint64_t i, n, lo, hi, strx, ran_off, toc_size, nnames;
+    uint32_t j, flags;
+    struct arch *arch;
+    struct member *member;
+
+	if(narchs != 1 || ofile->file_type != OFILE_ARCHIVE ||
+	   ofile->toc_addr == NULL || ofile->toc_bad == TRUE)
+	    return;
+	/*
+	 * The names are used in the order they are in the input's table of
+	 * contents.  If that is sorted it is only the order the symbols would
+	 * have if the new one is to be sorted too.
+	 */
+	if(cmd_flags.s == FALSE &&
+	   ((ofile->toc_name_size >= sizeof(SYMDEF_SORTED) - 1 &&
+	     strncmp(ofile->toc_name, SYMDEF_SORTED,
+		     sizeof(SYMDEF_SORTED) - 1) == 0) ||
+	    (ofile->toc_name_size >= sizeof(SYMDEF_64_SORTED) - 1 &&
+	     strncmp(ofile->toc_name, SYMDEF_64_SORTED,
+		     sizeof(SYMDEF_64_SORTED) - 1) == 0)))
+	    return;
+
+	cache_name = makestr(file_name, TOC_CACHE_SUFFIX, NULL);
+	fd = open(cache_name, O_RDONLY);
+	free(cache_name);
+	if(fd == -1)
+	    return;
+	if(fstat(fd, &stat_buf) == -1 ||
+	   stat_buf.st_size < (off_t)sizeof(struct toc_cache_header)){
+	    close(fd);
+	    return;
+	}
+	buf = allocate(stat_buf.st_size);
+	if(read(fd, buf, stat_buf.st_size) != stat_buf.st_size){
+	    close(fd);
+	    free(buf);
+	    return;
+	}
+	close(fd);
+
+	/*
+	 * Check the cache was written by this code with the same flags, is
+	 * complete and is for the table of contents in the archive.
+	 */
+	header = (struct toc_cache_header *)buf;
+	cache_members = (struct toc_cache_member *)
+			(buf + sizeof(struct toc_cache_header));
+	flags = cmd_flags.c == TRUE ? TOC_CACHE_COMMONS : 0;
+	toc_start = (char *)ofile->toc_ar_hdr;
+	toc_size = (ofile->toc_addr + ofile->toc_size) - toc_start;
+	if(header->magic != TOC_CACHE_MAGIC ||
+	   header->flags != flags ||
+	   (uint64_t)stat_buf.st_size != sizeof(struct toc_cache_header) +
+		(uint64_t)header->nmembers * sizeof(struct toc_cache_member) ||
+	   header->toc_size != toc_size ||
+	   header->toc_crc != crc32(toc_start, toc_size) ||
+	   header->crc != crc32(cache_members, header->nmembers *
+				sizeof(struct toc_cache_member))){
+	    free(buf);
+	    return;
+	}
+
+	/*
+	 * Sort the entries of the input's table of contents by the offset of
+	 * the member they are for, keeping their order for each member.
+	 */
+	n = ofile->toc_nranlibs;
+	entries = allocate(n * sizeof(struct input_toc_entry));
+	for(i = 0; i < n; i++){
+	    if(ofile->toc_is_32bit == TRUE){
+		strx = ofile->toc_ranlibs[i].ran_un.ran_strx;
+		ran_off = ofile->toc_ranlibs[i].ran_off;
+	    }
+	    else{
+		strx = ofile->toc_ranlibs64[i].ran_un.ran_strx;
+		ran_off = ofile->toc_ranlibs64[i].ran_off;
+	    }
+	    if(memchr(ofile->toc_strings + strx, '\0',
+		      ofile->toc_strsize - strx) == NULL){
+		free(entries);
+		free(buf);
+		return;
+	    }
+	    entries[i].ran_off = ran_off;
+	    entries[i].index = i;
+	}
+	qsort(entries, n, sizeof(struct input_toc_entry),
+	      (int (*)(const void *, const void *))input_toc_entry_qsort);
+	qsort(cache_members, header->nmembers, sizeof(struct toc_cache_member),
+	      (int (*)(const void *, const void *))toc_cache_member_qsort);
+
+	/*
+	 * The contents of members with a zero date are read from the file, as
+	 * ofile_map() may have swapped the headers of the mapped objects.
+	 */
+	archive_fd = open(file_name, O_RDONLY);
+	if(archive_fd == -1){
+	    free(entries);
+	    free(buf);
+	    return;
+	}
+
+	arch = archs;
+	arch->input_toc_names = allocate(n * sizeof(char *));
+	used = allocate(header->nmembers * sizeof(enum bool));
+	memset(used, '\0', header->nmembers * sizeof(enum bool));
+	nnames = 0;
+	for(j = 0; j < arch->nmembers; j++){
+	    member = arch->members + j;
+	    if(member->input_ar_hdr == NULL ||
+	       toc_cache_key((char *)member->input_ar_hdr,
+			     (ofile->file_addr + ofile->file_size) -
+			     (char *)member->input_ar_hdr, &key) == FALSE ||
+	       toc_cache_contents_crc(archive_fd,
+				      (char *)member->input_ar_hdr -
+				      ofile->file_addr, &key) == FALSE)
+		continue;
+	    found = bsearch(&key, cache_members, header->nmembers,
+			    sizeof(struct toc_cache_member),
+			    (int (*)(const void *, const void *))
+			    toc_cache_member_qsort);
+	    if(found == NULL)
+		continue;
+	    /*
+	     * An archive header that is in the cache more than once does not
+	     * say which member is which, and one cache entry is only used for
+	     * one member.
+	     */
+	    if((found != cache_members &&
+		toc_cache_member_qsort(found - 1, &key) == 0) ||
+	       (found + 1 != cache_members + header->nmembers &&
+		toc_cache_member_qsort(found + 1, &key) == 0) ||
+	       used[found - cache_members] == TRUE)
+		continue;
+	    used[found - cache_members] = TRUE;
+
+	    /* find the first entry for the member's offset then */
+	    lo = 0;
+	    hi = n;
+	    while(lo < hi){
+		i = lo + (hi - lo) / 2;
+		if(entries[i].ran_off < found->offset)
+		    lo = i + 1;
+		else
+		    hi = i;
+	    }
+	    member->use_input_toc = TRUE;
+	    member->input_toc_names = arch->input_toc_names + nnames;
+	    for(i = lo; i < n && entries[i].ran_off == found->offset; i++){
+		if(ofile->toc_is_32bit == TRUE)
+		    strx = ofile->toc_ranlibs[entries[i].index].ran_un.ran_strx;
+		else
+		    strx = ofile->toc_ranlibs64[entries[i].index].
+			   ran_un.ran_strx;
+		arch->input_toc_names[nnames++] = ofile->toc_strings + strx;
+		member->input_toc_nnames++;
+	    }
+	}
+	close(archive_fd);
+	free(used);
+	free(entries);
+	free(buf);
+}
+
+/*
+ * write_toc_cache() is called for ranlib -i after the thin archive output is
+ * written to write the cache for its table of contents and members.  The
+ * archive headers are read back from the file so they are what the next
+ * use_toc_cache() will see.
+ */
+static
+void
+write_toc_cache(
+char *output)
+{
+    int fd;
+    char *cache_name, *tmp_name, *buf, *toc, *hdr;
+    uint32_t j, hdr_size, name_size, size;
+    struct arch *arch;
+    struct toc_cache_header *header;
+    struct toc_cache_member *cache_members;
+
+	arch = archs;
+	if((fd = open(output, O_RDONLY)) == -1)
+	    return;
+	size = sizeof(struct toc_cache_header) +
+	       arch->nmembers * sizeof(struct toc_cache_member);
+	buf = allocate(size);
+	header = (struct toc_cache_header *)buf;
+	cache_members = (struct toc_cache_member *)
+			(buf + sizeof(struct toc_cache_header));
+	toc = allocate(arch->toc_size);
+	hdr_size = sizeof(struct ar_hdr);
+	hdr = allocate(hdr_size);
+	if(pread(fd, toc, arch->toc_size, SARMAG) != (ssize_t)arch->toc_size)
+	    goto done;
+	for(j = 0; j < arch->nmembers; j++){
+	    if(pread(fd, hdr, sizeof(struct ar_hdr), arch->members[j].offset) !=
+	       (ssize_t)sizeof(struct ar_hdr))
+		goto done;
+	    name_size = efmt1_name_size((struct ar_hdr *)hdr);
+	    if(sizeof(struct ar_hdr) + name_size > hdr_size){
+		hdr_size = sizeof(struct ar_hdr) + name_size;
+		hdr = reallocate(hdr, hdr_size);
+	    }
+	    if(pread(fd, hdr + sizeof(struct ar_hdr), name_size,
+		     arch->members[j].offset + sizeof(struct ar_hdr)) !=
+	       (ssize_t)name_size)
+		goto done;
+	    (void)toc_cache_key(hdr, sizeof(struct ar_hdr) + name_size,
+				cache_members + j);
+	    if(toc_cache_contents_crc(fd, arch->members[j].offset,
+				      cache_members + j) == FALSE)
+		goto done;
+	    cache_members[j].offset = arch->members[j].offset;
+	}
+	header->magic = TOC_CACHE_MAGIC;
+	header->flags = cmd_flags.c == TRUE ? TOC_CACHE_COMMONS : 0;
+	header->nmembers = arch->nmembers;
+	header->toc_size = arch->toc_size;
+	header->toc_crc = crc32(toc, arch->toc_size);
+	header->crc = crc32(cache_members,
+			    arch->nmembers * sizeof(struct toc_cache_member));
+	close(fd);
+
+	/*
+	 * The cache is written to a temporary file next to it and renamed to
+	 * it, so a ranlib that is interrupted or runs at the same time as
+	 * another never leaves a partly written cache.
+	 */
+	cache_name = makestr(output, TOC_CACHE_SUFFIX, NULL);
+	tmp_name = makestr(cache_name, ".XXXXXX", NULL);
+	if((fd = mkstemp(tmp_name)) != -1){
+	    if(write(fd, buf, size) == (ssize_t)size && close(fd) == 0){
+		if(rename(tmp_name, cache_name) == -1)
+		    (void)unlink(tmp_name);
+	    }
+	    else{
+		(void)close(fd);
+		(void)unlink(tmp_name);
+	    }
+	}
+	free(tmp_name);
+	free(cache_name);
+	fd = -1;
+done:
+	if(fd != -1)
+	    close(fd);
+	free(hdr);
+	free(toc);
+	free(buf);
+}
+
+/*
+ * toc_cache_key() sets the archive header and name crc of key from the archive
+ * header at addr, which has size bytes after it in memory.  It returns FALSE if
+ * the header's extended format #1 name does not fit in them.
+ */
+static
+enum bool
+toc_cache_key(
+char *addr,
+uint64_t size,
+struct toc_cache_member *key)
+{
+    uint32_t name_size;
+
+	memset(key, '\0', sizeof(struct toc_cache_member));
+	if(size < sizeof(struct ar_hdr))
+	    return(FALSE);
+	memcpy(&key->ar_hdr, addr, sizeof(struct ar_hdr));
+	name_size = efmt1_name_size(&key->ar_hdr);
+	if(name_size > size - sizeof(struct ar_hdr))
+	    return(FALSE);
+	if(name_size != 0)
+	    key->name_crc = crc32(addr + sizeof(struct ar_hdr), name_size);
+	return(TRUE);
+}
+
+/*
+ * toc_cache_contents_crc() sets the contents crc of key, for the member with
+ * its archive header at offset in the archive open on fd, if the date in the
+ * header is zero.  It returns FALSE if the contents can't be read.
+ */
+static
+enum bool
+toc_cache_contents_crc(
+int fd,
+uint64_t offset,
+struct toc_cache_member *key)
+{
+    char date_buf[sizeof(key->ar_hdr.ar_date) + 1];
+    char size_buf[sizeof(key->ar_hdr.ar_size) + 1];
+    char *contents;
+    uint64_t size;
+    uint32_t name_size;
+
+	memcpy(date_buf, key->ar_hdr.ar_date, sizeof(key->ar_hdr.ar_date));
+	date_buf[sizeof(key->ar_hdr.ar_date)] = '\0';
+	if(strtoul(date_buf, NULL, 10) != 0)
+	    return(TRUE);
+	memcpy(size_buf, key->ar_hdr.ar_size, sizeof(key->ar_hdr.ar_size));
+	size_buf[sizeof(key->ar_hdr.ar_size)] = '\0';
+	size = strtoull(size_buf, NULL, 10);
+	name_size = efmt1_name_size(&key->ar_hdr);
+	if(name_size > size || size - name_size > UINT32_MAX)
+	    return(FALSE);
+	size -= name_size;
+	contents = allocate(size);
+	if(pread(fd, contents, size, offset + sizeof(struct ar_hdr) +
+		 name_size) != (ssize_t)size){
+	    free(contents);
+	    return(FALSE);
+	}
+	key->contents_crc = crc32(contents, size);
+	free(contents);
+	return(TRUE);
+}
+
+/*
+ * efmt1_name_size() returns the size of the name after the archive header if
+ * it uses the 4.4bsd extended format #1 for its name, else 0.
+ */
+static
+uint32_t
+efmt1_name_size(
+struct ar_hdr *ar_hdr)
+{
+    char ar_name_buf[sizeof(ar_hdr->ar_name) + 1];
+
+	if(strncmp(ar_hdr->ar_name, AR_EFMT1, sizeof(AR_EFMT1) - 1) != 0)
+	    return(0);
+	memcpy(ar_name_buf, ar_hdr->ar_name, sizeof(ar_hdr->ar_name));
+	ar_name_buf[sizeof(ar_hdr->ar_name)] = '\0';
+	return(strtoul(ar_name_buf + sizeof(AR_EFMT1) - 1, NULL, 10));
+}
+
+/*
+ * Function for qsort() and bsearch() for comparing the archive headers and
+ * name crcs of toc_cache_member structs.
+ */
+static
+int
+toc_cache_member_qsort(
+const struct toc_cache_member *member1,
+const struct toc_cache_member *member2)
+{
+	return(memcmp(member1, member2, TOC_CACHE_KEY_SIZE));
+}
+
+/*
+ * Function for qsort() for comparing input_toc_entry structs by the offset of
+ * the member then their index in the table of contents.
+ */
+static
+int
+input_toc_entry_qsort(
+const struct input_toc_entry *entry1,
+const struct input_toc_entry *entry2)
+{
+	if(entry1->ran_off != entry2->ran_off)
+	    return(entry1->ran_off < entry2->ran_off ? -1 : 1);
+	if(entry1->index != entry2->index)
+	    return(entry1->index < entry2->index ? -1 : 1);
+	return(0);
+}
+
 #ifdef LTO_SUPPORT
 /*
  * save_lto_member_toc_info() saves away the table of contents info for a
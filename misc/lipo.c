@@ -36,7 +36,11 @@
  *   -replace <arch_type> <file_name>
  *   -segalign <arch_type> <value>
  *   -verify_arch <arch_type> ...
+ *   -verbose
  */
+#ifdef __linux__
+#define _GNU_SOURCE /* for copy_file_range(2) */
+#endif
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -94,6 +98,8 @@ struct thin_file {
     uint64_t offset;
     uint64_t size;
     uint32_t align;
+    int fd;			/* file it is in, -1 if only at addr */
+    uint64_t file_offset;	/* offset of it in that file */
     enum bool from_fat;
     enum bool extract;
     enum bool remove;
@@ -155,8 +161,35 @@ static uint32_t nverify_archs = 0;
 
 static enum bool fat64_flag = FALSE;
 
+static enum bool verbose_flag = FALSE;
+
+/*
+ * Where copy_file_range(2) is available the thin files are copied from the
+ * input files to the output file in the kernel, rather than written from where
+ * the input files are mapped, so the pages of a slice are not touched when
+ * only the fat headers change as with -replace, -remove and -extract, and on
+ * file systems that can the blocks are shared rather than copied.  Elsewhere,
+ * and for what copy_file_range(2) could not copy, they are written from memory
+ * as before.  There is no call on macOS to clone part of a file, and no output
+ * of lipo is a whole input file that clonefile(2) could clone, so there they
+ * are always written from memory.  The counts of the bytes written each way
+ * are reported with -verbose.
+ */
+#if defined(__linux__) && !defined(NO_COPY_FILE_RANGE)
+#define COPY_FILE_RANGE
+#endif
+static uint64_t nbytes_from_memory = 0;
+#ifdef COPY_FILE_RANGE
+static uint64_t nbytes_kernel_copied = 0;
+#endif
+
 static void create_fat(
     void);
+static void copy_thin_file(
+    struct thin_file *thin,
+    int fd,
+    uint64_t offset,
+    char *output);
 static void process_input_file(
     struct input_file *input);
 static void process_replace_file(
@@ -241,7 +274,6 @@ char *envp[])
     const struct arch_flag *arch_flags;
     enum bool found;
     struct arch_flag blank_arch;
-    uint64_t nbytes_to_write, nbytes_written;
 
 	input = NULL;
 	/*
@@ -470,6 +502,9 @@ char *envp[])
 			    }
 			}
 		    }
+		    else if(strcmp(p, "verbose") == 0){
+			verbose_flag = TRUE;
+		    }
 		    else
 			goto unknown_flag;
 		    break;
@@ -593,20 +628,7 @@ unknown_flag:
 			system_fatal("can't create output file: %s",
 				     output_file);
 
-		    nbytes_written = 0;
-		    do{
-#define MAX_WRITE 0x10000000
-			if(thin_files[i].size - nbytes_written > MAX_WRITE)
-			    nbytes_to_write = MAX_WRITE;
-			else
-			    nbytes_to_write = thin_files[i].size -
-					      nbytes_written;
-			if(write(fd, thin_files[i].addr + nbytes_written,
-				 nbytes_to_write) != nbytes_to_write)
-			    system_fatal("can't write thin file to output "
-					 "file: %s", output_file);
-			nbytes_written += nbytes_to_write;
-		    }while(nbytes_written != thin_files[i].size);
+		    copy_thin_file(thin_files + i, fd, 0, output_file);
 		    if(close(fd) == -1)
 			system_fatal("can't close output file: %s",output_file);
 		    if(utime(output_file,
@@ -899,6 +921,18 @@ unknown_flag:
 	    }
 	}
 
+	if(verbose_flag == TRUE &&
+	   (create_flag == TRUE || thin_flag == TRUE || extract_flag == TRUE ||
+	    remove_flag == TRUE || replace_flag == TRUE))
+#ifdef COPY_FILE_RANGE
+	    printf("%s: %llu bytes written from memory, %llu bytes copied "
+		   "with copy_file_range(2)\n", output_file,
+		   nbytes_from_memory, nbytes_kernel_copied);
+#else
+	    printf("%s: %llu bytes written from memory\n", output_file,
+		   nbytes_from_memory);
+#endif
+
 	return(0);
 }
 
@@ -915,7 +949,6 @@ create_fat(void)
     int fd;
     struct fat_arch fat_arch;
     struct fat_arch_64 fat_arch64;
-    uint64_t nbytes_to_write, nbytes_written;
 
 	/* fold in specified segment alignments */
 	for(i = 0; i < nsegaligns; i++){
@@ -1001,6 +1034,7 @@ create_fat(void)
 	       sizeof(struct fat_header))
 		system_fatal("can't write fat header to output file: %s",
 			     rename_file);
+	    nbytes_from_memory += sizeof(struct fat_header);
 #ifdef __LITTLE_ENDIAN__
 	    swap_fat_header(&fat_header, LITTLE_ENDIAN_BYTE_SEX);
 #endif /* __LITTLE_ENDIAN__ */
@@ -1027,6 +1061,7 @@ create_fat(void)
 		       sizeof(struct fat_arch_64))
 			system_fatal("can't write fat arch to output file: %s",
 				     rename_file);
+		    nbytes_from_memory += sizeof(struct fat_arch_64);
 		}
 		else{
 #ifdef __LITTLE_ENDIAN__
@@ -1036,25 +1071,17 @@ create_fat(void)
 		       sizeof(struct fat_arch))
 			system_fatal("can't write fat arch to output file: %s",
 				     rename_file);
+		    nbytes_from_memory += sizeof(struct fat_arch);
 		}
 	    }
 	}
 
 	for(i = 0; i < nthin_files; i++){
 	    if(extract_family_flag == FALSE || nthin_files > 1)
-		if(lseek(fd, thin_files[i].offset, L_SET) == -1)
-		    system_fatal("can't lseek in output file: %s", rename_file);
-	    nbytes_written = 0;
-	    do{
-		if(thin_files[i].size - nbytes_written > MAX_WRITE)
-		    nbytes_to_write = MAX_WRITE;
-		else
-		    nbytes_to_write = thin_files[i].size - nbytes_written;
-		if(write(fd, thin_files[i].addr + nbytes_written,
-			 nbytes_to_write) != nbytes_to_write)
-		    system_fatal("can't write to output file: %s", rename_file);
-		nbytes_written += nbytes_to_write;
-	    }while(nbytes_written != thin_files[i].size);
+		copy_thin_file(thin_files + i, fd, thin_files[i].offset,
+			       rename_file);
+	    else
+		copy_thin_file(thin_files + i, fd, 0, rename_file);
 	}
 	if(close(fd) == -1)
 	    system_fatal("can't close output file: %s", rename_file);
@@ -1064,6 +1091,65 @@ create_fat(void)
 	free(rename_file);
 }
 
+/*
+ * copy_thin_file() writes the contents of the thin file to the output file
+ * open on fd at offset.  Where it can it is copied from the file it is in
+ * (see the comment before COPY_FILE_RANGE), and otherwise it is written from
+ * addr.
+ */
+static
+void
+copy_thin_file(
+struct thin_file *thin,
+int fd,
+uint64_t offset,
+char *output)
+{
+    uint64_t ncopied, nbytes_to_write;
+#ifdef COPY_FILE_RANGE
+    ssize_t n;
+    off_t in_offset, out_offset;
+#endif
+
+#define MAX_WRITE 0x10000000
+	ncopied = 0;
+#ifdef COPY_FILE_RANGE
+	/*
+	 * If copy_file_range(2) fails, say because the files are on different
+	 * file systems with an older kernel, the rest is written from memory
+	 * which reports any error that is not just that.
+	 */
+	if(thin->fd != -1){
+	    while(ncopied != thin->size){
+		if(thin->size - ncopied > MAX_WRITE)
+		    nbytes_to_write = MAX_WRITE;
+		else
+		    nbytes_to_write = thin->size - ncopied;
+		in_offset = thin->file_offset + ncopied;
+		out_offset = offset + ncopied;
+		n = copy_file_range(thin->fd, &in_offset, fd, &out_offset,
+				    nbytes_to_write, 0);
+		if(n <= 0)
+		    break;
+		ncopied += n;
+	    }
+	    nbytes_kernel_copied += ncopied;
+	}
+#endif /* COPY_FILE_RANGE */
+
+	nbytes_from_memory += thin->size - ncopied;
+	while(ncopied != thin->size){
+	    if(thin->size - ncopied > MAX_WRITE)
+		nbytes_to_write = MAX_WRITE;
+	    else
+		nbytes_to_write = thin->size - ncopied;
+	    if(pwrite(fd, thin->addr + ncopied, nbytes_to_write,
+		      offset + ncopied) != (ssize_t)nbytes_to_write)
+		system_fatal("can't write to output file: %s", output);
+	    ncopied += nbytes_to_write;
+	}
+}
+
 /*
  * process_input_file() checks input file and breaks it down into thin files
  * for later operations.
@@ -1136,7 +1222,12 @@ struct input_file *input)
 	   stat_buf2.st_mtime != stat_buf.st_mtime)
 	    system_fatal("Input file: %s changed since opened", input->name);
 
+#ifdef COPY_FILE_RANGE
+	/* the file is left open for copy_thin_file() to copy its contents */
+#else
 	close(fd);
+	fd = -1;
+#endif /* COPY_FILE_RANGE */
 
 	/* Try to figure out what kind of file this is */
 
@@ -1213,6 +1304,8 @@ struct input_file *input)
 		thin = new_thin();
 		thin->name = input->name;
 		thin->addr = addr + input->fat_arches[i].offset;
+		thin->fd = fd;
+		thin->file_offset = input->fat_arches[i].offset;
 		thin->cputype = input->fat_arches[i].cputype;
 		thin->cpusubtype = input->fat_arches[i].cpusubtype;
 		thin->offset = input->fat_arches[i].offset;
@@ -1300,6 +1393,8 @@ struct input_file *input)
 		thin = new_thin();
 		thin->name = input->name;
 		thin->addr = addr + input->fat_arches64[i].offset;
+		thin->fd = fd;
+		thin->file_offset = input->fat_arches64[i].offset;
 		thin->cputype = input->fat_arches64[i].cputype;
 		thin->cpusubtype = input->fat_arches64[i].cpusubtype;
 		thin->offset = input->fat_arches64[i].offset;
@@ -1321,6 +1416,7 @@ struct input_file *input)
 	    input->is_thin = TRUE;
 	    thin->name = input->name;
 	    thin->addr = addr;
+	    thin->fd = fd;
 	    mhp = (struct mach_header *)addr;
 	    lcp = (struct load_command *)((char *)mhp +
 					  sizeof(struct mach_header));
@@ -1356,6 +1452,7 @@ struct input_file *input)
 	    input->is_thin = TRUE;
 	    thin->name = input->name;
 	    thin->addr = addr;
+	    thin->fd = fd;
 	    mhp64 = (struct mach_header_64 *)addr;
 	    lcp = (struct load_command *)((char *)mhp64 +
 					  sizeof(struct mach_header_64));
@@ -1392,6 +1489,7 @@ struct input_file *input)
 	    input->is_thin = TRUE;
 	    thin->name = input->name;
 	    thin->addr = addr;
+	    thin->fd = fd;
 	    if(fat64_flag == FALSE && size > UINT32_MAX)
 		fatal("file too large to be in a fat file because the size "
 		      "field in struct fat_arch is only 32-bits and the size "
@@ -1428,6 +1526,7 @@ struct input_file *input)
 		thin = new_thin();
 		thin->name = input->name;
 		thin->addr = addr;
+		thin->fd = fd;
 		if(fat64_flag == FALSE && size > UINT32_MAX)
 		    fatal("file too large to be in a fat file because the size "
 			  "field in struct fat_arch is only 32-bits and the "
@@ -1446,6 +1545,7 @@ struct input_file *input)
 		    thin = new_thin();
 		    thin->name = input->name;
 		    thin->addr = addr;
+		    thin->fd = fd;
 		    if(fat64_flag == FALSE && size > UINT32_MAX)
 			fatal("file too large to be in a fat file because the "
 			      "size field in struct fat_arch is only 32-bits "
@@ -1505,7 +1605,12 @@ struct replace *replace)
 	if((intptr_t)addr == -1)
 	    system_error("can't map replacement file: %s",
 			 replace->thin_file.name);
+#ifdef COPY_FILE_RANGE
+	/* the file is left open for copy_thin_file() to copy its contents */
+#else
 	close(fd);
+	fd = -1;
+#endif /* COPY_FILE_RANGE */
 
 	/* Try to figure out what kind of file this is */
 
@@ -1531,6 +1636,7 @@ struct replace *replace)
 
 	    /* this is a Mach-O file so fill in the thin file struct for it */
 	    replace->thin_file.addr = addr;
+	    replace->thin_file.fd = fd;
 	    mhp = (struct mach_header *)addr;
 	    lcp = (struct load_command *)((char *)mhp +
 					  sizeof(struct mach_header));
@@ -1561,6 +1667,7 @@ struct replace *replace)
 
 	    /* this is a Mach-O file so fill in the thin file struct for it */
 	    replace->thin_file.addr = addr;
+	    replace->thin_file.fd = fd;
 	    mhp64 = (struct mach_header_64 *)addr;
 	    lcp = (struct load_command *)((char *)mhp64 +
 					  sizeof(struct mach_header_64));
@@ -1597,6 +1704,7 @@ struct replace *replace)
 		      replace->thin_file.name);
 	    /* fill in the thin file struct for this archive */
 	    replace->thin_file.addr = addr;
+	    replace->thin_file.fd = fd;
 	    replace->thin_file.cputype = cputype;
 	    replace->thin_file.cpusubtype = cpusubtype;
 	    replace->thin_file.offset = 0;
@@ -1611,6 +1719,7 @@ struct replace *replace)
 		      replace->thin_file.name);
 	    /* fill in the thin file struct for it */
 	    replace->thin_file.addr = addr;
+	    replace->thin_file.fd = fd;
 	    replace->thin_file.cputype = replace->arch_flag.cputype;
 	    replace->thin_file.cpusubtype = replace->arch_flag.cpusubtype;
 	    replace->thin_file.offset = 0;
@@ -2676,6 +2785,7 @@ new_thin(void)
 	thin = thin_files + nthin_files;
 	nthin_files++;
 	memset(thin, '\0', sizeof(struct thin_file));
+	thin->fd = -1;
 	return(thin);
 }
 
@@ -2877,5 +2987,5 @@ usage(void)
 	      "[-remove <arch_type>] ... [-extract <arch_type>] ... "
 	      "[-extract_family <arch_type>] ... "
 	      "[-verify_arch <arch_type> ...] "
-	      "[-replace <arch_type> <file_name>] ...", progname);
+	      "[-replace <arch_type> <file_name>] ... [-verbose]", progname);
 }
@@ -96,6 +96,10 @@
 #include "stuff/errors.h"
 #include "stuff/allocate.h"
 #include "stuff/guess_short_name.h"
+#include "stuff/sort_names.h"
+#include "stuff/outbuf.h"
+#include "stuff/symbol_export.h"
+#include "stuff/arch.h"
 #ifdef LTO_SUPPORT
 #include "stuff/lto.h"
 #include <xar/xar.h>
@@ -132,6 +136,8 @@ struct cmd_flags {
     enum bool A;	/* pathname or library name of an object on each line */
     enum bool P;	/* portable output format */
     char *format;	/* the -t format */
+    enum bool E;	/* export the symbols in a format for programs */
+    enum symbol_export_format export_format; /*  the -E format */
 #ifdef LTO_SUPPORT
     enum bool L;	/* print the symbols from (__LLVM,__bundle) section */
 #endif /* LTO_SUPPORT */
@@ -203,10 +209,12 @@ static struct symbol *select_symbols(
     uint32_t *nsymbols);
 static void make_symbol_32(
     struct symbol *symbol,
-    struct nlist *nl);
+    struct nlist *nl,
+    enum bool swapped);
 static void make_symbol_64(
     struct symbol *symbol,
-    struct nlist_64 *nl);
+    struct nlist_64 *nl,
+    enum bool swapped);
 static enum bool select_symbol(
     struct symbol *symbol,
     struct cmd_flags *cmd_flags,
@@ -232,6 +240,14 @@ static void print_symbols(
     struct value_diff *value_diffs);
 static char * stab(
     unsigned char n_type);
+static void export_symbols(
+    struct ofile *ofile,
+    struct symbol *symbols,
+    uint32_t nsymbols);
+static void sort_symbols(
+    struct symbol *symbols,
+    uint32_t nsymbols,
+    struct cmd_flags *cmd_flags);
 static int compare(
     struct symbol *p1,
     struct symbol *p2);
@@ -254,9 +270,10 @@ char **envp)
     struct arch_flag *arch_flags;
     uint32_t narch_flags;
     enum bool all_archs;
-    char **files;
+    char **files, *endp;
 
 	progname = argv[0];
+	ofile_map_read_only = TRUE;
 
 	arch_flags = NULL;
 	narch_flags = 0;
@@ -316,6 +333,36 @@ char **envp)
 		    }
 		    i++;
 		}
+		else if(strcmp(argv[i], "-J") == 0){
+		    if(i + 1 == argc){
+			error("missing argument to %s option", argv[i]);
+			usage();
+		    }
+		    ofile_process_njobs = strtoul(argv[i+1], &endp, 10);
+		    if(*endp != '\0' || ofile_process_njobs == 0){
+			error("argument to %s option: %s is not a positive "
+			      "number", argv[i], argv[i+1]);
+			usage();
+		    }
+#ifdef LTO_SUPPORT
+		    lto_prefetch_njobs = ofile_process_njobs;
+#endif /* LTO_SUPPORT */
+		    i++;
+		}
+		else if(strcmp(argv[i], "-E") == 0){
+		    if(i + 1 == argc){
+			error("missing argument to %s option", argv[i]);
+			usage();
+		    }
+		    if(get_symbol_export_format(argv[i+1],
+					&cmd_flags.export_format) == FALSE){
+			error("invalid argument to option: %s %s",
+			      argv[i], argv[i+1]);
+			usage();
+		    }
+		    cmd_flags.E = TRUE;
+		    i++;
+		}
 		else if(strcmp(argv[i], "-t") == 0){
 		    if(i + 1 == argc){
 			error("missing argument to %s option", argv[i]);
@@ -459,6 +506,14 @@ char **envp)
 	    }
 	    files[cmd_flags.nfiles++] = argv[i];
 	}
+	if(cmd_flags.E == TRUE){
+	    if(cmd_flags.x == TRUE || cmd_flags.m == TRUE ||
+	       cmd_flags.P == TRUE){
+		error("can't specify -E with -x, -m or -P");
+		usage();
+	    }
+	    symbol_export_start(cmd_flags.export_format);
+	}
 
 	for(j = 0; j < cmd_flags.nfiles; j++)
 	    ofile_process(files[j], arch_flags, narch_flags, all_archs, TRUE,
@@ -486,7 +541,9 @@ void)
 		"L"
 #endif /* LTO_SUPPORT */
 		"[s segname sectname] [-] "
-		"[-t format] [[-arch <arch_flag>] ...] [file ...]\n", progname);
+		"[-t format] [-E json|binary] [[-arch <arch_flag>] ...] "
+		"[-J jobs] [file ...]\n",
+		progname);
 	exit(EXIT_FAILURE);
 }
 
@@ -808,8 +865,7 @@ void *cookie)
 
 	/* sort the symbols if needed */
 	if(cmd_flags->p == FALSE && cmd_flags->b == FALSE)
-	    qsort(symbols, nsymbols, sizeof(struct symbol),
-		  (int (*)(const void *, const void *))compare);
+	    sort_symbols(symbols, nsymbols, cmd_flags);
 
 	value_diffs = NULL;
 	if(cmd_flags->v == TRUE && cmd_flags->n == TRUE &&
@@ -832,7 +888,9 @@ void *cookie)
 	}
 
 	/* now print the symbols as specified by the flags */
-	if(cmd_flags->m == TRUE)
+	if(cmd_flags->E == TRUE)
+	    export_symbols(ofile, symbols, nsymbols);
+	else if(cmd_flags->m == TRUE)
 	    print_mach_symbols(ofile, symbols, nsymbols, strings, st->strsize,
 			       cmd_flags, &process_flags, arch_name);
 	else
@@ -938,11 +996,12 @@ struct cmd_flags *cmd_flags)
 
 	/* sort the symbols if needed */
 	if(cmd_flags->p == FALSE)
-	    qsort(symbols, nsymbols, sizeof(struct symbol),
-		  (int (*)(const void *, const void *))compare);
+	    sort_symbols(symbols, nsymbols, cmd_flags);
 
 	/* now print the symbols as specified by the flags */
-	if(cmd_flags->m == TRUE)
+	if(cmd_flags->E == TRUE)
+	    export_symbols(ofile, symbols, nsymbols);
+	else if(cmd_flags->m == TRUE)
 	    print_mach_symbols(ofile, symbols, nsymbols, NULL, 0,
 			       cmd_flags, &process_flags, arch_name);
 	else
@@ -1253,6 +1312,8 @@ struct ofile *ofile,
 char *arch_name,
 struct cmd_flags *cmd_flags)
 {
+	if(cmd_flags->E == TRUE)
+	    return;
 	if((ofile->member_ar_hdr != NULL ||
 	    ofile->dylib_module_name != NULL ||
 	    ofile->xar_member_name != NULL ||
@@ -1299,8 +1360,8 @@ uint32_t *nsymbols)
     struct symbol *selected_symbols, symbol;
     struct dylib_module m;
     struct dylib_module_64 m64;
-    struct dylib_reference *refs;
-    enum bool found;
+    struct dylib_reference *refs, ref;
+    enum bool found, swapped;
     uint32_t irefsym, nrefsym, nextdefsym, iextdefsym, nlocalsym, ilocalsym;
 
 	if(ofile->mh != NULL){
@@ -1314,12 +1375,12 @@ uint32_t *nsymbols)
 	selected_symbols = allocate(sizeof(struct symbol) * st->nsyms);
 	*nsymbols = 0;
 
-	if(ofile->object_byte_sex != get_host_byte_sex()){
-	    if(ofile->mh != NULL)
-		swap_nlist(all_symbols, st->nsyms, get_host_byte_sex());
-	    else
-		swap_nlist_64(all_symbols64, st->nsyms, get_host_byte_sex());
-	}
+	/*
+	 * The symbols are swapped one at a time as they are copied by
+	 * make_symbol_32() and make_symbol_64() rather than in place, so the
+	 * file's pages are not written.
+	 */
+	swapped = (enum bool)(ofile->object_byte_sex != get_host_byte_sex());
 
 	if(ofile->dylib_module != NULL){
 	    if(ofile->mh != NULL){
@@ -1346,22 +1407,21 @@ uint32_t *nsymbols)
 	    }
 	    refs = (struct dylib_reference *)(ofile->object_addr +
 					      dyst->extrefsymoff);
-	    if(ofile->object_byte_sex != get_host_byte_sex()){
-		swap_dylib_reference(refs + irefsym, nrefsym,
-				     get_host_byte_sex());
-	    }
 	    for(i = 0; i < nrefsym; i++){
-		flags = refs[i + irefsym].flags;
+		ref = refs[i + irefsym];
+		if(swapped)
+		    swap_dylib_reference(&ref, 1, get_host_byte_sex());
+		flags = ref.flags;
 		if(flags == REFERENCE_FLAG_UNDEFINED_NON_LAZY ||
 		   flags == REFERENCE_FLAG_UNDEFINED_LAZY ||
 		   flags == REFERENCE_FLAG_PRIVATE_UNDEFINED_NON_LAZY ||
 		   flags == REFERENCE_FLAG_PRIVATE_UNDEFINED_LAZY){
 		    if(ofile->mh != NULL)
 			make_symbol_32(&symbol,
-				      all_symbols + refs[i + irefsym].isym);
+				      all_symbols + ref.isym, swapped);
 		    else
 			make_symbol_64(&symbol,
-				      all_symbols64 + refs[i + irefsym].isym);
+				      all_symbols64 + ref.isym, swapped);
 		    if(flags == REFERENCE_FLAG_UNDEFINED_NON_LAZY ||
 		       flags == REFERENCE_FLAG_UNDEFINED_LAZY ||
 		       cmd_flags->m == TRUE)
@@ -1377,17 +1437,21 @@ uint32_t *nsymbols)
 	    }
 	    for(i = 0; i < nextdefsym && iextdefsym + i < st->nsyms; i++){
 		if(ofile->mh != NULL)
-		    make_symbol_32(&symbol, all_symbols + iextdefsym + i);
+		    make_symbol_32(&symbol, all_symbols + iextdefsym + i,
+				   swapped);
 		else
-		    make_symbol_64(&symbol, all_symbols64 + iextdefsym + i);
+		    make_symbol_64(&symbol, all_symbols64 + iextdefsym + i,
+				   swapped);
 		if(select_symbol(&symbol, cmd_flags, process_flags))
 		    selected_symbols[(*nsymbols)++] = symbol;
 	    }
 	    for(i = 0; i < nlocalsym && ilocalsym + i < st->nsyms; i++){
 		if(ofile->mh != NULL)
-		    make_symbol_32(&symbol, all_symbols + ilocalsym + i);
+		    make_symbol_32(&symbol, all_symbols + ilocalsym + i,
+				   swapped);
 		else
-		    make_symbol_64(&symbol, all_symbols64 + ilocalsym + i);
+		    make_symbol_64(&symbol, all_symbols64 + ilocalsym + i,
+				   swapped);
 		if(select_symbol(&symbol, cmd_flags, process_flags))
 		    selected_symbols[(*nsymbols)++] = symbol;
 	    }
@@ -1401,9 +1465,9 @@ uint32_t *nsymbols)
 		i = 0;
 	    for( ; i < st->nsyms; i++){
 		if(ofile->mh != NULL)
-		    make_symbol_32(&symbol, all_symbols + i);
+		    make_symbol_32(&symbol, all_symbols + i, swapped);
 		else
-		    make_symbol_64(&symbol, all_symbols64 + i);
+		    make_symbol_64(&symbol, all_symbols64 + i, swapped);
 		if(symbol.nl.n_type == N_BINCL &&
 		   symbol.nl.n_un.n_strx != 0 &&
 		   (uint32_t)symbol.nl.n_un.n_strx < st->strsize &&
@@ -1414,9 +1478,9 @@ uint32_t *nsymbols)
 		    nest = 0;
 		    for(i = i + 1 ; i < st->nsyms; i++){
 			if(ofile->mh != NULL)
-			    make_symbol_32(&symbol, all_symbols + i);
+			    make_symbol_32(&symbol, all_symbols + i, swapped);
 			else
-			    make_symbol_64(&symbol, all_symbols64 + i);
+			    make_symbol_64(&symbol, all_symbols64 + i, swapped);
 			if(symbol.nl.n_type == N_BINCL)
 			    nest++;
 			else if(symbol.nl.n_type == N_EINCL){
@@ -1437,19 +1501,13 @@ uint32_t *nsymbols)
 	else{
 	    for(i = 0; i < st->nsyms; i++){
 		if(ofile->mh != NULL)
-		    make_symbol_32(&symbol, all_symbols + i);
+		    make_symbol_32(&symbol, all_symbols + i, swapped);
 		else
-		    make_symbol_64(&symbol, all_symbols64 + i);
+		    make_symbol_64(&symbol, all_symbols64 + i, swapped);
 		if(select_symbol(&symbol, cmd_flags, process_flags))
 		    selected_symbols[(*nsymbols)++] = symbol;
 	    }
 	}
-	if(ofile->object_byte_sex != get_host_byte_sex()){
-	    if(ofile->mh != NULL)
-		swap_nlist(all_symbols, st->nsyms, ofile->object_byte_sex);
-	    else
-		swap_nlist_64(all_symbols64, st->nsyms, ofile->object_byte_sex);
-	}
 	/*
 	 * Could reallocate selected symbols to the exact size but it is more
 	 * of a time waste than a memory savings.
@@ -1461,22 +1519,31 @@ static
 void
 make_symbol_32(
 struct symbol *symbol,
-struct nlist *nl)
+struct nlist *nl,
+enum bool swapped)
 {
-	symbol->nl.n_un.n_strx = nl->n_un.n_strx;
-	symbol->nl.n_type = nl->n_type;
-	symbol->nl.n_sect = nl->n_sect;
-	symbol->nl.n_desc = nl->n_desc;
-	symbol->nl.n_value = nl->n_value;
+    struct nlist n;
+
+	n = *nl;
+	if(swapped)
+	    swap_nlist(&n, 1, get_host_byte_sex());
+	symbol->nl.n_un.n_strx = n.n_un.n_strx;
+	symbol->nl.n_type = n.n_type;
+	symbol->nl.n_sect = n.n_sect;
+	symbol->nl.n_desc = n.n_desc;
+	symbol->nl.n_value = n.n_value;
 }
 
 static
 void
 make_symbol_64(
 struct symbol *symbol,
-struct nlist_64 *nl)
+struct nlist_64 *nl,
+enum bool swapped)
 {
 	symbol->nl = *nl;
+	if(swapped)
+	    swap_nlist_64(&symbol->nl, 1, get_host_byte_sex());
 }
 
 /*
@@ -1799,7 +1866,8 @@ char *arch_name)
 
 /*
  * print_symbols() is called with the -m flag is not specified and prints
- * symbols in the standard BSD format.
+ * symbols in the standard BSD format.  As it prints a line for each symbol it
+ * uses the outbuf routines rather than printf(3) for each field.
  */
 static
 void
@@ -1814,87 +1882,88 @@ struct process_flags *process_flags,
 char *arch_name,
 struct value_diff *value_diffs)
 {
-    uint32_t i;
+    uint32_t i, width;
     unsigned char c;
-    char *ta_xfmt, *i_xfmt, *spaces, *dashes;
+    char *spaces, *dashes;
     const char *p;
 
 	if(ofile->mh != NULL ||
 	   (ofile->lto != NULL &&
 	    (ofile->lto_cputype & CPU_ARCH_ABI64) != CPU_ARCH_ABI64)){
-	    ta_xfmt = "%08llx";
-	    i_xfmt =  "%08x";
+	    width = 8;
 	    spaces = "        ";
 	    dashes = "--------";
 	}
 	else{
-	    ta_xfmt = "%016llx";
-	    i_xfmt =  "%016x";
+	    width = 16;
 	    spaces = "                ";
 	    dashes = "----------------";
 	}
 
 	for(i = 0; i < nsymbols; i++){
 	    if(cmd_flags->x == TRUE){
-		printf(ta_xfmt, symbols[i].nl.n_value);
-		printf(" %02x %02x %04x ",
-		       (unsigned int)(symbols[i].nl.n_type & 0xff),
-		       (unsigned int)(symbols[i].nl.n_sect & 0xff),
-		       (unsigned int)(symbols[i].nl.n_desc & 0xffff));
+		outbuf_hex(symbols[i].nl.n_value, width);
+		outbuf_char(' ');
+		outbuf_hex(symbols[i].nl.n_type & 0xff, 2);
+		outbuf_char(' ');
+		outbuf_hex(symbols[i].nl.n_sect & 0xff, 2);
+		outbuf_char(' ');
+		outbuf_hex(symbols[i].nl.n_desc & 0xffff, 4);
+		outbuf_char(' ');
 		if(symbols[i].nl.n_un.n_strx == 0){
-		    printf(i_xfmt, symbols[i].nl.n_un.n_strx);
-		    if(ofile->lto != NULL)
-			printf(" %s", symbols[i].name);
+		    outbuf_hex((uint32_t)symbols[i].nl.n_un.n_strx, width);
+		    if(ofile->lto != NULL){
+			outbuf_char(' ');
+			outbuf_str(symbols[i].name);
+		    }
 		    else
-			printf(" (null)");
+			outbuf_str(" (null)");
 		}
 		else if((uint32_t)symbols[i].nl.n_un.n_strx > strsize){
-		    printf("%08x", symbols[i].nl.n_un.n_strx);
-		    printf(" (bad string index)");
+		    outbuf_hex((uint32_t)symbols[i].nl.n_un.n_strx, 8);
+		    outbuf_str(" (bad string index)");
 		}
 		else{
-		    printf("%08x", symbols[i].nl.n_un.n_strx);
-		    printf(" %s", symbols[i].nl.n_un.n_strx + strings);
+		    outbuf_hex((uint32_t)symbols[i].nl.n_un.n_strx, 8);
+		    outbuf_char(' ');
+		    outbuf_str(symbols[i].nl.n_un.n_strx + strings);
 		}
 		if((symbols[i].nl.n_type & N_STAB) == 0 &&
 		   (symbols[i].nl.n_type & N_TYPE) == N_INDR){
-		    if(symbols[i].nl.n_value == 0){
-			printf(" (indirect for ");
-			printf(ta_xfmt, symbols[i].nl.n_value);
-			printf(" (null))\n");
-		    }
-		    else if(symbols[i].nl.n_value > strsize){
-			printf(" (indirect for ");
-			printf(ta_xfmt, symbols[i].nl.n_value);
-			printf(" (bad string index))\n");
-		    }
+		    outbuf_str(" (indirect for ");
+		    outbuf_hex(symbols[i].nl.n_value, width);
+		    if(symbols[i].nl.n_value == 0)
+			outbuf_str(" (null))\n");
+		    else if(symbols[i].nl.n_value > strsize)
+			outbuf_str(" (bad string index))\n");
 		    else{
-			printf(" (indirect for ");
-			printf(ta_xfmt, symbols[i].nl.n_value);
-			printf(" %s)\n", symbols[i].nl.n_value + strings);
+			outbuf_char(' ');
+			outbuf_str(symbols[i].nl.n_value + strings);
+			outbuf_str(")\n");
 		    }
 		}
 		else
-		    printf("\n");
+		    outbuf_char('\n');
 		continue;
 	    }
 	    if(cmd_flags->P == TRUE){
 		if(cmd_flags->A == TRUE){
 		    if(arch_name != NULL)
-			printf("(for architecture %s): ", arch_name);
+			outbuf_printf("(for architecture %s): ", arch_name);
 		    if(ofile->dylib_module_name != NULL){
-			printf("%s[%s]: ", ofile->file_name,
-			       ofile->dylib_module_name);
+			outbuf_printf("%s[%s]: ", ofile->file_name,
+				      ofile->dylib_module_name);
 		    }
 		    else if(ofile->member_ar_hdr != NULL){
-			printf("%s[%.*s]: ", ofile->file_name,
-			       (int)ofile->member_name_size,
-			       ofile->member_name);
+			outbuf_printf("%s[%.*s]: ", ofile->file_name,
+				      (int)ofile->member_name_size,
+				      ofile->member_name);
 		    }
 		    else
-			printf("%s: ", ofile->file_name);
+			outbuf_printf("%s: ", ofile->file_name);
 		}
-		printf("%s ", symbols[i].name);
+		outbuf_str(symbols[i].name);
+		outbuf_char(' ');
 
 		/* type */
 		c = symbols[i].nl.n_type;
@@ -1936,36 +2005,37 @@ struct value_diff *value_diffs)
 		}
 		if((symbols[i].nl.n_type & N_EXT) && c != '?')
 		    c = toupper(c);
-		printf("%c ", c);
-		printf(cmd_flags->format, symbols[i].nl.n_value);
-		printf(" 0\n"); /* the 0 is the size for conformance */
+		outbuf_char(c);
+		outbuf_char(' ');
+		outbuf_printf(cmd_flags->format, symbols[i].nl.n_value);
+		outbuf_str(" 0\n"); /* the 0 is the size for conformance */
 		continue;
 	    }
 	    c = symbols[i].nl.n_type;
 	    if(c & N_STAB){
 		if(cmd_flags->o == TRUE || cmd_flags->A == TRUE){
 		    if(arch_name != NULL)
-			printf("(for architecture %s):", arch_name);
+			outbuf_printf("(for architecture %s):", arch_name);
 		    if(ofile->dylib_module_name != NULL){
-			printf("%s:%s: ", ofile->file_name,
-			       ofile->dylib_module_name);
+			outbuf_printf("%s:%s: ", ofile->file_name,
+				      ofile->dylib_module_name);
 		    }
 		    else if(ofile->member_ar_hdr != NULL){
-			printf("%s:%.*s: ", ofile->file_name,
-			       (int)ofile->member_name_size,
-			       ofile->member_name);
+			outbuf_printf("%s:%.*s: ", ofile->file_name,
+				      (int)ofile->member_name_size,
+				      ofile->member_name);
 		    }
 		    else
-			printf("%s: ", ofile->file_name);
+			outbuf_printf("%s: ", ofile->file_name);
 		}
-		printf(ta_xfmt, symbols[i].nl.n_value);
-		printf(" - %02x %04x %5.5s ",
-		       (unsigned int)symbols[i].nl.n_sect & 0xff,
-		       (unsigned int)symbols[i].nl.n_desc & 0xffff,
-		       stab(symbols[i].nl.n_type));
+		outbuf_hex(symbols[i].nl.n_value, width);
+		outbuf_printf(" - %02x %04x %5.5s ",
+			      (unsigned int)symbols[i].nl.n_sect & 0xff,
+			      (unsigned int)symbols[i].nl.n_desc & 0xffff,
+			      stab(symbols[i].nl.n_type));
 		if(cmd_flags->b == TRUE){
 		    for(p = symbols[i].name; *p != '\0'; p++){
-			printf("%c", *p);
+			outbuf_char(*p);
 			if(*p == '('){
 			    p++;
 			    while(isdigit((unsigned char)*p))
@@ -1980,10 +2050,11 @@ struct value_diff *value_diffs)
 			    p--;
 			}
 		    }
-		    printf("\n");
+		    outbuf_char('\n');
 		}
 		else{
-		    printf("%s\n", symbols[i].name);
+		    outbuf_str(symbols[i].name);
+		    outbuf_char('\n');
 		}
 		continue;
 	    }
@@ -2020,43 +2091,93 @@ struct value_diff *value_diffs)
 		continue;
 	    if(cmd_flags->o == TRUE || cmd_flags->A == TRUE){
 		if(arch_name != NULL)
-		    printf("(for architecture %s):", arch_name);
+		    outbuf_printf("(for architecture %s):", arch_name);
 		if(ofile->dylib_module_name != NULL){
-		    printf("%s:%s: ", ofile->file_name,
-			   ofile->dylib_module_name);
+		    outbuf_printf("%s:%s: ", ofile->file_name,
+				  ofile->dylib_module_name);
 		}
 		else if(ofile->member_ar_hdr != NULL){
-		    printf("%s:%.*s: ", ofile->file_name,
-			   (int)ofile->member_name_size,
-			   ofile->member_name);
+		    outbuf_printf("%s:%.*s: ", ofile->file_name,
+				  (int)ofile->member_name_size,
+				  ofile->member_name);
 		}
 		else
-		    printf("%s: ", ofile->file_name);
+		    outbuf_printf("%s: ", ofile->file_name);
 	    }
 	    if((symbols[i].nl.n_type & N_EXT) && c != '?')
 		c = toupper(c);
 	    if(cmd_flags->u == FALSE && cmd_flags->j == FALSE){
 		if(c == 'u' || c == 'U' || c == 'i' || c == 'I')
-		    printf("%s", spaces);
+		    outbuf_str(spaces);
 		else{
 		    if(cmd_flags->v && value_diffs != NULL){
-			printf(ta_xfmt, value_diffs[i].size);
-			printf(" ");
+			outbuf_hex(value_diffs[i].size, width);
+			outbuf_char(' ');
 		    }
 		    if(ofile->lto)
-			printf("%s", dashes);
+			outbuf_str(dashes);
 		    else
-			printf(ta_xfmt, symbols[i].nl.n_value);
+			outbuf_hex(symbols[i].nl.n_value, width);
 		}
-		printf(" %c ", c);
+		outbuf_char(' ');
+		outbuf_char(c);
+		outbuf_char(' ');
 	    }
+	    outbuf_str(symbols[i].name);
 	    if(cmd_flags->j == FALSE &&
-	       (symbols[i].nl.n_type & N_TYPE) == N_INDR)
-		printf("%s (indirect for %s)\n", symbols[i].name,
-		       symbols[i].indr_name);
-	    else 
-		printf("%s\n", symbols[i].name);
+	       (symbols[i].nl.n_type & N_TYPE) == N_INDR){
+		outbuf_str(" (indirect for ");
+		outbuf_str(symbols[i].indr_name);
+		outbuf_char(')');
+	    }
+	    outbuf_char('\n');
 	}
+	outbuf_flush();
+}
+
+/*
+ * export_symbols() is called with the -E flag and writes the selected symbols
+ * with the symbol export routines rather than printing them.  The arch is
+ * always included, not just for universal files as in printed output.
+ */
+static
+void
+export_symbols(
+struct ofile *ofile,
+struct symbol *symbols,
+uint32_t nsymbols)
+{
+    uint32_t i;
+    const char *member, *arch_name;
+    uint32_t member_size;
+
+	if(ofile->dylib_module_name != NULL){
+	    member = ofile->dylib_module_name;
+	    member_size = strlen(member);
+	}
+	else if(ofile->member_ar_hdr != NULL){
+	    member = ofile->member_name;
+	    member_size = ofile->member_name_size;
+	}
+	else if(ofile->xar_member_name != NULL){
+	    member = ofile->xar_member_name;
+	    member_size = strlen(member);
+	}
+	else{
+	    member = NULL;
+	    member_size = 0;
+	}
+	if(ofile->lto != NULL)
+	    arch_name = get_arch_name_from_types(ofile->lto_cputype,
+						 ofile->lto_cpusubtype);
+	else
+	    arch_name = get_arch_name_from_types(ofile->mh_cputype,
+						 ofile->mh_cpusubtype);
+
+	symbol_export_begin(ofile->file_name, member, member_size, arch_name);
+	for(i = 0; i < nsymbols; i++)
+	    symbol_export_symbol(symbols[i].name, &symbols[i].nl);
+	symbol_export_end();
 }
 
 struct stabnames {
@@ -2116,6 +2237,39 @@ unsigned char n_type)
 	return(prbuf);
 }
 
+/*
+ * sort_symbols() sorts the symbols in the order set by the flags.  When they
+ * are sorted by just their names, which is the default, sort_names() is used
+ * as it is much faster than qsort() with strcmp() on large symbol tables, and
+ * for -r the sorted symbols are then reversed.  Otherwise qsort() is used with
+ * compare().
+ */
+static
+void
+sort_symbols(
+struct symbol *symbols,
+uint32_t nsymbols,
+struct cmd_flags *cmd_flags)
+{
+    uint32_t i;
+    struct symbol symbol;
+
+	if(cmd_flags->n == TRUE ||
+	   (cmd_flags->x == TRUE && compare_lto == FALSE)){
+	    qsort(symbols, nsymbols, sizeof(struct symbol),
+		  (int (*)(const void *, const void *))compare);
+	    return;
+	}
+	sort_names(symbols, nsymbols, sizeof(struct symbol));
+	if(cmd_flags->r == TRUE){
+	    for(i = 0; i < nsymbols / 2; i++){
+		symbol = symbols[i];
+		symbols[i] = symbols[nsymbols - 1 - i];
+		symbols[nsymbols - 1 - i] = symbol;
+	    }
+	}
+}
+
 /*
  * compare is the function used by qsort if any sorting of symbols is to be
  * done.
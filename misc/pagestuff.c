@@ -213,6 +213,7 @@ char *argv[])
     struct arch_flag a;
 
 	progname = argv[0];
+	ofile_map_read_only = TRUE;
 	if(argc < 3)
 	    usage();
 	start = 2;
@@ -520,8 +521,8 @@ struct file_part *fp)
     struct nlist_64 *allocated_symbols64, *symbols64;
     uint32_t ext_low, ext_high, local_low, local_high, n_strx, n_type;
     char *strings;
-    struct dylib_module *modtab;
-    struct dylib_module_64 *modtab64;
+    struct dylib_module *modtab, m;
+    struct dylib_module_64 *modtab64, m64;
     struct linkedit_data_command *split_info, *code_sig, *func_starts,
 			         *data_in_code, *code_sign_drs;
     struct linkedit_data_command *link_opt_hint;
@@ -891,27 +892,27 @@ struct file_part *fp)
 		if(ofile.mh != NULL){
 		    modtab = (struct dylib_module *)(ofile.object_addr +
 						     dyst->modtaboff);
-		    if(ofile.object_byte_sex != get_host_byte_sex())
-			swap_dylib_module(modtab, dyst->nmodtab,
-			       get_host_byte_sex());
 		    for(i = 0; i < dyst->nmodtab; i++){
-			if(modtab[i].module_name > local_high)
-			    local_high = modtab[i].module_name;
-			if(modtab[i].module_name < local_low)
-			    local_low = modtab[i].module_name;
+			m = modtab[i];
+			if(ofile.object_byte_sex != get_host_byte_sex())
+			    swap_dylib_module(&m, 1, get_host_byte_sex());
+			if(m.module_name > local_high)
+			    local_high = m.module_name;
+			if(m.module_name < local_low)
+			    local_low = m.module_name;
 		    }
 		}
 		else{
 		    modtab64 = (struct dylib_module_64 *)(ofile.object_addr +
 						          dyst->modtaboff);
-		    if(ofile.object_byte_sex != get_host_byte_sex())
-			swap_dylib_module_64(modtab64, dyst->nmodtab,
-			       get_host_byte_sex());
 		    for(i = 0; i < dyst->nmodtab; i++){
-			if(modtab64[i].module_name > local_high)
-			    local_high = modtab64[i].module_name;
-			if(modtab64[i].module_name < local_low)
-			    local_low = modtab64[i].module_name;
+			m64 = modtab64[i];
+			if(ofile.object_byte_sex != get_host_byte_sex())
+			    swap_dylib_module_64(&m64, 1, get_host_byte_sex());
+			if(m64.module_name > local_high)
+			    local_high = m64.module_name;
+			if(m64.module_name < local_low)
+			    local_low = m64.module_name;
 		    }
 		}
 
@@ -67,6 +67,9 @@
 #include "stuff/ofile.h"
 #include "stuff/errors.h"
 #include "stuff/allocate.h"
+#ifdef LTO_SUPPORT
+#include "stuff/lto.h"
+#endif /* LTO_SUPPORT */
 
 char *progname = NULL;
 
@@ -95,6 +98,7 @@ char **argv,
 char **envp)
 {
     int i;
+    char *endp;
     enum bool args_left;
     struct flags flag;
     struct arch_flag *arch_flags;
@@ -102,6 +106,7 @@ char **envp)
     enum bool all_archs;
 
 	progname = argv[0];
+	ofile_map_read_only = TRUE;
 	arch_flags = NULL;
 	narch_flags = 0;
 	all_archs = FALSE;
@@ -154,6 +159,23 @@ char **envp)
 		    i++;
 		    continue;
 		}
+		if(strcmp(argv[i], "-j") == 0){
+		    if(i + 1 == argc){
+			error("missing argument to %s option", argv[i]);
+			usage();
+		    }
+		    ofile_process_njobs = strtoul(argv[i+1], &endp, 10);
+		    if(*endp != '\0' || ofile_process_njobs == 0){
+			error("argument to %s option: %s is not a positive "
+			      "number", argv[i], argv[i+1]);
+			usage();
+		    }
+#ifdef LTO_SUPPORT
+		    lto_prefetch_njobs = ofile_process_njobs;
+#endif /* LTO_SUPPORT */
+		    i++;
+		    continue;
+		}
 	    }
 	    flag.nfiles++;
 	}
@@ -174,7 +196,8 @@ char **envp)
 		    continue;
 		if(strcmp(argv[i], "-x") == 0)
 		    continue;
-		if(strcmp(argv[i], "-arch") == 0){
+		if(strcmp(argv[i], "-arch") == 0 ||
+		   strcmp(argv[i], "-j") == 0){
 		    i++;
 		    continue;
 		}
@@ -200,7 +223,7 @@ usage(
 void)
 {
 	fprintf(stderr, "Usage: %s [-m] [-l] [-x] [--] "
-		"[[-arch <arch_flag>] ...] [file ...]\n", progname);
+		"[[-arch <arch_flag>] ...] [-j <jobs>] [file ...]\n", progname);
 	exit(EXIT_FAILURE);
 }
 
@@ -72,6 +72,7 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
 #include <limits.h>
 #include <sys/types.h>
@@ -80,9 +81,27 @@
 #include "stuff/ofile.h"
 #include "stuff/errors.h"
 #include "stuff/allocate.h"
+#ifdef LTO_SUPPORT
+#include "stuff/lto.h"
+#endif /* LTO_SUPPORT */
+#include "stuff/outbuf.h"
 
 char *progname = NULL;
 
+/*
+ * string_ends[] is TRUE for the bytes that end a string in the contents of an
+ * ofile, '\n' and those dirt() returns TRUE for as a signed char, which is how
+ * ofile_find() has always looked at them.  It is set in main().
+ */
+static char string_ends[256];
+
+/*
+ * For looking at 8 bytes at a time in string_end(), the value with each byte
+ * set to one and the value with the high bit of each byte set.
+ */
+#define STRING_ONES  0x0101010101010101ULL
+#define STRING_HIGHS 0x8080808080808080ULL
+
 struct flags {
     enum bool treat_as_data;
     enum bool print_offsets;
@@ -102,6 +121,10 @@ static void ofile_find(
     uint32_t size,
     uint32_t offset,
     struct flags *flags);
+static uint32_t string_end(
+    char *addr,
+    uint32_t i,
+    uint32_t size);
 static void find(
     uint32_t cnt,
     struct flags *flags);
@@ -140,6 +163,9 @@ char **envp)
 	flags.all_sections = FALSE;
 	flags.minimum_length = 4;
 
+	for(j = 0; j < 256; j++)
+	    string_ends[j] = j == '\n' || dirt((char)j);
+
 	rest_args_files = FALSE;
 	for(i = 1; i < argc; i++){
 	    if(rest_args_files == FALSE && argv[i][0] == '-'){
@@ -182,6 +208,22 @@ char **envp)
 		    }
 		    i++;
 		}
+		else if(strcmp(argv[i], "-j") == 0){
+		    if(i + 1 == argc){
+			error("missing argument to %s option", argv[i]);
+			usage();
+		    }
+		    ofile_process_njobs = strtoul(argv[i+1], &endp, 10);
+		    if(*endp != '\0' || ofile_process_njobs == 0){
+			error("argument to %s option: %s is not a positive "
+			      "number", argv[i], argv[i+1]);
+			usage();
+		    }
+#ifdef LTO_SUPPORT
+		    lto_prefetch_njobs = ofile_process_njobs;
+#endif /* LTO_SUPPORT */
+		    i++;
+		}
 		else if(strcmp(argv[i], "-t") == 0){
 		    if(i + 1 == argc){
 			error("missing argument to %s option", argv[i]);
@@ -272,6 +314,7 @@ char **envp)
 		}
 		else if(strcmp(argv[i], "-arch") == 0 ||
 			strcmp(argv[i], "-n") == 0 ||
+			strcmp(argv[i], "-j") == 0 ||
 			strcmp(argv[i], "-t") == 0)
 		    i++;
 		else if(strcmp(argv[i], "--") == 0)
@@ -296,7 +339,8 @@ usage(
 void)
 {
 	fprintf(stderr, "Usage: %s [-] [-a] [-o] [-t format] [-number] "
-		"[-n number] [[-arch <arch_flag>] ...] [--] [file ...]\n",
+		"[-n number] [[-arch <arch_flag>] ...] [-j jobs] [--] "
+		"[file ...]\n",
 		progname);
 	exit(EXIT_FAILURE);
 }
@@ -464,7 +508,8 @@ void *cookie)
 /*
  * ofile_find is used by ofile_processor() to find strings in part of a ofile
  * that is memory at addr for size.  offset is the offset in the file to this
- * data for use when printing offsets.
+ * data for use when printing offsets.  The strings are found a run at a time
+ * with string_end() and printed with the outbuf routines.
  */
 static
 void
@@ -474,36 +519,85 @@ uint32_t size,
 uint32_t offset,
 struct flags *flags)
 {
-    uint32_t i, string_length;
-    char c, *string;
+    uint32_t i, end, length;
 
-	string = addr;
-	string_length = 0;
-	for(i = 0; i < size; i++){
-	    c = addr[i];
-	    if(c == '\n' || dirt(c) || i == size - 1){
-		if(string_length >= flags->minimum_length){
+	i = 0;
+	while(i < size){
+	    end = string_end(addr, i, size);
+	    length = end - i;
+	    /*
+	     * At the end of the data the original code, which looked at a byte
+	     * at a time, checked the length before counting the last byte and
+	     * then printed it as part of the string unless it was a newline,
+	     * with "%.*s" so not if it was a nul either.
+	     */
+	    if(end >= size - 1 && (end == size || addr[end] != '\n')){
+		if(end == size)
+		    length--;
+		if(length >= flags->minimum_length){
 		    if(flags->print_offsets){
-			printf(flags->offset_format, offset + (string - addr));
-			printf(" ");
+			outbuf_printf(flags->offset_format, offset + (long)i);
+			outbuf_char(' ');
 		    }
-		    if(i == size - 1 && c != '\n')
-			printf("%.*s\n", (int)string_length + 1, string);
-		    else
-			printf("%.*s\n", (int)string_length, string);
+		    outbuf_strn(addr + i, size - i);
+		    outbuf_char('\n');
 		}
-		string = addr + i + 1;
-		string_length = 0;
+		break;
 	    }
-	    else{
-		string_length++;
+	    if(length >= flags->minimum_length){
+		if(flags->print_offsets){
+		    outbuf_printf(flags->offset_format, offset + (long)i);
+		    outbuf_char(' ');
+		}
+		outbuf_write(addr + i, length);
+		outbuf_char('\n');
+	    }
+	    i = end + 1;
+	}
+	outbuf_flush();
+}
+
+/*
+ * string_end() returns the index of the first byte at or after index i of the
+ * size bytes at addr that ends a string, or size if there is none.  Bytes are
+ * looked up in string_ends[] one at a time until a run has 8 bytes, as most
+ * are short, and then runs of the usual printing characters, ' ' through '~',
+ * are skipped 8 bytes at a time.
+ */
+static
+uint32_t
+string_end(
+char *addr,
+uint32_t i,
+uint32_t size)
+{
+    uint32_t start;
+    uint64_t w;
+
+	start = i;
+	while(i < size){
+	    if(string_ends[(unsigned char)addr[i]])
+		return(i);
+	    i++;
+	    if(i - start < sizeof(uint64_t))
+		continue;
+	    while(size - i >= sizeof(uint64_t)){
+		memcpy(&w, addr + i, sizeof(uint64_t));
+		/* any byte less than ' ' or greater than '~' */
+		if((((w - STRING_ONES * ' ') & ~w) |
+		    ((w + STRING_ONES * (0x7f - '~')) | w)) & STRING_HIGHS)
+		    break;
+		i += sizeof(uint64_t);
 	    }
 	}
+	return(size);
 }
 
 /*
  * find() is the original 4.3bsd code that uses the stdin stream.  It searches
- * for strings through a count of cnt bytes.
+ * for strings through a count of cnt bytes.  The stream is read a block at a
+ * time rather than with getc(3) for each byte, with EOF taking the place of
+ * the byte after the last one read.
  */
 static
 void
@@ -512,23 +606,31 @@ uint32_t cnt,
 struct flags *flags)
 {
     static char buf[BUFSIZ];
+    static unsigned char data[64 * 1024];
     register char *cp;
     register int c, cc, i;
+    size_t n, j;
 
     cp = buf, cc = 0;
+    n = 0, j = 0;
 	for (i = 0; i < cnt; ++i) {
-		c = getc(stdin);
+		if (j == n) {
+			n = fread(data, 1, sizeof(data), stdin);
+			j = 0;
+		}
+		c = j < n ? data[j++] : EOF;
 		if (c == '\n' || dirt(c) || (i + 1) == cnt) {
 			if (cp > buf && cp[-1] == '\n')
 				--cp;
 			*cp++ = 0;
 			if (cp > &buf[flags->minimum_length]) {
 				if (flags->print_offsets == TRUE){
-					printf(flags->offset_format,
-					       i - cc);
-					printf(" ");
+					outbuf_printf(flags->offset_format,
+						      i - cc);
+					outbuf_char(' ');
 				}
-				printf("%s\n", buf);
+				outbuf_str(buf);
+				outbuf_char('\n');
 			}
 			cp = buf, cc = 0;
 		} else {
@@ -536,9 +638,10 @@ struct flags *flags)
 				*cp++ = c;
 			cc++;
 		}
-		if (ferror(stdin) || feof(stdin))
+		if (c == EOF)
 			break;
 	}
+	outbuf_flush();
 }
 
 /*
@@ -33,6 +33,7 @@
 #include <libc.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <mach-o/loader.h>
 #include <mach-o/reloc.h>
 #include <mach-o/nlist.h>
@@ -44,8 +45,10 @@
 #include "stuff/reloc.h"
 #include "stuff/reloc.h"
 #include "stuff/symbol_list.h"
+#include "stuff/name_hash.h"
 #include "stuff/unix_standard_mode.h"
 #include "stuff/execute.h"
+#include "stuff/parallel.h"
 #ifdef TRIE_SUPPORT
 #include <mach-o/prune_trie.h>
 #endif /* TRIE_SUPPORT */
@@ -82,6 +85,7 @@ static uint32_t no_code_signature_warning;
 static uint32_t vflag;	/* -v for verbose debugging ld -r executions */
 static uint32_t lflag;	/* -l do ld -r executions even if it has bugs */
 static enum bool toc64flag = FALSE; /* -toc64 for a 64-bit toc in archives */
+static uint32_t njobs;	/* -j number of files to strip at once */
 static uint32_t strip_all = 1;
 /*
  * This is set on an object by object basis if the strip_all flag is still set
@@ -107,6 +111,12 @@ static struct symbol_list *save_symbols = NULL;
 static uint32_t nsave_symbols = 0;
 static struct symbol_list *remove_symbols = NULL;
 static uint32_t nremove_symbols = 0;
+/*
+ * These are indexes of the names in the lists, built once the lists are read,
+ * that are used to look up the symbols of the objects in them.
+ */
+static struct name_hash save_symbols_hash = { 0 };
+static struct name_hash remove_symbols_hash = { 0 };
 
 /*
  * saves points to an array of uint32_t's that is allocated.  This array is a
@@ -153,6 +163,10 @@ static uint32_t new_nundefsym = 0;
  * The index into the new symbols where the defined external start.
  */
 static uint32_t inew_nextdefsym = 0;
+/*
+ * The names of the defined external symbols being kept, for prune().
+ */
+static struct name_hash prune_hash = { 0 };
 #endif
 
 /*
@@ -169,6 +183,37 @@ static struct dylib_module_64 *new_mods64 = NULL;
 static uint32_t new_nmodtab = 0;
 #endif
 
+/*
+ * The members of archives at least SPILL_LIBRARY_SIZE bytes in size are
+ * written to the spill file as they are stripped, so the new symbol and string
+ * tables made for each can be freed before the next member is stripped.
+ */
+#define SPILL_LIBRARY_SIZE (256 * 1024 * 1024)
+static struct spill spill = { 0 };
+
+#ifndef NMEDIT
+/*
+ * The ld -r commands for the members of an archive that need them are run at
+ * the same time by prefetch_ld_r_objects() before the members are stripped,
+ * and make_ld_r_object() uses their output from here.  It is indexed by the
+ * member's index in the archive, with NULL names for members not prefetched.
+ */
+struct ld_r_prefetch {
+    char *input_file;
+    char *output_file;
+};
+static struct ld_r_prefetch *ld_r_prefetches = NULL;
+static uint32_t nld_r_prefetches = 0;
+/*
+ * The number of ld -r commands prefetch_ld_r_objects() runs at once, which is
+ * set from -j and is zero if it was not given.  The process that registered
+ * cleanup_ld_r_prefetches() to remove its files if it exits with a fatal error
+ * is ld_r_prefetch_pid.
+ */
+static uint32_t ld_r_njobs = 0;
+static pid_t ld_r_prefetch_pid = 0;
+#endif /* !defined(NMEDIT) */
+
 #ifndef NMEDIT
 /*
  * The list of file names to save debugging symbols from.
@@ -191,6 +236,41 @@ static char *qsort_strings = NULL;
 static void usage(
     void);
 
+static void setup_symbol_list_hash(
+    struct name_hash *hash,
+    struct symbol_list *list,
+    uint32_t size);
+
+static struct symbol_list *lookup_symbol_list(
+    struct name_hash *hash,
+    struct symbol_list *list,
+    const char *name);
+
+#ifndef NMEDIT
+/*
+ * When -j is used strip_files() strips the files with parallel_for() and each
+ * call of strip_file_job() stores the results for its file in this struct's
+ * arrays, which are in shared memory.
+ */
+struct strip_files_job {
+    char **files;
+    struct arch_flag *arch_flags;
+    uint32_t narch_flags;
+    enum bool all_archs;
+    uint32_t *nerrors;	/* errors while stripping each file */
+    uint64_t *sizes;	/* size of each file before it was stripped */
+    uint64_t *usecs;	/* microseconds it took to strip each file */
+};
+static void strip_files(
+    char **files,
+    uint32_t nfiles,
+    struct arch_flag *arch_flags,
+    uint32_t narch_flags,
+    enum bool all_archs);
+static void strip_file_job(
+    uint32_t i,
+    void *cookie);
+#endif /* !defined(NMEDIT) */
 static void strip_file(
     char *input_file,
     struct arch_flag *arch_flags,
@@ -265,6 +345,19 @@ static int prune(
     const char *name);
 #endif /* TRIE_SUPPORT */
 
+static enum bool ld_r_object_needed(
+    struct object *object);
+static void prefetch_ld_r_objects(
+    struct arch *arch);
+static void free_ld_r_prefetches(
+    void);
+static void cleanup_ld_r_prefetches(
+    void);
+static int ld_r_temp_file(
+    char **path);
+static void add_ld_r_execute_list(
+    char *input_file,
+    char *output_file);
 static void make_ld_r_object(
     struct arch *arch,
     struct member *member,
@@ -338,36 +431,6 @@ static int cmp_bsearch_filename(
     const char **name2);
 #endif /* NMEDIT */
 
-#ifdef NMEDIT
-/*
- * This variable and routines are used for nmedit(1) only.
- */
-static char *global_strings = NULL;
-
-static int cmp_qsort_global(
-    const struct nlist **sym1,
-    const struct nlist **sym2);
-
-static int cmp_qsort_global_64(
-    const struct nlist_64 **sym1,
-    const struct nlist_64 **sym2);
-
-static int cmp_bsearch_global_stab(
-    const char *name,
-    const struct nlist **sym);
-
-static int cmp_bsearch_global_stab_64(
-    const char *name,
-    const struct nlist_64 **sym);
-
-static int cmp_bsearch_global(
-    const char *name,
-    const struct nlist **sym);
-
-static int cmp_bsearch_global_64(
-    const char *name,
-    const struct nlist_64 **sym);
-#endif /* NMEDIT */
 
 /* apple_version is created by the libstuff/Makefile */
 extern char apple_version[];
@@ -385,6 +448,10 @@ char *envp[])
     uint32_t narch_flags;
     enum bool all_archs;
     struct symbol_list *sp;
+    char **files;
+#ifndef NMEDIT
+    char *endp;
+#endif /* !defined(NMEDIT) */
 
 	progname = argv[0];
 
@@ -445,6 +512,15 @@ char *envp[])
 		else if(strcmp(argv[i], "-toc64") == 0){
 		    toc64flag = TRUE;
 		}
+		else if(strcmp(argv[i], "-j") == 0){
+		    if(i + 1 >= argc)
+			fatal("-j requires an argument");
+		    njobs = strtoul(argv[i + 1], &endp, 10);
+		    if(*endp != '\0' || njobs == 0)
+			fatal("argument to -j: %s must be a positive number",
+			      argv[i + 1]);
+		    i++;
+		}
 #endif /* !defined(NMEDIT) */
 		else if(strcmp(argv[i], "-arch") == 0){
 		    if(i + 1 == argc){
@@ -567,6 +643,8 @@ char *envp[])
 
 	if(sfile){
 	    setup_symbol_list(sfile, &save_symbols, &nsave_symbols);
+	    setup_symbol_list_hash(&save_symbols_hash, save_symbols,
+				   nsave_symbols);
 	}
 #ifdef NMEDIT
 	else{
@@ -579,13 +657,12 @@ char *envp[])
 
 	if(Rfile){
 	    setup_symbol_list(Rfile, &remove_symbols, &nremove_symbols);
+	    setup_symbol_list_hash(&remove_symbols_hash, remove_symbols,
+				   nremove_symbols);
 	    if(sfile){
 		for(j = 0; j < nremove_symbols ; j++){
-		    sp = bsearch(remove_symbols[j].name,
-				 save_symbols, nsave_symbols,
-				 sizeof(struct symbol_list),
-				 (int (*)(const void *, const void *))
-				    symbol_list_bsearch);
+		    sp = lookup_symbol_list(&save_symbols_hash, save_symbols,
+					    remove_symbols[j].name);
 		    if(sp != NULL){
 			error("symbol name: %s is listed in both -s %s and -R "
 			      "%s files (can't be both saved and removed)",
@@ -607,6 +684,7 @@ char *envp[])
 	}
 #endif /* !defined(NMEDIT) */
 
+	files = allocate(argc * sizeof(char *));
 	files_specified = 0;
 	args_left = 1;
 	for (i = 1; i < argc; i++) {
@@ -618,6 +696,7 @@ char *envp[])
 			strcmp(argv[i], "-R") == 0 ||
 #ifndef NMEDIT
 			strcmp(argv[i], "-d") == 0 ||
+			strcmp(argv[i], "-j") == 0 ||
 #endif /* !defined(NMEDIT) */
 			strcmp(argv[i], "-arch") == 0)
 		    i++;
@@ -626,21 +705,68 @@ char *envp[])
 		char resolved_path[PATH_MAX + 1];
 
 		if(realpath(argv[i], resolved_path) == NULL)
-		    strip_file(argv[i], arch_flags, narch_flags, all_archs);
+		    files[files_specified] = argv[i];
 		else
-		    strip_file(resolved_path, arch_flags,narch_flags,all_archs);
+		    files[files_specified] = makestr(resolved_path, NULL);
 		files_specified++;
 	    }
 	}
 	if(files_specified == 0)
 	    fatal("no files specified");
 
+#ifndef NMEDIT
+	if(njobs != 0)
+	    strip_files(files, files_specified, arch_flags, narch_flags,
+			all_archs);
+	else
+#endif /* !defined(NMEDIT) */
+	    for(j = 0; j < files_specified; j++)
+		strip_file(files[j], arch_flags, narch_flags, all_archs);
+
 	if(errors)
 	    return(EXIT_FAILURE);
 	else
 	    return(EXIT_SUCCESS);
 }
 
+/*
+ * setup_symbol_list_hash() enters the names of the size symbol_list structs in
+ * list in hash so lookup_symbol_list() can find them.
+ */
+static
+void
+setup_symbol_list_hash(
+struct name_hash *hash,
+struct symbol_list *list,
+uint32_t size)
+{
+    uint32_t i;
+
+	name_hash_init(hash, size);
+	for(i = 0; i < size; i++)
+	    name_hash_enter(hash, list[i].name);
+}
+
+/*
+ * lookup_symbol_list() returns the symbol_list struct in list for name, using
+ * the hash set up for the list by setup_symbol_list_hash(), or NULL if name is
+ * not in the list.
+ */
+static
+struct symbol_list *
+lookup_symbol_list(
+struct name_hash *hash,
+struct symbol_list *list,
+const char *name)
+{
+    int32_t i;
+
+	i = name_hash_lookup(hash, name);
+	if(i == -1)
+	    return(NULL);
+	return(list + i);
+}
+
 static
 void
 usage(
@@ -648,7 +774,7 @@ void)
 {
 #ifndef NMEDIT
 	fprintf(stderr, "Usage: %s [-AnuSXx] [-] [-d filename] [-s filename] "
-		"[-R filename] [-o output] file [...] \n", progname);
+		"[-R filename] [-o output] [-j njobs] file [...] \n", progname);
 #else /* defined(NMEDIT) */
 	fprintf(stderr, "Usage: %s -s filename [-R filename] [-p] [-A] [-] "
 		"[-o output] file [...] \n",
@@ -657,6 +783,109 @@ void)
 	exit(EXIT_FAILURE);
 }
 
+#ifndef NMEDIT
+/*
+ * strip_files() is used with -j to strip the files, which are independent of
+ * each other, njobs at a time.  The -s and -R symbol lists have already been
+ * read so the worker processes share them.  With -v the size of each file and
+ * time taken to strip it are printed, followed by the totals.
+ */
+static
+void
+strip_files(
+char **files,
+uint32_t nfiles,
+struct arch_flag *arch_flags,
+uint32_t narch_flags,
+enum bool all_archs)
+{
+    struct strip_files_job job;
+    struct timeval start, end;
+    uint64_t total_size, usecs;
+    uint32_t i, previous_errors;
+
+	job.files = files;
+	job.arch_flags = arch_flags;
+	job.narch_flags = narch_flags;
+	job.all_archs = all_archs;
+	job.nerrors = parallel_allocate(nfiles * sizeof(uint32_t));
+	job.sizes = parallel_allocate(nfiles * sizeof(uint64_t));
+	job.usecs = parallel_allocate(nfiles * sizeof(uint64_t));
+
+	/*
+	 * The jobs left over when there are fewer files than jobs are shared
+	 * by the workers to run the ld -r commands for archive members and
+	 * to scan the symbols of large libraries for their tables of contents.
+	 */
+	ld_r_njobs = njobs / (njobs < nfiles ? njobs : nfiles);
+	if(ld_r_njobs > 1)
+	    writeout_toc_njobs = ld_r_njobs;
+
+	previous_errors = errors;
+	gettimeofday(&start, NULL);
+	parallel_for(nfiles, njobs, strip_file_job, &job);
+	gettimeofday(&end, NULL);
+
+	/*
+	 * Each call recorded its errors whether it was made in a worker
+	 * process or in this one, so the count is rebuilt from those.
+	 */
+	errors = previous_errors;
+	for(i = 0; i < nfiles; i++)
+	    errors += job.nerrors[i];
+
+	if(vflag){
+	    total_size = 0;
+	    for(i = 0; i < nfiles; i++){
+		fprintf(stderr, "%s: %s: %llu bytes in %.3f seconds\n",
+			progname, files[i], (unsigned long long)job.sizes[i],
+			job.usecs[i] / 1000000.0);
+		total_size += job.sizes[i];
+	    }
+	    usecs = (end.tv_sec - start.tv_sec) * 1000000ULL +
+		    end.tv_usec - start.tv_usec;
+	    fprintf(stderr, "%s: %u files, %llu bytes in %.3f seconds "
+		    "(%.1f MB/s) with %u jobs\n", progname, nfiles,
+		    (unsigned long long)total_size, usecs / 1000000.0,
+		    usecs == 0 ? 0.0 : (total_size / 1048576.0) /
+				       (usecs / 1000000.0),
+		    njobs < nfiles ? njobs : nfiles);
+	}
+
+	parallel_deallocate(job.nerrors, nfiles * sizeof(uint32_t));
+	parallel_deallocate(job.sizes, nfiles * sizeof(uint64_t));
+	parallel_deallocate(job.usecs, nfiles * sizeof(uint64_t));
+}
+
+/*
+ * strip_file_job() is called by parallel_for() to strip the i'th file of a
+ * strip_files_job.
+ */
+static
+void
+strip_file_job(
+uint32_t i,
+void *cookie)
+{
+    struct strip_files_job *job;
+    struct stat stat_buf;
+    struct timeval start, end;
+    uint32_t previous_errors;
+
+	job = (struct strip_files_job *)cookie;
+	if(stat(job->files[i], &stat_buf) == 0)
+	    job->sizes[i] = stat_buf.st_size;
+	previous_errors = errors;
+	gettimeofday(&start, NULL);
+	strip_file(job->files[i], job->arch_flags, job->narch_flags,
+		   job->all_archs);
+	gettimeofday(&end, NULL);
+	job->nerrors[i] = errors - previous_errors;
+	job->usecs[i] = (end.tv_sec - start.tv_sec) * 1000000ULL +
+			end.tv_usec - start.tv_usec;
+}
+#endif /* !defined(NMEDIT) */
+
 static
 void
 strip_file(
@@ -694,10 +923,14 @@ enum bool all_archs)
 	strip_arch(archs, narchs, arch_flags, narch_flags, all_archs);
 	if(errors){
 	    free_archs(archs, narchs);
+	    spill_free(&spill);
 	    ofile_unmap(ofile);
 	    return;
 	}
 
+	/* point the members written to the spill file, if any, at it */
+	spill_map(&spill, archs, narchs);
+
 	/* create the output file */
 	if(stat(input_file, &stat_buf) == -1)
 	    system_error("can't stat input file: %s", input_file);
@@ -800,6 +1033,7 @@ strip_file_return:
 #endif /* !defined(NMEDIT) */
 	/* clean-up data structures */
 	free_archs(archs, narchs);
+	spill_free(&spill);
 	ofile_unmap(ofile);
 
 	errors += previous_errors;
@@ -819,6 +1053,7 @@ enum bool all_archs)
     cpu_subtype_t cpusubtype;
     struct arch_flag host_arch_flag;
     enum bool arch_process, any_processing, *arch_flag_processed, family;
+    enum bool spill_members;
     const struct arch_flag *family_arch_flag;
     struct ar_hdr h;
     char size_buf[sizeof(h.ar_size) + 1];
@@ -900,12 +1135,32 @@ enum bool all_archs)
 	     * according to its type.
 	     */
 	    if(archs[i].type == OFILE_ARCHIVE){
+		spill_members = (enum bool)
+		    (archs[i].library_size >= SPILL_LIBRARY_SIZE);
+#ifndef NMEDIT
+		prefetch_ld_r_objects(archs + i);
+#endif /* !defined(NMEDIT) */
 		for(j = 0; j < archs[i].nmembers; j++){
 		    if(archs[i].members[j].type == OFILE_Mach_O){
 			strip_object(archs + i, archs[i].members + j,
 				     archs[i].members[j].object);
+			if(spill_members == TRUE && errors == 0){
+			    spill_member(&spill, archs[i].members + j);
+			    if(new_symbols != NULL)
+				free(new_symbols);
+			    if(new_symbols64 != NULL)
+				free(new_symbols64);
+			    if(new_strings != NULL)
+				free(new_strings);
+			    new_symbols = NULL;
+			    new_symbols64 = NULL;
+			    new_strings = NULL;
+			}
 		    }
 		}
+#ifndef NMEDIT
+		free_ld_r_prefetches();
+#endif /* !defined(NMEDIT) */
 		missing_syms = 0;
 		if(iflag == 0){
 		    for(k = 0; k < nsave_symbols; k++){
@@ -2879,7 +3134,7 @@ enum bool *nlist_outofsync_with_dyldinfo)
     uint64_t n_value;
     uint32_t module_name, iextdefsym, nextdefsym, ilocalsym, nlocalsym;
     uint32_t irefsym, nrefsym;
-    enum bool has_dwarf, hack_5614542;
+    enum bool hack_5614542;
     uint32_t swift_version;
     char *p_objc_image_info;
     struct objc_image_info o;
@@ -2908,71 +3163,10 @@ enum bool *nlist_outofsync_with_dyldinfo)
 	new_ext_strsize = 0;
 
 	/*
-	 * If this an object file that has DWARF debugging sections to strip
-	 * then we have to run ld -r on it.  We also have to do this for
-	 * ARM objects because thumb symbols can't be stripped as they are
-	 * needed for proper linking in .o files.  And we need to for i386
-	 * objects to not mess up compact unwind info.
+	 * If strip(1) can't do the stripping of this object file itself have
+	 * ld(1) do it and make an ld -r version of the object.
 	 */
-	if(object->mh_filetype == MH_OBJECT && (Sflag || xflag)){
-	    has_dwarf = FALSE;
-	    lc = object->load_commands;
-	    if(object->mh != NULL)
-		ncmds = object->mh->ncmds;
-	    else
-		ncmds = object->mh64->ncmds;
-	    for(i = 0; i < ncmds && has_dwarf == FALSE; i++){
-		if(lc->cmd == LC_SEGMENT){
-		    sg = (struct segment_command *)lc;
-		    s = (struct section *)((char *)sg +
-					    sizeof(struct segment_command));
-		    for(j = 0; j < sg->nsects; j++){
-			if(s->flags & S_ATTR_DEBUG){
-			    has_dwarf = TRUE;
-			    break;
-			}
-			s++;
-		    }
-		}
-		else if(lc->cmd == LC_SEGMENT_64){
-		    sg64 = (struct segment_command_64 *)lc;
-		    s64 = (struct section_64 *)((char *)sg64 +
-					    sizeof(struct segment_command_64));
-		    for(j = 0; j < sg64->nsects; j++){
-			if(s64->flags & S_ATTR_DEBUG){
-			    has_dwarf = TRUE;
-			    break;
-			}
-			s64++;
-		    }
-		}
-		lc = (struct load_command *)((char *)lc + lc->cmdsize);
-	    }
-	    /*
-	     * If the file has dwarf symbols or is an ARM or i386 object then
-	     * have ld(1) do the "stripping" and make an ld -r version of the
-	     * object.
-	     */
-	    if(has_dwarf == TRUE ||
-	       object->mh_cputype == CPU_TYPE_ARM ||
-	       object->mh_cputype == CPU_TYPE_I386)
-		make_ld_r_object(arch, member, object);
-	}
-	/*
-	 * Because of the "design" of 64-bit object files and the lack of
-	 * local relocation entries it is not possible for strip(1) to do its
-	 * job without becoming a static link editor.  The "design" does not
-	 * actually strip the symbols it simply renames them to things like
-	 * "l1000".  And they become static symbols but still have external
-	 * relocation entries.  Thus can never actually be stripped.  Also some
-	 * symbols, *.eh, symbols are not even changed to these names if there
-	 * corresponding global symbol is not stripped.  So strip(1) only
-	 * recourse is to use the unified linker to create an ld -r object then
-	 * save all resulting symbols (both static and global) and hope the user
-	 * does not notice the stripping is not what they asked for.
-	 */
-	if(object->mh_filetype == MH_OBJECT &&
-	   (object->mh64 != NULL && object->ld_r_ofile == NULL))
+	if(object->ld_r_ofile == NULL && ld_r_object_needed(object) == TRUE)
 	    make_ld_r_object(arch, member, object);
 
 	/*
@@ -3289,11 +3483,8 @@ enum bool *nlist_outofsync_with_dyldinfo)
 		 */
 		else if((n_type & N_PEXT) == N_PEXT){
 		    if(saves[i] == 0 && sfile){
-			sp = bsearch(strings + n_strx,
-				     save_symbols, nsave_symbols,
-				     sizeof(struct symbol_list),
-				     (int (*)(const void *, const void *))
-					symbol_list_bsearch);
+			sp = lookup_symbol_list(&save_symbols_hash,
+						save_symbols, strings + n_strx);
 			if(sp != NULL){
 			    if(sp->sym == NULL){
 				if(object->mh != NULL)
@@ -3343,11 +3534,8 @@ enum bool *nlist_outofsync_with_dyldinfo)
 		   (object->mh != NULL ||
 		    object->mh64->cputype != CPU_TYPE_X86_64 ||
 		    object->mh64->filetype != MH_OBJECT)){
-		    sp = bsearch(strings + n_strx,
-				 remove_symbols, nremove_symbols,
-				 sizeof(struct symbol_list),
-				 (int (*)(const void *, const void *))
-				    symbol_list_bsearch);
+		    sp = lookup_symbol_list(&remove_symbols_hash,
+					    remove_symbols, strings + n_strx);
 		    if(sp != NULL){
 			if((n_type & N_TYPE) == N_UNDF ||
 			   (n_type & N_TYPE) == N_PBUD){
@@ -3421,11 +3609,8 @@ enum bool *nlist_outofsync_with_dyldinfo)
 		    saves[i] = new_nsyms;
 		}
 		if(saves[i] == 0 && sfile){
-		    sp = bsearch(strings + n_strx,
-				 save_symbols, nsave_symbols,
-				 sizeof(struct symbol_list),
-				 (int (*)(const void *, const void *))
-				    symbol_list_bsearch);
+		    sp = lookup_symbol_list(&save_symbols_hash, save_symbols,
+					    strings + n_strx);
 		    if(sp != NULL){
 			if(sp->sym != NULL){
 			    sym = (struct nlist *)sp->sym;
@@ -4175,11 +4360,26 @@ enum bool *nlist_outofsync_with_dyldinfo)
 	    const char *error_string;
 	    uint32_t trie_new_size;
 
+	    /*
+	     * Index the names of the defined external symbols being kept so
+	     * prune() does not have to look through them for each name in the
+	     * trie.
+	     */
+	    name_hash_init(&prune_hash, new_nextdefsym);
+	    for(i = 0; i < new_nextdefsym; i++){
+		if(new_symbols != NULL)
+		    name_hash_enter(&prune_hash, new_strings +
+			new_symbols[inew_nextdefsym + i].n_un.n_strx);
+		else
+		    name_hash_enter(&prune_hash, new_strings +
+			new_symbols64[inew_nextdefsym + i].n_un.n_strx);
+	    }
 	    error_string = prune_trie((uint8_t *)(object->object_addr +
 						 object->dyld_info->export_off),
 		       		      object->dyld_info->export_size,
 		       		      prune,
 				      &trie_new_size);
+	    name_hash_free(&prune_hash);
 	    if(error_string != NULL){
 		error_arch(arch, member, "%s", error_string);
 		return(FALSE);
@@ -4220,30 +4420,288 @@ int
 prune(
 const char *name)
 {
-    uint32_t i;
+	if(name_hash_lookup(&prune_hash, name) != -1)
+	    return(0);
+	return(1);
+}
+#endif /* TRIE_SUPPORT */
+
+/*
+ * ld_r_object_needed() returns TRUE if the object file has to be changed to an
+ * ld -r file by make_ld_r_object() for strip_symtab() to strip it.
+ */
+static
+enum bool
+ld_r_object_needed(
+struct object *object)
+{
+    uint32_t i, j, ncmds;
+    struct load_command *lc;
+    struct segment_command *sg;
+    struct segment_command_64 *sg64;
+    struct section *s;
+    struct section_64 *s64;
+    enum bool has_dwarf;
 
-	for(i = 0; i < new_nextdefsym; i++){
-	    if(new_symbols != NULL){
-		if(strcmp(name, new_strings + new_symbols[inew_nextdefsym + i]
-							 .n_un.n_strx) == 0)
-		    return(0);
+	/*
+	 * If this an object file that has DWARF debugging sections to strip
+	 * then we have to run ld -r on it.  We also have to do this for
+	 * ARM objects because thumb symbols can't be stripped as they are
+	 * needed for proper linking in .o files.  And we need to for i386
+	 * objects to not mess up compact unwind info.
+	 */
+	if(object->mh_filetype != MH_OBJECT)
+	    return(FALSE);
+	if(Sflag || xflag){
+	    has_dwarf = FALSE;
+	    lc = object->load_commands;
+	    if(object->mh != NULL)
+		ncmds = object->mh->ncmds;
+	    else
+		ncmds = object->mh64->ncmds;
+	    for(i = 0; i < ncmds && has_dwarf == FALSE; i++){
+		if(lc->cmd == LC_SEGMENT){
+		    sg = (struct segment_command *)lc;
+		    s = (struct section *)((char *)sg +
+					    sizeof(struct segment_command));
+		    for(j = 0; j < sg->nsects; j++){
+			if(s->flags & S_ATTR_DEBUG){
+			    has_dwarf = TRUE;
+			    break;
+			}
+			s++;
+		    }
+		}
+		else if(lc->cmd == LC_SEGMENT_64){
+		    sg64 = (struct segment_command_64 *)lc;
+		    s64 = (struct section_64 *)((char *)sg64 +
+					    sizeof(struct segment_command_64));
+		    for(j = 0; j < sg64->nsects; j++){
+			if(s64->flags & S_ATTR_DEBUG){
+			    has_dwarf = TRUE;
+			    break;
+			}
+			s64++;
+		    }
+		}
+		lc = (struct load_command *)((char *)lc + lc->cmdsize);
 	    }
-	    else{
-		if(strcmp(name, new_strings + new_symbols64[inew_nextdefsym + i]
-							   .n_un.n_strx) == 0)
-		    return(0);
+	    /*
+	     * If the file has dwarf symbols or is an ARM or i386 object then
+	     * have ld(1) do the "stripping" and make an ld -r version of the
+	     * object.
+	     */
+	    if(has_dwarf == TRUE ||
+	       object->mh_cputype == CPU_TYPE_ARM ||
+	       object->mh_cputype == CPU_TYPE_I386)
+		return(TRUE);
+	}
+	/*
+	 * Because of the "design" of 64-bit object files and the lack of
+	 * local relocation entries it is not possible for strip(1) to do its
+	 * job without becoming a static link editor.  The "design" does not
+	 * actually strip the symbols it simply renames them to things like
+	 * "l1000".  And they become static symbols but still have external
+	 * relocation entries.  Thus can never actually be stripped.  Also some
+	 * symbols, *.eh, symbols are not even changed to these names if there
+	 * corresponding global symbol is not stripped.  So strip(1) only
+	 * recourse is to use the unified linker to create an ld -r object then
+	 * save all resulting symbols (both static and global) and hope the user
+	 * does not notice the stripping is not what they asked for.
+	 */
+	if(object->mh64 != NULL)
+	    return(TRUE);
+	return(FALSE);
+}
+
+/*
+ * prefetch_ld_r_objects() runs the ld -r commands for the members of the
+ * archive that make_ld_r_object() will need at the same time with
+ * execute_jobs(), rather than one after the other as each member is stripped.
+ * This is only done for members in the host byte sex, as their contents are
+ * not changed by strip_object() before make_ld_r_object() is called for them
+ * and so can be written out for ld(1) before the members are stripped.  It is
+ * only done with -j, running at most ld_r_njobs of the commands at once.
+ */
+static
+void
+prefetch_ld_r_objects(
+struct arch *arch)
+{
+    uint32_t i, n;
+    struct object *object;
+    char ***argvs;
+    uint32_t *indexes;
+    int fd;
+
+	if(ld_r_njobs < 2)
+	    return;
+	if(sfile == NULL && Rfile == NULL && dfile == NULL && !Aflag &&
+	   !uflag && !Sflag && !xflag && !Xflag && !Tflag && !nflag && !rflag)
+	    return;
+
+	indexes = allocate(arch->nmembers * sizeof(uint32_t));
+	n = 0;
+	for(i = 0; i < arch->nmembers; i++){
+	    if(arch->members[i].type != OFILE_Mach_O)
+		continue;
+	    object = arch->members[i].object;
+	    if(object->object_byte_sex != get_host_byte_sex() ||
+	       object->st == NULL || object->st->nsyms == 0 ||
+	       ld_r_object_needed(object) == FALSE)
+		continue;
+	    indexes[n++] = i;
+	}
+	if(n < 2){
+	    free(indexes);
+	    return;
+	}
+
+	if(ld_r_prefetch_pid != getpid()){
+	    ld_r_prefetch_pid = getpid();
+	    atexit(cleanup_ld_r_prefetches);
+	}
+	ld_r_prefetches = allocate(arch->nmembers *
+				   sizeof(struct ld_r_prefetch));
+	memset(ld_r_prefetches, '\0', arch->nmembers *
+	       sizeof(struct ld_r_prefetch));
+	nld_r_prefetches = arch->nmembers;
+	argvs = allocate(n * sizeof(char **));
+	for(i = 0; i < n; i++){
+	    object = arch->members[indexes[i]].object;
+	    fd = ld_r_temp_file(&ld_r_prefetches[indexes[i]].input_file);
+	    if(write(fd, object->object_addr, object->object_size) !=
+		    object->object_size)
+		system_fatal("can't write temporary file: %s",
+			     ld_r_prefetches[indexes[i]].input_file);
+	    if(close(fd) == -1)
+		system_fatal("can't close temporary file: %s",
+			     ld_r_prefetches[indexes[i]].input_file);
+	    /* ld(1) replaces the output file, which is made here to own it */
+	    fd = ld_r_temp_file(&ld_r_prefetches[indexes[i]].output_file);
+	    if(close(fd) == -1)
+		system_fatal("can't close temporary file: %s",
+			     ld_r_prefetches[indexes[i]].output_file);
+	    add_ld_r_execute_list(ld_r_prefetches[indexes[i]].input_file,
+				  ld_r_prefetches[indexes[i]].output_file);
+	    argvs[i] = copy_execute_list();
+	}
+
+	if(execute_jobs(argvs, n, ld_r_njobs, vflag, NULL) != 0){
+	    free_ld_r_prefetches();
+	    fatal("internal link edit command failed");
+	}
+	for(i = 0; i < n; i++)
+	    free(argvs[i]);
+	free(argvs);
+	free(indexes);
+}
+
+/*
+ * free_ld_r_prefetches() removes the files of the ld -r commands run by
+ * prefetch_ld_r_objects() that make_ld_r_object() did not use.
+ */
+static
+void
+free_ld_r_prefetches(
+void)
+{
+    uint32_t i;
+
+	for(i = 0; i < nld_r_prefetches; i++){
+	    if(ld_r_prefetches[i].input_file == NULL)
+		continue;
+	    unlink(ld_r_prefetches[i].input_file);
+	    free(ld_r_prefetches[i].input_file);
+	    if(ld_r_prefetches[i].output_file != NULL){
+		unlink(ld_r_prefetches[i].output_file);
+		free(ld_r_prefetches[i].output_file);
 	    }
 	}
-	return(1);
+	if(ld_r_prefetches != NULL)
+	    free(ld_r_prefetches);
+	ld_r_prefetches = NULL;
+	nld_r_prefetches = 0;
+}
+
+/*
+ * ld_r_temp_file() creates a temporary file in $TMPDIR, or /tmp, for an ld -r
+ * command run by prefetch_ld_r_objects() and returns its file descriptor.  Its
+ * name is stored in path before it is created, so cleanup_ld_r_prefetches()
+ * sees it if this or what follows is a fatal error.
+ */
+static
+int
+ld_r_temp_file(
+char **path)
+{
+    char *tmpdir;
+    int fd;
+
+	tmpdir = getenv("TMPDIR");
+	if(tmpdir == NULL || *tmpdir == '\0')
+	    tmpdir = "/tmp";
+	*path = makestr(tmpdir, "/strip.XXXXXX", NULL);
+	if((fd = mkstemp(*path)) == -1)
+	    system_fatal("can't create temporary file: %s", *path);
+	return(fd);
+}
+
+/*
+ * cleanup_ld_r_prefetches() is registered with atexit() by
+ * prefetch_ld_r_objects() so its temporary files are removed when a fatal
+ * error exits before the archive is done.  It does nothing in the processes
+ * forked by execute_jobs() for the ld -r commands.
+ */
+static
+void
+cleanup_ld_r_prefetches(
+void)
+{
+	if(getpid() == ld_r_prefetch_pid)
+	    free_ld_r_prefetches();
+}
+
+/*
+ * add_ld_r_execute_list() sets up the execute list with the ld -r command to
+ * do the stripping of input_file, making output_file.
+ */
+static
+void
+add_ld_r_execute_list(
+char *input_file,
+char *output_file)
+{
+	reset_execute_list();
+	add_execute_list_with_prefix("ld");
+	add_execute_list("-keep_private_externs");
+	add_execute_list("-r");
+	if(Sflag)
+	    add_execute_list("-S");
+	if(xflag)
+	    add_execute_list("-x");
+	add_execute_list(input_file);
+	add_execute_list("-o");
+	add_execute_list(output_file);
+	if(sfile != NULL){
+	    add_execute_list("-x");
+	    add_execute_list("-exported_symbols_list");
+	    add_execute_list(sfile);
+	}
+	if(Rfile != NULL){
+	    add_execute_list("-unexported_symbols_list");
+	    add_execute_list(Rfile);
+	}
 }
-#endif /* TRIE_SUPPORT */
 
 /*
  * make_ld_r_object() takes the object file contents referenced by the passed
  * data structures, writes that to a temporary file, runs "ld -r" plus the
  * specified stripping option creating a second temporary file, reads that file
  * in and replaces the object file contents with that and resets the variables
- * pointing to the symbol, string and indirect tables.
+ * pointing to the symbol, string and indirect tables.  If the ld -r command
+ * for this archive member was already run by prefetch_ld_r_objects() its
+ * output file is used.
  */
 static
 void
@@ -4257,10 +4715,22 @@ struct object *object)
     int fd;
     struct ofile *ld_r_ofile;
     struct arch *ld_r_archs;
-    uint32_t ld_r_narchs, save_errors;
+    uint32_t ld_r_narchs, save_errors, index;
 
 	host_byte_sex = get_host_byte_sex();
 
+	if(member != NULL && ld_r_prefetches != NULL){
+	    index = member - arch->members;
+	    if(index < nld_r_prefetches &&
+	       ld_r_prefetches[index].input_file != NULL){
+		input_file = ld_r_prefetches[index].input_file;
+		output_file = ld_r_prefetches[index].output_file;
+		ld_r_prefetches[index].input_file = NULL;
+		ld_r_prefetches[index].output_file = NULL;
+		goto make_ld_r_object_breakout;
+	    }
+	}
+
 	/*
 	 * Swap the object file back into its bytesex before writing it to the
 	 * temporary file if needed.
@@ -4308,29 +4778,11 @@ struct object *object)
 	/*
 	 * Create the ld -r command line and execute it.
 	 */
-	reset_execute_list();
-	add_execute_list_with_prefix("ld");
-	add_execute_list("-keep_private_externs");
-	add_execute_list("-r");
-	if(Sflag)
-	    add_execute_list("-S");
-	if(xflag)
-	    add_execute_list("-x");
-	add_execute_list(input_file);
-	add_execute_list("-o");
-	add_execute_list(output_file);
-	if(sfile != NULL){
-	    add_execute_list("-x");
-	    add_execute_list("-exported_symbols_list");
-	    add_execute_list(sfile);
-	}
-	if(Rfile != NULL){
-	    add_execute_list("-unexported_symbols_list");
-	    add_execute_list(Rfile);
-	}
+	add_ld_r_execute_list(input_file, output_file);
 	if(execute_list(vflag) == 0)
 	    fatal("internal link edit command failed");
 
+make_ld_r_object_breakout:
 	save_errors = errors;
 	errors = 0;
 	/* breakout the output file of the ld -f for processing */
@@ -4968,6 +5420,8 @@ uint32_t nextrefsyms)
     struct nlist **changed_globals;
     struct nlist_64 **changed_globals64;
     uint32_t nchanged_globals;
+    struct name_hash globals_hash, globals_stab_hash;
+    int32_t index;
     uint32_t ncmds, s_flags, n_strx, module_name, ilocalsym, nlocalsym;
     uint32_t iextdefsym, nextdefsym;
     uint8_t n_type, n_sect, global_symbol_n_sect;
@@ -5178,11 +5632,9 @@ uint32_t nextrefsyms)
 			    new_nextdefsym++;
 			    new_ext_strsize += len;
 			    new_strsize += len;
-			    sp = bsearch(strings + n_strx,
-					 remove_symbols, nremove_symbols,
-					 sizeof(struct symbol_list),
-					 (int (*)(const void *, const void *))
-					    symbol_list_bsearch);
+			    sp = lookup_symbol_list(&remove_symbols_hash,
+						    remove_symbols,
+						    strings + n_strx);
 			    if(sp != NULL){
 				if(sp->sym != NULL){
 				    error_arch(arch, member, "more than one "
@@ -5205,11 +5657,9 @@ uint32_t nextrefsyms)
 			     * symbol in the save list look for it and mark it
 			     * as seen so we don't complain about not seeing it.
 			     */
-			    sp = bsearch(strings + n_strx,
-					 save_symbols, nsave_symbols,
-					 sizeof(struct symbol_list),
-					 (int (*)(const void *, const void *))
-					    symbol_list_bsearch);
+			    sp = lookup_symbol_list(&save_symbols_hash,
+						    save_symbols,
+						    strings + n_strx);
 			    if(sp != NULL){
 				if(sp->sym != NULL){
 				    error_arch(arch, member, "more than one "
@@ -5227,11 +5677,8 @@ uint32_t nextrefsyms)
 			    continue; /* leave this symbol unchanged */
 			}
 		    }
-		    sp = bsearch(strings + n_strx,
-				 remove_symbols, nremove_symbols,
-				 sizeof(struct symbol_list),
-				 (int (*)(const void *, const void *))
-				    symbol_list_bsearch);
+		    sp = lookup_symbol_list(&remove_symbols_hash,
+					    remove_symbols, strings + n_strx);
 		    if(sp != NULL){
 			if(sp->sym != NULL){
 			    error_arch(arch, member, "more than one symbol "
@@ -5269,11 +5716,8 @@ uint32_t nextrefsyms)
 			    continue; /* leave this symbol unchanged */
 			}
 		    }
-		    sp = bsearch(strings + n_strx,
-				 save_symbols, nsave_symbols,
-				 sizeof(struct symbol_list),
-				 (int (*)(const void *, const void *))
-				    symbol_list_bsearch);
+		    sp = lookup_symbol_list(&save_symbols_hash, save_symbols,
+					    strings + n_strx);
 		    if(sp != NULL){
 			if(sp->sym != NULL){
 			    error_arch(arch, member, "more than one symbol "
@@ -5404,13 +5848,22 @@ change_symbol:
 	 * the key word 'static' and looking at the difference between the STABS
 	 * the compiler generates and trying to match that here.
 	 */
-	global_strings = strings;
-	if(object->mh != NULL)
-	    qsort(changed_globals, nchanged_globals, sizeof(struct nlist *),
-		  (int (*)(const void *, const void *))cmp_qsort_global);
-	else
-	    qsort(changed_globals64, nchanged_globals,sizeof(struct nlist_64 *),
-		  (int (*)(const void *, const void *))cmp_qsort_global_64);
+	name_hash_init(&globals_hash, nchanged_globals);
+	name_hash_init(&globals_stab_hash, nchanged_globals);
+	for(i = 0; i < nchanged_globals; i++){
+	    if(object->mh != NULL)
+		n_strx = changed_globals[i]->n_un.n_strx;
+	    else
+		n_strx = changed_globals64[i]->n_un.n_strx;
+	    name_hash_enter(&globals_hash, strings + n_strx);
+	    /*
+	     * The stabs for a global do not have the '_' the global symbol's
+	     * name starts with.
+	     */
+	    if(strings[n_strx] != '\0')
+		n_strx++;
+	    name_hash_enter(&globals_stab_hash, strings + n_strx);
+	}
 	dwarf_debug_map = FALSE;
 	for(i = 0; i < nsyms; i++){
 	  uint16_t n_desc;
@@ -5431,10 +5884,8 @@ change_symbol:
 	    else if (dwarf_debug_map && n_type == N_GSYM){
 	      global_name = strings + n_strx;
 	      if(object->mh != NULL){
-		global_symbol = bsearch(global_name, changed_globals,
-					nchanged_globals,sizeof(struct nlist *),
-			     		(int (*)(const void *, const void *))
-					cmp_bsearch_global);
+		index = name_hash_lookup(&globals_hash, global_name);
+		global_symbol = index == -1 ? NULL : changed_globals + index;
 		if(global_symbol != NULL){
 		  symbols[i].n_type = N_STSYM;
 		  symbols[i].n_sect = (*global_symbol)->n_sect;
@@ -5442,11 +5893,9 @@ change_symbol:
 		}
 	      }
 	      else{
-		global_symbol64 = bsearch(global_name, changed_globals64,
-					  nchanged_globals,
-					  sizeof(struct nlist_64 *),
-					  (int (*)(const void *, const void *))
-					  cmp_bsearch_global_64);
+		index = name_hash_lookup(&globals_hash, global_name);
+		global_symbol64 = index == -1 ? NULL :
+				  changed_globals64 + index;
 		if(global_symbol64 != NULL){
 		  symbols64[i].n_type = N_STSYM;
 		  symbols64[i].n_sect = (*global_symbol64)->n_sect;
@@ -5482,10 +5931,9 @@ change_symbol:
 		global_symbol_found = FALSE;
 		global_symbol_n_sect = 0;
 		if(object->mh != NULL){
-		    global_symbol = bsearch(global_name, changed_globals,
-					nchanged_globals,sizeof(struct nlist *),
-			     		(int (*)(const void *, const void *))
-					cmp_bsearch_global_stab);
+		    index = name_hash_lookup(&globals_stab_hash, global_name);
+		    global_symbol = index == -1 ? NULL :
+				    changed_globals + index;
 		    global_symbol64 = NULL;
 		    if(global_symbol != NULL){
 			global_symbol_found = TRUE;
@@ -5493,11 +5941,9 @@ change_symbol:
 		    }
 		}
 		else{
-		    global_symbol64 = bsearch(global_name, changed_globals64,
-					nchanged_globals,
-					sizeof(struct nlist_64 *),
-			     		(int (*)(const void *, const void *))
-					cmp_bsearch_global_stab_64);
+		    index = name_hash_lookup(&globals_stab_hash, global_name);
+		    global_symbol64 = index == -1 ? NULL :
+				      changed_globals64 + index;
 		    global_symbol = NULL;
 		    if(global_symbol64 != NULL){
 			global_symbol_found = TRUE;
@@ -5547,7 +5993,8 @@ change_symbol:
 		}
 	    }
 	}
-	global_strings = NULL;
+	name_hash_free(&globals_hash);
+	name_hash_free(&globals_stab_hash);
 
 	/*
 	 * Now what needs to be done is to create the new symbol table moving
@@ -6038,77 +6485,4 @@ change_symbol:
 	    return(FALSE);
 }
 
-/*
- * Function for qsort for comparing global symbol names.
- */
-static
-int
-cmp_qsort_global(
-const struct nlist **sym1,
-const struct nlist **sym2)
-{
-	return(strcmp(global_strings + (*sym1)->n_un.n_strx,
-		      global_strings + (*sym2)->n_un.n_strx));
-}
-
-static
-int
-cmp_qsort_global_64(
-const struct nlist_64 **sym1,
-const struct nlist_64 **sym2)
-{
-	return(strcmp(global_strings + (*sym1)->n_un.n_strx,
-		      global_strings + (*sym2)->n_un.n_strx));
-}
-
-/*
- * Function for bsearch for finding a global symbol that matches a stab name.
- */
-static
-int
-cmp_bsearch_global_stab(
-const char *name,
-const struct nlist **sym)
-{
-	/*
-	 * The +1 is for the '_' on the global symbol that is not on the
-	 * stab string that is trying to be matched.
-	 */
-	return(strcmp(name, global_strings + (*sym)->n_un.n_strx + 1));
-}
-
-static
-int
-cmp_bsearch_global_stab_64(
-const char *name,
-const struct nlist_64 **sym)
-{
-	/*
-	 * The +1 is for the '_' on the global symbol that is not on the
-	 * stab string that is trying to be matched.
-	 */
-	return(strcmp(name, global_strings + (*sym)->n_un.n_strx + 1));
-}
-
-/*
- * Function for bsearch for finding a global symbol that matches a stab name
- * in the debug map.
- */
-static
-int
-cmp_bsearch_global(
-const char *name,
-const struct nlist **sym)
-{
-	return(strcmp(name, global_strings + (*sym)->n_un.n_strx));
-}
-
-static
-int
-cmp_bsearch_global_64(
-const char *name,
-const struct nlist_64 **sym)
-{
-	return(strcmp(name, global_strings + (*sym)->n_un.n_strx));
-}
 #endif /* defined(NMEDIT) */
@@ -224,6 +224,7 @@
 #include "stuff/allocate.h"
 #include "stuff/errors.h"
 #include "stuff/guess_short_name.h"
+#include "stuff/outbuf.h"
 #include "dyld_bind_info.h"
 #include "ofile_print.h"
 
@@ -7957,19 +7958,24 @@ enum bool verbose)
 	    else
 		printf("\n");
 
+	    /*
+	     * There is a line for each entry so they are printed with the
+	     * outbuf routines.
+	     */
 	    for(j = 0 ; j < count && n + j < nindirect_symbols; j++){
+		outbuf_str("0x");
 		if(cputype & CPU_ARCH_ABI64)
-		    printf("0x%016llx ", sect_ind[i].addr + j * stride);
+		    outbuf_hex(sect_ind[i].addr + j * stride, 16);
 		else
-		    printf("0x%08x ",(uint32_t)
-				     (sect_ind[i].addr + j * stride));
+		    outbuf_hex((uint32_t)(sect_ind[i].addr + j * stride), 8);
+		outbuf_char(' ');
 		if(indirect_symbols[j + n] == INDIRECT_SYMBOL_LOCAL){
-		    printf("LOCAL\n");
+		    outbuf_str("LOCAL\n");
 		    continue;
 		}
 		if(indirect_symbols[j + n] ==
 		   (INDIRECT_SYMBOL_LOCAL | INDIRECT_SYMBOL_ABS)){
-		    printf("LOCAL ABSOLUTE\n");
+		    outbuf_str("LOCAL ABSOLUTE\n");
 		    continue;
 		}
 		if(indirect_symbols[j + n] == INDIRECT_SYMBOL_ABS){
@@ -7978,15 +7984,16 @@ enum bool verbose)
 		     * and for image-loader-cache slot for new lazy
 		     * symbol binding in Mac OS X 10.6 and later
 		     */ 
-		    printf("ABSOLUTE\n");
+		    outbuf_str("ABSOLUTE\n");
 		    continue;
 		}
-		printf("%5u ", indirect_symbols[j + n]);
+		outbuf_dec(indirect_symbols[j + n], 5);
+		outbuf_char(' ');
 		if(verbose){
 		    if(indirect_symbols[j + n] >= nsymbols ||
 		       (symbols == NULL && symbols64 == NULL) ||
 		       strings == NULL)
-			printf("?\n");
+			outbuf_str("?\n");
 		    else{
 			if(symbols != NULL)
 			    n_strx = symbols[indirect_symbols[j+n]].n_un.n_strx;
@@ -7994,14 +8001,17 @@ enum bool verbose)
 			    n_strx = symbols64[indirect_symbols[j+n]].
 					n_un.n_strx;
 			if(n_strx >= strings_size)
-			    printf("?\n");
-			else
-			    printf("%s\n", strings + n_strx);
+			    outbuf_str("?\n");
+			else{
+			    outbuf_str(strings + n_strx);
+			    outbuf_char('\n');
+			}
 		    }
 		}
 		else
-		    printf("\n");
+		    outbuf_char('\n');
 	    }
+	    outbuf_flush();
 	    n += count;
 	}
 }
@@ -8282,18 +8292,24 @@ enum bool print_addresses)
 	for(i = 0; i < sect_size ; i++){
 	    if(print_addresses == TRUE){
 	        if(cputype & CPU_ARCH_ABI64)
-		    printf("%016llx  ", sect_addr + i);
+		    outbuf_hex(sect_addr + i, 16);
 		else
-		    printf("%08x  ", (unsigned int)(sect_addr + i));
+		    outbuf_hex((uint32_t)(sect_addr + i), 8);
+		outbuf_str("  ");
 	    }
 
 	    for( ; i < sect_size && sect[i] != '\0'; i++)
 		print_cstring_char(sect[i]);
 	    if(i < sect_size && sect[i] == '\0')
-		printf("\n");
+		outbuf_char('\n');
 	}
+	outbuf_flush();
 }
 
+/*
+ * print_cstring_char() prints the character c with the outbuf routines so
+ * callers must call outbuf_flush() before printing anything else to stdout.
+ */
 static
 void
 print_cstring_char(
@@ -8301,35 +8317,36 @@ char c)
 {
 	if(isprint(c)){
 	    if(c == '\\')	/* backslash */
-		printf("\\\\");
+		outbuf_str("\\\\");
 	    else		/* all other printable characters */
-		printf("%c", c);
+		outbuf_char(c);
 	}
 	else{
 	    switch(c){
 	    case '\n':		/* newline */
-		printf("\\n");
+		outbuf_str("\\n");
 		break;
 	    case '\t':		/* tab */
-		printf("\\t");
+		outbuf_str("\\t");
 		break;
 	    case '\v':		/* vertical tab */
-		printf("\\v");
+		outbuf_str("\\v");
 		break;
 	    case '\b':		/* backspace */
-		printf("\\b");
+		outbuf_str("\\b");
 		break;
 	    case '\r':		/* carriage return */
-		printf("\\r");
+		outbuf_str("\\r");
 		break;
 	    case '\f':		/* formfeed */
-		printf("\\f");
+		outbuf_str("\\f");
 		break;
 	    case '\a':		/* audiable alert */
-		printf("\\a");
+		outbuf_str("\\a");
 		break;
 	    default:
-		printf("\\%03o", (unsigned int)c);
+		outbuf_char('\\');
+		outbuf_oct((unsigned int)c, 3);
 	    }
 	}
 }
@@ -8805,6 +8822,7 @@ enum bool print_addresses)
 					literal_sections[j].contents[k] != '\0';
 			    k++)
 			    print_cstring_char(literal_sections[j].contents[k]);
+			outbuf_flush();
 			printf("\n");
 			break;
 		    case S_4BYTE_LITERALS:
@@ -9394,38 +9412,43 @@ uint64_t addr)
 	   cputype == CPU_TYPE_X86_64){
 	    for(i = 0 ; i < size ; i += j , addr += j){
 		if(cputype & CPU_ARCH_ABI64)
-		    printf("%016llx\t", addr);
+		    outbuf_hex(addr, 16);
 		else
-		    printf("%08x\t", (uint32_t)addr);
+		    outbuf_hex((uint32_t)addr, 8);
+		outbuf_char('\t');
 		for(j = 0;
 		    j < 16 * sizeof(char) && i + j < size;
 		    j += sizeof(char)){
 		    byte_word = *(sect + i + j);
-		    printf("%02x ", (unsigned int)byte_word);
+		    outbuf_hex(byte_word, 2);
+		    outbuf_char(' ');
 		}
-		printf("\n");
+		outbuf_char('\n');
 	    }
 	}
 	else if(cputype == CPU_TYPE_MC680x0){
 	    for(i = 0 ; i < size ; i += j , addr += j){
-		printf("%08x ", (unsigned int)addr);
+		outbuf_hex((uint32_t)addr, 8);
+		outbuf_char(' ');
 		for(j = 0;
 		    j < 8 * sizeof(short) && i + j < size;
 		    j += sizeof(short)){
 		    memcpy(&short_word, sect + i + j, sizeof(short));
 		    if(swapped)
 			short_word = SWAP_SHORT(short_word);
-		    printf("%04x ", (unsigned int)short_word);
+		    outbuf_hex(short_word, 4);
+		    outbuf_char(' ');
 		}
-		printf("\n");
+		outbuf_char('\n');
 	    }
 	}
 	else{
 	    for(i = 0 ; i < size ; i += j , addr += j){
 		if(cputype & CPU_ARCH_ABI64)
-		    printf("%016llx\t", addr);
+		    outbuf_hex(addr, 16);
 		else
-		    printf("%08x\t", (uint32_t)addr);
+		    outbuf_hex((uint32_t)addr, 8);
+		outbuf_char('\t');
 		for(j = 0;
 		    j < 4 * sizeof(int32_t) && i + j < size;
 		    j += sizeof(int32_t)){
@@ -9433,18 +9456,21 @@ uint64_t addr)
 			memcpy(&long_word, sect + i + j, sizeof(int32_t));
 			if(swapped)
 			    long_word = SWAP_INT(long_word);
-			printf("%08x ", (unsigned int)long_word);
+			outbuf_hex(long_word, 8);
+			outbuf_char(' ');
 		    }
 		    else{
 			for(k = 0; i + j + k < size; k++){
 			    byte_word = *(sect + i + j + k);
-			    printf("%02x ", (unsigned int)byte_word);
+			    outbuf_hex(byte_word, 2);
+			    outbuf_char(' ');
 			}
 		    }
 		}
-		printf("\n");
+		outbuf_char('\n');
 	    }
 	}
+	outbuf_flush();
 }
 
 /*